@@ -0,0 +1,183 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file capture.h
+ * @brief Framing of capture files of concatenated messages
+ */
+
+#if !defined (LIBHTTPMESSAGGE_CAPTURE_H__)
+#define LIBHTTPMESSAGGE_CAPTURE_H__
+
+#include "httpmessage/message.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+/**
+ * @ingroup capture
+ *
+ * @brief Location of a message in a capture
+ */
+typedef struct __httpmessage_capture_frame
+{
+	/** Message offset in the capture text */
+	size_t offset;
+	/** Message length */
+	size_t length;
+	/** Message type. ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE */
+	int type;
+	
+	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+} httpmessage_capture_frame;
+
+/**
+ * @ingroup capture
+ *
+ * @brief Messages starting in a range of a capture text
+ *
+ * A capture text is a sequence of concatenated requests and responses.
+ * It is split in contiguous ranges framed independently, for example by
+ * several threads. Each range is framed from the first plausible message start
+ * (see httpmessage_capture_synchronize()), which may be wrong when a message body
+ * looks like a message. httpmessage_capture_stitch() then verifies range boundaries
+ * so the result is the same as a sequential parse of the whole capture.
+ *
+ * Ranges do not share any data except the read-only capture text.
+ */
+typedef struct __httpmessage_capture_range
+{
+	/** Capture text */
+	const char *text;
+	/** Capture text length */
+	size_t length;
+	/** Range start offset in the capture text */
+	size_t begin;
+	/** Range end offset in the capture text */
+	size_t end;
+	/** Frames of the messages starting in the range, in order */
+	httpmessage_capture_frame *frames;
+	/** Number of frames */
+	size_t frame_count;
+	/** Number of allocated frames */
+	size_t frame_capacity;
+	/** Offset of the end of the last frame, or of the message that could not be parsed */
+	size_t stop;
+	/** Framing result. ::HTTPMESSAGE_OK or the error of the message at @c stop */
+	ssize_t result;
+	/** Request storage */
+	httpmessage_request *request;
+	/** Response storage */
+	httpmessage_response *response;
+	/** Option flags given to the message consume functions */
+	int option_flags;
+	
+	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+} httpmessage_capture_range;
+
+/**
+ * @ingroup capture
+ *
+ * @brief Find the first plausible message start
+ *
+ * A message starts at the beginning of the capture or after a CRLF,
+ * with a valid request line or status line.
+ *
+ * @param text Capture text
+ * @param length Capture text length
+ * @param offset Search start offset
+ *
+ * @return Offset of the first plausible message start at or after @c offset.
+ * @c length if there is none.
+ */
+HMAPI size_t httpmessage_capture_synchronize(
+    const char *text, size_t length,
+    size_t offset);
+
+/**
+ * @ingroup capture
+ *
+ * @brief Initialize a capture range
+ *
+ * @param range Range to initialize
+ * @param text Capture text
+ * @param length Capture text length
+ * @param begin Range start offset
+ * @param end Range end offset
+ * @param max_headerfield_count Number of pre-allocated header fields of the message storage
+ * @param option_flags Option flags given to the message consume functions. Supported flags are
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ *
+ * @return ::HTTPMESSAGE_OK on success.
+ * ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if the range is not in the capture text.
+ * ::HTTPMESSAGE_ERROR_ALLOCATION if the message storage cannot be allocated.
+ */
+HMAPI int httpmessage_capture_range_init(
+    httpmessage_capture_range *range,
+    const char *text, size_t length,
+    size_t begin, size_t end,
+    size_t max_headerfield_count,
+    int option_flags);
+
+/**
+ * @ingroup capture
+ *
+ * @brief Release the range frames and message storage
+ *
+ * Messages are released with httpmessage_request_storage_free() and
+ * httpmessage_response_storage_free(), including the memory they kept for reuse.
+ *
+ * @param range Range
+ */
+HMAPI void httpmessage_capture_range_clear(httpmessage_capture_range *range);
+
+/**
+ * @ingroup capture
+ *
+ * @brief Frame the messages starting in the range
+ *
+ * Messages are parsed from the first plausible message start of the range
+ * until a message starts after the end of the range. The last message may end
+ * after the end of the range.
+ *
+ * @param range Range
+ *
+ * @return The number of frames. On error, one of httpmessage_result_code.
+ * A parse error is not an error of this function. It is stored in httpmessage_capture_range::result.
+ */
+HMAPI ssize_t httpmessage_capture_range_frame(httpmessage_capture_range *range);
+
+/**
+ * @ingroup capture
+ *
+ * @brief Verify range boundaries
+ *
+ * Frames of each range are checked in order against the end of the last frame
+ * of the previous range. Frames starting before are dropped. A range that
+ * does not have a frame starting there is framed again from this offset.
+ * Ranges after a parse error do not have any frame.
+ *
+ * After this call, the concatenation of range frames is the result of a sequential
+ * parse of the whole capture.
+ *
+ * @param ranges Contiguous ranges covering the whole capture, framed by
+ * httpmessage_capture_range_frame()
+ * @param range_count Number of ranges
+ *
+ * @return The total number of frames. On error, one of httpmessage_result_code.
+ * A parse error is not an error of this function. It is stored in the
+ * httpmessage_capture_range::result of the range where the parse stopped.
+ */
+HMAPI ssize_t httpmessage_capture_stitch(
+    httpmessage_capture_range *ranges,
+    size_t range_count);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_CAPTURE_H__ */
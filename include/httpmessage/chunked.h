@@ -0,0 +1,354 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file chunked.h
+ * @brief Chunked transfer coding
+ */
+
+#if !defined (LIBHTTPMESSAGGE_CHUNKED_H__)
+#define LIBHTTPMESSAGGE_CHUNKED_H__
+
+#include "httpmessage/text.h"
+#include "httpmessage/header.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Chunked body decoder states
+ */
+enum httpmessage_chunked_state
+{
+	/** Waiting for the first digit of a chunk size */
+	HTTPMESSAGE_CHUNKED_SIZE = 0,
+	/** Reading chunk size digits */
+	HTTPMESSAGE_CHUNKED_SIZE_DIGITS,
+	/** Reading white spaces before a chunk extension */
+	HTTPMESSAGE_CHUNKED_EXTENSION,
+	/** Waiting for the first character of a chunk extension name */
+	HTTPMESSAGE_CHUNKED_EXTENSION_NAME_START,
+	/** Reading a chunk extension name */
+	HTTPMESSAGE_CHUNKED_EXTENSION_NAME,
+	/** Waiting for the first character of a chunk extension value */
+	HTTPMESSAGE_CHUNKED_EXTENSION_VALUE_START,
+	/** Reading a chunk extension token value */
+	HTTPMESSAGE_CHUNKED_EXTENSION_VALUE,
+	/** Reading a chunk extension quoted-string value */
+	HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED,
+	/** Waiting for the character escaped in a chunk extension quoted-string value */
+	HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED_PAIR,
+	/** Waiting for another chunk extension or the end of the chunk size line */
+	HTTPMESSAGE_CHUNKED_EXTENSION_END,
+	/** Waiting for the LF ending the chunk size line */
+	HTTPMESSAGE_CHUNKED_SIZE_LF,
+	/** Reading chunk data */
+	HTTPMESSAGE_CHUNKED_DATA,
+	/** Waiting for the CR following chunk data */
+	HTTPMESSAGE_CHUNKED_DATA_CR,
+	/** Waiting for the LF following chunk data */
+	HTTPMESSAGE_CHUNKED_DATA_LF,
+	/** Waiting for a trailer field line or the empty line ending the body */
+	HTTPMESSAGE_CHUNKED_TRAILER,
+	/** Reading a trailer field line */
+	HTTPMESSAGE_CHUNKED_TRAILER_LINE,
+	/** Waiting for the LF ending a trailer field line */
+	HTTPMESSAGE_CHUNKED_TRAILER_LINE_LF,
+	/** Waiting for the LF of the empty line ending the body */
+	HTTPMESSAGE_CHUNKED_TRAILER_END_LF,
+	/** The chunked body is complete */
+	HTTPMESSAGE_CHUNKED_COMPLETE,
+	/** An error occurred. See httpmessage_chunked_decoder::error */
+	HTTPMESSAGE_CHUNKED_ERROR
+};
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Resumable chunked body decoder
+ *
+ * The decoder processes any input split, byte per byte if needed.
+ * Each call consumes input until a chunk data view is available,
+ * the input is exhausted or the body is complete.
+ *
+ * Chunk extensions must follow the grammar
+ * <code>chunk-ext = *( BWS ";" BWS token [ "=" ( token / quoted-string ) ] )</code>
+ * and the chunk size line must end with CRLF.
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-4.1
+ */
+typedef struct __httpmessage_chunked_decoder
+{
+	/** Remaining bytes of the current chunk size or data */
+	size_t chunk_length;
+	
+	/** Number of decoded body bytes */
+	size_t body_length;
+	
+	/** Length of the trailer section, excluding the empty line ending the body */
+	size_t trailer_length;
+	
+	/**
+	 * @brief Trailer section
+	 *
+	 * Field lines following the last chunk, including their CRLF.
+	 * Only set if the whole trailer section was part of the input of a single call.
+	 */
+	httpmessage_stringview trailer;
+	
+	/** Decoder state. One of ::httpmessage_chunked_state */
+	int state;
+	
+	/** Result code of the error in the ::HTTPMESSAGE_CHUNKED_ERROR state */
+	int error;
+} httpmessage_chunked_decoder;
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Initialize a chunked body decoder
+ *
+ * @param decoder Decoder to initialize
+ */
+HMAPI void httpmessage_chunked_decoder_init(httpmessage_chunked_decoder *decoder);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Decode chunked body bytes without copying chunk data
+ *
+ * @param decoder Decoder
+ * @param data Output chunk data view. Refers to the input text.
+ * Empty if no chunk data was consumed.
+ * @param text Input text, following the bytes given to the previous call
+ * @param length Input text length
+ *
+ * @return On success, the number of bytes of @c text consumed. All bytes are consumed
+ * unless a chunk data view is available or the body is complete.
+ * On error, one of httpmessage_result_code. Errors are persistent.
+ */
+HMAPI ssize_t httpmessage_chunked_decoder_consume(
+    httpmessage_chunked_decoder *decoder,
+    httpmessage_stringview *data,
+    const char *text, size_t length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Decode chunked body bytes in place
+ *
+ * Chunk data is moved to the beginning of @c text, over the chunk size lines.
+ * The trailer section is not moved.
+ *
+ * @param decoder Decoder
+ * @param text Writable input text, following the bytes given to the previous call
+ * @param length Input: input text length. Output: number of decoded bytes
+ * at the beginning of @c text.
+ *
+ * @return The number of input bytes following the chunked body, which are left
+ * at the end of the input text.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the chunked body is not complete.
+ * All input bytes were consumed.
+ * On error, one of httpmessage_result_code.
+ */
+HMAPI ssize_t httpmessage_chunked_decode(
+    httpmessage_chunked_decoder *decoder,
+    char *text, size_t *length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Size of the chunk size line storage of a chunked encoder
+ */
+#define HTTPMESSAGE_CHUNK_SIZE_LINE_SIZE 20
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Maximum number of vectors produced by a chunked encoder function
+ */
+#define HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT 6
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Chunked body encoder
+ *
+ * The encoder frames body fragments written after the message header.
+ * The chunk framing is given as a list of string views (I/O vectors) referring
+ * to the body fragment, to the encoder coalescing buffer and to static text,
+ * suitable for a @c writev() like function. Body fragments are not copied,
+ * unless they are small enough to be coalesced.
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-4.1
+ */
+typedef struct __httpmessage_chunked_encoder
+{
+	/** Coalescing buffer. May be NULL */
+	char *buffer;
+	
+	/**
+	 * @brief Coalescing buffer size
+	 *
+	 * Body fragments are kept in the buffer until the pending data
+	 * reaches this size.
+	 */
+	size_t buffer_size;
+	
+	/** Number of pending body bytes in the coalescing buffer */
+	size_t buffer_length;
+	
+	/** Number of body bytes written in chunks */
+	size_t body_length;
+	
+	/** Chunk size line storage */
+	char size_line[HTTPMESSAGE_CHUNK_SIZE_LINE_SIZE];
+	
+	/** Non-zero once the last chunk was written */
+	int complete;
+} httpmessage_chunked_encoder;
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Initialize a chunked body encoder
+ *
+ * @param encoder Encoder to initialize
+ * @param buffer Coalescing buffer. If @c NULL, each body fragment is written in its own chunk.
+ * @param buffer_size Coalescing buffer size. Body fragments are coalesced
+ * until the pending data reaches this size.
+ */
+HMAPI void httpmessage_chunked_encoder_init(
+    httpmessage_chunked_encoder *encoder,
+    char *buffer, size_t buffer_size);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Write a body fragment
+ *
+ * @param encoder Encoder
+ * @param vectors Output vectors. Must have room for ::HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT
+ * elements. Output vectors are valid until the next call on the encoder.
+ * @param text Body fragment
+ * @param length Body fragment length
+ *
+ * @return On success, the number of output vectors, or 0 if the fragment was
+ * kept in the coalescing buffer.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_chunked_encoder_write(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors,
+    const char *text, size_t length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Write the body bytes pending in the coalescing buffer as a chunk
+ *
+ * @param encoder Encoder
+ * @param vectors Output vectors. Must have room for ::HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT
+ * elements. Output vectors are valid until the next call on the encoder.
+ *
+ * @return On success, the number of output vectors, 0 if no body bytes were pending.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_chunked_encoder_flush(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Write the pending body bytes, the last chunk and the trailer section
+ *
+ * @param encoder Encoder
+ * @param vectors Output vectors. Must have room for ::HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT
+ * elements. Output vectors are valid until the next call on the encoder.
+ * @param trailer Trailer section text. Field lines including their CRLF. May be NULL.
+ * @param trailer_length Trailer section text length
+ *
+ * @return On success, the number of output vectors.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_chunked_encoder_finish(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors,
+    const char *trailer, size_t trailer_length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Write a body fragment to a file
+ *
+ * @param encoder Encoder
+ * @param file Output file
+ * @param text Body fragment
+ * @param length Body fragment length
+ *
+ * @return On success, the number of bytes written.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_chunked_encoder_write_file(
+    httpmessage_chunked_encoder *encoder,
+    FILE *file,
+    const char *text, size_t length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Write the pending body bytes, the last chunk and the trailer fields to a file
+ *
+ * @param encoder Encoder
+ * @param file Output file
+ * @param trailer Trailer field list. May be NULL.
+ *
+ * @return On success, the number of bytes written.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_chunked_encoder_finish_file(
+    httpmessage_chunked_encoder *encoder,
+    FILE *file,
+    const httpmessage_headerfield *trailer);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Read a chunk size from its hexadecimal text representation
+ *
+ * @param output Output value. On error, the value is undefined.
+ * @param text Input text
+ * @param length Input text length
+ *
+ * @return On success, the number of bytes consumed in text.
+ * ::HTTPMESSAGE_ERROR_OVERFLOW if the value does not fit in a @c size_t.
+ * On error, one of httpmessage_result_code.
+ */
+HMAPI ssize_t httpmessage_chunk_size_consume(
+    size_t *output,
+    const char *text, size_t length);
+
+/**
+ * @ingroup chunked
+ *
+ * @brief Indicate if the last transfer coding of a Transfer-Encoding value is @c chunked
+ *
+ * @param text Transfer-Encoding header field value
+ * @param length Value length
+ *
+ * @return Non-zero if the last transfer coding is @c chunked
+ */
+HMAPI int httpmessage_transfer_coding_is_chunked(
+    const char *text, size_t length);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_CHUNKED_H__ */
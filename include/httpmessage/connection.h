@@ -0,0 +1,176 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file connection.h
+ * @brief Persistent connection request reader
+ */
+
+#if !defined (LIBHTTPMESSAGGE_CONNECTION_H__)
+#define LIBHTTPMESSAGGE_CONNECTION_H__
+
+#include "httpmessage/parser.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+/**
+ * @ingroup connection
+ *
+ * @brief Requests received on a persistent connection
+ *
+ * The connection owns an input buffer and a request with pre-allocated storage.
+ * Requests are parsed incrementally as input is received. Pipelined requests
+ * are parsed from the input remaining after the previous one.
+ *
+ * Request elements are string views on the input buffer. They remain valid
+ * until the request is released. The input buffer is compacted or enlarged
+ * only when no request is held.
+ */
+typedef struct __httpmessage_connection
+{
+	/** Input buffer */
+	char *buffer;
+	
+	/** Input buffer size */
+	size_t buffer_size;
+	
+	/** Maximum input buffer size. A request cannot be larger. */
+	size_t max_buffer_size;
+	
+	/** Number of input bytes in the buffer */
+	size_t length;
+	
+	/** Offset of the current request in the input buffer */
+	size_t offset;
+	
+	/** Size of the request held by the caller. 0 if no request is held. */
+	size_t message_size;
+	
+	/** Number of released requests */
+	size_t request_count;
+	
+	/** Request storage, reused by each request */
+	httpmessage_request *request;
+	
+	/** Incremental parser of the current request */
+	httpmessage_parser parser;
+	
+	/** Option flags given to the parser */
+	int option_flags;
+	
+	/** Non-zero once the end of the input was reached */
+	int closed;
+	
+	/** Non-zero while the connection persists after the current request */
+	int keep_alive;
+	
+	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+} httpmessage_connection;
+
+/**
+ * @ingroup connection
+ *
+ * @brief Initialize a connection
+ *
+ * @param connection Connection to initialize
+ * @param buffer_size Initial input buffer size
+ * @param max_buffer_size Maximum input buffer size. The buffer grows until
+ * a whole request fits in it.
+ * @param max_headerfield_count Number of pre-allocated header fields of the request storage
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ *
+ * @return ::HTTPMESSAGE_OK on success.
+ * ::HTTPMESSAGE_ERROR_ALLOCATION if the input buffer or the request storage
+ * cannot be allocated.
+ */
+HMAPI int httpmessage_connection_init(
+    httpmessage_connection *connection,
+    size_t buffer_size, size_t max_buffer_size,
+    size_t max_headerfield_count,
+    int option_flags);
+
+/**
+ * @ingroup connection
+ *
+ * @brief Release the connection input buffer and request storage
+ *
+ * The request is released with httpmessage_request_storage_free(), including
+ * the memory it kept for reuse while the connection cleared it with ::HTTPMESSAGE_CLEAR_NO_FREE.
+ *
+ * @param connection Connection
+ */
+HMAPI void httpmessage_connection_clear(httpmessage_connection *connection);
+
+/**
+ * @ingroup connection
+ *
+ * @brief Read available input from a caller-supplied input function
+ *
+ * Performs a single call of @c input. The input function reads at most @c size bytes
+ * into @c buffer and returns the number of bytes read, 0 at the end of the input
+ * or a negative value on error. For example, a POSIX socket reader is
+ * @code
+ * static ssize_t socket_input(void *user_data, char *buffer, size_t size)
+ * {
+ * 	return read(*(int *)user_data, buffer, size);
+ * }
+ * @endcode
+ *
+ * @param connection Connection
+ * @param input Input function
+ * @param user_data User data given to the input function (ex. a socket)
+ *
+ * @return The number of bytes read. 0 at the end of the input.
+ * ::HTTPMESSAGE_ERROR_OVERFLOW if the input buffer is full.
+ * ::HTTPMESSAGE_ERROR_READ if the input function failed.
+ * On error, one of httpmessage_result_code.
+ */
+HMAPI ssize_t httpmessage_connection_read(
+    httpmessage_connection *connection,
+    ssize_t (*input)(void *user_data, char *buffer, size_t size),
+    void *user_data);
+
+/**
+ * @ingroup connection
+ *
+ * @brief Get the next complete request
+ *
+ * The request must be released with httpmessage_connection_release()
+ * before reading the next one.
+ *
+ * @param connection Connection
+ * @param request Output request. Set on success.
+ *
+ * @return On success, the request size.
+ * 0 if there is no more request: the input ended between two requests
+ * or the previous request did not keep the connection alive.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if more input is required.
+ * ::HTTPMESSAGE_ERROR_TRUNCATED if the input ended inside a request.
+ * On error, one of httpmessage_result_code.
+ */
+HMAPI ssize_t httpmessage_connection_next_request(
+    httpmessage_connection *connection,
+    httpmessage_request **request);
+
+/**
+ * @ingroup connection
+ *
+ * @brief Release the request obtained with httpmessage_connection_next_request()
+ *
+ * The request storage is cleared and the parser is ready for the next request.
+ *
+ * @param connection Connection
+ */
+HMAPI void httpmessage_connection_release(httpmessage_connection *connection);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_CONNECTION_H__ */
@@ -0,0 +1,436 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file copy.h
+ * @brief Message copies
+ */
+
+#if !defined (LIBHTTPMESSAGGE_COPY_H__)
+#define LIBHTTPMESSAGGE_COPY_H__
+
+#include "httpmessage/message.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+#include <stdint.h>
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get the size of the memory block allocated by httpmessage_request_clone_compact()
+ *
+ * @param request Request to clone
+ * @param option_flags Option flags. See httpmessage_request_clone_compact()
+ *
+ * @return Memory block size
+ */
+HMAPI size_t httpmessage_request_clone_compact_size(
+    const httpmessage_request *request,
+    int option_flags);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Deep copy of a request in a single memory block
+ *
+ * The request, its header fields, its trailer fields, its value lines and the text
+ * referenced by all string views (method, request URI, header field names and values, body)
+ * are copied in a single memory block of the exact required size.
+ * Trailer fields are merged in the header field list of the copy if they are in the original.
+ * All string views of the copy reference the text stored in the block.
+ * The copy does not reference the original input text anymore.
+ *
+ * Header fields and value lines of the copy are stored as pre-allocated storage
+ * (See httpmessage_request_storage_new()).
+ *
+ * @param request Request to clone
+ * @param option_flags Option flags. ::HTTPMESSAGE_CLONE_NO_BODY to exclude the message body.
+ *
+ * @return The request copy or @c NULL on error.
+ *
+ * @attention Use httpmessage_request_storage_free() to release the copy.
+ */
+HMAPI httpmessage_request *httpmessage_request_clone_compact(
+    const httpmessage_request *request,
+    int option_flags);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get the size of the memory block allocated by httpmessage_response_clone_compact()
+ *
+ * @param response Response to clone
+ * @param option_flags Option flags. See httpmessage_response_clone_compact()
+ *
+ * @return Memory block size
+ */
+HMAPI size_t httpmessage_response_clone_compact_size(
+    const httpmessage_response *response,
+    int option_flags);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Deep copy of a response in a single memory block
+ *
+ * Same as httpmessage_request_clone_compact() for responses.
+ * The reason phrase is copied instead of the method and request URI.
+ *
+ * @param response Response to clone
+ * @param option_flags Option flags. ::HTTPMESSAGE_CLONE_NO_BODY to exclude the message body.
+ *
+ * @return The response copy or @c NULL on error.
+ *
+ * @attention Use httpmessage_response_storage_free() to release the copy.
+ */
+HMAPI httpmessage_response *httpmessage_response_clone_compact(
+    const httpmessage_response *response,
+    int option_flags);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Move message string views from a text range to another.
+ *
+ * Each string view (header and trailer field names, value lines and body) starting in
+ * [ @c old_text, @c old_text + @c length [ is moved to the same position relative to @c new_text.
+ * Other string views are not modified.
+ *
+ * Use this function after moving the input text of a message
+ * (ex. input buffer compaction) instead of parsing the text again.
+ * To shift all views by a given offset, use the text range of the whole input buffer
+ * and <tt>new_text = old_text + offset</tt>.
+ *
+ * @param message Message
+ * @param old_text Previous location of the text
+ * @param length Text length
+ * @param new_text New location of the text
+ *
+ * @return Number of moved string views
+ */
+HMAPI size_t httpmessage_message_rebase(
+    httpmessage_message *message,
+    const char *old_text, size_t length,
+    const char *new_text);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Move request string views from a text range to another.
+ *
+ * Same as httpmessage_message_rebase(). The method and the request URI are moved too.
+ *
+ * @param request Request
+ * @param old_text Previous location of the text
+ * @param length Text length
+ * @param new_text New location of the text
+ *
+ * @return Number of moved string views
+ */
+HMAPI size_t httpmessage_request_rebase(
+    httpmessage_request *request,
+    const char *old_text, size_t length,
+    const char *new_text);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Move response string views from a text range to another.
+ *
+ * Same as httpmessage_message_rebase(). The reason phrase is moved too.
+ *
+ * @param response Response
+ * @param old_text Previous location of the text
+ * @param length Text length
+ * @param new_text New location of the text
+ *
+ * @return Number of moved string views
+ */
+HMAPI size_t httpmessage_response_rebase(
+    httpmessage_response *response,
+    const char *old_text, size_t length,
+    const char *new_text);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Serialized message signature
+ */
+#define HTTPMESSAGE_SERIALIZED_SIGNATURE 0x4D534848 /* "HHSM" */
+
+/**
+ * @ingroup copy
+ *
+ * @brief Position-independent string view
+ */
+typedef struct __httpmessage_serialized_stringview
+{
+	/** Offset of the first character, relative to the message text */
+	uint32_t offset;
+	/** Number of characters */
+	uint32_t length;
+} httpmessage_serialized_stringview;
+
+/**
+ * @ingroup copy
+ *
+ * @brief Serialized header field
+ */
+typedef struct __httpmessage_serialized_headerfield
+{
+	/** Header field name */
+	httpmessage_serialized_stringview name;
+	/** Index of the first value line in the line table */
+	uint32_t first_line;
+	/** Number of value lines */
+	uint32_t line_count;
+} httpmessage_serialized_headerfield;
+
+/**
+ * @ingroup copy
+ *
+ * @brief Serialized message descriptor
+ *
+ * A position-independent description of a parsed message where all string views
+ * are stored as offsets relative to the message text.
+ * The descriptor and the text can be copied or shared between processes
+ * (ex. in a shared memory slot) and accessed without parsing the text again.
+ *
+ * The descriptor header is followed by the header field table
+ * (@c headerfield_count ::httpmessage_serialized_headerfield)
+ * and the value line table (@c line_count ::httpmessage_serialized_stringview).
+ * The last @c trailer_count entries of the header field table are the trailer fields
+ * (see httpmessage_message::trailer_list).
+ */
+typedef struct __httpmessage_serialized_message
+{
+	/** ::HTTPMESSAGE_SERIALIZED_SIGNATURE */
+	uint32_t signature;
+	/** Descriptor size, including header field and value line tables */
+	uint32_t size;
+	/** Message type. ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE */
+	int32_t type;
+	/** HTTP protocol major version */
+	int32_t major_version;
+	/** HTTP protocol minor version */
+	int32_t minor_version;
+	/** Response status code. 0 for requests */
+	int32_t status_code;
+	/** Length of the text referenced by the message */
+	uint32_t text_length;
+	/** Number of header fields, including trailer fields */
+	uint32_t headerfield_count;
+	/** Number of trailer fields */
+	uint32_t trailer_count;
+	/** Non-zero if trailer fields are merged in the header field list */
+	int32_t trailer_merged;
+	/** Total number of value lines */
+	uint32_t line_count;
+	/** Request method */
+	httpmessage_serialized_stringview method;
+	/** Request URI */
+	httpmessage_serialized_stringview request_uri;
+	/** Response reason phrase */
+	httpmessage_serialized_stringview reason_phrase;
+	/** Message body */
+	httpmessage_serialized_stringview body;
+} httpmessage_serialized_message;
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get the size of the serialized descriptor of a request
+ *
+ * @param request Request
+ * @return Descriptor size in bytes
+ */
+HMAPI size_t httpmessage_request_serialized_size(const httpmessage_request *request);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Write the position-independent descriptor of a request
+ *
+ * @param output Output buffer. Should be aligned on 4 bytes.
+ * @param output_size Output buffer size
+ * @param request Request parsed from @c text
+ * @param text Message text
+ * @param text_length Message text length
+ *
+ * @return On success, the number of bytes written.
+ * ::HTTPMESSAGE_ERROR_OVERFLOW if @c output is too small.
+ * ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if a string view of the request is not part of @c text.
+ */
+HMAPI ssize_t httpmessage_request_serialize(
+    void *output, size_t output_size,
+    const httpmessage_request *request,
+    const char *text, size_t text_length);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get the size of the serialized descriptor of a response
+ *
+ * @param response Response
+ * @return Descriptor size in bytes
+ */
+HMAPI size_t httpmessage_response_serialized_size(const httpmessage_response *response);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Write the position-independent descriptor of a response
+ *
+ * @param output Output buffer. Should be aligned on 4 bytes.
+ * @param output_size Output buffer size
+ * @param response Response parsed from @c text
+ * @param text Message text
+ * @param text_length Message text length
+ *
+ * @return On success, the number of bytes written.
+ * ::HTTPMESSAGE_ERROR_OVERFLOW if @c output is too small.
+ * ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if a string view of the response is not part of @c text.
+ */
+HMAPI ssize_t httpmessage_response_serialize(
+    void *output, size_t output_size,
+    const httpmessage_response *response,
+    const char *text, size_t text_length);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Zero-copy access to a serialized message
+ */
+typedef struct __httpmessage_serialized_view
+{
+	/** Message descriptor */
+	const httpmessage_serialized_message *message;
+	/** Header field table */
+	const httpmessage_serialized_headerfield *headerfields;
+	/** Value line table */
+	const httpmessage_serialized_stringview *lines;
+	/** Message text */
+	const char *text;
+} httpmessage_serialized_view;
+
+/**
+ * @ingroup copy
+ *
+ * @brief Initialize a view on a serialized message
+ *
+ * The descriptor is validated. All offsets are checked against the text length.
+ *
+ * @param view View to initialize
+ * @param descriptor Descriptor written by httpmessage_request_serialize() or httpmessage_response_serialize()
+ * @param descriptor_size Size of the memory area containing the descriptor
+ * @param text Message text in the address space of the caller
+ * @param text_length Message text length
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if the descriptor is invalid.
+ */
+HMAPI int httpmessage_serialized_view_init(
+    httpmessage_serialized_view *view,
+    const void *descriptor, size_t descriptor_size,
+    const char *text, size_t text_length);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get a string view from a serialized string view
+ *
+ * @param string Output string view pointing to the view text
+ * @param view Serialized message view
+ * @param serialized Serialized string view of the message
+ */
+HMAPI void httpmessage_serialized_view_get_string(
+    httpmessage_stringview *string,
+    const httpmessage_serialized_view *view,
+    const httpmessage_serialized_stringview *serialized);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Find a header field by name
+ *
+ * Trailer fields are searched only if they are merged in the header field list.
+ *
+ * @param view Serialized message view
+ * @param name Header field name (case insensitive)
+ * @param name_length Header field name length
+ *
+ * @return The first header field with the given name or @c NULL if not found
+ */
+HMAPI const httpmessage_serialized_headerfield *httpmessage_serialized_view_find_headerfield(
+    const httpmessage_serialized_view *view,
+    const char *name, size_t name_length);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Get a header field value line
+ *
+ * @param line Output string view pointing to the view text
+ * @param view Serialized message view
+ * @param field Header field of the view
+ * @param index Line index
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if @c index is out of range
+ */
+HMAPI int httpmessage_serialized_view_get_value_line(
+    httpmessage_stringview *line,
+    const httpmessage_serialized_view *view,
+    const httpmessage_serialized_headerfield *field,
+    size_t index);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Build a request from a serialized message view without parsing
+ *
+ * String views of the request point to the view text.
+ * Header fields and value lines are allocated with the message allocator
+ * or taken from the pre-allocated storage of the request.
+ * Trailer fields are restored in httpmessage_message::trailer_list,
+ * merged in the header field list if they were in the serialized request.
+ *
+ * @param request Request. The request is cleared first.
+ * @param view Serialized request view
+ * @param option_flags Option flags. ::HTTPMESSAGE_NO_ALLOCATION is honored.
+ *
+ * @return ::HTTPMESSAGE_OK, ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if the view is not a request
+ * or ::HTTPMESSAGE_ERROR_ALLOCATION
+ */
+HMAPI int httpmessage_request_deserialize(
+    httpmessage_request *request,
+    const httpmessage_serialized_view *view,
+    int option_flags);
+
+/**
+ * @ingroup copy
+ *
+ * @brief Build a response from a serialized message view without parsing
+ *
+ * Same as httpmessage_request_deserialize() for responses.
+ *
+ * @param response Response. The response is cleared first.
+ * @param view Serialized response view
+ * @param option_flags Option flags. ::HTTPMESSAGE_NO_ALLOCATION is honored.
+ *
+ * @return ::HTTPMESSAGE_OK, ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT if the view is not a response
+ * or ::HTTPMESSAGE_ERROR_ALLOCATION
+ */
+HMAPI int httpmessage_response_deserialize(
+    httpmessage_response *response,
+    const httpmessage_serialized_view *view,
+    int option_flags);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_COPY_H__ */
@@ -275,6 +275,24 @@ HMAPI ssize_t httpmessage_quoted_string_consume(
 HMAPI ssize_t httpmessage_int_consume(int *output,
                                       const char *text, size_t length);
 
+/**
+ * @ingroup grammar
+ *
+ * @brief Read an unsigned size value from its decimal text representation
+ *
+ * Unlike httpmessage_int_consume(), the value may exceed @c INT_MAX (ex. a Content-Length).
+ *
+ * @param output Output value. On error, the value is undefined.
+ * @param text Input text to parse
+ * @param length Input text length
+ *
+ * @return On success, the number of bytes consumed in text.
+ * ::HTTPMESSAGE_ERROR_OVERFLOW if the value does not fit in a @c size_t.
+ * On error, one of the #httpmessage_result_code error codes
+ */
+HMAPI ssize_t httpmessage_size_consume(size_t *output,
+                                       const char *text, size_t length);
+
 HTTPMESSAGE_C_END
 
 #endif /* LIBHTTPMESSAGGE_GRAMMAR_H__ */
@@ -15,6 +15,7 @@
 #define LIBHTTPMESSAGGE_HEADER_H__
 
 #include "httpmessage/preprocessor.h"
+#include "httpmessage/memory.h"
 #include "httpmessage/text.h"
 
 HTTPMESSAGE_C_BEGIN
@@ -105,6 +106,20 @@ HMAPI void httpmessage_headerfield_value_clear(
  */
 HMAPI httpmessage_headerfield_value *httpmessage_headerfield_value_new(void);
 
+/**
+ * @ingroup header
+ *
+ * @brief Release a chain of header field value lines
+ *
+ * @param value First value line to release. The value line itself and all
+ * its following lines are released.
+ * @param allocator Allocator used to allocate the value lines.
+ * If @c NULL, the standard C library @c free() is used.
+ */
+HMAPI void httpmessage_headerfield_value_release(
+    httpmessage_headerfield_value *value,
+    httpmessage_allocator *allocator);
+
 
 /**
  * @ingroup header
@@ -268,6 +283,42 @@ HMAPI void httpmessage_headerfield_clear(
     httpmessage_headerfield *field,
     int option_flags);
 
+/**
+ * @ingroup header
+ *
+ * @brief Clear header member to their initial state.
+ *
+ * Except if @c ::HTTPMESSAGE_CLEAR_NO_FREE option is set,
+ * all following header fields and value lines are released
+ * using the given allocator.
+ *
+ * @param field Header to clear
+ * @param option_flags Option flags. Supported flags are:
+ * - @c ::HTTPMESSAGE_CLEAR_NO_FREE
+ * @param allocator Allocator used to allocate header field and value lines.
+ * If @c NULL, the standard C library @c free() is used.
+ *
+ * @see httpmessage_option_flags
+ */
+HMAPI void httpmessage_headerfield_clear_with_allocator(
+    httpmessage_headerfield *field,
+    int option_flags,
+    httpmessage_allocator *allocator);
+
+/**
+ * @ingroup header
+ *
+ * @brief Release a chain of header fields
+ *
+ * @param field First header field to release. The header field itself,
+ * all its following header fields and their value lines are released.
+ * @param allocator Allocator used to allocate header fields and value lines.
+ * If @c NULL, the standard C library @c free() is used.
+ */
+HMAPI void httpmessage_headerfield_release(
+    httpmessage_headerfield *field,
+    httpmessage_allocator *allocator);
+
 /**
  * @ingroup header
  *
@@ -329,6 +380,38 @@ HMAPI ssize_t httpmessage_headerfield_line_consume(
     const char *text, size_t length,
     int option_flags);
 
+/**
+ * @ingroup header
+ *
+ * @brief Read header field name and value on a single line
+ *
+ * Same as httpmessage_headerfield_line_consume() but new header fields
+ * and value lines are allocated with the given allocator.
+ *
+ * @param field The new header
+ * @param current_header The current header
+ * @param text Input text
+ * @param length Input text length
+ * @param option_flags Option flags. Supported flags are:
+ * - ::HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * @param allocator Header field and value line allocator.
+ * If @c NULL, the standard C library @c malloc() is used.
+ *
+ * @return On success, the number of bytes consumed (the current line length).
+ * On error, one of httpmessage_result_code
+ *
+ * @see httpmessage_result_code
+ * @see httpmessage_option_flags
+ */
+HMAPI ssize_t httpmessage_headerfield_line_consume_with_allocator(
+    httpmessage_headerfield **field,
+    httpmessage_headerfield *current_header,
+    const char *text, size_t length,
+    int option_flags,
+    httpmessage_allocator *allocator);
+
 /**
  * @ingroup header
  * @brief Write a HTTP header line to a file
@@ -389,6 +472,31 @@ HMAPI ssize_t httpmessage_headerfield_list_consume(
     const char *text, size_t length,
     int option_flags);
 
+/**
+ * @ingroup header
+ * @brief Parse all headers in the given text
+ *
+ * Same as httpmessage_headerfield_list_consume() but new header fields
+ * and value lines are allocated with the given allocator.
+ *
+ * @param headerfield_list Header list to populate
+ * @param text Input text
+ * @param length Input text length
+ * @param option_flags Option flags. These flags are passed to httpmessage API functions called internally.
+ * @param allocator Header field and value line allocator.
+ * If @c NULL, the standard C library @c malloc() is used.
+ *
+ * @return On success, number of bytes consumed in @c text.
+ * On error, one of @c httpmessage_result_code
+ *
+ * @see httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_headerfield_list_consume_with_allocator(
+    httpmessage_headerfield *headerfield_list,
+    const char *text, size_t length,
+    int option_flags,
+    httpmessage_allocator *allocator);
+
 /**
  * @ingroup header
  * @brief Write HTTP headers to a file.
@@ -15,7 +15,15 @@
 #define LIBHTTPMESSAGGE_H__
 
 #include "httpmessage/message.h"
+#include "httpmessage/copy.h"
+#include "httpmessage/chunked.h"
+#include "httpmessage/parser.h"
+#include "httpmessage/connection.h"
+#include "httpmessage/capture.h"
 #include "httpmessage/header.h"
+#include "httpmessage/memory.h"
+#include "httpmessage/pool.h"
+#include "httpmessage/statistics.h"
 #include "httpmessage/text.h"
 #include "httpmessage/grammar.h"
 #include "httpmessage/preprocessor.h"
@@ -34,8 +42,12 @@ typedef enum __httpmessage_result_code
 	HTTPMESSAGE_ERROR_OVERFLOW = -1100,        	/**< Output buffer will overflow */
 	HTTPMESSAGE_ERROR_WRITE = -1101, 			/**< I/O Write error */
 	HTTPMESSAGE_ERROR_ALLOCATION = -1102,		/**< An object failed to be allocated due to memory issue or allocation option rules */
+	HTTPMESSAGE_ERROR_BUDGET = -1103,			/**< An object failed to be allocated because the memory budget is exhausted */
+	HTTPMESSAGE_ERROR_READ = -1104, 			/**< I/O Read error */
 	HTTPMESSAGE_ERROR_SYNTAX = -1200,        	/**< The text given in argument does not match the expected syntax */
 	HTTPMESSAGE_ERROR_INCOMPLETE = -1201, 		/**< Input text is incomplete; more data is required */
+	HTTPMESSAGE_ERROR_TRUNCATED = -1202, 		/**< Input ended before the end of the message */
+	HTTPMESSAGE_ERROR_INTERRUPTED = -1300,		/**< A callback interrupted the operation */
 } httpmessage_result_code;
 
 /**
@@ -89,7 +101,51 @@ typedef enum
 	 * a ::HTTPMESSAGE_ERROR_ALLOCATION error code
 	 * will be returned.
 	 */
-	HTTPMESSAGE_NO_ALLOCATION = (1 << 2)
+	HTTPMESSAGE_NO_ALLOCATION = (1 << 2),
+	
+	/**
+	 * @brief Count header fields and value lines before parsing them.
+	 *
+	 * Applies to message @c *_consume functions. All header fields and value lines
+	 * that do not fit in the message are allocated at once in a single memory block
+	 * of the exact required size.
+	 *
+	 * Ignored if the message has pre-allocated storage or if ::HTTPMESSAGE_NO_ALLOCATION is set.
+	 */
+	HTTPMESSAGE_CONSUME_PRESCAN = (1 << 3),
+	
+	/**
+	 * @brief Do not copy the message body.
+	 *
+	 * Applies to message @c *_clone_* functions.
+	 */
+	HTTPMESSAGE_CLONE_NO_BODY = (1 << 4),
+	
+	/**
+	 * @brief Stop after the empty line ending the message header.
+	 *
+	 * Applies to message @c *_consume functions. The message body is left empty
+	 * and the function returns the header size, which is also the offset of the body
+	 * in the input text. The body framing is given by httpmessage_message_get_framing().
+	 */
+	HTTPMESSAGE_CONSUME_HEADER_ONLY = (1 << 5),
+	
+	/**
+	 * @brief Link the trailer fields after the header fields.
+	 *
+	 * Applies to message @c *_consume functions and to the parser.
+	 * Header field lookups in httpmessage_message::field_list also find
+	 * the trailer fields of a chunked body.
+	 */
+	HTTPMESSAGE_CONSUME_MERGE_TRAILER = (1 << 6),
+	
+	/**
+	 * @brief Copy a message body crossing an input segment boundary.
+	 *
+	 * Applies to message @c *_segments_consume functions. Without this flag,
+	 * such a body is left in the input segments and only its location is given.
+	 */
+	HTTPMESSAGE_CONSUME_COPY_BODY = (1 << 7)
 } httpmessage_option_flags;
 
 HTTPMESSAGE_C_END
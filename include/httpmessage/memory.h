@@ -0,0 +1,541 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file memory.h
+ * @brief Memory allocation strategies
+ */
+
+#if !defined (LIBHTTPMESSAGGE_MEMORY_H__)
+#define LIBHTTPMESSAGGE_MEMORY_H__
+
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+#include <stddef.h>
+
+/**
+ * @ingroup memory
+ *
+ * @brief Memory alignment of blocks returned by the library allocators.
+ */
+#define HTTPMESSAGE_MEMORY_ALIGNMENT (2 * sizeof(void *))
+
+/**
+ * @ingroup memory
+ *
+ * @brief Round a size to the next multiple of ::HTTPMESSAGE_MEMORY_ALIGNMENT
+ */
+#define HTTPMESSAGE_MEMORY_ALIGN(_size) \
+	((((size_t)(_size)) + (HTTPMESSAGE_MEMORY_ALIGNMENT - 1)) \
+	 & ~(HTTPMESSAGE_MEMORY_ALIGNMENT - 1))
+
+/**
+ * @ingroup memory
+ *
+ * @brief Generic memory allocator interface
+ *
+ * Custom allocators extend this structure by declaring it
+ * as their first member. Each callback receives the allocator
+ * itself as first argument.
+ */
+typedef struct __httpmessage_allocator
+{
+	/**
+	 * @brief Allocate a memory block
+	 *
+	 * MUST return @c NULL on error.
+	 */
+	void *(*allocate)(struct __httpmessage_allocator *allocator, size_t size);
+	
+	/**
+	 * @brief Release a memory block allocated with @c allocate
+	 *
+	 * @c NULL if the allocator does not support individual block release.
+	 */
+	void (*release)(struct __httpmessage_allocator *allocator, void *memory);
+	
+	/**
+	 * @brief Release all memory blocks at once.
+	 *
+	 * @c NULL if the allocator does not support bulk release.
+	 */
+	void (*reset)(struct __httpmessage_allocator *allocator);
+} httpmessage_allocator;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Allocate memory using the given allocator
+ *
+ * @param allocator Allocator. If @c NULL, the standard C library @c malloc() is used.
+ * @param size Memory block size
+ *
+ * @return The newly allocated memory block or @c NULL on error
+ */
+HMAPI void *httpmessage_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Release memory allocated with httpmessage_allocator_allocate()
+ *
+ * @param allocator Allocator used to allocate @c memory.
+ * If @c NULL, the standard C library @c free() is used.
+ * @param memory Memory block to release
+ */
+HMAPI void httpmessage_allocator_release(
+    httpmessage_allocator *allocator,
+    void *memory);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Get the result code describing the last allocation failure of an allocator
+ *
+ * @param allocator Allocator. May be @c NULL.
+ *
+ * @return ::HTTPMESSAGE_ERROR_BUDGET if @c allocator is a ::httpmessage_budget
+ * which refused its last allocation request. ::HTTPMESSAGE_ERROR_ALLOCATION otherwise.
+ */
+HMAPI int httpmessage_allocator_get_error(
+    const httpmessage_allocator *allocator);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Process-wide heap allocation counters
+ *
+ * Count the memory blocks allocated with @c malloc() and released with @c free()
+ * by httpmessage_allocator_allocate() and httpmessage_allocator_release()
+ * when no custom allocator is given. All heap memory of the library is allocated
+ * and released by these functions: messages, message storage, compact copies,
+ * header field nodes, string blocks, pools, connection buffers, capture frames,
+ * and arena chunks and budget blocks when they use the default allocator.
+ * Counters are balanced once every object is released with its matching @c *_free()
+ * or @c *_clear() function.
+ *
+ * Counters are updated with relaxed atomic operations when the compiler supports them.
+ */
+typedef struct __httpmessage_allocation_counters
+{
+	/** Number of allocated blocks */
+	size_t allocation_count;
+	/** Number of released blocks */
+	size_t release_count;
+	/** Cumulative size of allocated blocks, in bytes */
+	size_t allocation_size;
+} httpmessage_allocation_counters;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Get a snapshot of the process-wide heap allocation counters
+ *
+ * @param counters Output counters
+ */
+HMAPI void httpmessage_allocation_counters_get(
+    httpmessage_allocation_counters *counters);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Arena memory chunk header
+ *
+ * The usable memory follows the header.
+ */
+typedef struct __httpmessage_arena_chunk
+{
+	/** Next chunk */
+	struct __httpmessage_arena_chunk *next_chunk;
+	/** Usable chunk memory size */
+	size_t size;
+} httpmessage_arena_chunk;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Chunked bump allocator
+ *
+ * @extends httpmessage_allocator
+ *
+ * Memory blocks are carved sequentially from chunks.
+ * Individual blocks are never released. httpmessage_arena_reset()
+ * rewinds the arena in constant time and keeps all chunks for later use.
+ */
+typedef struct __httpmessage_arena
+{
+	/** Allocator interface */
+	httpmessage_allocator allocator;
+	
+	/** Chunk list */
+	httpmessage_arena_chunk *first_chunk;
+	
+	/** Chunk currently used */
+	httpmessage_arena_chunk *current_chunk;
+	
+	/** Offset of the first free byte in the current chunk */
+	size_t offset;
+	
+	/** Minimum usable size of new chunks */
+	size_t chunk_size;
+	
+	/**
+	 * @brief Allocator of arena chunks
+	 *
+	 * If @c NULL, chunks are allocated with @c malloc().
+	 */
+	httpmessage_allocator *chunk_allocator;
+} httpmessage_arena;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Default arena chunk size
+ */
+#define HTTPMESSAGE_ARENA_CHUNK_SIZE 4096
+
+/**
+ * @ingroup memory
+ *
+ * @brief Initialize an arena.
+ *
+ * No memory is allocated until the first allocation request.
+ *
+ * @param arena Arena to initialize
+ * @param chunk_size Minimum usable size of arena chunks.
+ * If zero, ::HTTPMESSAGE_ARENA_CHUNK_SIZE is used.
+ */
+HMAPI void httpmessage_arena_init(
+    httpmessage_arena *arena,
+    size_t chunk_size);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Allocate memory from the arena
+ *
+ * @param arena Arena
+ * @param size Memory block size
+ *
+ * @return A memory block aligned on ::HTTPMESSAGE_MEMORY_ALIGNMENT or @c NULL on error
+ */
+HMAPI void *httpmessage_arena_allocate(
+    httpmessage_arena *arena,
+    size_t size);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Rewind arena
+ *
+ * All memory blocks previously allocated become invalid.
+ * Chunks are kept and reused by subsequent allocations.
+ *
+ * @param arena Arena to rewind
+ */
+HMAPI void httpmessage_arena_reset(httpmessage_arena *arena);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Release all arena chunks
+ *
+ * @param arena Arena to clear
+ */
+HMAPI void httpmessage_arena_clear(httpmessage_arena *arena);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Get the number of chunks owned by the arena.
+ *
+ * @param arena Arena
+ * @return Number of chunks
+ */
+HMAPI size_t httpmessage_arena_chunk_count(const httpmessage_arena *arena);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Size of the memory regions of a huge page allocator (2 MiB).
+ */
+#define HTTPMESSAGE_HUGEPAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+/**
+ * @ingroup memory
+ *
+ * @brief Huge page allocator region strategies
+ *
+ * Each region records the strategy it was obtained with.
+ * A combination of these flags selects the strategies a
+ * huge page allocator is allowed to use. Strategies are tried in the declaration order.
+ */
+enum httpmessage_hugepage_strategy
+{
+	/**
+	 * @brief Explicit huge pages from the hugetlbfs pool (@c MAP_HUGETLB).
+	 *
+	 * Requires huge pages reserved by the system administrator.
+	 */
+	HTTPMESSAGE_HUGEPAGE_HUGETLB = (1 << 0),
+	/**
+	 * @brief Anonymous mapping aligned on a huge page boundary
+	 * and advised with @c MADV_HUGEPAGE (transparent huge pages).
+	 */
+	HTTPMESSAGE_HUGEPAGE_TRANSPARENT = (1 << 1),
+	/**
+	 * @brief Regular memory allocated with @c malloc().
+	 */
+	HTTPMESSAGE_HUGEPAGE_FALLBACK = (1 << 2),
+	/**
+	 * @brief All strategies
+	 */
+	HTTPMESSAGE_HUGEPAGE_ANY = 0x7
+};
+
+/**
+ * @ingroup memory
+ *
+ * @brief Huge page allocator region header
+ *
+ * The region memory blocks follow the header.
+ */
+typedef struct __httpmessage_hugepage_region
+{
+	/** Next region */
+	struct __httpmessage_hugepage_region *next_region;
+	/** Region size, including the header */
+	size_t size;
+	/** Strategy used to obtain the region. One of ::httpmessage_hugepage_strategy */
+	int strategy;
+} httpmessage_hugepage_region;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Fixed-size block allocator backed by huge pages
+ *
+ * @extends httpmessage_allocator
+ *
+ * Memory blocks of a single size are carved from ::HTTPMESSAGE_HUGEPAGE_SIZE regions,
+ * so that many small long-lived objects (ex. pre-allocated message storage)
+ * share a few TLB entries instead of one per 4 KiB page.
+ * Released blocks are kept in a free list and reused by subsequent allocations.
+ * When huge pages are not available, the allocator falls back to the next
+ * allowed strategy.
+ *
+ * @note This allocator is not thread-safe.
+ */
+typedef struct __httpmessage_hugepage_allocator
+{
+	/** Allocator interface */
+	httpmessage_allocator allocator;
+	
+	/** Region list. The first region is the one currently used */
+	httpmessage_hugepage_region *first_region;
+	
+	/** Offset of the first unused byte in the first region */
+	size_t offset;
+	
+	/** Size of memory blocks */
+	size_t block_size;
+	
+	/** Released blocks */
+	void *free_list;
+	
+	/** Allowed strategies. A combination of ::httpmessage_hugepage_strategy flags */
+	int strategies;
+} httpmessage_hugepage_allocator;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Initialize a huge page allocator
+ *
+ * No memory is allocated until the first allocation request.
+ *
+ * @param allocator Allocator to initialize
+ * @param block_size Size of the memory blocks. Allocation requests for
+ * larger blocks fail.
+ * @param strategies Allowed region strategies. A combination of ::httpmessage_hugepage_strategy flags.
+ * If zero, ::HTTPMESSAGE_HUGEPAGE_ANY is used.
+ */
+HMAPI void httpmessage_hugepage_allocator_init(
+    httpmessage_hugepage_allocator *allocator,
+    size_t block_size,
+    int strategies);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Allocate a memory block
+ *
+ * @param allocator Huge page allocator
+ * @param size Memory block size. Must not exceed the allocator block size.
+ *
+ * @return A memory block aligned on ::HTTPMESSAGE_MEMORY_ALIGNMENT or @c NULL on error
+ */
+HMAPI void *httpmessage_hugepage_allocator_allocate(
+    httpmessage_hugepage_allocator *allocator,
+    size_t size);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Give a memory block back to the allocator
+ *
+ * @param allocator Huge page allocator
+ * @param memory Memory block allocated with httpmessage_hugepage_allocator_allocate()
+ */
+HMAPI void httpmessage_hugepage_allocator_release(
+    httpmessage_hugepage_allocator *allocator,
+    void *memory);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Release all regions
+ *
+ * All memory blocks previously allocated become invalid.
+ *
+ * @param allocator Allocator to clear
+ */
+HMAPI void httpmessage_hugepage_allocator_clear(
+    httpmessage_hugepage_allocator *allocator);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Get the number of regions obtained with the given strategies
+ *
+ * @param allocator Huge page allocator
+ * @param strategies A combination of ::httpmessage_hugepage_strategy flags
+ *
+ * @return Number of regions
+ */
+HMAPI size_t httpmessage_hugepage_allocator_region_count(
+    const httpmessage_hugepage_allocator *allocator,
+    int strategies);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Size of the block header added by a memory budget to each allocation.
+ */
+#define HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE HTTPMESSAGE_MEMORY_ALIGN(sizeof(size_t))
+
+/**
+ * @ingroup memory
+ *
+ * @brief Memory budget
+ *
+ * @extends httpmessage_allocator
+ *
+ * Allocator wrapper that limits the amount of memory obtained from
+ * another allocator. A budget is typically assigned to the messages
+ * of a single connection, so that oversized or slowly growing header sections
+ * cannot exhaust the process memory.
+ *
+ * Each allocation is charged with its size plus ::HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE
+ * and released blocks are credited back.
+ * Once the limit would be exceeded, allocation requests fail and parsing
+ * functions return ::HTTPMESSAGE_ERROR_BUDGET.
+ *
+ * @note The budget counters are not atomic. A budget must be used by a single thread at a time.
+ */
+typedef struct __httpmessage_budget
+{
+	/** Allocator interface */
+	httpmessage_allocator allocator;
+	
+	/**
+	 * @brief Allocator of the memory blocks
+	 *
+	 * If @c NULL, blocks are allocated with @c malloc().
+	 */
+	httpmessage_allocator *parent;
+	
+	/** Maximum amount of memory, in bytes */
+	size_t limit;
+	
+	/** Amount of memory currently charged, in bytes */
+	size_t used;
+	
+	/** Highest value of @c used */
+	size_t peak;
+	
+	/** Number of refused allocation requests */
+	size_t refusal_count;
+	
+	/** Non-zero if the last allocation request was refused */
+	int exceeded;
+} httpmessage_budget;
+
+/**
+ * @ingroup memory
+ *
+ * @brief Initialize a memory budget
+ *
+ * The budget supports individual block release and bulk release
+ * when its parent allocator does.
+ *
+ * @param budget Budget to initialize
+ * @param limit Maximum amount of memory the budget can charge, in bytes
+ * @param parent Allocator of memory blocks. If @c NULL, @c malloc() and @c free() are used.
+ */
+HMAPI void httpmessage_budget_init(
+    httpmessage_budget *budget,
+    size_t limit,
+    httpmessage_allocator *parent);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Allocate a memory block and charge it to the budget
+ *
+ * @param budget Budget
+ * @param size Memory block size
+ *
+ * @return The newly allocated memory block or @c NULL if the budget limit
+ * is reached or if the parent allocator failed.
+ */
+HMAPI void *httpmessage_budget_allocate(
+    httpmessage_budget *budget,
+    size_t size);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Release a memory block and credit it back to the budget
+ *
+ * @param budget Budget
+ * @param memory Memory block allocated with httpmessage_budget_allocate()
+ */
+HMAPI void httpmessage_budget_release(
+    httpmessage_budget *budget,
+    void *memory);
+
+/**
+ * @ingroup memory
+ *
+ * @brief Reset the budget
+ *
+ * The refusal state is cleared. If the parent allocator supports bulk release,
+ * all memory blocks are released at once and the budget is fully credited.
+ *
+ * @param budget Budget
+ */
+HMAPI void httpmessage_budget_reset(httpmessage_budget *budget);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_MEMORY_H__ */
@@ -46,10 +46,72 @@ typedef struct __httpmessage_message
 	/** HTTP protocol minor version */
 	int minor_version;
 	
-	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+	/** Non-zero if the trailer fields follow the header fields in httpmessage_message::field_list */
+	int trailer_merged;
+	
+	/**
+	 * @brief Header field and value line allocator
+	 *
+	 * If @c NULL, the standard C library allocation functions are used.
+	 *
+	 * An allocator supporting bulk release (with a @c reset callback)
+	 * is considered to be owned by the message. It is reset each time
+	 * the message is cleared, unless httpmessage_message::allocator_shared is set.
+	 */
+	httpmessage_allocator *allocator;
+	
+	/**
+	 * @brief Non-zero if the allocator supporting bulk release is shared with other messages
+	 *
+	 * Header fields and value lines are dropped without being released
+	 * when the message is cleared and the allocator is never reset by the message.
+	 * The owner of the allocator resets it once none of the messages uses it.
+	 */
+	int allocator_shared;
+	
+	HTTPMESSAGE_PAD64(__allocator_padding, 4) /**< structure padding */
+	
+	/**
+	 * @brief End of the pre-allocated header field storage
+	 *
+	 * Header fields and value lines located between the message and this address
+	 * belong to the message pre-allocated storage.
+	 * @c NULL if the message does not have pre-allocated storage.
+	 */
+	const void *storage_end;
+	
+	/**
+	 * @brief Header fields and value lines allocated at once
+	 * with the ::HTTPMESSAGE_CONSUME_PRESCAN option.
+	 *
+	 * The block is allocated with the message allocator and
+	 * released each time the message is cleared, regardless of ::HTTPMESSAGE_CLEAR_NO_FREE.
+	 */
+	void *header_block;
+	
+	/**
+	 * @brief Header field names and values copied by httpmessage_message_append_header_copy()
+	 * and message elements crossing an input segment boundary
+	 *
+	 * Blocks are allocated with the message allocator and released
+	 * when the message is cleared. With ::HTTPMESSAGE_CLEAR_NO_FREE, the largest block is kept
+ * until httpmessage_message_release() is called.
+	 */
+	void *string_block;
 	
 	/** Header list */
 	httpmessage_headerfield field_list;
+	
+	/**
+	 * @brief Trailer fields following the last chunk of a chunked body
+	 *
+	 * Trailer fields and value lines are taken from the same storage as the header fields.
+	 * With ::HTTPMESSAGE_CONSUME_MERGE_TRAILER, the trailer fields are also linked
+	 * after the last header field of httpmessage_message::field_list.
+	 * @c NULL if the message does not have trailer fields.
+	 */
+	httpmessage_headerfield *trailer_list;
+	
 	/** Message body */
 	httpmessage_body 	body;
 } httpmessage_message;
@@ -68,6 +130,10 @@ HMAPI void httpmessage_message_init(httpmessage_message *message);
  *
  * @brief Clear message
  *
+ * If the message allocator supports bulk release,
+ * the allocator is reset in constant time and ::HTTPMESSAGE_CLEAR_NO_FREE is ignored.
+ * A shared allocator (see httpmessage_message::allocator_shared) is not reset.
+ *
  * @param message Message instance
  * @param option_flags Option flags. Supported flags are
  * - ::HTTPMESSAGE_CLEAR_NO_FREE
@@ -78,6 +144,19 @@ HMAPI void httpmessage_message_clear(
     httpmessage_message *message,
     int option_flags);
 
+/**
+ * @ingroup message
+ *
+ * @brief Clear message and release the memory kept for reuse
+ *
+ * Header fields, value lines and string blocks kept by a previous clear
+ * with ::HTTPMESSAGE_CLEAR_NO_FREE are released with the message allocator.
+ * Call this function before releasing the memory of the message itself.
+ *
+ * @param message Message instance
+ */
+HMAPI void httpmessage_message_release(httpmessage_message *message);
+
 /**
  * @ingroup message
  * @brief Append a header to the given message.
@@ -117,6 +196,57 @@ HMAPI int httpmessage_message_append_header_with_lengths(
     const char *value, size_t value_length,
     int option_flags);
 
+/**
+ * @ingroup message
+ * @brief Minimum size of the blocks storing copied header field names and values
+ */
+#define HTTPMESSAGE_STRING_BLOCK_SIZE 512
+
+/**
+ * @ingroup message
+ * @brief Append a header to the given message, copying the name and value.
+ *
+ * Name and value are copied into a string block owned by the message,
+ * so the caller does not have to keep them alive.
+ * Small header fields share a single block allocation.
+ *
+ * @param message Message to add the header to.
+ * @param name Header field name
+ * @param value Header value
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ *
+ * @return HTTPMESSAGE_OK on success. One of httpmessage_result_code error codes on error.
+ */
+HMAPI int httpmessage_message_append_header_copy(
+    httpmessage_message *message,
+    const char *name, const char *value,
+    int option_flags);
+
+/**
+ * @ingroup message
+ * @brief Append a header to the given message, copying the name and value.
+ *
+ * @param message Message to add the header to.
+ * @param name Header field name
+ * @param name_length Header field name length
+ * @param value Header value
+ * @param value_length Header field value length
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ *
+ * @return HTTPMESSAGE_OK on success. One of httpmessage_result_code error codes on error.
+ *
+ * @see httpmessage_message_append_header_copy()
+ */
+HMAPI int httpmessage_message_append_header_copy_with_lengths(
+    httpmessage_message *message,
+    const char *name, size_t name_length,
+    const char *value, size_t value_length,
+    int option_flags);
+
 /**
  * @ingroup message
  *
@@ -136,6 +266,52 @@ HMAPI int httpmessage_message_get_storage_infos(
     size_t *max_line_per_value,
     const httpmessage_message *message);
 
+/**
+ * @ingroup message
+ *
+ * @brief Memory used by a message
+ *
+ * Sizes are expressed in bytes. Header field and value line nodes embedded
+ * in the message structure itself are not counted.
+ */
+typedef struct __httpmessage_memory_usage
+{
+	/** Header field nodes holding a header field */
+	size_t headerfield_size;
+	
+	/** Value line nodes holding a value line */
+	size_t line_size;
+	
+	/**
+	 * @brief Header field and value line nodes linked to the message
+	 * but not holding data (pre-allocated storage or nodes kept by ::HTTPMESSAGE_CLEAR_NO_FREE)
+	 */
+	size_t unused_size;
+	
+	/** Other internal allocations (ex. header block bookkeeping and padding, copied strings) */
+	size_t internal_size;
+	
+	/** Sum of all the above */
+	size_t total_size;
+	
+	/** Input text referenced by the message string views. */
+	size_t referenced_size;
+} httpmessage_memory_usage;
+
+/**
+ * @ingroup message
+ *
+ * @brief Compute the memory used by a message
+ *
+ * @param usage Output memory usage
+ * @param message Message to inspect
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ */
+HMAPI int httpmessage_message_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_message *message);
+
 /**
  * @ingroup message
  *
@@ -195,10 +371,20 @@ HMAPI void httpmessage_request_clear(
  * @ingroup message
  *
  * @brief Clear and free a request allocated with httpmessage_request_new()
+ * or httpmessage_request_arena_new()
  * @param request Request to free
  */
 HMAPI void httpmessage_request_free(httpmessage_request **request);
 
+/**
+ * @ingroup message
+ *
+ * @brief Size of an inline storage array of @c _count elements.
+ *
+ * C89 does not allow empty arrays, an unused element is declared instead.
+ */
+#define HTTPMESSAGE_STORAGE_ARRAY_SIZE(_count) (((_count) > 0) ? (_count) : 1)
+
 /**
  * @ingroup message
  *
@@ -210,15 +396,166 @@ HMAPI void httpmessage_request_free(httpmessage_request **request);
  *
  * @return A request with pre-allocated header fields.
  *
+ * Header fields and value lines that do not fit in the pre-allocated storage
+ * are allocated with the message allocator (@c message.allocator)
+ * unless ::HTTPMESSAGE_NO_ALLOCATION is set.
+ * These overflow nodes are released (or the allocator is reset) each time the message is cleared
+ * or consumes a new input, the pre-allocated storage is always kept.
+ *
  * @attention NEVER call httpmessage_request_init() on the returned object. This will reset the maximum number of header field and value line to 1.
- * @attention Use @c free() to release the object allocated with this function.
- * @attention ALWAYS set ::HTTPMESSAGE_CLEAR_NO_FREE and ::HTTPMESSAGE_NO_ALLOCATION
- * when using this object with @c *_consume or @c *_clear() functions
+ * @attention Use httpmessage_request_storage_free() to release the object allocated with this function.
+ * @attention ALWAYS set ::HTTPMESSAGE_CLEAR_NO_FREE when using this object with @c *_consume or @c *_clear() functions.
+ * Also set ::HTTPMESSAGE_NO_ALLOCATION to fail with ::HTTPMESSAGE_ERROR_ALLOCATION
+ * instead of allocating overflow nodes.
  */
 HMAPI httpmessage_request *httpmessage_request_storage_new(
     size_t max_headerfield_count,
     size_t max_line_per_headerfield_value);
 
+/**
+ * @ingroup message
+ *
+ * @brief Clear and free a request allocated with httpmessage_request_storage_new()
+ * or httpmessage_request_clone_compact()
+ *
+ * Overflow nodes and string blocks kept for reuse are released
+ * (see httpmessage_message_release()).
+ * The memory block is released with httpmessage_allocator_release().
+ *
+ * @param request Request to free
+ */
+HMAPI void httpmessage_request_storage_free(httpmessage_request **request);
+
+/**
+ * @ingroup message
+ *
+ * @brief Get the size of the memory block allocated by httpmessage_request_storage_new()
+ *
+ * @param max_headerfield_count Number of header field to allocated
+ * @param max_line_per_headerfield_value Number of header field value line to allocate for each header field.
+ *
+ * @return Storage block size
+ */
+HMAPI size_t httpmessage_request_storage_size(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value);
+
+/**
+ * @ingroup message
+ *
+ * @brief Create a request message with pre-allocated header field storage
+ * in a single memory block obtained from the given allocator.
+ *
+ * Same as httpmessage_request_storage_new() except for the storage block allocation.
+ * The message allocator used for overflow nodes (@c message.allocator) is not affected.
+ *
+ * @param max_headerfield_count Number of header field to allocated
+ * @param max_line_per_headerfield_value Number of header field value line to allocate for each header field.
+ * @param allocator Allocator of the storage block. If @c NULL, @c malloc() is used.
+ *
+ * @return A request with pre-allocated header fields or @c NULL on error.
+ *
+ * @attention Use httpmessage_allocator_release() with the same allocator to release the object.
+ */
+HMAPI httpmessage_request *httpmessage_request_storage_new_with_allocator(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    httpmessage_allocator *allocator);
+
+/**
+ * @ingroup message
+ *
+ * @brief Initialize a request with pre-allocated header field storage
+ * provided by the caller.
+ *
+ * @param request Request to initialize
+ * @param headerfields Array of at least <tt>max_headerfield_count - 1</tt> header fields
+ * @param lines Array of at least <tt>max_headerfield_count * (max_line_per_headerfield_value - 1)</tt> value lines
+ * @param max_headerfield_count Number of header fields, including the one embedded in the request
+ * @param max_line_per_headerfield_value Number of value lines of each header field
+ *
+ * The same rules as for httpmessage_request_storage_new() apply to the initialized request.
+ *
+ * @attention @c headerfields and @c lines MUST be located after the request
+ * in the same object. Use ::HTTPMESSAGE_DECLARE_REQUEST_STORAGE to declare a suitable type.
+ */
+HMAPI void httpmessage_request_storage_init(
+    httpmessage_request *request,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value);
+
+/**
+ * @ingroup message
+ *
+ * @brief Declare a request type with inline pre-allocated header field storage.
+ *
+ * The declared structure does not require any dynamic allocation.
+ * It can be declared on the stack, embedded in another structure or used in static arrays.
+ * It has to be initialized with ::HTTPMESSAGE_REQUEST_STORAGE_INIT before use.
+ *
+ * @param _name Type name
+ * @param _max_headerfield_count Number of pre-allocated header fields
+ * @param _max_line_per_headerfield_value Number of pre-allocated value lines per header field
+ *
+ * @code{.c}
+ * HTTPMESSAGE_DECLARE_REQUEST_STORAGE(connection_request, 32, 2);
+ *
+ * connection_request storage;
+ * httpmessage_request *request = HTTPMESSAGE_REQUEST_STORAGE_INIT(connection_request, &storage);
+ * @endcode
+ */
+#define HTTPMESSAGE_DECLARE_REQUEST_STORAGE(_name, _max_headerfield_count, _max_line_per_headerfield_value) \
+	typedef struct __##_name \
+	{ \
+		httpmessage_request request; \
+		httpmessage_headerfield headerfields[HTTPMESSAGE_STORAGE_ARRAY_SIZE( \
+		        (_max_headerfield_count) - 1)]; \
+		httpmessage_headerfield_value lines[HTTPMESSAGE_STORAGE_ARRAY_SIZE( \
+		        (_max_headerfield_count) * ((_max_line_per_headerfield_value) - 1))]; \
+	} _name; \
+	enum \
+	{ \
+		_name##_headerfield_count = (_max_headerfield_count), \
+		_name##_line_per_headerfield_value = (_max_line_per_headerfield_value) \
+	}
+
+/**
+ * @ingroup message
+ *
+ * @brief Initialize a request declared with ::HTTPMESSAGE_DECLARE_REQUEST_STORAGE
+ *
+ * @param _name Type name
+ * @param _storage Pointer to the object to initialize
+ *
+ * @return Pointer to the initialized request
+ */
+#define HTTPMESSAGE_REQUEST_STORAGE_INIT(_name, _storage) \
+	(httpmessage_request_storage_init(&(_storage)->request, \
+	        (_storage)->headerfields, (_storage)->lines, \
+	        _name##_headerfield_count, _name##_line_per_headerfield_value), \
+	 &(_storage)->request)
+
+/**
+ * @ingroup message
+ *
+ * @brief Create a request message that allocates its header fields from its own arena.
+ *
+ * The request and its arena are allocated in a single memory block.
+ * httpmessage_request_clear() and httpmessage_request_consume() rewind the arena
+ * in constant time. Arena chunks are kept and reused by the next requests,
+ * so parsing a keep-alive connection does not allocate once the arena is large enough.
+ *
+ * @param chunk_size Arena chunk size. If zero, ::HTTPMESSAGE_ARENA_CHUNK_SIZE is used.
+ *
+ * @return The new request or @c NULL on error.
+ *
+ * @attention NEVER call httpmessage_request_init() on the returned object. This will detach the arena.
+ * @attention Use httpmessage_request_free() to release the object allocated with this function.
+ */
+HMAPI httpmessage_request *httpmessage_request_arena_new(size_t chunk_size);
+
 /**
  * @ingroup message
  *
@@ -280,6 +617,7 @@ HMAPI void httpmessage_response_clear(
  * @ingroup message
  *
  * @brief Clear and free a response allocated with httpmessage_response_new()
+ * or httpmessage_response_arena_new()
  *
  * @param response Response to free
  */
@@ -296,15 +634,165 @@ HMAPI void httpmessage_response_free(httpmessage_response **response);
  *
  * @return A response with pre-allocated header fields.
  *
+ * Header fields and value lines that do not fit in the pre-allocated storage
+ * are allocated with the message allocator (@c message.allocator)
+ * unless ::HTTPMESSAGE_NO_ALLOCATION is set.
+ * These overflow nodes are released (or the allocator is reset) each time the message is cleared
+ * or consumes a new input, the pre-allocated storage is always kept.
+ *
  * @attention NEVER call httpmessage_response_init() on the returned object. This will reset the maximum number of header field and value line to 1.
- * @attention Use @c free() to release the object allocated with this function.
- * @attention ALWAYS set ::HTTPMESSAGE_CLEAR_NO_FREE and ::HTTPMESSAGE_NO_ALLOCATION
- * when using this object with @c *_consume or @c *_clear() functions
+ * @attention Use httpmessage_response_storage_free() to release the object allocated with this function.
+ * @attention ALWAYS set ::HTTPMESSAGE_CLEAR_NO_FREE when using this object with @c *_consume or @c *_clear() functions.
+ * Also set ::HTTPMESSAGE_NO_ALLOCATION to fail with ::HTTPMESSAGE_ERROR_ALLOCATION
+ * instead of allocating overflow nodes.
  */
 HMAPI httpmessage_response *httpmessage_response_storage_new(
     size_t max_headerfield_count,
     size_t max_line_per_headerfield_value);
 
+/**
+ * @ingroup message
+ *
+ * @brief Clear and free a response allocated with httpmessage_response_storage_new()
+ * or httpmessage_response_clone_compact()
+ *
+ * Overflow nodes and string blocks kept for reuse are released
+ * (see httpmessage_message_release()).
+ * The memory block is released with httpmessage_allocator_release().
+ *
+ * @param response Response to free
+ */
+HMAPI void httpmessage_response_storage_free(httpmessage_response **response);
+
+/**
+ * @ingroup message
+ *
+ * @brief Get the size of the memory block allocated by httpmessage_response_storage_new()
+ *
+ * @param max_headerfield_count Number of header field to allocated
+ * @param max_line_per_headerfield_value Number of header field value line to allocate for each header field.
+ *
+ * @return Storage block size
+ */
+HMAPI size_t httpmessage_response_storage_size(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value);
+
+/**
+ * @ingroup message
+ *
+ * @brief Create a response message with pre-allocated header field storage
+ * in a single memory block obtained from the given allocator.
+ *
+ * Same as httpmessage_response_storage_new() except for the storage block allocation.
+ * The message allocator used for overflow nodes (@c message.allocator) is not affected.
+ *
+ * @param max_headerfield_count Number of header field to allocated
+ * @param max_line_per_headerfield_value Number of header field value line to allocate for each header field.
+ * @param allocator Allocator of the storage block. If @c NULL, @c malloc() is used.
+ *
+ * @return A response with pre-allocated header fields or @c NULL on error.
+ *
+ * @attention Use httpmessage_allocator_release() with the same allocator to release the object.
+ */
+HMAPI httpmessage_response *httpmessage_response_storage_new_with_allocator(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    httpmessage_allocator *allocator);
+
+/**
+ * @ingroup message
+ *
+ * @brief Initialize a response with pre-allocated header field storage
+ * provided by the caller.
+ *
+ * @param response Response to initialize
+ * @param headerfields Array of at least <tt>max_headerfield_count - 1</tt> header fields
+ * @param lines Array of at least <tt>max_headerfield_count * (max_line_per_headerfield_value - 1)</tt> value lines
+ * @param max_headerfield_count Number of header fields, including the one embedded in the response
+ * @param max_line_per_headerfield_value Number of value lines of each header field
+ *
+ * The same rules as for httpmessage_response_storage_new() apply to the initialized response.
+ *
+ * @attention @c headerfields and @c lines MUST be located after the response
+ * in the same object. Use ::HTTPMESSAGE_DECLARE_RESPONSE_STORAGE to declare a suitable type.
+ */
+HMAPI void httpmessage_response_storage_init(
+    httpmessage_response *response,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value);
+
+/**
+ * @ingroup message
+ *
+ * @brief Declare a response type with inline pre-allocated header field storage.
+ *
+ * The declared structure does not require any dynamic allocation.
+ * It can be declared on the stack, embedded in another structure or used in static arrays.
+ * It has to be initialized with ::HTTPMESSAGE_RESPONSE_STORAGE_INIT before use.
+ *
+ * @param _name Type name
+ * @param _max_headerfield_count Number of pre-allocated header fields
+ * @param _max_line_per_headerfield_value Number of pre-allocated value lines per header field
+ *
+ * @code{.c}
+ * HTTPMESSAGE_DECLARE_RESPONSE_STORAGE(connection_response, 32, 2);
+ *
+ * connection_response storage;
+ * httpmessage_response *response = HTTPMESSAGE_RESPONSE_STORAGE_INIT(connection_response, &storage);
+ * @endcode
+ */
+#define HTTPMESSAGE_DECLARE_RESPONSE_STORAGE(_name, _max_headerfield_count, _max_line_per_headerfield_value) \
+	typedef struct __##_name \
+	{ \
+		httpmessage_response response; \
+		httpmessage_headerfield headerfields[HTTPMESSAGE_STORAGE_ARRAY_SIZE( \
+		        (_max_headerfield_count) - 1)]; \
+		httpmessage_headerfield_value lines[HTTPMESSAGE_STORAGE_ARRAY_SIZE( \
+		        (_max_headerfield_count) * ((_max_line_per_headerfield_value) - 1))]; \
+	} _name; \
+	enum \
+	{ \
+		_name##_headerfield_count = (_max_headerfield_count), \
+		_name##_line_per_headerfield_value = (_max_line_per_headerfield_value) \
+	}
+
+/**
+ * @ingroup message
+ *
+ * @brief Initialize a response declared with ::HTTPMESSAGE_DECLARE_RESPONSE_STORAGE
+ *
+ * @param _name Type name
+ * @param _storage Pointer to the object to initialize
+ *
+ * @return Pointer to the initialized response
+ */
+#define HTTPMESSAGE_RESPONSE_STORAGE_INIT(_name, _storage) \
+	(httpmessage_response_storage_init(&(_storage)->response, \
+	        (_storage)->headerfields, (_storage)->lines, \
+	        _name##_headerfield_count, _name##_line_per_headerfield_value), \
+	 &(_storage)->response)
+
+/**
+ * @ingroup message
+ *
+ * @brief Create a response message that allocates its header fields from its own arena.
+ *
+ * The response and its arena are allocated in a single memory block.
+ * httpmessage_response_clear() and httpmessage_response_consume() rewind the arena
+ * in constant time.
+ *
+ * @param chunk_size Arena chunk size. If zero, ::HTTPMESSAGE_ARENA_CHUNK_SIZE is used.
+ *
+ * @return The new response or @c NULL on error.
+ *
+ * @attention NEVER call httpmessage_response_init() on the returned object. This will detach the arena.
+ * @attention Use httpmessage_response_free() to release the object allocated with this function.
+ */
+HMAPI httpmessage_response *httpmessage_response_arena_new(size_t chunk_size);
+
 /**
  * @ingroup message
  *
@@ -444,15 +932,85 @@ HMAPI int httpmessage_message_get_type(
     const char *text, size_t length,
     int option_flags);
 
+/**
+ * @ingroup message
+ *
+ * @brief Message body framing
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-3.3.3
+ */
+enum httpmessage_framing
+{
+	/** The message does not have a body */
+	HTTPMESSAGE_FRAMING_NONE = 0,
+	/** The body length is given by the Content-Length header field */
+	HTTPMESSAGE_FRAMING_LENGTH,
+	/** The body is a sequence of chunks (Transfer-Encoding: chunked) */
+	HTTPMESSAGE_FRAMING_CHUNKED,
+	/** The body ends when the connection is closed */
+	HTTPMESSAGE_FRAMING_UNTIL_CLOSE
+};
+
+/**
+ * @ingroup message
+ *
+ * @brief Get the body framing of a message from its header fields
+ *
+ * The transfer codings of all Transfer-Encoding header fields form a single list.
+ * When the last transfer coding is @c chunked, the body is chunked.
+ * Otherwise, the Content-Length header field gives the body length.
+ * A request without any of them does not have a body.
+ * A response without any of them ends when the connection is closed.
+ *
+ * @param body_length Output body length. Set for ::HTTPMESSAGE_FRAMING_LENGTH, 0 otherwise.
+ * @param message Message. Any message type other than ::HTTPMESSAGE_TYPE_RESPONSE
+ * is considered to be a request.
+ *
+ * @return One of ::httpmessage_framing. ::HTTPMESSAGE_ERROR_SYNTAX if a
+ * Content-Length value is not a decimal number, if several Content-Length values differ,
+ * if a request has both Content-Length and Transfer-Encoding header fields,
+ * if @c chunked is not the final transfer coding or is applied more than once,
+ * or if a request transfer coding is not @c chunked.
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-3.3.3
+ */
+HMAPI int httpmessage_message_get_framing(
+    size_t *body_length,
+    const httpmessage_message *message);
+
+/**
+ * @ingroup message
+ *
+ * @brief Indicate if the connection persists after the message
+ *
+ * A HTTP/1.1 connection persists unless the Connection header field has the @c close option.
+ * A HTTP/1.0 connection only persists with the @c keep-alive option.
+ *
+ * @param message Message
+ *
+ * @return Non-zero if the connection persists after the message
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-6.3
+ */
+HMAPI int httpmessage_message_is_keep_alive(const httpmessage_message *message);
+
 /**
  * @ingroup message
  * @brief Read HTTP message headers and body.
  *
+ * The body framing is given by httpmessage_message_get_framing().
+ * A request without Content-Length or Transfer-Encoding header field does not have a body.
+ * A response without them covers the remaining input.
+ * The body of a chunked message is the chunked text, including the trailer section
+ * (see httpmessage_chunked_decoder).
+ *
  * @param message Output message descriptor
  * @param text Input text
  * @param length Input text length
  * @param option_flags Option flags. Supported flags are
  * - ::HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
  *
  * @return On success, number of bytes consumed in @c text.
  * On error, one of httpmessage_result_code
@@ -465,6 +1023,32 @@ HMAPI ssize_t httpmessage_message_content_consume(
     const char *text, size_t length,
     int option_flags);
 
+/**
+ * @ingroup message
+ *
+ * @brief Read the trailer section of a chunked message body
+ *
+ * Trailer field lines are parsed as header field lines into httpmessage_message::trailer_list.
+ * Previous trailer fields of the message are discarded.
+ *
+ * @param message Message
+ * @param text Trailer field lines, excluding the empty line ending the chunked body
+ * @param length Input text length
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ *
+ * @return On success, number of bytes consumed in @c text.
+ * On error, one of httpmessage_result_code
+ *
+ * @see httpmessage_result_code
+ * @see httpmessage_option_flags
+ */
+HMAPI ssize_t httpmessage_message_trailer_consume(
+    httpmessage_message *message,
+    const char *text, size_t length,
+    int option_flags);
+
 /**
  * @ingroup message
  *
@@ -512,6 +1096,8 @@ HMAPI ssize_t httpmessage_message_content_write_buffer(
  * @param length Input text length
  * @param option_flags Option flags. Supported flags are
  * - ::HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
  *
  * @return On success, number of bytes consumed in @c text.
  * On error, one of httpmessage_result_code
@@ -570,6 +1156,8 @@ HMAPI ssize_t httpmessage_request_write_buffer(
  * @param length Input text length
  * @param option_flags Option flags. Supported flags are
  * - ::HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
  *
  * @return On success, number of bytes consumed in @c text.
  * On error, one of httpmessage_result_code
@@ -582,6 +1170,248 @@ HMAPI ssize_t httpmessage_response_consume(
     const char *text, size_t length,
     int option_flags);
 
+/**
+ * @ingroup message
+ *
+ * @brief Indicate if a response is an interim response
+ *
+ * An interim response is followed by another response to the same request.
+ *
+ * @param response Response
+ *
+ * @return Non-zero if the status code is 1xx, except 101 (Switching Protocols),
+ * after which the connection no longer uses HTTP.
+ */
+HMAPI int httpmessage_response_is_interim(const httpmessage_response *response);
+
+/**
+ * @ingroup message
+ *
+ * @brief Get the body framing of a response, knowing the request method
+ *
+ * Responses to a HEAD request, 2xx responses to a CONNECT request,
+ * 1xx, 204 (No Content) and 304 (Not Modified) responses do not have a body.
+ * Otherwise, the framing is given by httpmessage_message_get_framing().
+ *
+ * @param body_length Output body length. Set for ::HTTPMESSAGE_FRAMING_LENGTH, 0 otherwise.
+ * @param response Response
+ * @param request_method Method of the request. May be @c NULL if unknown.
+ *
+ * @return One of ::httpmessage_framing. ::HTTPMESSAGE_ERROR_SYNTAX if the
+ * Content-Length value is invalid or if several Content-Length values differ.
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-3.3.3
+ */
+HMAPI int httpmessage_response_get_framing(
+    size_t *body_length,
+    const httpmessage_response *response,
+    const httpmessage_stringview *request_method);
+
+/**
+ * @ingroup message
+ *
+ * @brief Read a HTTP response message, knowing the request method
+ *
+ * Unlike httpmessage_response_consume(), the body framing depends on the
+ * request method and on the status code (see httpmessage_response_get_framing()).
+ *
+ * When the response is interim (see httpmessage_response_is_interim()),
+ * the final response follows in the input.
+ *
+ * @param response Output response
+ * @param framing Output body framing. One of ::httpmessage_framing.
+ * With ::HTTPMESSAGE_FRAMING_UNTIL_CLOSE, the body covers the remaining input
+ * and the response is only complete once the connection is closed.
+ * @param request_method Method of the request. May be @c NULL if unknown.
+ * @param text Input text
+ * @param length Input text length
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ *
+ * @return On success, number of bytes consumed in @c text.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the response header or the body is incomplete.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_response_consume_for_request(
+    httpmessage_response *response,
+    int *framing,
+    const httpmessage_stringview *request_method,
+    const char *text, size_t length,
+    int option_flags);
+
+/**
+ * @ingroup message
+ *
+ * @brief Sequence of back-to-back messages in a single input text
+ *
+ * @see https://datatracker.ietf.org/doc/html/rfc7230#section-6.3.2
+ */
+typedef struct __httpmessage_pipeline
+{
+	/** Input text */
+	const char *text;
+	/** Input text length */
+	size_t length;
+	/** Offset of the next message in the input text */
+	size_t offset;
+	/** Number of messages consumed */
+	size_t message_count;
+	/** Option flags given to the message consume functions */
+	int option_flags;
+	
+	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+} httpmessage_pipeline;
+
+/**
+ * @ingroup message
+ *
+ * @brief Initialize a message pipeline
+ *
+ * @param pipeline Pipeline to initialize
+ * @param text Input text
+ * @param length Input text length
+ * @param option_flags Option flags given to the message consume functions.
+ * ::HTTPMESSAGE_CONSUME_HEADER_ONLY is ignored.
+ */
+HMAPI void httpmessage_pipeline_init(
+    httpmessage_pipeline *pipeline,
+    const char *text, size_t length,
+    int option_flags);
+
+/**
+ * @ingroup message
+ *
+ * @brief Read the next request of a pipeline
+ *
+ * @param pipeline Pipeline
+ * @param request Output request
+ *
+ * @return The size of the request, which is consumed.
+ * 0 if there is no more input.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the remaining input is a partial request,
+ * i.e. valid header lines followed by a line truncated by the end of the input.
+ * ::HTTPMESSAGE_ERROR_SYNTAX as soon as a complete line or a character is invalid.
+ * The pipeline offset is not moved, so the remaining input can be completed and parsed again.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_pipeline_request_consume(
+    httpmessage_pipeline *pipeline,
+    httpmessage_request *request);
+
+/**
+ * @ingroup message
+ *
+ * @brief Read the next response of a pipeline
+ *
+ * A response without Content-Length or chunked transfer coding
+ * covers the remaining input.
+ *
+ * @param pipeline Pipeline
+ * @param response Output response
+ *
+ * @return The size of the response, which is consumed.
+ * 0 if there is no more input.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the remaining input is a partial response.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_pipeline_response_consume(
+    httpmessage_pipeline *pipeline,
+    httpmessage_response *response);
+
+/**
+ * @ingroup message
+ *
+ * @brief Location of a message body in input segments
+ */
+typedef struct __httpmessage_segment_range
+{
+	/** Index of the segment of the first byte */
+	size_t first_segment;
+	/** Offset of the first byte in the first segment */
+	size_t offset;
+	/** Index of the segment of the last byte. Same as @c first_segment for an empty body */
+	size_t last_segment;
+	/** Number of bytes */
+	size_t length;
+} httpmessage_segment_range;
+
+/**
+ * @ingroup message
+ *
+ * @brief Read a HTTP request message split in several input segments
+ *
+ * Request elements are string views on the input segments. An element crossing
+ * a segment boundary is copied in the message string blocks
+ * (see httpmessage_message::string_block), so a request
+ * contained in a single segment is parsed without any copy.
+ *
+ * A body contained in a single segment is a string view on this segment.
+ * A body crossing a segment boundary is left in the input segments and
+ * httpmessage_message::body is empty. Its location is given by @c body_range.
+ * With the chunked transfer coding, the body is the encoded body
+ * and trailer fields are parsed.
+ *
+ * With ::HTTPMESSAGE_CONSUME_COPY_BODY, a body crossing a segment boundary is copied
+ * as a whole, which requires a string block of at least the body size.
+ * With ::HTTPMESSAGE_NO_ALLOCATION, such a body is never copied,
+ * even in a string block kept by ::HTTPMESSAGE_CLEAR_NO_FREE.
+ *
+ * @param request Output request
+ * @param segments Input segments, in order. Empty segments are allowed.
+ * @param segment_count Number of input segments
+ * @param body_range If not @c NULL, receives the location of the body in the input segments.
+ * Not modified with ::HTTPMESSAGE_CONSUME_HEADER_ONLY.
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ * - ::HTTPMESSAGE_CONSUME_COPY_BODY
+ *
+ * @return On success, number of bytes consumed in the input segments.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the request is incomplete.
+ * ::HTTPMESSAGE_ERROR_ALLOCATION with ::HTTPMESSAGE_NO_ALLOCATION if the body
+ * crosses a segment boundary and ::HTTPMESSAGE_CONSUME_COPY_BODY is set,
+ * or if another element crossing a segment boundary
+ * does not fit in the memory kept by the message.
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_request_segments_consume(
+    httpmessage_request *request,
+    const httpmessage_stringview *segments, size_t segment_count,
+    httpmessage_segment_range *body_range,
+    int option_flags);
+
+/**
+ * @ingroup message
+ *
+ * @brief Read a HTTP response message split in several input segments
+ *
+ * Same as httpmessage_request_segments_consume() for a response.
+ *
+ * @param response Output response
+ * @param segments Input segments, in order. Empty segments are allowed.
+ * @param segment_count Number of input segments
+ * @param body_range If not @c NULL, receives the location of the body in the input segments
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_HEADER_ONLY
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ * - ::HTTPMESSAGE_CONSUME_COPY_BODY
+ *
+ * @return On success, number of bytes consumed in the input segments.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the response is incomplete.
+ * ::HTTPMESSAGE_ERROR_ALLOCATION as for httpmessage_request_segments_consume().
+ * On error, one of httpmessage_result_code
+ */
+HMAPI ssize_t httpmessage_response_segments_consume(
+    httpmessage_response *response,
+    const httpmessage_stringview *segments, size_t segment_count,
+    httpmessage_segment_range *body_range,
+    int option_flags);
+
 /**
  * @ingroup message
  * @brief Write a HTTP response to a file.
@@ -618,6 +1448,40 @@ HMAPI ssize_t httpmessage_response_write_buffer(
     void *output, size_t output_size,
     const httpmessage_response *response);
 
+/**
+ * @ingroup message
+ *
+ * @brief Compute the memory used by a request
+ *
+ * Same as httpmessage_message_memory_usage(). The request method and URI
+ * are part of the referenced input text.
+ *
+ * @param usage Output memory usage
+ * @param request Request to inspect
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ */
+HMAPI int httpmessage_request_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_request *request);
+
+/**
+ * @ingroup message
+ *
+ * @brief Compute the memory used by a response
+ *
+ * Same as httpmessage_message_memory_usage(). The response reason phrase
+ * is part of the referenced input text.
+ *
+ * @param usage Output memory usage
+ * @param response Response to inspect
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ */
+HMAPI int httpmessage_response_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_response *response);
+
 HTTPMESSAGE_C_END
 
 #endif /* LIBHTTPMESSAGGE_MESSAGE_H__ */
@@ -0,0 +1,282 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file parser.h
+ * @brief Incremental message parser
+ */
+
+#if !defined (LIBHTTPMESSAGGE_PARSER_H__)
+#define LIBHTTPMESSAGGE_PARSER_H__
+
+#include "httpmessage/message.h"
+#include "httpmessage/chunked.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+/**
+ * @ingroup parser
+ *
+ * @brief Incremental parser states
+ */
+enum httpmessage_parser_state
+{
+	/** Waiting for the end of the request or status line */
+	HTTPMESSAGE_PARSER_FIRST_LINE = 0,
+	/** Waiting for header field lines or the empty line */
+	HTTPMESSAGE_PARSER_HEADERS,
+	/** Waiting for the message body */
+	HTTPMESSAGE_PARSER_BODY,
+	/** The message is complete */
+	HTTPMESSAGE_PARSER_COMPLETE,
+	/** An error occurred. See httpmessage_parser::error */
+	HTTPMESSAGE_PARSER_ERROR
+};
+
+struct __httpmessage_parser;
+
+/**
+ * @ingroup parser
+ *
+ * @brief Parser event callbacks
+ *
+ * Each callback is optional.
+ * String views refer to the input text and are only valid during the call.
+ *
+ * A callback returns ::HTTPMESSAGE_OK to continue parsing. Any other value
+ * stops the parser with the ::HTTPMESSAGE_ERROR_INTERRUPTED error.
+ * httpmessage_parser::offset is then the offset of the first input byte
+ * following the element given to the callback.
+ */
+typedef struct __httpmessage_parser_callbacks
+{
+	/** Request method */
+	int (*on_method)(
+	    struct __httpmessage_parser *parser,
+	    const httpmessage_stringview *method);
+	    
+	/** Request URI */
+	int (*on_request_uri)(
+	    struct __httpmessage_parser *parser,
+	    const httpmessage_stringview *request_uri);
+	    
+	/** Response status code and reason phrase */
+	int (*on_status)(
+	    struct __httpmessage_parser *parser,
+	    int status_code,
+	    const httpmessage_stringview *reason_phrase);
+	    
+	/** HTTP version of the request or status line */
+	int (*on_version)(
+	    struct __httpmessage_parser *parser,
+	    int major_version,
+	    int minor_version);
+	    
+	/**
+	 * @brief Header field
+	 *
+	 * The value is trimmed. The value of a header field spanning multiple lines
+	 * covers all lines, including the line breaks.
+	 */
+	int (*on_header)(
+	    struct __httpmessage_parser *parser,
+	    const httpmessage_stringview *name,
+	    const httpmessage_stringview *value);
+	    
+	/** End of the header */
+	int (*on_headers_complete)(struct __httpmessage_parser *parser);
+	
+	/** Body bytes received since the previous call */
+	int (*on_body_chunk)(
+	    struct __httpmessage_parser *parser,
+	    const char *text, size_t length);
+	    
+	/** End of the message */
+	int (*on_message_complete)(struct __httpmessage_parser *parser);
+} httpmessage_parser_callbacks;
+
+/**
+ * @ingroup parser
+ *
+ * @brief Incremental message parser
+ *
+ * The parser keeps track of its position in the input text, so that
+ * each call only processes the bytes received since the previous call.
+ * Input bytes are scanned once, regardless of the number of calls.
+ *
+ * The input text of a message must be contiguous and must keep its
+ * content between calls. It may be moved (ex. after a @c realloc()),
+ * in which case the message string views are moved accordingly.
+ */
+typedef struct __httpmessage_parser
+{
+	/**
+	 * @brief Message being parsed
+	 *
+	 * A httpmessage_request or a httpmessage_response, depending on the message type.
+	 * NULL when the parser reports the message elements through callbacks.
+	 */
+	httpmessage_message *message;
+	
+	/** Message type. ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE */
+	int type;
+	
+	/** Event callbacks */
+	const httpmessage_parser_callbacks *callbacks;
+	
+	/** User data available to the callbacks */
+	void *user_data;
+	
+	/** Input text given to the last call */
+	const char *text;
+	
+	/** Input text length given to the last call */
+	size_t length;
+	
+	/** Offset of the first input byte that is not part of a processed line or body */
+	size_t offset;
+	
+	/**
+	 * @brief Offset where the search of the end of the current line resumes.
+	 *
+	 * In the ::HTTPMESSAGE_PARSER_BODY state, end of the body bytes already processed.
+	 */
+	size_t scan_offset;
+	
+	/** Header field receiving continuation lines */
+	httpmessage_headerfield *current_field;
+	
+	/** Offset of the name of the header field not yet reported to the callbacks */
+	size_t field_name_offset;
+	
+	/** Length of the name of the header field not yet reported to the callbacks */
+	size_t field_name_length;
+	
+	/** Offset of the value of the header field not yet reported to the callbacks */
+	size_t field_value_offset;
+	
+	/** Length of the value of the header field not yet reported to the callbacks */
+	size_t field_value_length;
+	
+	/** Expected body length (::HTTPMESSAGE_FRAMING_LENGTH) */
+	size_t body_length;
+	
+	/** Chunked body decoder (::HTTPMESSAGE_FRAMING_CHUNKED) */
+	httpmessage_chunked_decoder chunked;
+	
+	/** Body framing. One of ::httpmessage_framing */
+	int framing;
+	
+	/** Parser state. One of ::httpmessage_parser_state */
+	int state;
+	
+	/** Option flags given to the init function */
+	int option_flags;
+	
+	/** Result code of the error in the ::HTTPMESSAGE_PARSER_ERROR state */
+	int error;
+} httpmessage_parser;
+
+/**
+ * @ingroup parser
+ *
+ * @brief Initialize a parser for a request message
+ *
+ * The request is cleared.
+ *
+ * @param parser Parser to initialize
+ * @param request Output request
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ */
+HMAPI void httpmessage_parser_init_request(
+    httpmessage_parser *parser,
+    httpmessage_request *request,
+    int option_flags);
+
+/**
+ * @ingroup parser
+ *
+ * @brief Initialize a parser for a response message
+ *
+ * The response is cleared.
+ *
+ * @param parser Parser to initialize
+ * @param response Output response
+ * @param option_flags Option flags. Supported flags are
+ * - ::HTTPMESSAGE_CLEAR_NO_FREE
+ * - ::HTTPMESSAGE_NO_ALLOCATION
+ * - ::HTTPMESSAGE_CONSUME_MERGE_TRAILER
+ */
+HMAPI void httpmessage_parser_init_response(
+    httpmessage_parser *parser,
+    httpmessage_response *response,
+    int option_flags);
+
+/**
+ * @ingroup parser
+ *
+ * @brief Initialize a parser reporting message elements through callbacks
+ *
+ * The parser does not allocate any memory.
+ * A header field is reported once the next line is received.
+ *
+ * @param parser Parser to initialize
+ * @param type Message type. ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE
+ * @param callbacks Event callbacks. Must remain valid while the parser is in use.
+ * @param user_data User data available to the callbacks
+ */
+HMAPI void httpmessage_parser_init_callbacks(
+    httpmessage_parser *parser,
+    int type,
+    const httpmessage_parser_callbacks *callbacks,
+    void *user_data);
+
+/**
+ * @ingroup parser
+ *
+ * @brief Parse the bytes received since the previous call
+ *
+ * The body framing is given by httpmessage_message_get_framing().
+ * The body of a response without Content-Length or Transfer-Encoding header field ends
+ * with the input (see httpmessage_parser_finish()).
+ * While the body is incomplete, the message body covers the bytes received so far.
+ * The body of a chunked message is the chunked text. The callbacks receive decoded chunk data.
+ *
+ * @param parser Parser
+ * @param text Input text, from the first byte of the message.
+ * The first @c parser->length bytes must be the ones given to the previous call.
+ * @param length Input text length. Must not be lower than the length given to the previous call.
+ *
+ * @return On success, the message size in bytes.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if more input is required.
+ * On error, one of httpmessage_result_code. Errors are persistent.
+ */
+HMAPI ssize_t httpmessage_parser_consume(
+    httpmessage_parser *parser,
+    const char *text, size_t length);
+
+/**
+ * @ingroup parser
+ *
+ * @brief Indicate the end of the input (ex. the connection was closed)
+ *
+ * @param parser Parser
+ *
+ * @return The message size in bytes if the message is complete.
+ * ::HTTPMESSAGE_ERROR_INCOMPLETE if the message is truncated.
+ * On error, one of httpmessage_result_code.
+ */
+HMAPI ssize_t httpmessage_parser_finish(httpmessage_parser *parser);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_PARSER_H__ */
@@ -0,0 +1,351 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file pool.h
+ * @brief Thread-safe pools of pre-allocated messages
+ */
+
+#if !defined (LIBHTTPMESSAGGE_POOL_H__)
+#define LIBHTTPMESSAGGE_POOL_H__
+
+#include "httpmessage/message.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+#include <stdint.h>
+
+/**
+ * @ingroup pool
+ *
+ * @brief Assumed CPU cache line size.
+ *
+ * Members of a pool modified by different threads are kept on distinct cache lines.
+ */
+#define HTTPMESSAGE_POOL_CACHE_LINE_SIZE 64
+
+/**
+ * @ingroup pool
+ *
+ * @brief Pool slot
+ *
+ * A slot holds a cached message or is part of the list of empty slots.
+ */
+typedef struct __httpmessage_pool_slot
+{
+	/** Cached message */
+	void *block;
+	/** Index of the next slot in the same stack */
+	uint32_t next_slot;
+	
+	HTTPMESSAGE_PAD64(__padding, 4) /**< structure padding */
+} httpmessage_pool_slot;
+
+/**
+ * @ingroup pool
+ *
+ * @brief Bounded lock-free pool of pre-allocated messages of a given shape
+ *
+ * Cached messages and empty slots are kept in two lock-free stacks.
+ * Each stack head packs a slot index and a modification counter
+ * in a single 64 bits word to prevent the ABA problem.
+ */
+typedef struct __httpmessage_pool
+{
+	/** Stack of slots holding a cached message */
+	uint64_t block_stack;
+	char __block_stack_padding[HTTPMESSAGE_POOL_CACHE_LINE_SIZE - sizeof(uint64_t)]; /**< cache line padding */
+	
+	/** Stack of empty slots */
+	uint64_t free_stack;
+	char __free_stack_padding[HTTPMESSAGE_POOL_CACHE_LINE_SIZE - sizeof(uint64_t)]; /**< cache line padding */
+	
+	/** Approximate number of cached messages */
+	uint32_t block_count;
+	
+	/**
+	 * @brief Message type
+	 *
+	 * ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE
+	 */
+	int type;
+	
+	/** Number of pre-allocated header fields of each message */
+	size_t max_headerfield_count;
+	/** Number of pre-allocated value lines per header field of each message */
+	size_t max_line_per_headerfield_value;
+	/** Maximum number of cached messages */
+	size_t capacity;
+	/** Slots */
+	httpmessage_pool_slot *slots;
+} httpmessage_pool;
+
+/**
+ * @ingroup pool
+ *
+ * @brief Create a message pool
+ *
+ * @param type Type of pooled messages. ::HTTPMESSAGE_TYPE_REQUEST or ::HTTPMESSAGE_TYPE_RESPONSE
+ * @param max_headerfield_count Number of pre-allocated header fields of each message
+ * @param max_line_per_headerfield_value Number of pre-allocated value lines per header field
+ * @param capacity Maximum number of cached messages
+ *
+ * @return The new pool or @c NULL on error
+ */
+HMAPI httpmessage_pool *httpmessage_pool_new(
+    int type,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    size_t capacity);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Free a pool and all its cached messages
+ *
+ * @param pool Pool to free
+ *
+ * @attention This function is not thread-safe. Messages acquired and not yet
+ * released are not affected and must be released with httpmessage_request_storage_free()
+ * or httpmessage_response_storage_free().
+ */
+HMAPI void httpmessage_pool_free(httpmessage_pool **pool);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Release cached messages until at most @c keep_count messages remain in the pool
+ *
+ * @param pool Pool
+ * @param keep_count Number of messages to keep
+ *
+ * @return Number of released messages
+ */
+HMAPI size_t httpmessage_pool_trim(
+    httpmessage_pool *pool,
+    size_t keep_count);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Get the number of cached messages
+ *
+ * @param pool Pool
+ * @return Number of cached messages. The value may be outdated as soon as it is returned.
+ */
+HMAPI size_t httpmessage_pool_count(const httpmessage_pool *pool);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Get a request from a request pool
+ *
+ * A new request is allocated with httpmessage_request_storage_new()
+ * if the pool is empty.
+ *
+ * @param pool Request pool
+ * @return A cleared request with pre-allocated storage or @c NULL on error.
+ *
+ * @attention The same rules as for httpmessage_request_storage_new() apply to the returned request.
+ */
+HMAPI httpmessage_request *httpmessage_pool_acquire_request(httpmessage_pool *pool);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a request back to its pool
+ *
+ * The request is cleared using ::HTTPMESSAGE_CLEAR_NO_FREE and its allocator is detached.
+ * If the request uses another allocator than the default one, the memory kept for reuse
+ * is released with this allocator first.
+ * The request is freed with httpmessage_request_storage_free() if the pool is full.
+ *
+ * @param pool Request pool
+ * @param request Request obtained with httpmessage_pool_acquire_request()
+ */
+HMAPI void httpmessage_pool_release_request(
+    httpmessage_pool *pool,
+    httpmessage_request *request);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Get a response from a response pool
+ *
+ * A new response is allocated with httpmessage_response_storage_new()
+ * if the pool is empty.
+ *
+ * @param pool Response pool
+ * @return A cleared response with pre-allocated storage or @c NULL on error.
+ *
+ * @attention The same rules as for httpmessage_response_storage_new() apply to the returned response.
+ */
+HMAPI httpmessage_response *httpmessage_pool_acquire_response(httpmessage_pool *pool);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a response back to its pool
+ *
+ * The response is cleared using ::HTTPMESSAGE_CLEAR_NO_FREE and its allocator is detached.
+ * If the response uses another allocator than the default one, the memory kept for reuse
+ * is released with this allocator first.
+ * The response is freed with httpmessage_response_storage_free() if the pool is full.
+ *
+ * @param pool Response pool
+ * @param response Response obtained with httpmessage_pool_acquire_response()
+ */
+HMAPI void httpmessage_pool_release_response(
+    httpmessage_pool *pool,
+    httpmessage_response *response);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Maximum number of messages kept by a pool cache.
+ */
+#define HTTPMESSAGE_POOL_CACHE_SIZE 16
+
+/**
+ * @ingroup pool
+ *
+ * @brief Number of messages exchanged at once between a pool cache and its pool
+ */
+#define HTTPMESSAGE_POOL_CACHE_BATCH_SIZE (HTTPMESSAGE_POOL_CACHE_SIZE / 2)
+
+/**
+ * @ingroup pool
+ *
+ * @brief Per-thread cache of pooled messages
+ *
+ * A cache is owned by a single thread and keeps the most recently released
+ * messages in a LIFO, so they are handed out again while still in CPU caches.
+ * Acquiring and releasing messages through the cache does not use any atomic operation,
+ * except when a batch of messages is exchanged with the shared pool.
+ *
+ * Messages released by other threads are pushed on the remote free list of
+ * their owner cache and collected by the owner thread on its next acquisition.
+ * Collected messages that do not fit in the cache go back to the pool.
+ */
+typedef struct __httpmessage_pool_cache
+{
+	/** Shared pool */
+	httpmessage_pool *pool;
+	
+	/** Messages released by other threads */
+	void *remote_free_list;
+	char __remote_free_list_padding[HTTPMESSAGE_POOL_CACHE_LINE_SIZE - sizeof(void *)]; /**< cache line padding */
+	
+	/** Number of cached messages */
+	size_t count;
+	/** Cached messages. The most recently released message is the last one. */
+	void *blocks[HTTPMESSAGE_POOL_CACHE_SIZE];
+} httpmessage_pool_cache;
+
+/**
+ * @ingroup pool
+ *
+ * @brief Initialize a pool cache
+ *
+ * @param cache Cache to initialize
+ * @param pool Shared pool
+ */
+HMAPI void httpmessage_pool_cache_init(
+    httpmessage_pool_cache *cache,
+    httpmessage_pool *pool);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give all messages of a cache back to its pool
+ *
+ * Must be called by the owner thread before it exits,
+ * once no other thread may release messages to this cache.
+ *
+ * @param cache Cache to flush
+ */
+HMAPI void httpmessage_pool_cache_flush(httpmessage_pool_cache *cache);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Get a request from a cache.
+ *
+ * @param cache Cache of a request pool, owned by the calling thread
+ * @return A cleared request with pre-allocated storage or @c NULL on error.
+ */
+HMAPI httpmessage_request *httpmessage_pool_cache_acquire_request(
+    httpmessage_pool_cache *cache);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a request back to the cache of the calling thread.
+ *
+ * @param cache Cache owned by the calling thread
+ * @param request Request to release
+ */
+HMAPI void httpmessage_pool_cache_release_request(
+    httpmessage_pool_cache *cache,
+    httpmessage_request *request);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a request back to the cache of another thread.
+ *
+ * This function can be called from any thread.
+ *
+ * @param owner Cache the request was acquired from
+ * @param request Request to release
+ */
+HMAPI void httpmessage_pool_cache_remote_release_request(
+    httpmessage_pool_cache *owner,
+    httpmessage_request *request);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Get a response from a cache.
+ *
+ * @param cache Cache of a response pool, owned by the calling thread
+ * @return A cleared response with pre-allocated storage or @c NULL on error.
+ */
+HMAPI httpmessage_response *httpmessage_pool_cache_acquire_response(
+    httpmessage_pool_cache *cache);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a response back to the cache of the calling thread.
+ *
+ * @param cache Cache owned by the calling thread
+ * @param response Response to release
+ */
+HMAPI void httpmessage_pool_cache_release_response(
+    httpmessage_pool_cache *cache,
+    httpmessage_response *response);
+
+/**
+ * @ingroup pool
+ *
+ * @brief Give a response back to the cache of another thread.
+ *
+ * This function can be called from any thread.
+ *
+ * @param owner Cache the response was acquired from
+ * @param response Response to release
+ */
+HMAPI void httpmessage_pool_cache_remote_release_response(
+    httpmessage_pool_cache *owner,
+    httpmessage_response *response);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_POOL_H__ */
@@ -126,7 +126,7 @@
  */
 #define HTTPMESSAGE_TEXT_WRITE_BUFFER(_output, _output_size, _text, _length) { \
 	if ((size_t)(_output_size) < (size_t)(_length)) return HTTPMESSAGE_ERROR_OVERFLOW; \
-	memcpy (_output, _text, _length); \
+	if ((size_t)(_length)) memcpy (_output, _text, _length); \
 	_output += (size_t)(_length); _output_size -= (size_t)(_length); \
 }
 
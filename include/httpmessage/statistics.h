@@ -0,0 +1,188 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/**
+ * @file statistics.h
+ * @brief Message shape statistics
+ */
+
+#if !defined (LIBHTTPMESSAGGE_STATISTICS_H__)
+#define LIBHTTPMESSAGGE_STATISTICS_H__
+
+#include "httpmessage/message.h"
+#include "httpmessage/preprocessor.h"
+
+HTTPMESSAGE_C_BEGIN
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Number of buckets of a histogram.
+ */
+#define HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT 64
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Fixed-size histogram of unsigned values
+ *
+ * Bucket @c i counts values in the range [ i * bucket_width, (i + 1) * bucket_width [.
+ * The last bucket counts all larger values.
+ */
+typedef struct __httpmessage_histogram
+{
+	/** Value range covered by each bucket */
+	size_t bucket_width;
+	/** Number of samples */
+	size_t sample_count;
+	/** Largest sample value */
+	size_t maximum;
+	/** Sample count per bucket */
+	size_t buckets[HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT];
+} httpmessage_histogram;
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Initialize an empty histogram
+ *
+ * @param histogram Histogram to initialize
+ * @param bucket_width Value range covered by each bucket. If zero, 1 is used.
+ */
+HMAPI void httpmessage_histogram_init(
+    httpmessage_histogram *histogram,
+    size_t bucket_width);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Add a sample to a histogram
+ *
+ * @param histogram Histogram
+ * @param value Sample value
+ */
+HMAPI void httpmessage_histogram_add(
+    httpmessage_histogram *histogram,
+    size_t value);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Add all samples of a histogram to another one
+ *
+ * @param histogram Target histogram
+ * @param other Histogram to merge. Must have the same bucket width as @c histogram
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ * if bucket widths differ.
+ */
+HMAPI int httpmessage_histogram_merge(
+    httpmessage_histogram *histogram,
+    const httpmessage_histogram *other);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Get the value below or equal to which the given percentage of samples fall.
+ *
+ * The result is rounded up to the upper bound of the bucket
+ * and never exceeds the largest sample value.
+ *
+ * @param histogram Histogram
+ * @param percentile Percentage of samples, in the range ]0, 100]
+ *
+ * @return Percentile value. 0 if the histogram does not contain any sample.
+ */
+HMAPI size_t httpmessage_histogram_percentile(
+    const httpmessage_histogram *histogram,
+    double percentile);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Aggregated shape of parsed messages
+ *
+ * Used to size pre-allocated message storage and input buffers
+ * from observed traffic.
+ */
+typedef struct __httpmessage_statistics
+{
+	/** Number of header fields per message */
+	httpmessage_histogram headerfield_count;
+	/** Maximum number of lines of a header field value, per message */
+	httpmessage_histogram line_per_value;
+	/** Size of the header block (first line, header fields and empty line) */
+	httpmessage_histogram header_size;
+	/** Length of the request or status line, including CRLF */
+	httpmessage_histogram first_line_length;
+} httpmessage_statistics;
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Initialize statistics
+ *
+ * @param statistics Statistics to initialize
+ */
+HMAPI void httpmessage_statistics_init(httpmessage_statistics *statistics);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Record the shape of a parsed message
+ *
+ * @param statistics Statistics
+ * @param message Message successfully parsed from @c text
+ * @param text Input text given to the @c *_consume function
+ * @param consumed Number of bytes consumed by the @c *_consume function
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ */
+HMAPI int httpmessage_statistics_add_message(
+    httpmessage_statistics *statistics,
+    const httpmessage_message *message,
+    const char *text, size_t consumed);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Add statistics collected elsewhere (ex. by another thread)
+ *
+ * @param statistics Target statistics
+ * @param other Statistics to merge
+ */
+HMAPI void httpmessage_statistics_merge(
+    httpmessage_statistics *statistics,
+    const httpmessage_statistics *other);
+
+/**
+ * @ingroup statistics
+ *
+ * @brief Recommend pre-allocated storage parameters
+ *
+ * The returned values are suitable arguments for httpmessage_request_storage_new()
+ * or httpmessage_response_storage_new() and cover the given percentage of
+ * the recorded messages.
+ *
+ * @param max_headerfield_count Output number of header fields
+ * @param max_line_per_headerfield_value Output number of lines per header field value
+ * @param statistics Statistics
+ * @param percentile Percentage of messages to cover, in the range ]0, 100]
+ *
+ * @return ::HTTPMESSAGE_OK or ::HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+ * if @c percentile is out of range or no message was recorded.
+ */
+HMAPI int httpmessage_statistics_get_storage_parameters(
+    size_t *max_headerfield_count,
+    size_t *max_line_per_headerfield_value,
+    const httpmessage_statistics *statistics,
+    double percentile);
+
+HTTPMESSAGE_C_END
+
+#endif /* LIBHTTPMESSAGGE_STATISTICS_H__ */
@@ -26,5 +26,8 @@ do
 		links {
 			"httpmessage"
 		}
+		filter "system:linux"
+			links { "pthread" }
+		filter {}
 	end
 	
@@ -23,5 +23,8 @@ do
 		links {
 			"httpmessage"
 		}
+		filter "system:linux"
+			links { "pthread" }
+		filter {}
 	end
 	
@@ -0,0 +1,308 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+/*
+ * Compare pre-allocated message storage allocated with malloc()
+ * and with the huge page allocator.
+ *
+ * A large number of request storage blocks are allocated, then requests
+ * are parsed into the blocks in a random order. The elapsed time and,
+ * when available (Linux perf events), the number of data TLB misses are reported.
+ */
+
+#if defined (__linux__) && !defined (_DEFAULT_SOURCE)
+/* syscall(), clock_gettime() */
+#define _DEFAULT_SOURCE
+#endif
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined (__linux__)
+#	include <sys/syscall.h>
+#	include <sys/ioctl.h>
+#	include <linux/perf_event.h>
+#endif
+
+#define BENCHMARK_MESSAGE_COUNT 20000
+#define BENCHMARK_PASS_COUNT 8
+#define BENCHMARK_HEADERFIELD_COUNT 32
+#define BENCHMARK_LINE_PER_VALUE 2
+
+typedef struct __benchmark_backend
+{
+	const char *name;
+	int strategies; /* 0 for malloc() */
+} benchmark_backend;
+
+typedef struct __benchmark_result
+{
+	double seconds;
+	long long tlb_misses; /* -1 if not available */
+	size_t region_count;
+} benchmark_result;
+
+int tlb_counter_open(void);
+void tlb_counter_start(int fd);
+long long tlb_counter_stop(int fd);
+double now(void);
+int run_benchmark(benchmark_result *result,
+                  const benchmark_backend *backend,
+                  size_t message_count, size_t pass_count);
+
+static const char *benchmark_text =
+    "GET /benchmark/resource?query=string HTTP/1.1\r\n"
+    "Host: example.org\r\n"
+    "User-Agent: httpmessage-benchmark/1.0\r\n"
+    "Accept: text/html,\r\n"
+    " application/xhtml+xml\r\n"
+    "Accept-Language: fr, en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: no-cache\r\n"
+    "\r\n";
+
+int tlb_counter_open(void)
+{
+#if defined (__linux__)
+	struct perf_event_attr attributes;
+	memset(&attributes, 0, sizeof(attributes));
+	attributes.type = PERF_TYPE_HW_CACHE;
+	attributes.size = sizeof(attributes);
+	attributes.config = PERF_COUNT_HW_CACHE_DTLB
+	                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+	                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attributes.disabled = 1;
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+void tlb_counter_start(int fd)
+{
+#if defined (__linux__)
+	if (fd >= 0)
+	{
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#else
+	(void) fd;
+#endif
+}
+
+long long tlb_counter_stop(int fd)
+{
+#if defined (__linux__)
+	long long count;
+	
+	if (fd < 0)
+	{
+		return -1;
+	}
+	
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	
+	if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+	{
+		return -1;
+	}
+	
+	return count;
+#else
+	(void) fd;
+	return -1;
+#endif
+}
+
+double now(void)
+{
+#if defined (CLOCK_MONOTONIC)
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + ((double)t.tv_nsec / 1000000000.0);
+#else
+	return (double)clock() / (double)CLOCKS_PER_SEC;
+#endif
+}
+
+int run_benchmark(benchmark_result *result,
+                  const benchmark_backend *backend,
+                  size_t message_count, size_t pass_count)
+{
+	httpmessage_hugepage_allocator hugepage_allocator;
+	httpmessage_allocator *allocator = NULL;
+	httpmessage_request **requests;
+	size_t *order;
+	size_t length = strlen(benchmark_text);
+	size_t a, pass;
+	int exit_code = EXIT_SUCCESS;
+	int fd;
+	double start;
+	
+	requests = (httpmessage_request **)calloc(message_count, sizeof(httpmessage_request *));
+	order = (size_t *)malloc(message_count * sizeof(size_t));
+	
+	if (!(requests && order))
+	{
+		free(requests);
+		free(order);
+		return EXIT_FAILURE;
+	}
+	
+	if (backend->strategies)
+	{
+		httpmessage_hugepage_allocator_init(&hugepage_allocator,
+		                                    httpmessage_request_storage_size(BENCHMARK_HEADERFIELD_COUNT,
+		                                            BENCHMARK_LINE_PER_VALUE),
+		                                    backend->strategies);
+		allocator = &hugepage_allocator.allocator;
+	}
+	
+	for (a = 0; a < message_count; ++a)
+	{
+		requests[a] = httpmessage_request_storage_new_with_allocator(
+		                  BENCHMARK_HEADERFIELD_COUNT, BENCHMARK_LINE_PER_VALUE,
+		                  allocator);
+		                  
+		if (!requests[a])
+		{
+			fprintf(stderr, "Failed to allocate request %lu\n", (unsigned long)a);
+			exit_code = EXIT_FAILURE;
+			goto run_benchmark_cleanup;
+		}
+		
+		order[a] = a;
+	}
+	
+	/* Random access order, the same for all backends */
+	srand(42);
+	
+	for (a = message_count - 1; a > 0; --a)
+	{
+		size_t b = (size_t)rand() % (a + 1);
+		size_t t = order[a];
+		order[a] = order[b];
+		order[b] = t;
+	}
+	
+	fd = tlb_counter_open();
+	start = now();
+	tlb_counter_start(fd);
+	
+	for (pass = 0; pass < pass_count; ++pass)
+	{
+		for (a = 0; a < message_count; ++a)
+		{
+			if (httpmessage_request_consume(requests[order[a]],
+			                                benchmark_text, length,
+			                                HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION)
+			        != (ssize_t)length)
+			{
+				exit_code = EXIT_FAILURE;
+			}
+		}
+	}
+	
+	result->tlb_misses = tlb_counter_stop(fd);
+	result->seconds = now() - start;
+	result->region_count = (backend->strategies
+	                        ? httpmessage_hugepage_allocator_region_count(&hugepage_allocator,
+	                                HTTPMESSAGE_HUGEPAGE_HUGETLB | HTTPMESSAGE_HUGEPAGE_TRANSPARENT)
+	                        : 0);
+	                        
+	if (fd >= 0)
+	{
+		close(fd);
+	}
+
+run_benchmark_cleanup:
+	for (a = 0; a < message_count && requests[a]; ++a)
+	{
+		httpmessage_allocator_release(allocator, requests[a]);
+	}
+	
+	if (backend->strategies)
+	{
+		httpmessage_hugepage_allocator_clear(&hugepage_allocator);
+	}
+	
+	free(requests);
+	free(order);
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const benchmark_backend backends[] =
+	{
+		{ "malloc", 0 },
+		{ "regions", HTTPMESSAGE_HUGEPAGE_FALLBACK },
+		{ "hugepages", HTTPMESSAGE_HUGEPAGE_ANY }
+	};
+	size_t message_count = BENCHMARK_MESSAGE_COUNT;
+	size_t pass_count = BENCHMARK_PASS_COUNT;
+	size_t a;
+	
+	if (argc > 1)
+	{
+		message_count = (size_t)strtoul(argv[1], NULL, 10);
+	}
+	
+	if (argc > 2)
+	{
+		pass_count = (size_t)strtoul(argv[2], NULL, 10);
+	}
+	
+	if (!(message_count && pass_count))
+	{
+		fprintf(stderr, "Usage: %s [message count] [pass count]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	fprintf(stdout, "%lu messages of %lu bytes, %lu passes\n",
+	        (unsigned long)message_count,
+	        (unsigned long)httpmessage_request_storage_size(BENCHMARK_HEADERFIELD_COUNT,
+	                BENCHMARK_LINE_PER_VALUE),
+	        (unsigned long)pass_count);
+	fprintf(stdout, "%-12s %12s %16s %14s\n",
+	        "Backend", "Time (s)", "dTLB misses", "Huge regions");
+	        
+	for (a = 0; a < (sizeof(backends) / sizeof(benchmark_backend)); ++a)
+	{
+		benchmark_result result;
+		
+		if (run_benchmark(&result, &backends[a], message_count, pass_count) != EXIT_SUCCESS)
+		{
+			fprintf(stderr, "%s benchmark failed\n", backends[a].name);
+			return EXIT_FAILURE;
+		}
+		
+		if (result.tlb_misses >= 0)
+		{
+			fprintf(stdout, "%-12s %12.3f %16lld %14lu\n", backends[a].name,
+			        result.seconds, result.tlb_misses,
+			        (unsigned long)result.region_count);
+		}
+		else
+		{
+			fprintf(stdout, "%-12s %12.3f %16s %14lu\n", backends[a].name,
+			        result.seconds, "n/a",
+			        (unsigned long)result.region_count);
+		}
+	}
+	
+	return EXIT_SUCCESS;
+}
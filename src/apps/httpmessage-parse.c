@@ -17,9 +17,18 @@
 #else
 #	include <error.h>
 #endif
+#if defined(__unix__) || defined(__APPLE__)
+#	include <pthread.h>
+#	define HTTPMESSAGE_PARSE_THREADS 1
+#endif
 
 #define MESSAGE_MAX_LENGTH 4095
 
+/* Capture files */
+#define CAPTURE_MAX_RANGE_COUNT 256
+#define CAPTURE_MIN_RANGE_SIZE 65536
+#define CAPTURE_MAX_HEADERFIELD_COUNT 32
+
 void print_message(FILE *stream, const httpmessage_message *message);
 void print_response(FILE *stream, const httpmessage_response *response);
 void print_request(FILE *stream, const httpmessage_request *request);
@@ -27,6 +36,8 @@ int parse_response_text(const char *text, size_t length);
 int parse_request_text(const char *text, size_t length);
 int parse_text(const char *text, size_t length);
 int parse_file(FILE *file);
+size_t get_thread_count(void);
+int parse_capture(FILE *file, size_t range_count);
 
 
 void print_message(FILE *stream, const httpmessage_message *message)
@@ -172,15 +183,189 @@ int parse_file(FILE *file)
 	return EXIT_FAILURE;
 }
 
+size_t get_thread_count(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	
+	if (count > 0)
+	{
+		return (size_t)count;
+	}
+
+#endif
+	return 1;
+}
+
+#if defined(HTTPMESSAGE_PARSE_THREADS)
+static void *frame_capture_range(void *range)
+{
+	httpmessage_capture_range_frame((httpmessage_capture_range *)range);
+	return NULL;
+}
+#endif
+
+int parse_capture(FILE *file, size_t range_count)
+{
+	httpmessage_capture_range ranges[CAPTURE_MAX_RANGE_COUNT];
+#if defined(HTTPMESSAGE_PARSE_THREADS)
+	pthread_t threads[CAPTURE_MAX_RANGE_COUNT];
+	int started[CAPTURE_MAX_RANGE_COUNT];
+#endif
+	int exit_code = EXIT_SUCCESS;
+	ssize_t result = HTTPMESSAGE_OK;
+	size_t length;
+	size_t r, f;
+	char *text;
+	long size;
+	
+	if (fseek(file, 0, SEEK_END) != 0
+	        || (size = ftell(file)) < 0
+	        || fseek(file, 0, SEEK_SET) != 0)
+	{
+		fprintf(stderr, "Failed to get capture file size\n");
+		return EXIT_FAILURE;
+	}
+	
+	length = (size_t)size;
+	text = (char *)malloc(length ? length : 1);
+	
+	if (!text || fread(text, 1, length, file) != length)
+	{
+		fprintf(stderr, "Failed to read capture file\n");
+		free(text);
+		return EXIT_FAILURE;
+	}
+	
+	/* Small ranges are not worth a thread */
+	if (range_count > (length / CAPTURE_MIN_RANGE_SIZE) + 1)
+	{
+		range_count = (length / CAPTURE_MIN_RANGE_SIZE) + 1;
+	}
+	
+	if (range_count > CAPTURE_MAX_RANGE_COUNT)
+	{
+		range_count = CAPTURE_MAX_RANGE_COUNT;
+	}
+	
+	if (range_count == 0)
+	{
+		range_count = 1;
+	}
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		result = httpmessage_capture_range_init(&ranges[r], text, length,
+		                                        (length / range_count) * r,
+		                                        ((r + 1) == range_count)
+		                                        ? length : (length / range_count) * (r + 1),
+		                                        CAPTURE_MAX_HEADERFIELD_COUNT, 0);
+		                                        
+		if (result != HTTPMESSAGE_OK)
+		{
+			range_count = r;
+			goto parse_capture_end;
+		}
+	}
+
+#if defined(HTTPMESSAGE_PARSE_THREADS)
+	
+	for (r = 1; r < range_count; ++r)
+	{
+		started[r] = (pthread_create(&threads[r], NULL,
+		                             frame_capture_range, &ranges[r]) == 0);
+	}
+	
+	httpmessage_capture_range_frame(&ranges[0]);
+	
+	for (r = 1; r < range_count; ++r)
+	{
+		if (started[r])
+		{
+			pthread_join(threads[r], NULL);
+		}
+		else
+		{
+			httpmessage_capture_range_frame(&ranges[r]);
+		}
+	}
+
+#else
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		httpmessage_capture_range_frame(&ranges[r]);
+	}
+
+#endif
+	
+	result = httpmessage_capture_stitch(ranges, range_count);
+
+parse_capture_end:
+	
+	if (result < 0)
+	{
+		fprintf(stderr, "Failed to frame capture (%s)\n",
+		        httpmessage_result_get_text((int)result));
+		exit_code = EXIT_FAILURE;
+	}
+	else
+	{
+		for (r = 0; r < range_count; ++r)
+		{
+			for (f = 0; f < ranges[r].frame_count; ++f)
+			{
+				const httpmessage_capture_frame *frame = &ranges[r].frames[f];
+				fprintf(stdout, "%zu\t%zu\t%s\n", frame->offset, frame->length,
+				        (frame->type == HTTPMESSAGE_TYPE_RESPONSE)
+				        ? "Response" : "Request");
+			}
+			
+			if (ranges[r].result != HTTPMESSAGE_OK)
+			{
+				fprintf(stderr, "Failed to parse message at offset %zu (%s)\n",
+				        ranges[r].stop,
+				        httpmessage_result_get_text((int)ranges[r].result));
+				exit_code = EXIT_FAILURE;
+			}
+		}
+	}
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		httpmessage_capture_range_clear(&ranges[r]);
+	}
+	
+	free(text);
+	return exit_code;
+}
+
 int main(int argc, const char **argv)
 {
 	size_t command_line_message_count = 0;
+	size_t thread_count = get_thread_count();
+	int capture = 0;
 	int result;
 	int a;
 	
 	for (a = 1; a < argc; ++a)
 	{
-		FILE *file = fopen(argv[a], "rb");
+		FILE *file;
+		
+		/* Files of concatenated messages */
+		if (strcmp(argv[a], "--capture") == 0)
+		{
+			capture = 1;
+			continue;
+		}
+		
+		if (strcmp(argv[a], "--threads") == 0 && (a + 1) < argc)
+		{
+			thread_count = (size_t)strtoul(argv[++a], NULL, 10);
+			continue;
+		}
+		
+		file = fopen(argv[a], "rb");
 		
 		if (!file)
 		{
@@ -190,7 +375,7 @@ int main(int argc, const char **argv)
 		}
 		
 		++command_line_message_count;
-		result = parse_file(file);
+		result = (capture ? parse_capture(file, thread_count) : parse_file(file));
 		fclose(file);
 		
 		if (result != 0)
@@ -204,6 +389,12 @@ int main(int argc, const char **argv)
 		return EXIT_SUCCESS;
 	}
 	
+	if (capture)
+	{
+		fprintf(stderr, "Capture file is required\n");
+		return EXIT_FAILURE;
+	}
+	
 	fflush(stdout);
 	return parse_file(stdin);
 }
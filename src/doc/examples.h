@@ -13,3 +13,9 @@
  * Demonstrates how to use pre-allocated message storage
  * to read messages with a single run time allocation.
  */
+
+/**
+ * @example static-storage.c
+ * Demonstrates how to declare requests with compile-time sized storage
+ * that do not require any dynamic allocation.
+ */
@@ -0,0 +1,34 @@
+/*
+ * Request type with at most 16 header fields
+ * and header field values on at most 2 lines
+ */
+HTTPMESSAGE_DECLARE_REQUEST_STORAGE(connection_request, 16, 2);
+
+typedef struct
+{
+	int socket;
+	/* Request storage is part of the connection */
+	connection_request request_storage;
+} connection;
+
+/* No dynamic allocation at all */
+static connection connections[64];
+
+void connection_init(connection *c, int socket)
+{
+	c->socket = socket;
+	HTTPMESSAGE_REQUEST_STORAGE_INIT(connection_request, &c->request_storage);
+}
+
+int connection_read(connection *c, const char *text, size_t text_length)
+{
+	/*
+	 * As with httpmessage_request_storage_new(), these option flags are MANDATORY
+	 */
+	return httpmessage_request_consume(&c->request_storage.request,
+	                                   text, text_length,
+	                                   HTTPMESSAGE_CLEAR_NO_FREE
+	                                   | HTTPMESSAGE_NO_ALLOCATION);
+}
+
+/* Nothing to free */
@@ -49,7 +49,7 @@ while ( some_condition )
 }
 
 /* Free request memory block */
-free (request);
+httpmessage_request_storage_free (&request);
 
 
 
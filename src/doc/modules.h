@@ -4,4 +4,12 @@
 * @defgroup grammar General RFC 2616 grammar utility
 * @defgroup header HTTP header field and values
 * @defgroup message HTTP messages
+* @defgroup copy Message copies
+* @defgroup parser Incremental parser
+* @defgroup chunked Chunked transfer coding
+* @defgroup connection Persistent connections
+* @defgroup capture Capture files
+* @defgroup memory Memory management
+* @defgroup pool Message pools
+* @defgroup statistics Message statistics
 */
@@ -0,0 +1,235 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+
+/* Initial number of frames of a range */
+#define HTTPMESSAGE_CAPTURE_FRAME_CAPACITY 64
+
+size_t httpmessage_capture_synchronize(
+    const char *text, size_t length,
+    size_t offset)
+{
+	const char *end = text + length;
+	const char *cursor;
+	
+	if (offset == 0)
+	{
+		return 0;
+	}
+	
+	if (offset >= length)
+	{
+		return length;
+	}
+	
+	/* Include a line feed right before the offset */
+	cursor = text + offset - 1;
+	
+	while (cursor < end)
+	{
+		const char *lf = (const char *)memchr(cursor, '\n', (size_t)(end - cursor));
+		
+		if (!lf)
+		{
+			break;
+		}
+		
+		cursor = lf + 1;
+		
+		if (lf > text && *(lf - 1) == '\r'
+		        && cursor < end
+		        && httpmessage_message_get_type(cursor, (size_t)(end - cursor), 0)
+		        != HTTPMESSAGE_TYPE_UNKNOWN)
+		{
+			return (size_t)(cursor - text);
+		}
+	}
+	
+	return length;
+}
+
+int httpmessage_capture_range_init(
+    httpmessage_capture_range *range,
+    const char *text, size_t length,
+    size_t begin, size_t end,
+    size_t max_headerfield_count,
+    int option_flags)
+{
+	if (!(range && (text || !length) && begin <= end && end <= length))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	range->text = text;
+	range->length = length;
+	range->begin = begin;
+	range->end = end;
+	range->frames = NULL;
+	range->frame_count = 0;
+	range->frame_capacity = 0;
+	range->stop = begin;
+	range->result = HTTPMESSAGE_OK;
+	range->option_flags = (option_flags | HTTPMESSAGE_CLEAR_NO_FREE);
+	range->request = httpmessage_request_storage_new(max_headerfield_count, 1);
+	range->response = httpmessage_response_storage_new(max_headerfield_count, 1);
+	
+	if (!(range->request && range->response))
+	{
+		httpmessage_capture_range_clear(range);
+		return HTTPMESSAGE_ERROR_ALLOCATION;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+void httpmessage_capture_range_clear(httpmessage_capture_range *range)
+{
+	httpmessage_request_storage_free(&range->request);
+	httpmessage_response_storage_free(&range->response);
+	httpmessage_allocator_release(NULL, range->frames);
+	range->frames = NULL;
+	range->frame_count = 0;
+	range->frame_capacity = 0;
+}
+
+/* Frame the messages starting between offset and the end of the range */
+static ssize_t httpmessage_capture_range_frame_from(
+    httpmessage_capture_range *range,
+    size_t offset)
+{
+	httpmessage_pipeline pipeline;
+	httpmessage_pipeline_init(&pipeline, range->text, range->length,
+	                          range->option_flags);
+	pipeline.offset = offset;
+	range->frame_count = 0;
+	range->result = HTTPMESSAGE_OK;
+	
+	while (pipeline.offset < range->end)
+	{
+		httpmessage_capture_frame *frame;
+		ssize_t result;
+		int type = httpmessage_message_get_type(
+		               range->text + pipeline.offset,
+		               range->length - pipeline.offset, 0);
+		               
+		/* Anything else fails as a request would in a sequential parse */
+		if (type == HTTPMESSAGE_TYPE_RESPONSE)
+		{
+			result = httpmessage_pipeline_response_consume(&pipeline, range->response);
+		}
+		else
+		{
+			type = HTTPMESSAGE_TYPE_REQUEST;
+			result = httpmessage_pipeline_request_consume(&pipeline, range->request);
+		}
+		
+		if (result <= 0)
+		{
+			range->result = (result < 0) ? result : HTTPMESSAGE_ERROR_SYNTAX;
+			break;
+		}
+		
+		if (range->frame_count == range->frame_capacity)
+		{
+			size_t capacity = (range->frame_capacity
+			                   ? (2 * range->frame_capacity)
+			                   : HTTPMESSAGE_CAPTURE_FRAME_CAPACITY);
+			frame = (httpmessage_capture_frame *)httpmessage_allocator_allocate(NULL,
+			            capacity * sizeof(httpmessage_capture_frame));
+			            
+			if (!frame)
+			{
+				return HTTPMESSAGE_ERROR_ALLOCATION;
+			}
+			
+			if (range->frame_count)
+			{
+				memcpy(frame, range->frames,
+				       range->frame_count * sizeof(httpmessage_capture_frame));
+			}
+			
+			httpmessage_allocator_release(NULL, range->frames);
+			range->frames = frame;
+			range->frame_capacity = capacity;
+		}
+		
+		frame = &range->frames[range->frame_count];
+		frame->offset = pipeline.offset - (size_t)result;
+		frame->length = (size_t)result;
+		frame->type = type;
+		++range->frame_count;
+	}
+	
+	range->stop = pipeline.offset;
+	return (ssize_t)range->frame_count;
+}
+
+ssize_t httpmessage_capture_range_frame(httpmessage_capture_range *range)
+{
+	return httpmessage_capture_range_frame_from(range,
+	        httpmessage_capture_synchronize(range->text, range->length, range->begin));
+}
+
+ssize_t httpmessage_capture_stitch(
+    httpmessage_capture_range *ranges,
+    size_t range_count)
+{
+	size_t offset = 0;
+	size_t frame_count = 0;
+	int stopped = 0;
+	size_t r;
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		httpmessage_capture_range *range = &ranges[r];
+		size_t f = 0;
+		
+		/* The range is covered by the previous message or follows a parse error */
+		if (stopped || offset >= range->end)
+		{
+			range->frame_count = 0;
+			range->result = HTTPMESSAGE_OK;
+			range->stop = offset;
+			continue;
+		}
+		
+		while (f < range->frame_count && range->frames[f].offset < offset)
+		{
+			++f;
+		}
+		
+		if (f < range->frame_count && range->frames[f].offset == offset)
+		{
+			/* Drop the frames of a wrong synchronization */
+			if (f)
+			{
+				range->frame_count -= f;
+				memmove(range->frames, range->frames + f,
+				        range->frame_count * sizeof(httpmessage_capture_frame));
+			}
+		}
+		else
+		{
+			ssize_t result = httpmessage_capture_range_frame_from(range, offset);
+			
+			if (result < 0)
+			{
+				return result;
+			}
+		}
+		
+		frame_count += range->frame_count;
+		offset = range->stop;
+		stopped = (range->result != HTTPMESSAGE_OK);
+	}
+	
+	return (ssize_t)frame_count;
+}
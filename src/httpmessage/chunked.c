@@ -0,0 +1,687 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+
+/* Value of hexadecimal digits, -1 for other characters */
+static const signed char httpmessage_hex_digit_values[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+#define HTTPMESSAGE_CHUNK_SIZE_MAX (((size_t)-1) >> 4)
+
+ssize_t httpmessage_chunk_size_consume(
+    size_t *output,
+    const char *text, size_t length)
+{
+	size_t value = 0;
+	const char *t = text;
+	const char *end = text + length;
+	
+	if (!(text && length))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	for (; t < end; ++t)
+	{
+		int digit = httpmessage_hex_digit_values[(unsigned char)*t];
+		
+		if (digit < 0)
+		{
+			break;
+		}
+		
+		if (value > HTTPMESSAGE_CHUNK_SIZE_MAX)
+		{
+			return HTTPMESSAGE_ERROR_OVERFLOW;
+		}
+		
+		value = (value << 4) | (size_t)digit;
+	}
+	
+	if (t == text)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (output)
+	{
+		*output = value;
+	}
+	
+	return (ssize_t)(t - text);
+}
+
+int httpmessage_transfer_coding_is_chunked(
+    const char *text, size_t length)
+{
+	httpmessage_stringview coding;
+	size_t offset;
+	
+	/* Trailing white spaces and line breaks of multi-line values */
+	while (length && (httpmessage_text_is_LWS(text[length - 1])
+	                  || text[length - 1] == '\r' || text[length - 1] == '\n'))
+	{
+		--length;
+	}
+	
+	offset = length;
+	
+	while (offset && text[offset - 1] != ',')
+	{
+		--offset;
+	}
+	
+	while (offset < length
+	        && (httpmessage_text_is_LWS(text[offset])
+	            || text[offset] == '\r' || text[offset] == '\n'))
+	{
+		++offset;
+	}
+	
+	coding.text = text + offset;
+	coding.length = length - offset;
+	return (coding.length == 7
+	        && httpmessage_stringview_caseless_compare_text(&coding, "chunked", 7) == 0);
+}
+
+void httpmessage_chunked_decoder_init(httpmessage_chunked_decoder *decoder)
+{
+	decoder->chunk_length = 0;
+	decoder->body_length = 0;
+	decoder->trailer_length = 0;
+	httpmessage_stringview_clear(&decoder->trailer);
+	decoder->state = HTTPMESSAGE_CHUNKED_SIZE;
+	decoder->error = HTTPMESSAGE_OK;
+}
+
+/* Token characters are ASCII */
+static int httpmessage_chunked_extension_is_tchar(int c)
+{
+	return (c < 0x80) && httpmessage_text_is_token_char(c);
+}
+
+/*
+ * State following a character of a chunk extension.
+ * -1 if the character is not allowed in the given state.
+ */
+static int httpmessage_chunked_extension_next_state(int state, int c)
+{
+	switch (state)
+	{
+		case HTTPMESSAGE_CHUNKED_EXTENSION:
+			if (httpmessage_text_is_LWS(c))
+			{
+				return state;
+			}
+			
+			return (c == ';') ? HTTPMESSAGE_CHUNKED_EXTENSION_NAME_START : -1;
+		
+		case HTTPMESSAGE_CHUNKED_EXTENSION_NAME_START:
+			if (httpmessage_text_is_LWS(c))
+			{
+				return state;
+			}
+			
+			return httpmessage_chunked_extension_is_tchar(c)
+			       ? HTTPMESSAGE_CHUNKED_EXTENSION_NAME : -1;
+			       
+		case HTTPMESSAGE_CHUNKED_EXTENSION_NAME:
+			if (c == '=')
+			{
+				return HTTPMESSAGE_CHUNKED_EXTENSION_VALUE_START;
+			}
+			
+			if (httpmessage_chunked_extension_is_tchar(c))
+			{
+				return state;
+			}
+			
+			break;
+		
+		case HTTPMESSAGE_CHUNKED_EXTENSION_VALUE_START:
+			if (c == '"')
+			{
+				return HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED;
+			}
+			
+			return httpmessage_chunked_extension_is_tchar(c)
+			       ? HTTPMESSAGE_CHUNKED_EXTENSION_VALUE : -1;
+			       
+		case HTTPMESSAGE_CHUNKED_EXTENSION_VALUE:
+			if (httpmessage_chunked_extension_is_tchar(c))
+			{
+				return state;
+			}
+			
+			break;
+		
+		case HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED:
+			if (c == '"')
+			{
+				return HTTPMESSAGE_CHUNKED_EXTENSION_END;
+			}
+			
+			if (c == '\\')
+			{
+				return HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED_PAIR;
+			}
+			
+			/* qdtext */
+			return (c == '\t' || (c >= ' ' && c != 0x7F)) ? state : -1;
+		
+		case HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED_PAIR:
+			return (c == '\t' || (c >= ' ' && c != 0x7F))
+			       ? HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED : -1;
+			       
+		default:
+			break;
+	}
+	
+	/* End of a chunk extension or of the chunk size */
+	if (c == ';')
+	{
+		return HTTPMESSAGE_CHUNKED_EXTENSION_NAME_START;
+	}
+	
+	if (c == '\r')
+	{
+		return HTTPMESSAGE_CHUNKED_SIZE_LF;
+	}
+	
+	return httpmessage_text_is_LWS(c) ? HTTPMESSAGE_CHUNKED_EXTENSION : -1;
+}
+
+static ssize_t httpmessage_chunked_decoder_fail(
+    httpmessage_chunked_decoder *decoder,
+    int error)
+{
+	decoder->state = HTTPMESSAGE_CHUNKED_ERROR;
+	decoder->error = error;
+	return error;
+}
+
+ssize_t httpmessage_chunked_decoder_consume(
+    httpmessage_chunked_decoder *decoder,
+    httpmessage_stringview *data,
+    const char *text, size_t length)
+{
+	const char *t = text;
+	const char *end = text + length;
+	
+	httpmessage_stringview_clear(data);
+	
+	if (decoder->state == HTTPMESSAGE_CHUNKED_ERROR)
+	{
+		return decoder->error;
+	}
+	
+	if (decoder->state >= HTTPMESSAGE_CHUNKED_TRAILER
+	        && decoder->state < HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		/* The trailer section started in a previous input */
+		decoder->trailer.text = (decoder->trailer_length ? NULL : text);
+		decoder->trailer.length = 0;
+	}
+	
+	while (t < end)
+	{
+		switch (decoder->state)
+		{
+			case HTTPMESSAGE_CHUNKED_SIZE:
+			case HTTPMESSAGE_CHUNKED_SIZE_DIGITS:
+			{
+				for (; t < end; ++t)
+				{
+					int digit = httpmessage_hex_digit_values[(unsigned char)*t];
+					
+					if (digit < 0)
+					{
+						break;
+					}
+					
+					if (decoder->chunk_length > HTTPMESSAGE_CHUNK_SIZE_MAX)
+					{
+						return httpmessage_chunked_decoder_fail(decoder,
+						        HTTPMESSAGE_ERROR_OVERFLOW);
+					}
+					
+					decoder->chunk_length = (decoder->chunk_length << 4) | (size_t)digit;
+					decoder->state = HTTPMESSAGE_CHUNKED_SIZE_DIGITS;
+				}
+				
+				if (t == end)
+				{
+					break;
+				}
+				
+				if (decoder->state == HTTPMESSAGE_CHUNKED_SIZE)
+				{
+					return httpmessage_chunked_decoder_fail(decoder,
+					        HTTPMESSAGE_ERROR_SYNTAX);
+				}
+				
+				/* Chunk extensions or CRLF */
+				decoder->state = HTTPMESSAGE_CHUNKED_EXTENSION_END;
+			}
+			break;
+			
+			case HTTPMESSAGE_CHUNKED_EXTENSION:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_NAME_START:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_NAME:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_VALUE_START:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_VALUE:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_QUOTED_PAIR:
+			case HTTPMESSAGE_CHUNKED_EXTENSION_END:
+				for (; t < end && decoder->state != HTTPMESSAGE_CHUNKED_SIZE_LF; ++t)
+				{
+					int state = httpmessage_chunked_extension_next_state(decoder->state,
+					            (unsigned char)*t);
+					            
+					if (state < 0)
+					{
+						return httpmessage_chunked_decoder_fail(decoder,
+						        HTTPMESSAGE_ERROR_SYNTAX);
+					}
+					
+					decoder->state = state;
+				}
+				break;
+			
+			case HTTPMESSAGE_CHUNKED_SIZE_LF:
+				if (*t != '\n')
+				{
+					return httpmessage_chunked_decoder_fail(decoder,
+					        HTTPMESSAGE_ERROR_SYNTAX);
+				}
+				
+				++t;
+				
+				if (decoder->chunk_length)
+				{
+					decoder->state = HTTPMESSAGE_CHUNKED_DATA;
+				}
+				else
+				{
+					/* Last chunk */
+					decoder->trailer.text = t;
+					decoder->trailer.length = 0;
+					decoder->state = HTTPMESSAGE_CHUNKED_TRAILER;
+				}
+				break;
+			
+			case HTTPMESSAGE_CHUNKED_DATA:
+			{
+				size_t available = (size_t)(end - t);
+				
+				if (data->length)
+				{
+					/* One chunk data view per call */
+					return (ssize_t)(t - text);
+				}
+				
+				data->text = t;
+				data->length = ((available < decoder->chunk_length)
+				                ? available
+				                : decoder->chunk_length);
+				t += data->length;
+				decoder->chunk_length -= data->length;
+				decoder->body_length += data->length;
+				
+				if (!decoder->chunk_length)
+				{
+					decoder->state = HTTPMESSAGE_CHUNKED_DATA_CR;
+				}
+			}
+			break;
+			
+			case HTTPMESSAGE_CHUNKED_DATA_CR:
+			case HTTPMESSAGE_CHUNKED_DATA_LF:
+				if (*t != ((decoder->state == HTTPMESSAGE_CHUNKED_DATA_CR) ? '\r' : '\n'))
+				{
+					return httpmessage_chunked_decoder_fail(decoder,
+					        HTTPMESSAGE_ERROR_SYNTAX);
+				}
+				
+				++t;
+				decoder->state = ((decoder->state == HTTPMESSAGE_CHUNKED_DATA_CR)
+				                  ? HTTPMESSAGE_CHUNKED_DATA_LF
+				                  : HTTPMESSAGE_CHUNKED_SIZE);
+				break;
+			
+			case HTTPMESSAGE_CHUNKED_TRAILER:
+				if (*t == '\r')
+				{
+					++t;
+					decoder->state = HTTPMESSAGE_CHUNKED_TRAILER_END_LF;
+				}
+				else
+				{
+					decoder->state = HTTPMESSAGE_CHUNKED_TRAILER_LINE;
+				}
+				break;
+			
+			case HTTPMESSAGE_CHUNKED_TRAILER_LINE:
+			case HTTPMESSAGE_CHUNKED_TRAILER_LINE_LF:
+			{
+				const char *next;
+				
+				if (decoder->state == HTTPMESSAGE_CHUNKED_TRAILER_LINE)
+				{
+					const char *cr = (const char *)memchr(t, '\r', (size_t)(end - t));
+					next = (cr ? (cr + 1) : end);
+					
+					if (cr)
+					{
+						decoder->state = HTTPMESSAGE_CHUNKED_TRAILER_LINE_LF;
+					}
+				}
+				else
+				{
+					if (*t != '\n')
+					{
+						return httpmessage_chunked_decoder_fail(decoder,
+						        HTTPMESSAGE_ERROR_SYNTAX);
+					}
+					
+					next = t + 1;
+					decoder->state = HTTPMESSAGE_CHUNKED_TRAILER;
+				}
+				
+				decoder->trailer_length += (size_t)(next - t);
+				
+				if (decoder->trailer.text)
+				{
+					decoder->trailer.length += (size_t)(next - t);
+				}
+				
+				t = next;
+			}
+			break;
+			
+			case HTTPMESSAGE_CHUNKED_TRAILER_END_LF:
+				if (*t != '\n')
+				{
+					return httpmessage_chunked_decoder_fail(decoder,
+					        HTTPMESSAGE_ERROR_SYNTAX);
+				}
+				
+				++t;
+				
+				if (!decoder->trailer.length)
+				{
+					decoder->trailer.text = NULL;
+				}
+				
+				decoder->state = HTTPMESSAGE_CHUNKED_COMPLETE;
+				return (ssize_t)(t - text);
+			
+			default:
+				/* Complete */
+				return (ssize_t)(t - text);
+		}
+	}
+	
+	return (ssize_t)(t - text);
+}
+
+ssize_t httpmessage_chunked_decode(
+    httpmessage_chunked_decoder *decoder,
+    char *text, size_t *length)
+{
+	httpmessage_stringview data;
+	size_t offset = 0;
+	size_t output = 0;
+	
+	while (offset < *length
+	        && decoder->state != HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		ssize_t result = httpmessage_chunked_decoder_consume(decoder, &data,
+		                 text + offset, *length - offset);
+		                 
+		if (result < 0)
+		{
+			return result;
+		}
+		
+		if (data.length)
+		{
+			memmove(text + output, data.text, data.length);
+			output += data.length;
+		}
+		
+		offset += (size_t)result;
+	}
+	
+	offset = *length - offset;
+	*length = output;
+	
+	if (decoder->state != HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	return (ssize_t)offset;
+}
+
+static const char httpmessage_hex_digits[16] =
+{
+	'0', '1', '2', '3', '4', '5', '6', '7',
+	'8', '9', 'a', 'b', 'c', 'd', 'e', 'f'
+};
+
+void httpmessage_chunked_encoder_init(
+    httpmessage_chunked_encoder *encoder,
+    char *buffer, size_t buffer_size)
+{
+	encoder->buffer = buffer;
+	encoder->buffer_size = (buffer ? buffer_size : 0);
+	encoder->buffer_length = 0;
+	encoder->body_length = 0;
+	encoder->complete = 0;
+}
+
+/* Write the chunk size line at the end of the size line storage */
+static void httpmessage_chunked_encoder_size_line(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vector,
+    size_t size)
+{
+	char *end = encoder->size_line + HTTPMESSAGE_CHUNK_SIZE_LINE_SIZE;
+	char *t = end - 2;
+	t[0] = '\r';
+	t[1] = '\n';
+	
+	do
+	{
+		*(--t) = httpmessage_hex_digits[size & 0xF];
+		size >>= 4;
+	}
+	while (size);
+	
+	vector->text = t;
+	vector->length = (size_t)(end - t);
+}
+
+/* Frame the pending bytes followed by the given fragment */
+static ssize_t httpmessage_chunked_encoder_chunk(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors,
+    const char *text, size_t length)
+{
+	size_t count = 1;
+	size_t size = encoder->buffer_length + length;
+	
+	if (size == 0)
+	{
+		return 0;
+	}
+	
+	httpmessage_chunked_encoder_size_line(encoder, vectors, size);
+	
+	if (encoder->buffer_length)
+	{
+		vectors[count].text = encoder->buffer;
+		vectors[count].length = encoder->buffer_length;
+		++count;
+	}
+	
+	if (length)
+	{
+		vectors[count].text = text;
+		vectors[count].length = length;
+		++count;
+	}
+	
+	httpmessage_stringview_assign(&vectors[count], "\r\n");
+	++count;
+	encoder->buffer_length = 0;
+	encoder->body_length += size;
+	return (ssize_t)count;
+}
+
+ssize_t httpmessage_chunked_encoder_write(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors,
+    const char *text, size_t length)
+{
+	if (!(encoder && vectors) || (length && !text) || encoder->complete)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	if (length == 0)
+	{
+		return 0;
+	}
+	
+	if ((encoder->buffer_length + length) < encoder->buffer_size)
+	{
+		memcpy(encoder->buffer + encoder->buffer_length, text, length);
+		encoder->buffer_length += length;
+		return 0;
+	}
+	
+	return httpmessage_chunked_encoder_chunk(encoder, vectors, text, length);
+}
+
+ssize_t httpmessage_chunked_encoder_flush(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors)
+{
+	if (!(encoder && vectors) || encoder->complete)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	return httpmessage_chunked_encoder_chunk(encoder, vectors, NULL, 0);
+}
+
+ssize_t httpmessage_chunked_encoder_finish(
+    httpmessage_chunked_encoder *encoder,
+    httpmessage_stringview *vectors,
+    const char *trailer, size_t trailer_length)
+{
+	ssize_t count = httpmessage_chunked_encoder_flush(encoder, vectors);
+	
+	if (count < 0)
+	{
+		return count;
+	}
+	
+	httpmessage_stringview_assign(&vectors[count++], "0\r\n");
+	
+	if (trailer && trailer_length)
+	{
+		vectors[count].text = trailer;
+		vectors[count].length = trailer_length;
+		++count;
+	}
+	
+	httpmessage_stringview_assign(&vectors[count++], "\r\n");
+	encoder->complete = 1;
+	return count;
+}
+
+static ssize_t httpmessage_chunked_vectors_write_file(
+    FILE *file,
+    const httpmessage_stringview *vectors, ssize_t count)
+{
+	size_t written = 0;
+	ssize_t v;
+	
+	if (count < 0)
+	{
+		return count;
+	}
+	
+	for (v = 0; v < count; ++v)
+	{
+		HTTPMESSAGE_STRING_WRITE_FILE(written, file, vectors[v]);
+	}
+	
+	return (ssize_t)written;
+}
+
+ssize_t httpmessage_chunked_encoder_write_file(
+    httpmessage_chunked_encoder *encoder,
+    FILE *file,
+    const char *text, size_t length)
+{
+	httpmessage_stringview vectors[HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT];
+	return httpmessage_chunked_vectors_write_file(file, vectors,
+	        httpmessage_chunked_encoder_write(encoder, vectors, text, length));
+}
+
+ssize_t httpmessage_chunked_encoder_finish_file(
+    httpmessage_chunked_encoder *encoder,
+    FILE *file,
+    const httpmessage_headerfield *trailer)
+{
+	httpmessage_stringview vectors[HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT];
+	ssize_t written = httpmessage_chunked_vectors_write_file(file, vectors,
+	                  httpmessage_chunked_encoder_flush(encoder, vectors));
+	ssize_t w;
+	
+	if (written < 0)
+	{
+		return written;
+	}
+	
+	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, "0\r\n", 3);
+	w = httpmessage_headerfield_list_write_file(file, trailer);
+	
+	if (w < 0)
+	{
+		return w;
+	}
+	
+	written += w;
+	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, "\r\n", 2);
+	encoder->complete = 1;
+	return written;
+}
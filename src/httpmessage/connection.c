@@ -0,0 +1,212 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+
+int httpmessage_connection_init(
+    httpmessage_connection *connection,
+    size_t buffer_size, size_t max_buffer_size,
+    size_t max_headerfield_count,
+    int option_flags)
+{
+	if (!(connection && buffer_size && max_headerfield_count))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	connection->buffer_size = buffer_size;
+	connection->max_buffer_size = ((max_buffer_size > buffer_size)
+	                               ? max_buffer_size : buffer_size);
+	connection->length = 0;
+	connection->offset = 0;
+	connection->message_size = 0;
+	connection->request_count = 0;
+	connection->option_flags = (option_flags | HTTPMESSAGE_CLEAR_NO_FREE);
+	connection->closed = 0;
+	connection->keep_alive = 1;
+	connection->buffer = (char *)httpmessage_allocator_allocate(NULL, buffer_size);
+	connection->request = httpmessage_request_storage_new(max_headerfield_count, 1);
+	
+	if (!(connection->buffer && connection->request))
+	{
+		httpmessage_connection_clear(connection);
+		return HTTPMESSAGE_ERROR_ALLOCATION;
+	}
+	
+	httpmessage_parser_init_request(&connection->parser, connection->request,
+	                                connection->option_flags);
+	return HTTPMESSAGE_OK;
+}
+
+void httpmessage_connection_clear(httpmessage_connection *connection)
+{
+	httpmessage_request_storage_free(&connection->request);
+	httpmessage_allocator_release(NULL, connection->buffer);
+	connection->buffer = NULL;
+	connection->buffer_size = 0;
+	connection->length = 0;
+	connection->offset = 0;
+	connection->message_size = 0;
+}
+
+/* Make room at the end of the input buffer */
+static int httpmessage_connection_reserve(httpmessage_connection *connection)
+{
+	size_t size;
+	char *buffer;
+	
+	if (connection->length < connection->buffer_size)
+	{
+		return HTTPMESSAGE_OK;
+	}
+	
+	/* Views on the held request must remain valid */
+	if (connection->message_size)
+	{
+		return HTTPMESSAGE_ERROR_OVERFLOW;
+	}
+	
+	/* Move the partial request to the beginning of the buffer */
+	if (connection->offset)
+	{
+		memmove(connection->buffer, connection->buffer + connection->offset,
+		        connection->length - connection->offset);
+		connection->length -= connection->offset;
+		connection->offset = 0;
+		return HTTPMESSAGE_OK;
+	}
+	
+	if (connection->buffer_size >= connection->max_buffer_size)
+	{
+		return HTTPMESSAGE_ERROR_OVERFLOW;
+	}
+	
+	size = 2 * connection->buffer_size;
+	
+	if (size > connection->max_buffer_size)
+	{
+		size = connection->max_buffer_size;
+	}
+	
+	/* The parser moves the request views on the next call */
+	buffer = (char *)httpmessage_allocator_allocate(NULL, size);
+	
+	if (!buffer)
+	{
+		return HTTPMESSAGE_ERROR_ALLOCATION;
+	}
+	
+	memcpy(buffer, connection->buffer, connection->length);
+	httpmessage_allocator_release(NULL, connection->buffer);
+	connection->buffer = buffer;
+	connection->buffer_size = size;
+	return HTTPMESSAGE_OK;
+}
+
+ssize_t httpmessage_connection_read(
+    httpmessage_connection *connection,
+    ssize_t (*input)(void *user_data, char *buffer, size_t size),
+    void *user_data)
+{
+	ssize_t result;
+	
+	if (connection->closed)
+	{
+		return 0;
+	}
+	
+	result = httpmessage_connection_reserve(connection);
+	
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	result = input(user_data, connection->buffer + connection->length,
+	               connection->buffer_size - connection->length);
+	               
+	if (result < 0)
+	{
+		return HTTPMESSAGE_ERROR_READ;
+	}
+	
+	if (result == 0)
+	{
+		connection->closed = 1;
+	}
+	
+	connection->length += (size_t)result;
+	return result;
+}
+
+ssize_t httpmessage_connection_next_request(
+    httpmessage_connection *connection,
+    httpmessage_request **request)
+{
+	ssize_t result;
+	
+	if (connection->message_size)
+	{
+		*request = connection->request;
+		return (ssize_t)connection->message_size;
+	}
+	
+	if (!connection->keep_alive
+	        || (connection->closed && connection->offset == connection->length))
+	{
+		return 0;
+	}
+	
+	if (connection->offset == connection->length)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	result = httpmessage_parser_consume(&connection->parser,
+	                                    connection->buffer + connection->offset,
+	                                    connection->length - connection->offset);
+	                                    
+	/* No more input will complete the request */
+	if (result == HTTPMESSAGE_ERROR_INCOMPLETE && connection->closed)
+	{
+		return HTTPMESSAGE_ERROR_TRUNCATED;
+	}
+	
+	if (result < 0)
+	{
+		return result;
+	}
+	
+	connection->message_size = (size_t)result;
+	connection->keep_alive = httpmessage_message_is_keep_alive(
+	                             &connection->request->message);
+	*request = connection->request;
+	return result;
+}
+
+void httpmessage_connection_release(httpmessage_connection *connection)
+{
+	if (!connection->message_size)
+	{
+		return;
+	}
+	
+	connection->offset += connection->message_size;
+	connection->message_size = 0;
+	++connection->request_count;
+	
+	if (connection->offset == connection->length)
+	{
+		connection->offset = connection->length = 0;
+	}
+	
+	httpmessage_parser_init_request(&connection->parser, connection->request,
+	                                connection->option_flags);
+}
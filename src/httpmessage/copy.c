@@ -0,0 +1,831 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+/* Shape and text size of a message */
+typedef struct __httpmessage_message_shape
+{
+	/* Header fields, including the one embedded in the message */
+	size_t headerfield_count;
+	/* Trailer fields that are not merged in the header field list */
+	size_t trailer_count;
+	/* Value lines that are not embedded in a header field */
+	size_t line_count;
+	/* Text referenced by header fields and body */
+	size_t text_size;
+} httpmessage_message_shape;
+
+/* Count the fields of a list, their value lines and text */
+static size_t httpmessage_headerfield_list_measure(
+    httpmessage_message_shape *shape,
+    const httpmessage_headerfield *field)
+{
+	size_t count = 0;
+	
+	while (field && field->name.length)
+	{
+		const httpmessage_headerfield_value *value = field->value.next_line;
+		++count;
+		shape->text_size += field->name.length + field->value.line.length;
+		
+		while (value && value->line.length)
+		{
+			++shape->line_count;
+			shape->text_size += value->line.length;
+			value = value->next_line;
+		}
+		
+		field = field->next_field;
+	}
+	
+	return count;
+}
+
+static void httpmessage_message_shape_measure(
+    httpmessage_message_shape *shape,
+    const httpmessage_message *message,
+    int option_flags)
+{
+	shape->trailer_count = 0;
+	shape->line_count = 0;
+	shape->text_size = 0;
+	shape->headerfield_count = httpmessage_headerfield_list_measure(shape,
+	                           &message->field_list);
+	                           
+	if (!message->trailer_merged)
+	{
+		shape->trailer_count = httpmessage_headerfield_list_measure(shape,
+		                       message->trailer_list);
+	}
+	
+	if (!(option_flags & HTTPMESSAGE_CLONE_NO_BODY))
+	{
+		shape->text_size += message->body.length;
+	}
+}
+
+static size_t httpmessage_message_shape_size(
+    const httpmessage_message_shape *shape,
+    size_t object_size)
+{
+	return object_size
+	       + (((shape->headerfield_count > 1) ? (shape->headerfield_count - 1) : 0)
+	          + shape->trailer_count)
+	       * sizeof(httpmessage_headerfield)
+	       + shape->line_count * sizeof(httpmessage_headerfield_value)
+	       + shape->text_size;
+}
+
+static void httpmessage_stringview_copy(
+    httpmessage_stringview *target,
+    const httpmessage_stringview *source,
+    char **text)
+{
+	target->length = source->length;
+	
+	if (!source->length)
+	{
+		target->text = NULL;
+		return;
+	}
+	
+	memcpy(*text, source->text, source->length);
+	target->text = *text;
+	*text += source->length;
+}
+
+/* Storage of a compact clone */
+typedef struct __httpmessage_clone_storage
+{
+	httpmessage_headerfield *headerfields;
+	httpmessage_headerfield_value *lines;
+	char *text;
+} httpmessage_clone_storage;
+
+/*
+ * Copy a header field list after field, which is initialized.
+ * Return the copy of the source field stop, if any.
+ */
+static httpmessage_headerfield *httpmessage_headerfield_list_clone_fill(
+    httpmessage_headerfield *field,
+    const httpmessage_headerfield *source_field,
+    const httpmessage_headerfield *stop,
+    httpmessage_clone_storage *storage)
+{
+	const httpmessage_headerfield *first = source_field;
+	httpmessage_headerfield *copy = NULL;
+	
+	while (source_field && source_field->name.length)
+	{
+		const httpmessage_headerfield_value *source_value = &source_field->value;
+		httpmessage_headerfield_value *value;
+		
+		if (source_field != first)
+		{
+			field->next_field = storage->headerfields++;
+			field = field->next_field;
+			httpmessage_headerfield_init(field);
+		}
+		
+		if (source_field == stop)
+		{
+			copy = field;
+		}
+		
+		value = &field->value;
+		httpmessage_stringview_copy(&field->name, &source_field->name, &storage->text);
+		httpmessage_stringview_copy(&value->line, &source_value->line, &storage->text);
+		source_value = source_value->next_line;
+		
+		while (source_value && source_value->line.length)
+		{
+			value->next_line = storage->lines++;
+			value = value->next_line;
+			value->next_line = NULL;
+			httpmessage_stringview_copy(&value->line, &source_value->line, &storage->text);
+			source_value = source_value->next_line;
+		}
+		
+		source_field = source_field->next_field;
+	}
+	
+	return copy;
+}
+
+/*
+ * Copy header fields, trailer fields and body of a message into the message at the start of block.
+ * text points to the text area of the block.
+ */
+static void httpmessage_message_clone_compact_fill(
+    uint8_t *block,
+    const httpmessage_message *source,
+    const httpmessage_message_shape *shape,
+    size_t object_size,
+    char *text,
+    int option_flags)
+{
+	httpmessage_message *message = (httpmessage_message *)block;
+	httpmessage_clone_storage storage;
+	
+	storage.headerfields = (httpmessage_headerfield *)(block + object_size);
+	storage.lines = (httpmessage_headerfield_value *)(
+	                    storage.headerfields
+	                    + ((shape->headerfield_count > 1) ? (shape->headerfield_count - 1) : 0)
+	                    + shape->trailer_count);
+	storage.text = text;
+	
+	message->type = source->type;
+	message->major_version = source->major_version;
+	message->minor_version = source->minor_version;
+	message->storage_end = storage.lines + shape->line_count;
+	message->trailer_list = httpmessage_headerfield_list_clone_fill(
+	                            &message->field_list, &source->field_list,
+	                            source->trailer_list, &storage);
+	message->trailer_merged = (message->trailer_list != NULL);
+	
+	if (shape->trailer_count)
+	{
+		message->trailer_list = storage.headerfields++;
+		httpmessage_headerfield_init(message->trailer_list);
+		httpmessage_headerfield_list_clone_fill(message->trailer_list,
+		                                        source->trailer_list, NULL, &storage);
+	}
+	
+	if (!(option_flags & HTTPMESSAGE_CLONE_NO_BODY))
+	{
+		httpmessage_stringview_copy(&message->body, &source->body, &storage.text);
+	}
+}
+
+size_t httpmessage_request_clone_compact_size(
+    const httpmessage_request *request,
+    int option_flags)
+{
+	httpmessage_message_shape shape;
+	httpmessage_message_shape_measure(&shape, &request->message, option_flags);
+	return httpmessage_message_shape_size(&shape, sizeof(httpmessage_request))
+	       + request->method.length + request->request_uri.length;
+}
+
+httpmessage_request *httpmessage_request_clone_compact(
+    const httpmessage_request *request,
+    int option_flags)
+{
+	httpmessage_message_shape shape;
+	httpmessage_request *clone;
+	size_t size;
+	char *text;
+	
+	httpmessage_message_shape_measure(&shape, &request->message, option_flags);
+	size = httpmessage_message_shape_size(&shape, sizeof(httpmessage_request));
+	clone = (httpmessage_request *)httpmessage_allocator_allocate(NULL,
+	            size + request->method.length + request->request_uri.length);
+	            
+	if (!clone)
+	{
+		return NULL;
+	}
+	
+	httpmessage_request_init(clone);
+	
+	/* First line text precedes header text */
+	text = (char *)clone + (size - shape.text_size);
+	httpmessage_stringview_copy(&clone->method, &request->method, &text);
+	httpmessage_stringview_copy(&clone->request_uri, &request->request_uri, &text);
+	httpmessage_message_clone_compact_fill((uint8_t *)clone, &request->message,
+	                                       &shape, sizeof(httpmessage_request),
+	                                       text, option_flags);
+	return clone;
+}
+
+size_t httpmessage_response_clone_compact_size(
+    const httpmessage_response *response,
+    int option_flags)
+{
+	httpmessage_message_shape shape;
+	httpmessage_message_shape_measure(&shape, &response->message, option_flags);
+	return httpmessage_message_shape_size(&shape, sizeof(httpmessage_response))
+	       + response->reason_phrase.length;
+}
+
+httpmessage_response *httpmessage_response_clone_compact(
+    const httpmessage_response *response,
+    int option_flags)
+{
+	httpmessage_message_shape shape;
+	httpmessage_response *clone;
+	size_t size;
+	char *text;
+	
+	httpmessage_message_shape_measure(&shape, &response->message, option_flags);
+	size = httpmessage_message_shape_size(&shape, sizeof(httpmessage_response));
+	clone = (httpmessage_response *)httpmessage_allocator_allocate(NULL,
+	            size + response->reason_phrase.length);
+	
+	if (!clone)
+	{
+		return NULL;
+	}
+	
+	httpmessage_response_init(clone);
+	clone->status_code = response->status_code;
+	
+	/* First line text precedes header text */
+	text = (char *)clone + (size - shape.text_size);
+	httpmessage_stringview_copy(&clone->reason_phrase, &response->reason_phrase, &text);
+	httpmessage_message_clone_compact_fill((uint8_t *)clone, &response->message,
+	                                       &shape, sizeof(httpmessage_response),
+	                                       text, option_flags);
+	return clone;
+}
+
+static size_t httpmessage_stringview_rebase(
+    httpmessage_stringview *view,
+    const char *old_text, size_t length,
+    const char *new_text)
+{
+	if (!(view->text
+	        && view->text >= old_text
+	        && view->text < (old_text + length)))
+	{
+		return 0;
+	}
+	
+	view->text = new_text + (view->text - old_text);
+	return 1;
+}
+
+static size_t httpmessage_headerfield_list_rebase(
+    httpmessage_headerfield *field,
+    const char *old_text, size_t length,
+    const char *new_text)
+{
+	size_t count = 0;
+	
+	while (field)
+	{
+		httpmessage_headerfield_value *value = &field->value;
+		count += httpmessage_stringview_rebase(&field->name, old_text, length, new_text);
+		
+		while (value)
+		{
+			count += httpmessage_stringview_rebase(&value->line, old_text, length, new_text);
+			value = value->next_line;
+		}
+		
+		field = field->next_field;
+	}
+	
+	return count;
+}
+
+size_t httpmessage_message_rebase(
+    httpmessage_message *message,
+    const char *old_text, size_t length,
+    const char *new_text)
+{
+	size_t count = httpmessage_headerfield_list_rebase(&message->field_list,
+	               old_text, length, new_text);
+	               
+	if (!message->trailer_merged)
+	{
+		count += httpmessage_headerfield_list_rebase(message->trailer_list,
+		         old_text, length, new_text);
+	}
+	
+	return count + httpmessage_stringview_rebase(&message->body,
+	        old_text, length, new_text);
+}
+
+size_t httpmessage_request_rebase(
+    httpmessage_request *request,
+    const char *old_text, size_t length,
+    const char *new_text)
+{
+	return httpmessage_stringview_rebase(&request->method, old_text, length, new_text)
+	       + httpmessage_stringview_rebase(&request->request_uri, old_text, length, new_text)
+	       + httpmessage_message_rebase(&request->message, old_text, length, new_text);
+}
+
+size_t httpmessage_response_rebase(
+    httpmessage_response *response,
+    const char *old_text, size_t length,
+    const char *new_text)
+{
+	return httpmessage_stringview_rebase(&response->reason_phrase, old_text, length, new_text)
+	       + httpmessage_message_rebase(&response->message, old_text, length, new_text);
+}
+
+static int httpmessage_serialized_stringview_assign(
+    httpmessage_serialized_stringview *serialized,
+    const httpmessage_stringview *string,
+    const char *text, size_t text_length)
+{
+	serialized->offset = 0;
+	serialized->length = 0;
+	
+	if (!(string && string->length))
+	{
+		return HTTPMESSAGE_OK;
+	}
+	
+	if (!(string->text >= text
+	        && string->length <= text_length
+	        && (size_t)(string->text - text) <= (text_length - string->length)))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	serialized->offset = (uint32_t)(string->text - text);
+	serialized->length = (uint32_t)string->length;
+	return HTTPMESSAGE_OK;
+}
+
+static size_t httpmessage_message_serialized_size(const httpmessage_message *message)
+{
+	httpmessage_message_shape shape;
+	size_t headerfield_count;
+	httpmessage_message_shape_measure(&shape, message, HTTPMESSAGE_CLONE_NO_BODY);
+	headerfield_count = shape.headerfield_count + shape.trailer_count;
+	return sizeof(httpmessage_serialized_message)
+	       + headerfield_count * sizeof(httpmessage_serialized_headerfield)
+	       + (headerfield_count + shape.line_count) * sizeof(httpmessage_serialized_stringview);
+}
+
+/* Write the header fields of a list and their value lines */
+static int httpmessage_headerfield_list_serialize(
+    uint8_t **headerfields,
+    uint8_t **lines,
+    uint32_t *line_index,
+    const httpmessage_headerfield *field,
+    const char *text, size_t text_length)
+{
+	while (field && field->name.length)
+	{
+		httpmessage_serialized_headerfield serialized_field;
+		const httpmessage_headerfield_value *value = &field->value;
+		
+		if (httpmessage_serialized_stringview_assign(&serialized_field.name, &field->name,
+		        text, text_length) != HTTPMESSAGE_OK)
+		{
+			return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+		}
+		
+		serialized_field.first_line = *line_index;
+		serialized_field.line_count = 0;
+		
+		do
+		{
+			httpmessage_serialized_stringview line;
+			
+			if (httpmessage_serialized_stringview_assign(&line, &value->line,
+			        text, text_length) != HTTPMESSAGE_OK)
+			{
+				return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+			}
+			
+			memcpy(*lines, &line, sizeof(line));
+			*lines += sizeof(line);
+			++serialized_field.line_count;
+			value = value->next_line;
+		}
+		while (value && value->line.length);
+		
+		*line_index += serialized_field.line_count;
+		memcpy(*headerfields, &serialized_field, sizeof(serialized_field));
+		*headerfields += sizeof(serialized_field);
+		field = field->next_field;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/*
+ * Write header fields, trailer fields and body of a message.
+ * descriptor is initialized with first line data by the caller.
+ */
+static ssize_t httpmessage_message_serialize(
+    void *output, size_t output_size,
+    httpmessage_serialized_message *descriptor,
+    const httpmessage_message *message,
+    const char *text, size_t text_length)
+{
+	httpmessage_message_shape shape;
+	uint8_t *headerfields;
+	uint8_t *lines;
+	size_t headerfield_count;
+	size_t size;
+	uint32_t line_index = 0;
+	
+	if (text_length > UINT32_MAX)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	httpmessage_message_shape_measure(&shape, message, HTTPMESSAGE_CLONE_NO_BODY);
+	headerfield_count = shape.headerfield_count + shape.trailer_count;
+	size = httpmessage_message_serialized_size(message);
+	
+	if (size > output_size)
+	{
+		return HTTPMESSAGE_ERROR_OVERFLOW;
+	}
+	
+	descriptor->signature = HTTPMESSAGE_SERIALIZED_SIGNATURE;
+	descriptor->size = (uint32_t)size;
+	descriptor->major_version = message->major_version;
+	descriptor->minor_version = message->minor_version;
+	descriptor->text_length = (uint32_t)text_length;
+	descriptor->headerfield_count = (uint32_t)headerfield_count;
+	descriptor->trailer_count = (uint32_t)httpmessage_headerfield_count(message->trailer_list);
+	descriptor->trailer_merged = (descriptor->trailer_count && message->trailer_merged);
+	descriptor->line_count = (uint32_t)(headerfield_count + shape.line_count);
+	
+	if (httpmessage_serialized_stringview_assign(&descriptor->body, &message->body,
+	        text, text_length) != HTTPMESSAGE_OK)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	memcpy(output, descriptor, sizeof(httpmessage_serialized_message));
+	headerfields = (uint8_t *)output + sizeof(httpmessage_serialized_message);
+	lines = headerfields + headerfield_count * sizeof(httpmessage_serialized_headerfield);
+	
+	if (httpmessage_headerfield_list_serialize(&headerfields, &lines, &line_index,
+	        &message->field_list, text, text_length) != HTTPMESSAGE_OK
+	        || (!message->trailer_merged
+	            && httpmessage_headerfield_list_serialize(&headerfields, &lines, &line_index,
+	                    message->trailer_list, text, text_length) != HTTPMESSAGE_OK))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	return (ssize_t)size;
+}
+
+size_t httpmessage_request_serialized_size(const httpmessage_request *request)
+{
+	return httpmessage_message_serialized_size(&request->message);
+}
+
+ssize_t httpmessage_request_serialize(
+    void *output, size_t output_size,
+    const httpmessage_request *request,
+    const char *text, size_t text_length)
+{
+	httpmessage_serialized_message descriptor;
+	memset(&descriptor, 0, sizeof(descriptor));
+	descriptor.type = HTTPMESSAGE_TYPE_REQUEST;
+	
+	if (httpmessage_serialized_stringview_assign(&descriptor.method,
+	        &request->method, text, text_length) != HTTPMESSAGE_OK
+	        || httpmessage_serialized_stringview_assign(&descriptor.request_uri,
+	                &request->request_uri, text, text_length) != HTTPMESSAGE_OK)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	return httpmessage_message_serialize(output, output_size, &descriptor,
+	                                     &request->message, text, text_length);
+}
+
+size_t httpmessage_response_serialized_size(const httpmessage_response *response)
+{
+	return httpmessage_message_serialized_size(&response->message);
+}
+
+ssize_t httpmessage_response_serialize(
+    void *output, size_t output_size,
+    const httpmessage_response *response,
+    const char *text, size_t text_length)
+{
+	httpmessage_serialized_message descriptor;
+	memset(&descriptor, 0, sizeof(descriptor));
+	descriptor.type = HTTPMESSAGE_TYPE_RESPONSE;
+	descriptor.status_code = response->status_code;
+	
+	if (httpmessage_serialized_stringview_assign(&descriptor.reason_phrase,
+	        &response->reason_phrase, text, text_length) != HTTPMESSAGE_OK)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	return httpmessage_message_serialize(output, output_size, &descriptor,
+	                                     &response->message, text, text_length);
+}
+
+static int httpmessage_serialized_stringview_is_valid(
+    const httpmessage_serialized_stringview *serialized,
+    size_t text_length)
+{
+	return (serialized->offset <= text_length)
+	       && (serialized->length <= (text_length - serialized->offset));
+}
+
+int httpmessage_serialized_view_init(
+    httpmessage_serialized_view *view,
+    const void *descriptor, size_t descriptor_size,
+    const char *text, size_t text_length)
+{
+	const httpmessage_serialized_message *message = (const httpmessage_serialized_message *)descriptor;
+	size_t available;
+	size_t a;
+	
+	view->message = NULL;
+	view->headerfields = NULL;
+	view->lines = NULL;
+	view->text = text;
+	
+	if (!(descriptor && descriptor_size >= sizeof(httpmessage_serialized_message)
+	        && message->signature == HTTPMESSAGE_SERIALIZED_SIGNATURE
+	        && message->size <= descriptor_size
+	        && message->text_length <= text_length))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	available = message->size - sizeof(httpmessage_serialized_message);
+	
+	if (message->headerfield_count > (available / sizeof(httpmessage_serialized_headerfield)))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	available -= message->headerfield_count * sizeof(httpmessage_serialized_headerfield);
+	
+	/* Detached trailer fields follow at least one header field */
+	if (available != message->line_count * sizeof(httpmessage_serialized_stringview)
+	        || message->trailer_count > message->headerfield_count
+	        || (message->trailer_count == message->headerfield_count
+	            && message->trailer_count && !message->trailer_merged)
+	        || !httpmessage_serialized_stringview_is_valid(&message->method, message->text_length)
+	        || !httpmessage_serialized_stringview_is_valid(&message->request_uri, message->text_length)
+	        || !httpmessage_serialized_stringview_is_valid(&message->reason_phrase, message->text_length)
+	        || !httpmessage_serialized_stringview_is_valid(&message->body, message->text_length))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	view->headerfields = (const httpmessage_serialized_headerfield *)(message + 1);
+	view->lines = (const httpmessage_serialized_stringview *)(
+	                  view->headerfields + message->headerfield_count);
+	                  
+	for (a = 0; a < message->headerfield_count; ++a)
+	{
+		const httpmessage_serialized_headerfield *field = &view->headerfields[a];
+		
+		if (!httpmessage_serialized_stringview_is_valid(&field->name, message->text_length)
+		        || field->first_line > message->line_count
+		        || field->line_count > (message->line_count - field->first_line))
+		{
+			return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+		}
+	}
+	
+	for (a = 0; a < message->line_count; ++a)
+	{
+		if (!httpmessage_serialized_stringview_is_valid(&view->lines[a], message->text_length))
+		{
+			return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+		}
+	}
+	
+	view->message = message;
+	return HTTPMESSAGE_OK;
+}
+
+void httpmessage_serialized_view_get_string(
+    httpmessage_stringview *string,
+    const httpmessage_serialized_view *view,
+    const httpmessage_serialized_stringview *serialized)
+{
+	string->text = (serialized->length ? (view->text + serialized->offset) : NULL);
+	string->length = serialized->length;
+}
+
+const httpmessage_serialized_headerfield *httpmessage_serialized_view_find_headerfield(
+    const httpmessage_serialized_view *view,
+    const char *name, size_t name_length)
+{
+	size_t count = view->message->headerfield_count;
+	size_t a;
+	
+	if (!view->message->trailer_merged)
+	{
+		count -= view->message->trailer_count;
+	}
+	
+	for (a = 0; a < count; ++a)
+	{
+		httpmessage_stringview field_name;
+		httpmessage_serialized_view_get_string(&field_name, view,
+		                                       &view->headerfields[a].name);
+		                                       
+		if (httpmessage_stringview_caseless_compare_text(&field_name,
+		        name, name_length) == 0)
+		{
+			return &view->headerfields[a];
+		}
+	}
+	
+	return NULL;
+}
+
+int httpmessage_serialized_view_get_value_line(
+    httpmessage_stringview *line,
+    const httpmessage_serialized_view *view,
+    const httpmessage_serialized_headerfield *field,
+    size_t index)
+{
+	if (index >= field->line_count)
+	{
+		httpmessage_stringview_clear(line);
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	httpmessage_serialized_view_get_string(line, view,
+	                                       &view->lines[field->first_line + index]);
+	return HTTPMESSAGE_OK;
+}
+
+static int httpmessage_message_deserialize(
+    httpmessage_message *message,
+    const httpmessage_serialized_view *view,
+    int option_flags)
+{
+	httpmessage_headerfield *field = &message->field_list;
+	httpmessage_headerfield *last_header = NULL;
+	httpmessage_headerfield *trailer = NULL;
+	size_t trailer_index = view->message->headerfield_count - view->message->trailer_count;
+	size_t a, b;
+	
+	message->major_version = view->message->major_version;
+	message->minor_version = view->message->minor_version;
+	
+	for (a = 0; a < view->message->headerfield_count; ++a)
+	{
+		const httpmessage_serialized_headerfield *serialized = &view->headerfields[a];
+		httpmessage_headerfield_value *value;
+		
+		if (a && !field->next_field)
+		{
+			if (option_flags & HTTPMESSAGE_NO_ALLOCATION)
+			{
+				return HTTPMESSAGE_ERROR_ALLOCATION;
+			}
+			
+			field->next_field = (httpmessage_headerfield *)httpmessage_allocator_allocate(
+			                        message->allocator, sizeof(httpmessage_headerfield));
+			                        
+			if (!field->next_field)
+			{
+				return httpmessage_allocator_get_error(message->allocator);
+			}
+			
+			httpmessage_headerfield_init(field->next_field);
+		}
+		
+		if (a)
+		{
+			field = field->next_field;
+		}
+		
+		if (a == trailer_index)
+		{
+			trailer = field;
+		}
+		else if (a < trailer_index)
+		{
+			last_header = field;
+		}
+		
+		httpmessage_serialized_view_get_string(&field->name, view, &serialized->name);
+		value = &field->value;
+		
+		for (b = 0; b < serialized->line_count; ++b)
+		{
+			if (b && !value->next_line)
+			{
+				if (option_flags & HTTPMESSAGE_NO_ALLOCATION)
+				{
+					return HTTPMESSAGE_ERROR_ALLOCATION;
+				}
+				
+				value->next_line = (httpmessage_headerfield_value *)httpmessage_allocator_allocate(
+				                       message->allocator, sizeof(httpmessage_headerfield_value));
+				                       
+				if (!value->next_line)
+				{
+					return httpmessage_allocator_get_error(message->allocator);
+				}
+				
+				httpmessage_headerfield_value_init(value->next_line);
+			}
+			
+			if (b)
+			{
+				value = value->next_line;
+			}
+			
+			httpmessage_serialized_view_get_string(&value->line, view,
+			                                       &view->lines[serialized->first_line + b]);
+		}
+	}
+	
+	/* Trailer fields are detached as by the parser */
+	if (trailer)
+	{
+		message->trailer_list = trailer;
+		message->trailer_merged = (view->message->trailer_merged != 0);
+		
+		if (!message->trailer_merged)
+		{
+			last_header->next_field = NULL;
+		}
+	}
+	
+	httpmessage_serialized_view_get_string(&message->body, view, &view->message->body);
+	return HTTPMESSAGE_OK;
+}
+
+int httpmessage_request_deserialize(
+    httpmessage_request *request,
+    const httpmessage_serialized_view *view,
+    int option_flags)
+{
+	if (!(view->message && view->message->type == HTTPMESSAGE_TYPE_REQUEST))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	httpmessage_request_clear(request, option_flags);
+	httpmessage_serialized_view_get_string(&request->method, view, &view->message->method);
+	httpmessage_serialized_view_get_string(&request->request_uri, view, &view->message->request_uri);
+	return httpmessage_message_deserialize(&request->message, view, option_flags);
+}
+
+int httpmessage_response_deserialize(
+    httpmessage_response *response,
+    const httpmessage_serialized_view *view,
+    int option_flags)
+{
+	if (!(view->message && view->message->type == HTTPMESSAGE_TYPE_RESPONSE))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	httpmessage_response_clear(response, option_flags);
+	response->status_code = view->message->status_code;
+	httpmessage_serialized_view_get_string(&response->reason_phrase, view,
+	                                       &view->message->reason_phrase);
+	return httpmessage_message_deserialize(&response->message, view, option_flags);
+}
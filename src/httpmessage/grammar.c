@@ -324,3 +324,39 @@ ssize_t httpmessage_int_consume(int *output,
 	
 	return (ssize_t)((t - text) / sizeof(char));
 }
+
+ssize_t httpmessage_size_consume(size_t *output,
+                                 const char *text, size_t length)
+{
+	size_t value = 0;
+	const char *t = text;
+	
+	if (!(text && (length > 0)))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	for (; length && httpmessage_text_is_DIGIT(*t); ++t, --length)
+	{
+		size_t digit = (size_t)(*t - '0');
+		
+		if (value > (((size_t)-1) - digit) / 10)
+		{
+			return HTTPMESSAGE_ERROR_OVERFLOW;
+		}
+		
+		value = (10 * value) + digit;
+	}
+	
+	if (t == text)
+	{
+		return (length ? HTTPMESSAGE_ERROR_SYNTAX : HTTPMESSAGE_ERROR_INCOMPLETE);
+	}
+	
+	if (output)
+	{
+		*output = value;
+	}
+	
+	return (ssize_t)(t - text);
+}
@@ -30,9 +30,37 @@ void httpmessage_headerfield_value_init(
 	value->next_line = NULL;
 }
 
-void httpmessage_headerfield_value_clear(
+static httpmessage_headerfield_value *httpmessage_headerfield_value_allocate(
+    httpmessage_allocator *allocator)
+{
+	httpmessage_headerfield_value *value = (httpmessage_headerfield_value *)
+	                                       httpmessage_allocator_allocate(allocator, sizeof(httpmessage_headerfield_value));
+	                                       
+	if (!value)
+	{
+		return NULL;
+	}
+	
+	httpmessage_headerfield_value_init(value);
+	return value;
+}
+
+void httpmessage_headerfield_value_release(
     httpmessage_headerfield_value *value,
-    int option_flags)
+    httpmessage_allocator *allocator)
+{
+	while (value)
+	{
+		httpmessage_headerfield_value *next_line = value->next_line;
+		httpmessage_allocator_release(allocator, value);
+		value = next_line;
+	}
+}
+
+static void httpmessage_headerfield_value_clear_with_allocator(
+    httpmessage_headerfield_value *value,
+    int option_flags,
+    httpmessage_allocator *allocator)
 {
 	httpmessage_stringview_clear(&value->line);
 	
@@ -43,31 +71,34 @@ void httpmessage_headerfield_value_clear(
 	
 	if (option_flags & HTTPMESSAGE_CLEAR_NO_FREE)
 	{
-		httpmessage_headerfield_value_clear(value->next_line, option_flags);
+		httpmessage_headerfield_value_clear_with_allocator(
+		    value->next_line, option_flags, allocator);
 		return;
 	}
 	
-	httpmessage_headerfield_value_free(&value->next_line);
+	httpmessage_headerfield_value_release(value->next_line, allocator);
+	value->next_line = NULL;
+}
+
+void httpmessage_headerfield_value_clear(
+    httpmessage_headerfield_value *value,
+    int option_flags)
+{
+	httpmessage_headerfield_value_clear_with_allocator(value, option_flags, NULL);
 }
 
 httpmessage_headerfield_value *httpmessage_headerfield_value_new(void)
 {
-	httpmessage_headerfield_value *value = (httpmessage_headerfield_value *) malloc(sizeof(httpmessage_headerfield_value));
-	
-	if (!value)
-	{
-		return NULL;
-	}
-	
-	httpmessage_headerfield_value_init(value);
-	return value;
+	return httpmessage_headerfield_value_allocate(NULL);
 }
 
 httpmessage_headerfield_value *httpmessage_headerfield_value_append_line(
     httpmessage_headerfield_value *value,
     const char *text, size_t length)
 {
-	httpmessage_headerfield_value *o = (httpmessage_headerfield_value *)malloc(sizeof(httpmessage_headerfield_value));
+	httpmessage_headerfield_value *o = (httpmessage_headerfield_value *)
+	                                   httpmessage_allocator_allocate(NULL,
+	                                           sizeof(httpmessage_headerfield_value));
 	
 	if (!o)
 	{
@@ -76,6 +107,7 @@ httpmessage_headerfield_value *httpmessage_headerfield_value_append_line(
 	
 	o->line.text = text;
 	o->line.length = length;
+	o->next_line = NULL;
 	value->next_line = o;
 	return o;
 }
@@ -164,7 +196,7 @@ void httpmessage_headerfield_value_free(
 		httpmessage_headerfield_value_free(&(*value)->next_line);
 	}
 	
-	free(*value);
+	httpmessage_allocator_release(NULL, *value);
 	*value = NULL;
 }
 
@@ -321,17 +353,47 @@ void httpmessage_headerfield_free(httpmessage_headerfield **field)
 		httpmessage_headerfield_free(&(*field)->next_field);
 	}
 	
-	free(*field);
+	httpmessage_allocator_release(NULL, *field);
 	*field = NULL;
 }
 
-void httpmessage_headerfield_clear(
+static httpmessage_headerfield *httpmessage_headerfield_allocate(
+    httpmessage_allocator *allocator)
+{
+	httpmessage_headerfield *header = (httpmessage_headerfield *)
+	                                  httpmessage_allocator_allocate(allocator, sizeof(httpmessage_headerfield));
+	                                  
+	if (!header)
+	{
+		return NULL;
+	}
+	
+	httpmessage_headerfield_init(header);
+	return header;
+}
+
+void httpmessage_headerfield_release(
     httpmessage_headerfield *field,
-    int option_flags)
+    httpmessage_allocator *allocator)
+{
+	while (field)
+	{
+		httpmessage_headerfield *next_field = field->next_field;
+		httpmessage_headerfield_value_release(field->value.next_line, allocator);
+		httpmessage_allocator_release(allocator, field);
+		field = next_field;
+	}
+}
+
+void httpmessage_headerfield_clear_with_allocator(
+    httpmessage_headerfield *field,
+    int option_flags,
+    httpmessage_allocator *allocator)
 {
 	httpmessage_stringview_clear(&field->name);
-	httpmessage_headerfield_value_clear(&field->value, option_flags);
-	
+	httpmessage_headerfield_value_clear_with_allocator(&field->value,
+	        option_flags, allocator);
+	        
 	if (!field->next_field)
 	{
 		return;
@@ -339,24 +401,25 @@ void httpmessage_headerfield_clear(
 	
 	if (option_flags & HTTPMESSAGE_CLEAR_NO_FREE)
 	{
-		httpmessage_headerfield_clear(field->next_field, option_flags);
+		httpmessage_headerfield_clear_with_allocator(field->next_field,
+		        option_flags, allocator);
 		return;
 	}
 	
-	httpmessage_headerfield_free(&field->next_field);
+	httpmessage_headerfield_release(field->next_field, allocator);
+	field->next_field = NULL;
+}
+
+void httpmessage_headerfield_clear(
+    httpmessage_headerfield *field,
+    int option_flags)
+{
+	httpmessage_headerfield_clear_with_allocator(field, option_flags, NULL);
 }
 
 httpmessage_headerfield *httpmessage_headerfield_new(void)
 {
-	httpmessage_headerfield *header = (httpmessage_headerfield *)malloc(sizeof(httpmessage_headerfield));
-	
-	if (!header)
-	{
-		return NULL;
-	}
-	
-	httpmessage_headerfield_init(header);
-	return header;
+	return httpmessage_headerfield_allocate(NULL);
 }
 
 size_t httpmessage_headerfield_count(const httpmessage_headerfield *headerfield_list)
@@ -401,6 +464,19 @@ ssize_t httpmessage_headerfield_line_consume(
     httpmessage_headerfield *current_header,
     const char *text, size_t length,
     int option_flags)
+{
+	return httpmessage_headerfield_line_consume_with_allocator(
+	           header, current_header,
+	           text, length,
+	           option_flags, NULL);
+}
+
+ssize_t httpmessage_headerfield_line_consume_with_allocator(
+    httpmessage_headerfield **header,
+    httpmessage_headerfield *current_header,
+    const char *text, size_t length,
+    int option_flags,
+    httpmessage_allocator *allocator)
 {
 	ssize_t consumed = 0;
 	ssize_t result = 0;
@@ -437,7 +513,13 @@ ssize_t httpmessage_headerfield_line_consume(
 				return HTTPMESSAGE_ERROR_ALLOCATION;
 			}
 			
-			headerfield_value->next_line = httpmessage_headerfield_value_new();
+			headerfield_value->next_line = httpmessage_headerfield_value_allocate(allocator);
+			
+			if (!headerfield_value->next_line)
+			{
+				return httpmessage_allocator_get_error(allocator);
+			}
+			
 			headerfield_value = headerfield_value->next_line;
 		}
 		
@@ -511,7 +593,13 @@ ssize_t httpmessage_headerfield_line_consume(
 			return HTTPMESSAGE_ERROR_ALLOCATION;
 		}
 		
-		(*header)->next_field = httpmessage_headerfield_new();
+		(*header)->next_field = httpmessage_headerfield_allocate(allocator);
+		
+		if (!(*header)->next_field)
+		{
+			return httpmessage_allocator_get_error(allocator);
+		}
+		
 		*header = (*header)->next_field;
 	}
 	
@@ -528,20 +616,33 @@ ssize_t httpmessage_headerfield_list_consume(
     httpmessage_headerfield *headerfield_list,
     const char *text, size_t length,
     int option_flags)
+{
+	return httpmessage_headerfield_list_consume_with_allocator(
+	           headerfield_list,
+	           text, length,
+	           option_flags, NULL);
+}
+
+ssize_t httpmessage_headerfield_list_consume_with_allocator(
+    httpmessage_headerfield *headerfield_list,
+    const char *text, size_t length,
+    int option_flags,
+    httpmessage_allocator *allocator)
 {
 	ssize_t consumed = 0;
 	httpmessage_headerfield *new_header = NULL;
 	httpmessage_headerfield *current_header = headerfield_list;
-	httpmessage_headerfield_clear(headerfield_list,
-	                              HTTPMESSAGE_CLEAR_NO_FREE);
-	                              
+	httpmessage_headerfield_clear_with_allocator(headerfield_list,
+	        HTTPMESSAGE_CLEAR_NO_FREE, allocator);
+	        
 	while (length && !httpmessage_text_is_CRLF(text, length))
 	{
-		ssize_t result = httpmessage_headerfield_line_consume(
+		ssize_t result = httpmessage_headerfield_line_consume_with_allocator(
 		                     &new_header,
 		                     current_header,
 		                     text, length,
-		                     option_flags);
+		                     option_flags,
+		                     allocator);
 		                     
 		if (result < 0)
 		{
@@ -0,0 +1,592 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#if defined (__linux__) && !defined (_DEFAULT_SOURCE)
+/* mmap() flags */
+#define _DEFAULT_SOURCE
+#endif
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#if defined (__unix__) || defined (__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#define HTTPMESSAGE_ARENA_CHUNK_HEADER_SIZE \
+	HTTPMESSAGE_MEMORY_ALIGN(sizeof(httpmessage_arena_chunk))
+
+#define HTTPMESSAGE_HUGEPAGE_REGION_HEADER_SIZE \
+	HTTPMESSAGE_MEMORY_ALIGN(sizeof(httpmessage_hugepage_region))
+
+#if defined (__ATOMIC_RELAXED)
+#	define HTTPMESSAGE_COUNTER_ADD(_counter, _value) \
+	(void)__atomic_fetch_add(&(_counter), (_value), __ATOMIC_RELAXED)
+#	define HTTPMESSAGE_COUNTER_GET(_counter) \
+	__atomic_load_n(&(_counter), __ATOMIC_RELAXED)
+#else
+#	define HTTPMESSAGE_COUNTER_ADD(_counter, _value) (_counter) += (_value)
+#	define HTTPMESSAGE_COUNTER_GET(_counter) (_counter)
+#endif
+
+static httpmessage_allocation_counters httpmessage_heap_counters = { 0, 0, 0 };
+
+void httpmessage_allocation_counters_get(
+    httpmessage_allocation_counters *counters)
+{
+	counters->allocation_count = HTTPMESSAGE_COUNTER_GET(httpmessage_heap_counters.allocation_count);
+	counters->release_count = HTTPMESSAGE_COUNTER_GET(httpmessage_heap_counters.release_count);
+	counters->allocation_size = HTTPMESSAGE_COUNTER_GET(httpmessage_heap_counters.allocation_size);
+}
+
+void *httpmessage_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size)
+{
+	if (!allocator)
+	{
+		void *memory = malloc(size);
+		
+		if (memory)
+		{
+			HTTPMESSAGE_COUNTER_ADD(httpmessage_heap_counters.allocation_count, 1);
+			HTTPMESSAGE_COUNTER_ADD(httpmessage_heap_counters.allocation_size, size);
+		}
+		
+		return memory;
+	}
+	
+	return (*allocator->allocate)(allocator, size);
+}
+
+void httpmessage_allocator_release(
+    httpmessage_allocator *allocator,
+    void *memory)
+{
+	if (!allocator)
+	{
+		if (memory)
+		{
+			HTTPMESSAGE_COUNTER_ADD(httpmessage_heap_counters.release_count, 1);
+		}
+		
+		free(memory);
+		return;
+	}
+	
+	if (allocator->release)
+	{
+		(*allocator->release)(allocator, memory);
+	}
+}
+
+static void *httpmessage_arena_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size)
+{
+	return httpmessage_arena_allocate((httpmessage_arena *)allocator, size);
+}
+
+static void httpmessage_arena_allocator_reset(
+    httpmessage_allocator *allocator)
+{
+	httpmessage_arena_reset((httpmessage_arena *)allocator);
+}
+
+void httpmessage_arena_init(
+    httpmessage_arena *arena,
+    size_t chunk_size)
+{
+	arena->allocator.allocate = httpmessage_arena_allocator_allocate;
+	arena->allocator.release = NULL;
+	arena->allocator.reset = httpmessage_arena_allocator_reset;
+	arena->first_chunk = NULL;
+	arena->current_chunk = NULL;
+	arena->offset = 0;
+	arena->chunk_size = HTTPMESSAGE_MEMORY_ALIGN(chunk_size ? chunk_size : HTTPMESSAGE_ARENA_CHUNK_SIZE);
+	arena->chunk_allocator = NULL;
+}
+
+static httpmessage_arena_chunk *httpmessage_arena_chunk_new(
+    httpmessage_arena *arena,
+    size_t size)
+{
+	httpmessage_arena_chunk *chunk;
+	
+	if (size < arena->chunk_size)
+	{
+		size = arena->chunk_size;
+	}
+	
+	chunk = (httpmessage_arena_chunk *)httpmessage_allocator_allocate(
+	            arena->chunk_allocator,
+	            HTTPMESSAGE_ARENA_CHUNK_HEADER_SIZE + size);
+	            
+	if (!chunk)
+	{
+		return NULL;
+	}
+	
+	chunk->next_chunk = NULL;
+	chunk->size = size;
+	return chunk;
+}
+
+void *httpmessage_arena_allocate(
+    httpmessage_arena *arena,
+    size_t size)
+{
+	httpmessage_arena_chunk *chunk;
+	void *memory;
+	
+	size = HTTPMESSAGE_MEMORY_ALIGN(size);
+	
+	if (arena->current_chunk
+	        && (arena->current_chunk->size - arena->offset) >= size)
+	{
+		goto httpmessage_arena_allocate_ok;
+	}
+	
+	/* Reuse the following chunk if possible */
+	chunk = (arena->current_chunk
+	         ? arena->current_chunk->next_chunk
+	         : arena->first_chunk);
+	         
+	if (!(chunk && chunk->size >= size))
+	{
+		httpmessage_arena_chunk *next = chunk;
+		chunk = httpmessage_arena_chunk_new(arena, size);
+		
+		if (!chunk)
+		{
+			return NULL;
+		}
+		
+		chunk->next_chunk = next;
+		
+		if (arena->current_chunk)
+		{
+			arena->current_chunk->next_chunk = chunk;
+		}
+		else
+		{
+			arena->first_chunk = chunk;
+		}
+	}
+	
+	arena->current_chunk = chunk;
+	arena->offset = 0;
+
+httpmessage_arena_allocate_ok:
+	memory = (uint8_t *)arena->current_chunk
+	         + HTTPMESSAGE_ARENA_CHUNK_HEADER_SIZE
+	         + arena->offset;
+	arena->offset += size;
+	return memory;
+}
+
+void httpmessage_arena_reset(httpmessage_arena *arena)
+{
+	arena->current_chunk = NULL;
+	arena->offset = 0;
+}
+
+void httpmessage_arena_clear(httpmessage_arena *arena)
+{
+	httpmessage_arena_chunk *chunk = arena->first_chunk;
+	
+	while (chunk)
+	{
+		httpmessage_arena_chunk *next = chunk->next_chunk;
+		httpmessage_allocator_release(arena->chunk_allocator, chunk);
+		chunk = next;
+	}
+	
+	arena->first_chunk = NULL;
+	arena->current_chunk = NULL;
+	arena->offset = 0;
+}
+
+size_t httpmessage_arena_chunk_count(const httpmessage_arena *arena)
+{
+	size_t count = 0;
+	const httpmessage_arena_chunk *chunk = arena->first_chunk;
+	
+	while (chunk)
+	{
+		++count;
+		chunk = chunk->next_chunk;
+	}
+	
+	return count;
+}
+
+static void *httpmessage_hugepage_allocator_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size)
+{
+	return httpmessage_hugepage_allocator_allocate(
+	           (httpmessage_hugepage_allocator *)allocator, size);
+}
+
+static void httpmessage_hugepage_allocator_allocator_release(
+    httpmessage_allocator *allocator,
+    void *memory)
+{
+	httpmessage_hugepage_allocator_release(
+	    (httpmessage_hugepage_allocator *)allocator, memory);
+}
+
+void httpmessage_hugepage_allocator_init(
+    httpmessage_hugepage_allocator *allocator,
+    size_t block_size,
+    int strategies)
+{
+	allocator->allocator.allocate = httpmessage_hugepage_allocator_allocator_allocate;
+	allocator->allocator.release = httpmessage_hugepage_allocator_allocator_release;
+	allocator->allocator.reset = NULL;
+	allocator->first_region = NULL;
+	allocator->offset = 0;
+	allocator->block_size = HTTPMESSAGE_MEMORY_ALIGN(
+	                            (block_size < sizeof(void *)) ? sizeof(void *) : block_size);
+	allocator->free_list = NULL;
+	allocator->strategies = (strategies & HTTPMESSAGE_HUGEPAGE_ANY);
+	
+	if (!allocator->strategies)
+	{
+		allocator->strategies = HTTPMESSAGE_HUGEPAGE_ANY;
+	}
+}
+
+static void *httpmessage_hugepage_region_map(int strategy)
+{
+#if defined (__linux__)
+	void *memory;
+	
+	if (strategy == HTTPMESSAGE_HUGEPAGE_HUGETLB)
+	{
+#	if defined (MAP_HUGETLB)
+		memory = mmap(NULL, HTTPMESSAGE_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+		              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		return ((memory == MAP_FAILED) ? NULL : memory);
+#	endif
+	}
+	else if (strategy == HTTPMESSAGE_HUGEPAGE_TRANSPARENT)
+	{
+#	if defined (MADV_HUGEPAGE)
+		uint8_t *mapping;
+		size_t head;
+		size_t tail;
+		
+		/* Over-allocate to get a region aligned on a huge page boundary */
+		memory = mmap(NULL, 2 * HTTPMESSAGE_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE,
+		              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		              
+		if (memory == MAP_FAILED)
+		{
+			return NULL;
+		}
+		
+		mapping = (uint8_t *)memory;
+		head = (HTTPMESSAGE_HUGEPAGE_SIZE
+		        - ((uintptr_t)mapping % HTTPMESSAGE_HUGEPAGE_SIZE))
+		       % HTTPMESSAGE_HUGEPAGE_SIZE;
+		tail = HTTPMESSAGE_HUGEPAGE_SIZE - head;
+		
+		if (head)
+		{
+			munmap(mapping, head);
+		}
+		
+		if (tail)
+		{
+			munmap(mapping + head + HTTPMESSAGE_HUGEPAGE_SIZE, tail);
+		}
+		
+		memory = mapping + head;
+		
+		if (madvise(memory, HTTPMESSAGE_HUGEPAGE_SIZE, MADV_HUGEPAGE) != 0)
+		{
+			/* Transparent huge pages are not supported */
+			munmap(memory, HTTPMESSAGE_HUGEPAGE_SIZE);
+			return NULL;
+		}
+		
+		return memory;
+#	endif
+	}
+#else
+	(void) strategy;
+#endif
+	
+	return NULL;
+}
+
+static httpmessage_hugepage_region *httpmessage_hugepage_region_new(
+    httpmessage_hugepage_allocator *allocator)
+{
+	static const int strategies[] =
+	{
+		HTTPMESSAGE_HUGEPAGE_HUGETLB,
+		HTTPMESSAGE_HUGEPAGE_TRANSPARENT
+	};
+	httpmessage_hugepage_region *region = NULL;
+	int strategy = HTTPMESSAGE_HUGEPAGE_FALLBACK;
+	size_t a;
+	
+	for (a = 0; !region && a < (sizeof(strategies) / sizeof(int)); ++a)
+	{
+		if (allocator->strategies & strategies[a])
+		{
+			strategy = strategies[a];
+			region = (httpmessage_hugepage_region *)httpmessage_hugepage_region_map(strategy);
+		}
+	}
+	
+	if (!region && (allocator->strategies & HTTPMESSAGE_HUGEPAGE_FALLBACK))
+	{
+		strategy = HTTPMESSAGE_HUGEPAGE_FALLBACK;
+		region = (httpmessage_hugepage_region *)httpmessage_allocator_allocate(NULL,
+		         HTTPMESSAGE_HUGEPAGE_SIZE);
+	}
+	
+	if (!region)
+	{
+		return NULL;
+	}
+	
+	region->next_region = NULL;
+	region->size = HTTPMESSAGE_HUGEPAGE_SIZE;
+	region->strategy = strategy;
+	return region;
+}
+
+static void httpmessage_hugepage_region_free(httpmessage_hugepage_region *region)
+{
+	if (region->strategy == HTTPMESSAGE_HUGEPAGE_FALLBACK)
+	{
+		httpmessage_allocator_release(NULL, region);
+		return;
+	}
+
+#if defined (__unix__) || defined (__APPLE__)
+	munmap(region, region->size);
+#endif
+}
+
+void *httpmessage_hugepage_allocator_allocate(
+    httpmessage_hugepage_allocator *allocator,
+    size_t size)
+{
+	httpmessage_hugepage_region *region;
+	void *memory;
+	
+	if (size > allocator->block_size
+	        || (HTTPMESSAGE_HUGEPAGE_REGION_HEADER_SIZE + allocator->block_size)
+	        > HTTPMESSAGE_HUGEPAGE_SIZE)
+	{
+		return NULL;
+	}
+	
+	if (allocator->free_list)
+	{
+		memory = allocator->free_list;
+		memcpy(&allocator->free_list, memory, sizeof(void *));
+		return memory;
+	}
+	
+	region = allocator->first_region;
+	
+	if (!(region
+	        && (region->size - allocator->offset) >= allocator->block_size))
+	{
+		region = httpmessage_hugepage_region_new(allocator);
+		
+		if (!region)
+		{
+			return NULL;
+		}
+		
+		region->next_region = allocator->first_region;
+		allocator->first_region = region;
+		allocator->offset = HTTPMESSAGE_HUGEPAGE_REGION_HEADER_SIZE;
+	}
+	
+	memory = (uint8_t *)region + allocator->offset;
+	allocator->offset += allocator->block_size;
+	return memory;
+}
+
+void httpmessage_hugepage_allocator_release(
+    httpmessage_hugepage_allocator *allocator,
+    void *memory)
+{
+	if (!memory)
+	{
+		return;
+	}
+	
+	memcpy(memory, &allocator->free_list, sizeof(void *));
+	allocator->free_list = memory;
+}
+
+void httpmessage_hugepage_allocator_clear(
+    httpmessage_hugepage_allocator *allocator)
+{
+	httpmessage_hugepage_region *region = allocator->first_region;
+	
+	while (region)
+	{
+		httpmessage_hugepage_region *next = region->next_region;
+		httpmessage_hugepage_region_free(region);
+		region = next;
+	}
+	
+	allocator->first_region = NULL;
+	allocator->offset = 0;
+	allocator->free_list = NULL;
+}
+
+size_t httpmessage_hugepage_allocator_region_count(
+    const httpmessage_hugepage_allocator *allocator,
+    int strategies)
+{
+	size_t count = 0;
+	const httpmessage_hugepage_region *region = allocator->first_region;
+	
+	while (region)
+	{
+		if (region->strategy & strategies)
+		{
+			++count;
+		}
+		
+		region = region->next_region;
+	}
+	
+	return count;
+}
+
+static void *httpmessage_budget_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size)
+{
+	return httpmessage_budget_allocate((httpmessage_budget *)allocator, size);
+}
+
+static void httpmessage_budget_allocator_release(
+    httpmessage_allocator *allocator,
+    void *memory)
+{
+	httpmessage_budget_release((httpmessage_budget *)allocator, memory);
+}
+
+static void httpmessage_budget_allocator_reset(
+    httpmessage_allocator *allocator)
+{
+	httpmessage_budget_reset((httpmessage_budget *)allocator);
+}
+
+int httpmessage_allocator_get_error(
+    const httpmessage_allocator *allocator)
+{
+	if (allocator
+	        && allocator->allocate == httpmessage_budget_allocator_allocate
+	        && ((const httpmessage_budget *)allocator)->exceeded)
+	{
+		return HTTPMESSAGE_ERROR_BUDGET;
+	}
+	
+	return HTTPMESSAGE_ERROR_ALLOCATION;
+}
+
+void httpmessage_budget_init(
+    httpmessage_budget *budget,
+    size_t limit,
+    httpmessage_allocator *parent)
+{
+	budget->allocator.allocate = httpmessage_budget_allocator_allocate;
+	budget->allocator.release = ((!parent || parent->release)
+	                             ? httpmessage_budget_allocator_release
+	                             : NULL);
+	budget->allocator.reset = ((parent && parent->reset)
+	                           ? httpmessage_budget_allocator_reset
+	                           : NULL);
+	budget->parent = parent;
+	budget->limit = limit;
+	budget->used = 0;
+	budget->peak = 0;
+	budget->refusal_count = 0;
+	budget->exceeded = 0;
+}
+
+void *httpmessage_budget_allocate(
+    httpmessage_budget *budget,
+    size_t size)
+{
+	uint8_t *memory;
+	
+	if (budget->limit < HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE
+	        || size > (budget->limit - HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE)
+	        || (size + HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE) > (budget->limit - budget->used))
+	{
+		++budget->refusal_count;
+		budget->exceeded = 1;
+		return NULL;
+	}
+	
+	budget->exceeded = 0;
+	size += HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE;
+	memory = (uint8_t *)httpmessage_allocator_allocate(budget->parent, size);
+	
+	if (!memory)
+	{
+		return NULL;
+	}
+	
+	memcpy(memory, &size, sizeof(size_t));
+	budget->used += size;
+	
+	if (budget->used > budget->peak)
+	{
+		budget->peak = budget->used;
+	}
+	
+	return memory + HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE;
+}
+
+void httpmessage_budget_release(
+    httpmessage_budget *budget,
+    void *memory)
+{
+	uint8_t *block;
+	size_t size;
+	
+	if (!memory)
+	{
+		return;
+	}
+	
+	block = (uint8_t *)memory - HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE;
+	memcpy(&size, block, sizeof(size_t));
+	budget->used -= (size < budget->used) ? size : budget->used;
+	httpmessage_allocator_release(budget->parent, block);
+}
+
+void httpmessage_budget_reset(httpmessage_budget *budget)
+{
+	budget->exceeded = 0;
+	
+	if (budget->parent && budget->parent->reset)
+	{
+		(*budget->parent->reset)(budget->parent);
+		budget->used = 0;
+	}
+}
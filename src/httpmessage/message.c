@@ -14,7 +14,8 @@
 
 void httpmessage_message_storage_init(
     httpmessage_message *message,
-    uint8_t *storage,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
     size_t max_headerfield_count,
     size_t max_line_per_headerfield_value);
 
@@ -420,20 +421,343 @@ HMAPI int httpmessage_message_get_storage_infos(
 
 void httpmessage_message_init(httpmessage_message *message)
 {
+	message->type = HTTPMESSAGE_TYPE_UNKNOWN;
+	message->allocator = NULL;
+	message->allocator_shared = 0;
+	message->storage_end = NULL;
+	message->header_block = NULL;
+	message->string_block = NULL;
 	httpmessage_headerfield_init(&message->field_list);
+	message->trailer_list = NULL;
+	message->trailer_merged = 0;
 	httpmessage_stringview_clear(&message->body);
 	message->major_version = message->minor_version = 1;
 }
 
+static int httpmessage_message_range_contains(
+    const void *begin, const void *end,
+    const void *node)
+{
+	return ((const uint8_t *)node >= (const uint8_t *)begin)
+	       && ((const uint8_t *)node < (const uint8_t *)end);
+}
+
+/* String block header. The copied strings follow the header */
+typedef struct __httpmessage_string_block
+{
+	struct __httpmessage_string_block *next_block;
+	/** Usable size */
+	size_t size;
+	/** Offset of the first unused byte */
+	size_t offset;
+} httpmessage_string_block;
+
+#define HTTPMESSAGE_STRING_BLOCK_HEADER_SIZE \
+	HTTPMESSAGE_MEMORY_ALIGN(sizeof(httpmessage_string_block))
+
+int httpmessage_message_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_message *message)
+{
+	const httpmessage_headerfield *lists[2];
+	const httpmessage_headerfield *field;
+	size_t l;
+	const uint8_t *header_block;
+	size_t header_block_size = 0;
+	size_t header_block_node_size = 0;
+	const httpmessage_string_block *string_block;
+	
+	memset(usage, 0, sizeof(httpmessage_memory_usage));
+	
+	if (!message)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	header_block = (const uint8_t *)message->header_block;
+	
+	if (header_block)
+	{
+		memcpy(&header_block_size, header_block, sizeof(size_t));
+	}
+	
+	/* Header fields, then detached trailer fields */
+	lists[0] = &message->field_list;
+	lists[1] = (message->trailer_merged ? NULL : message->trailer_list);
+	
+	for (l = 0; l < 2; ++l)
+	{
+		for (field = lists[l]; field; field = field->next_field)
+		{
+			const httpmessage_headerfield_value *value;
+			int used = (field->name.length != 0);
+			
+			if (used)
+			{
+				usage->referenced_size += field->name.length;
+			}
+			
+			if (field != &message->field_list)
+			{
+				*(used ? &usage->headerfield_size : &usage->unused_size) +=
+				    sizeof(httpmessage_headerfield);
+				    
+				if (header_block
+				        && httpmessage_message_range_contains(header_block,
+				                header_block + header_block_size, field))
+				{
+					header_block_node_size += sizeof(httpmessage_headerfield);
+				}
+			}
+			
+			for (value = &field->value; value; value = value->next_line)
+			{
+				int line_used = (used && value->line.length);
+				
+				if (line_used)
+				{
+					usage->referenced_size += value->line.length;
+				}
+				
+				if (value == &field->value)
+				{
+					continue;
+				}
+				
+				*(line_used ? &usage->line_size : &usage->unused_size) +=
+				    sizeof(httpmessage_headerfield_value);
+				    
+				if (header_block
+				        && httpmessage_message_range_contains(header_block,
+				                header_block + header_block_size, value))
+				{
+					header_block_node_size += sizeof(httpmessage_headerfield_value);
+				}
+			}
+		}
+	}
+	
+	usage->internal_size = header_block_size - header_block_node_size;
+	
+	for (string_block = (const httpmessage_string_block *)message->string_block;
+	        string_block; string_block = string_block->next_block)
+	{
+		usage->internal_size += HTTPMESSAGE_STRING_BLOCK_HEADER_SIZE + string_block->size;
+	}
+	
+	usage->total_size = usage->headerfield_size + usage->line_size
+	                    + usage->unused_size + usage->internal_size;
+	usage->referenced_size += message->body.length;
+	return HTTPMESSAGE_OK;
+}
+
+/*
+ * Clear header fields and detach nodes located outside of [begin, end[.
+ * Detached nodes are released unless the message allocator supports bulk release.
+ */
+static void httpmessage_message_headerfield_list_detach(
+    httpmessage_message *message,
+    const void *begin, const void *end)
+{
+	httpmessage_allocator *allocator = message->allocator;
+	int release = !(allocator && allocator->reset);
+	httpmessage_headerfield *field = &message->field_list;
+	
+	while (field)
+	{
+		httpmessage_headerfield_value *value = &field->value;
+		httpmessage_stringview_clear(&field->name);
+		
+		while (value)
+		{
+			httpmessage_stringview_clear(&value->line);
+			
+			if (value->next_line
+			        && !httpmessage_message_range_contains(begin, end, value->next_line))
+			{
+				if (release)
+				{
+					httpmessage_headerfield_value_release(value->next_line, allocator);
+				}
+				
+				value->next_line = NULL;
+			}
+			
+			value = value->next_line;
+		}
+		
+		if (field->next_field
+		        && !httpmessage_message_range_contains(begin, end, field->next_field))
+		{
+			if (release)
+			{
+				httpmessage_headerfield_release(field->next_field, allocator);
+			}
+			
+			field->next_field = NULL;
+		}
+		
+		field = field->next_field;
+	}
+}
+
+/* Clear pre-allocated header fields and detach overflow nodes */
+static void httpmessage_message_storage_clear(httpmessage_message *message)
+{
+	httpmessage_allocator *allocator = message->allocator;
+	
+	httpmessage_message_headerfield_list_detach(message,
+	        message, message->storage_end);
+	        
+	if (allocator && allocator->reset && !message->allocator_shared)
+	{
+		(*allocator->reset)(allocator);
+	}
+}
+
+/*
+ * Header block layout: block size followed by header fields and value lines
+ */
+#define HTTPMESSAGE_HEADER_BLOCK_HEADER_SIZE \
+	HTTPMESSAGE_MEMORY_ALIGN(sizeof(size_t))
+
+/* Release the header block and nodes appended after it */
+static void httpmessage_message_header_block_clear(httpmessage_message *message)
+{
+	uint8_t *block = (uint8_t *)message->header_block;
+	size_t size;
+	
+	memcpy(&size, block, sizeof(size_t));
+	httpmessage_message_headerfield_list_detach(message, block, block + size);
+	httpmessage_headerfield_init(&message->field_list);
+	
+	if (!(message->allocator && message->allocator->reset))
+	{
+		httpmessage_allocator_release(message->allocator, block);
+	}
+	
+	message->header_block = NULL;
+}
+
+/*
+ * Release string blocks.
+ * The first block is the largest one. It is kept with HTTPMESSAGE_CLEAR_NO_FREE.
+ */
+static void httpmessage_message_string_block_clear(
+    httpmessage_message *message,
+    int option_flags)
+{
+	httpmessage_string_block *block = (httpmessage_string_block *)message->string_block;
+	
+	if (!block)
+	{
+		return;
+	}
+	
+	if (message->allocator && message->allocator->reset)
+	{
+		/* Released by the allocator reset */
+		message->string_block = NULL;
+		return;
+	}
+	
+	if (option_flags & HTTPMESSAGE_CLEAR_NO_FREE)
+	{
+		block->offset = 0;
+		block = block->next_block;
+		((httpmessage_string_block *)message->string_block)->next_block = NULL;
+	}
+	else
+	{
+		message->string_block = NULL;
+	}
+	
+	while (block)
+	{
+		httpmessage_string_block *next = block->next_block;
+		httpmessage_allocator_release(message->allocator, block);
+		block = next;
+	}
+}
+
+/* Link detached trailer fields back after the header fields */
+static void httpmessage_message_trailer_list_attach(httpmessage_message *message)
+{
+	httpmessage_headerfield *field = &message->field_list;
+	
+	if (message->trailer_list && !message->trailer_merged)
+	{
+		while (field->next_field)
+		{
+			field = field->next_field;
+		}
+		
+		field->next_field = message->trailer_list;
+	}
+	
+	message->trailer_list = NULL;
+	message->trailer_merged = 0;
+}
+
+static void httpmessage_message_headerfield_list_clear(
+    httpmessage_message *message,
+    int option_flags)
+{
+	httpmessage_message_trailer_list_attach(message);
+	httpmessage_message_string_block_clear(message, option_flags);
+	
+	if (message->storage_end)
+	{
+		httpmessage_message_storage_clear(message);
+		return;
+	}
+	
+	if (message->header_block)
+	{
+		httpmessage_message_header_block_clear(message);
+	}
+	
+	if (message->allocator && message->allocator->reset)
+	{
+		/* All header fields are released at once, by the owner of a shared allocator */
+		httpmessage_headerfield_init(&message->field_list);
+		
+		if (!message->allocator_shared)
+		{
+			(*message->allocator->reset)(message->allocator);
+		}
+		
+		return;
+	}
+	
+	httpmessage_headerfield_clear_with_allocator(&message->field_list,
+	        option_flags, message->allocator);
+}
+
 void httpmessage_message_clear(
     httpmessage_message *message,
     int option_flags)
 {
-	httpmessage_headerfield_clear(&message->field_list, option_flags);
+	httpmessage_message_headerfield_list_clear(message, option_flags);
 	httpmessage_stringview_clear(&message->body);
 	message->major_version = message->minor_version = 1;
 }
 
+void httpmessage_message_release(httpmessage_message *message)
+{
+	httpmessage_message_clear(message, 0);
+}
+
+static void httpmessage_message_arena_clear(
+    httpmessage_message *message,
+    void *arena)
+{
+	if (message->allocator == (httpmessage_allocator *)arena)
+	{
+		httpmessage_arena_clear((httpmessage_arena *)arena);
+	}
+}
+
 int httpmessage_message_append_header_with_lengths(
     httpmessage_message *message,
     const char *name, size_t name_length,
@@ -458,14 +782,16 @@ int httpmessage_message_append_header_with_lengths(
 		return HTTPMESSAGE_ERROR_ALLOCATION;
 	}
 	
-	header->next_field = httpmessage_headerfield_new();
-	
+	header->next_field = (httpmessage_headerfield *)httpmessage_allocator_allocate(
+	                         message->allocator, sizeof(httpmessage_headerfield));
+	                         
 	if (!header->next_field)
 	{
-		return HTTPMESSAGE_ERROR_ALLOCATION;
+		return httpmessage_allocator_get_error(message->allocator);
 	}
 	
 	header = header->next_field;
+	httpmessage_headerfield_init(header);
 	
 httpmessage_message_append_headerfield_ok:
 	header->name.text = name;
@@ -488,324 +814,655 @@ int httpmessage_message_append_header(
 	           option_flags);
 }
 
-ssize_t httpmessage_message_content_consume(
+/* Reserve memory in the current string block or in a new one */
+static char *httpmessage_message_string_block_reserve(
     httpmessage_message *message,
-    const char *text, size_t length,
+    size_t size,
     int option_flags)
 {
-	ssize_t consumed = 0;
-	ssize_t result = 0;
-	httpmessage_headerfield *field;
-	httpmessage_headerfield_clear(&message->field_list, option_flags);
-	httpmessage_stringview_clear(&message->body);
+	httpmessage_string_block *block = (httpmessage_string_block *)message->string_block;
+	size_t block_size = HTTPMESSAGE_STRING_BLOCK_SIZE;
+	char *memory;
 	
-	/* Headers */
-	result = httpmessage_headerfield_list_consume(
-	             &message->field_list,
-	             text, length,
-	             option_flags);
-	             
-	if (result < 0)
+	if (block && (block->size - block->offset) >= size)
 	{
-		switch (result)
-		{
-			case HTTPMESSAGE_ERROR_ALLOCATION:
-				return result;
-				
-			default:
-				break;
-		}
-		
-		return HTTPMESSAGE_ERROR_SYNTAX;
+		goto httpmessage_message_string_block_reserve_ok;
 	}
 	
-	text += result;
-	length -= (size_t)result;
+	if (option_flags & HTTPMESSAGE_NO_ALLOCATION)
+	{
+		return NULL;
+	}
 	
-	consumed += result;
+	/* Grow geometrically, so the first block is always the largest one */
+	if (block && (2 * block->size) > block_size)
+	{
+		block_size = 2 * block->size;
+	}
 	
-	if (length == 0)
+	if (size > block_size)
 	{
-		if ((option_flags & HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF) == 0)
-		{
-			return HTTPMESSAGE_ERROR_INCOMPLETE;
-		}
-		
-		return consumed;
+		block_size = size;
 	}
 	
-	/* CRLF line */
+	block = (httpmessage_string_block *)httpmessage_allocator_allocate(
+	            message->allocator,
+	            HTTPMESSAGE_STRING_BLOCK_HEADER_SIZE + block_size);
+	            
+	if (!block)
+	{
+		return NULL;
+	}
 	
-	if (!httpmessage_text_is_CRLF(text, length))
+	block->next_block = (httpmessage_string_block *)message->string_block;
+	block->size = block_size;
+	block->offset = 0;
+	message->string_block = block;
+
+httpmessage_message_string_block_reserve_ok:
+	memory = (char *)block + HTTPMESSAGE_STRING_BLOCK_HEADER_SIZE + block->offset;
+	block->offset += size;
+	return memory;
+}
+
+int httpmessage_message_append_header_copy_with_lengths(
+    httpmessage_message *message,
+    const char *name, size_t name_length,
+    const char *value, size_t value_length,
+    int option_flags)
+{
+	char *text;
+	int result;
+	
+	text = httpmessage_message_string_block_reserve(message,
+	        name_length + value_length, option_flags);
+	        
+	if (!text)
 	{
-		return HTTPMESSAGE_ERROR_SYNTAX;
+		return ((option_flags & HTTPMESSAGE_NO_ALLOCATION)
+		        ? HTTPMESSAGE_ERROR_ALLOCATION
+		        : httpmessage_allocator_get_error(message->allocator));
 	}
 	
-	text += 2;
-	length -= 2;
-	consumed += 2;
+	memcpy(text, name, name_length);
+	memcpy(text + name_length, value, value_length);
 	
-	/* Body == 0 */
-	if (length == 0)
+	result = httpmessage_message_append_header_with_lengths(message,
+	         text, name_length,
+	         text + name_length, value_length,
+	         option_flags);
+	         
+	if (result != HTTPMESSAGE_OK)
 	{
-		return consumed;
+		/* Give the reserved memory back */
+		((httpmessage_string_block *)message->string_block)->offset -=
+		    name_length + value_length;
 	}
 	
-	field = httpmessage_headerfield_find(&message->field_list, "Content-Length", 14);
+	return result;
+}
+
+int httpmessage_message_append_header_copy(
+    httpmessage_message *message,
+    const char *name, const char *value,
+    int option_flags)
+{
+	return httpmessage_message_append_header_copy_with_lengths(
+	           message,
+	           name, strlen(name),
+	           value, strlen(value),
+	           option_flags);
+}
+
+/*
+ * Count header field lines and continuation lines of a header block.
+ *
+ * Lines are located with memchr(), which is vectorized by most C libraries.
+ */
+static void httpmessage_message_header_block_prescan(
+    size_t *field_count,
+    size_t *continuation_count,
+    const char *text, size_t length)
+{
+	const char *end = text + length;
+	*field_count = 0;
+	*continuation_count = 0;
 	
-	if (field)
+	while (text < end && !httpmessage_text_is_CRLF(text, (size_t)(end - text)))
 	{
-		int value;
+		const char *p = text;
 		
-		result = httpmessage_int_consume(&value, field->value.line.text, field->value.line.length);
-		
-		if (result <= 0)
+		if (httpmessage_text_is_LWS(*text))
 		{
-			return HTTPMESSAGE_ERROR_SYNTAX;
+			++(*continuation_count);
 		}
-		
-		
-		if (value < 0)
+		else
 		{
-			return HTTPMESSAGE_ERROR_SYNTAX;
+			++(*field_count);
 		}
 		
-		if ((size_t)value > length)
+		/* Next CRLF */
+		for (;;)
 		{
-			return HTTPMESSAGE_ERROR_INCOMPLETE;
+			const char *lf = (const char *)memchr(p, '\n', (size_t)(end - p));
+			
+			if (!lf)
+			{
+				return;
+			}
+			
+			p = lf + 1;
+			
+			if (lf > text && *(lf - 1) == '\r')
+			{
+				break;
+			}
 		}
 		
-		length = (size_t) value;
+		text = p;
 	}
-	
-	message->body.text = text;
-	message->body.length = length;
-	
-	return consumed + (ssize_t)length;
 }
 
-ssize_t httpmessage_message_content_write_file(
-    FILE *file,
-    const httpmessage_message *message)
+/* Bump allocator over a header block */
+typedef struct __httpmessage_header_block_allocator
 {
-	ssize_t written = 0;
-	ssize_t w;
+	httpmessage_allocator allocator;
+	uint8_t *memory;
+	size_t available;
+} httpmessage_header_block_allocator;
+
+static void *httpmessage_header_block_allocator_allocate(
+    httpmessage_allocator *allocator,
+    size_t size)
+{
+	httpmessage_header_block_allocator *block = (httpmessage_header_block_allocator *)allocator;
+	void *memory = block->memory;
+	size = HTTPMESSAGE_MEMORY_ALIGN(size);
 	
-	if (!(file && message))
+	if (size > block->available)
 	{
-		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+		return NULL;
 	}
 	
-	/* Header */
-	w = httpmessage_headerfield_list_write_file(file, &message->field_list);
-	
-	if (w < 0)
-	{
-		return w;
+	block->memory += size;
+	block->available -= size;
+	return memory;
+}
+
+static ssize_t httpmessage_message_headerfield_list_prescan_consume(
+    httpmessage_message *message,
+    const char *text, size_t length,
+    int option_flags)
+{
+	httpmessage_header_block_allocator block;
+	size_t field_count;
+	size_t continuation_count;
+	size_t size;
+	
+	/* Header fields kept by a previous HTTPMESSAGE_CLEAR_NO_FREE are not reused */
+	httpmessage_message_headerfield_list_clear(message,
+	        option_flags & ~HTTPMESSAGE_CLEAR_NO_FREE);
+	        
+	httpmessage_message_header_block_prescan(&field_count, &continuation_count,
+	        text, length);
+	        
+	/* The first header field is part of the message */
+	size = ((field_count > 1) ? (field_count - 1) : 0)
+	       * HTTPMESSAGE_MEMORY_ALIGN(sizeof(httpmessage_headerfield))
+	       + continuation_count * HTTPMESSAGE_MEMORY_ALIGN(sizeof(httpmessage_headerfield_value));
+	       
+	block.allocator.allocate = httpmessage_header_block_allocator_allocate;
+	block.allocator.release = NULL;
+	block.allocator.reset = NULL;
+	block.memory = NULL;
+	block.available = size;
+	
+	if (size)
+	{
+		size += HTTPMESSAGE_HEADER_BLOCK_HEADER_SIZE;
+		message->header_block = httpmessage_allocator_allocate(message->allocator, size);
+		
+		if (!message->header_block)
+		{
+			return httpmessage_allocator_get_error(message->allocator);
+		}
+		
+		memcpy(message->header_block, &size, sizeof(size_t));
+		block.memory = (uint8_t *)message->header_block
+		               + HTTPMESSAGE_HEADER_BLOCK_HEADER_SIZE;
 	}
 	
-	written += w;
-	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, "\r\n", 2)
-	
-	/* Body */
-	HTTPMESSAGE_STRING_WRITE_FILE(written, file, message->body)
-	
-	return written;
+	return httpmessage_headerfield_list_consume_with_allocator(
+	           &message->field_list,
+	           text, length,
+	           option_flags,
+	           &block.allocator);
 }
 
-ssize_t httpmessage_message_content_write_buffer(
-    void *output, size_t output_size,
-    const httpmessage_message *message)
+/* Trailer field lines parsed after the last header field, then detached unless merged */
+ssize_t httpmessage_message_trailer_consume(
+    httpmessage_message *message,
+    const char *text, size_t length,
+    int option_flags)
 {
-	ssize_t w;
-	char *o = (char *)output;
+	httpmessage_headerfield *last = NULL;
+	httpmessage_headerfield *current = NULL;
+	httpmessage_headerfield *field = NULL;
+	httpmessage_headerfield *trailer_list = NULL;
+	ssize_t consumed = 0;
 	
-	if (!(output && output_size && message))
+	if (!message || (length && !text))
 	{
 		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
 	}
 	
-	w = httpmessage_headerfield_list_write_buffer(o, output_size, &message->field_list);
+	/* Previous trailer fields become unused nodes */
+	trailer_list = message->trailer_list;
+	httpmessage_message_trailer_list_attach(message);
 	
-	if (w < 0)
+	if (trailer_list)
 	{
-		return w;
+		httpmessage_headerfield_clear_with_allocator(trailer_list,
+		        HTTPMESSAGE_CLEAR_NO_FREE, message->allocator);
 	}
 	
-	o += w;
-	output_size -= (size_t)w;
+	if (length == 0)
+	{
+		return 0;
+	}
 	
-	HTTPMESSAGE_TEXT_WRITE_BUFFER(o, output_size, "\r\n", 2)
+	/* Trailer fields cannot be the first fields nor continue a header field value */
+	if (!message->field_list.name.length || httpmessage_text_is_LWS(*text))
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
 	
-	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, message->body)
+	last = &message->field_list;
 	
-	return (o - (char *)output);
-}
-
-httpmessage_request *httpmessage_request_new()
-{
-	httpmessage_request *request = (httpmessage_request *)malloc(sizeof(httpmessage_request));
+	while (last->next_field && last->next_field->name.length)
+	{
+		last = last->next_field;
+	}
 	
-	if (!request)
+	current = last;
+	
+	while (length)
 	{
-		return request;
+		ssize_t result = httpmessage_headerfield_line_consume_with_allocator(
+		                     &field, current,
+		                     text, length,
+		                     option_flags,
+		                     message->allocator);
+		                     
+		if (result < 0)
+		{
+			return result;
+		}
+		
+		if (result == 0)
+		{
+			break;
+		}
+		
+		current = field;
+		text += result;
+		length -= (size_t)result;
+		consumed += result;
 	}
 	
-	httpmessage_request_init(request);
-	return request;
+	if (last->next_field && last->next_field->name.length)
+	{
+		message->trailer_list = last->next_field;
+		message->trailer_merged = ((option_flags & HTTPMESSAGE_CONSUME_MERGE_TRAILER) != 0);
+		
+		if (!message->trailer_merged)
+		{
+			last->next_field = NULL;
+		}
+	}
+	
+	return consumed;
 }
 
-void httpmessage_request_init(httpmessage_request *request)
+static ssize_t httpmessage_message_body_consume(
+    httpmessage_message *message,
+    int framing, size_t body_length,
+    const char *text, size_t length,
+    int option_flags)
 {
-	httpmessage_stringview_clear(&request->method);
-	httpmessage_stringview_clear(&request->request_uri);
-	httpmessage_message_init(&request->message);
+	switch (framing)
+	{
+		case HTTPMESSAGE_FRAMING_NONE:
+			return 0;
+		
+		case HTTPMESSAGE_FRAMING_LENGTH:
+			if (body_length > length)
+			{
+				return HTTPMESSAGE_ERROR_INCOMPLETE;
+			}
+			
+			length = body_length;
+			break;
+		
+		case HTTPMESSAGE_FRAMING_CHUNKED:
+		{
+			httpmessage_chunked_decoder decoder;
+			httpmessage_stringview data;
+			size_t offset = 0;
+			httpmessage_chunked_decoder_init(&decoder);
+			
+			/* The body is the chunked text */
+			while (offset < length
+			        && decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+			{
+				ssize_t result = httpmessage_chunked_decoder_consume(&decoder, &data,
+				                 text + offset, length - offset);
+				                 
+				if (result < 0)
+				{
+					return HTTPMESSAGE_ERROR_SYNTAX;
+				}
+				
+				offset += (size_t)result;
+			}
+			
+			if (decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+			{
+				return HTTPMESSAGE_ERROR_INCOMPLETE;
+			}
+			
+			length = offset;
+			
+			/* Trailer section precedes the final CRLF */
+			if (decoder.trailer_length)
+			{
+				ssize_t result = httpmessage_message_trailer_consume(message,
+				                 text + offset - 2 - decoder.trailer_length,
+				                 decoder.trailer_length, option_flags);
+				                 
+				if (result < 0)
+				{
+					return (result == HTTPMESSAGE_ERROR_ALLOCATION
+					        || result == HTTPMESSAGE_ERROR_BUDGET)
+					       ? result : HTTPMESSAGE_ERROR_SYNTAX;
+				}
+			}
+		}
+		break;
+		
+		default:
+			/* The body covers the remaining input */
+			break;
+	}
+	
+	/* Body == 0 */
+	if (length == 0)
+	{
+		return 0;
+	}
+	
+	message->body.text = text;
+	message->body.length = length;
+	
+	return (ssize_t)length;
 }
 
-void httpmessage_request_clear(
-    httpmessage_request *request,
-    int option_flags)
+/*
+ * Scan the transfer codings of a Transfer-Encoding value, in order.
+ * Count the chunked codings and tell if the last coding is chunked.
+ */
+static void httpmessage_message_transfer_codings_scan(
+    const httpmessage_headerfield_value *value,
+    int *chunked_count,
+    int *chunked_last)
 {
-	httpmessage_message_clear(&request->message, option_flags);
-	httpmessage_stringview_clear(&request->method);
-	httpmessage_stringview_clear(&request->request_uri);
+	for (; value && value->line.length; value = value->next_line)
+	{
+		const char *text = value->line.text;
+		const char *end = value->line.text + value->line.length;
+		
+		while (text < end)
+		{
+			const char *separator = (const char *)memchr(text, ',', (size_t)(end - text));
+			const char *element_end = (separator ? separator : end);
+			httpmessage_stringview coding;
+			
+			while (text < element_end
+			        && (httpmessage_text_is_LWS(*text) || *text == '\r' || *text == '\n'))
+			{
+				++text;
+			}
+			
+			while (element_end > text
+			        && (httpmessage_text_is_LWS(element_end[-1])
+			            || element_end[-1] == '\r' || element_end[-1] == '\n'))
+			{
+				--element_end;
+			}
+			
+			coding.text = text;
+			coding.length = (size_t)(element_end - text);
+			
+			/* Empty list elements are ignored */
+			if (coding.length)
+			{
+				*chunked_last = (httpmessage_stringview_caseless_compare_text(&coding,
+				                 "chunked", 7) == 0);
+				*chunked_count += *chunked_last;
+			}
+			
+			text = (separator ? separator + 1 : end);
+		}
+	}
 }
 
-void httpmessage_request_free(httpmessage_request **request)
+/* A Content-Length value is a single sequence of digits */
+static int httpmessage_message_content_length_consume(
+    size_t *body_length,
+    const httpmessage_headerfield_value *value)
 {
-	if (*request)
+	if ((value->next_line && value->next_line->line.length)
+	        || httpmessage_size_consume(body_length, value->line.text,
+	                                    value->line.length)
+	        != (ssize_t)value->line.length)
 	{
-		httpmessage_request_clear(*request, 0);
-		free(*request);
+		return HTTPMESSAGE_ERROR_SYNTAX;
 	}
 	
-	*request = NULL;
+	return HTTPMESSAGE_OK;
 }
 
-void httpmessage_message_storage_init(
-    httpmessage_message *message,
-    uint8_t *storage,
-    size_t max_headerfield_count,
-    size_t max_line_per_headerfield_value)
+int httpmessage_message_get_framing(
+    size_t *body_length,
+    const httpmessage_message *message)
 {
-	httpmessage_headerfield *header;
-	httpmessage_headerfield_value *value;
-	uint8_t *p;
-	size_t a, b;
-	
-	--max_headerfield_count;
-	--max_line_per_headerfield_value;
-	
-	p = storage;
-	
-	header = &message->field_list;
+	const httpmessage_headerfield *content_length = NULL;
+	const httpmessage_headerfield *field;
+	int transfer_encoding = 0;
+	int chunked_count = 0;
+	int chunked_last = 0;
+	*body_length = 0;
+	
+	for (field = &message->field_list;
+	        field && field->name.length;
+	        field = field->next_field)
+	{
+		if (httpmessage_stringview_caseless_compare_text(
+		            &field->name, "Transfer-Encoding", 17) == 0)
+		{
+			/* Codings of all fields form a single list */
+			transfer_encoding = 1;
+			httpmessage_message_transfer_codings_scan(&field->value,
+			        &chunked_count, &chunked_last);
+		}
+		else if (httpmessage_stringview_caseless_compare_text(
+		                 &field->name, "Content-Length", 14) == 0)
+		{
+			size_t length;
+			
+			/* Conflicting lengths are a request smuggling vector (RFC 7230 3.3.3) */
+			if (httpmessage_message_content_length_consume(&length, &field->value)
+			        != HTTPMESSAGE_OK
+			        || (content_length && length != *body_length))
+			{
+				*body_length = 0;
+				return HTTPMESSAGE_ERROR_SYNTAX;
+			}
+			
+			*body_length = length;
+			content_length = field;
+		}
+	}
 	
-	for (a = 0; a < max_headerfield_count; ++a)
+	if (transfer_encoding)
 	{
-		value = &header->value;
+		*body_length = 0;
 		
-		for (b = 0; b < max_line_per_headerfield_value; ++b)
+		/* A request cannot have both */
+		if (content_length && message->type != HTTPMESSAGE_TYPE_RESPONSE)
 		{
-			value->next_line = (httpmessage_headerfield_value *)p;
-			value = value->next_line;
-			httpmessage_headerfield_value_init(value);
-			p += sizeof(httpmessage_headerfield_value);
+			return HTTPMESSAGE_ERROR_SYNTAX;
 		}
 		
-		header->next_field = (httpmessage_headerfield *)p;
-		header = header->next_field;
-		httpmessage_headerfield_init(header);
-		p += sizeof(httpmessage_headerfield);
+		/* chunked is applied once, as the final coding (RFC 7230 3.3.1) */
+		if (chunked_count > 1 || (chunked_count && !chunked_last))
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		if (chunked_last)
+		{
+			return HTTPMESSAGE_FRAMING_CHUNKED;
+		}
+		
+		/* The length of a request body cannot be determined */
+		return ((message->type == HTTPMESSAGE_TYPE_RESPONSE)
+		        ? HTTPMESSAGE_FRAMING_UNTIL_CLOSE
+		        : HTTPMESSAGE_ERROR_SYNTAX);
+	}
+	
+	if (content_length)
+	{
+		return HTTPMESSAGE_FRAMING_LENGTH;
 	}
+	
+	return ((message->type == HTTPMESSAGE_TYPE_RESPONSE)
+	        ? HTTPMESSAGE_FRAMING_UNTIL_CLOSE
+	        : HTTPMESSAGE_FRAMING_NONE);
 }
 
-httpmessage_request *httpmessage_request_storage_new(
-    size_t max_headerfield_count,
-    size_t max_line_per_headerfield_value)
+/* Whether a comma separated list value contains the given option */
+static int httpmessage_message_option_list_contains(
+    const httpmessage_stringview *line,
+    const char *option, size_t option_length)
 {
-	size_t storage_size = sizeof(httpmessage_request)
-	                      + ((max_headerfield_count - 1) * sizeof(httpmessage_headerfield)
-	                         + ((max_line_per_headerfield_value - 1) * max_headerfield_count * sizeof(httpmessage_headerfield_value))
-	                        );
-	httpmessage_request *storage = (httpmessage_request *)malloc(storage_size);
+	const char *text = line->text;
+	const char *end = line->text + line->length;
 	
-	if (!storage)
+	while (text < end)
 	{
-		return NULL;
+		const char *separator = (const char *)memchr(text, ',', (size_t)(end - text));
+		const char *element_end = (separator ? separator : end);
+		httpmessage_stringview element;
+		
+		while (text < element_end && (*text == ' ' || *text == '\t'))
+		{
+			++text;
+		}
+		
+		while (element_end > text && (element_end[-1] == ' ' || element_end[-1] == '\t'))
+		{
+			--element_end;
+		}
+		
+		element.text = text;
+		element.length = (size_t)(element_end - text);
+		
+		if (httpmessage_stringview_caseless_compare_text(&element,
+		        option, option_length) == 0)
+		{
+			return 1;
+		}
+		
+		text = (separator ? separator + 1 : end);
 	}
 	
-	httpmessage_request_init(storage);
-	httpmessage_message_storage_init(
-	    &storage->message,
-	    (uint8_t *)(storage + 1),
-	    max_headerfield_count, max_line_per_headerfield_value);
-	    
-	return storage;
+	return 0;
 }
 
-httpmessage_response *httpmessage_response_storage_new(
-    size_t max_headerfield_count,
-    size_t max_line_per_headerfield_value)
+int httpmessage_message_is_keep_alive(const httpmessage_message *message)
 {
-	size_t storage_size = sizeof(httpmessage_response)
-	                      + ((max_headerfield_count - 1) * sizeof(httpmessage_headerfield)
-	                         + ((max_line_per_headerfield_value - 1) * max_headerfield_count * sizeof(httpmessage_headerfield_value))
-	                        );
-	httpmessage_response *storage = (httpmessage_response *)malloc(storage_size);
-	
-	if (!storage)
-	{
-		return NULL;
+	const httpmessage_headerfield *field;
+	int keep_alive = (message->major_version > 1
+	                  || (message->major_version == 1 && message->minor_version >= 1));
+	                  
+	for (field = &message->field_list;
+	        field && field->name.length;
+	        field = field->next_field)
+	{
+		const httpmessage_headerfield_value *value;
+		
+		if (httpmessage_stringview_caseless_compare_text(
+		            &field->name, "Connection", 10) != 0)
+		{
+			continue;
+		}
+		
+		for (value = &field->value; value && value->line.length; value = value->next_line)
+		{
+			if (httpmessage_message_option_list_contains(&value->line, "close", 5))
+			{
+				return 0;
+			}
+			
+			if (httpmessage_message_option_list_contains(&value->line, "keep-alive", 10))
+			{
+				keep_alive = 1;
+			}
+		}
 	}
 	
-	httpmessage_response_init(storage);
-	httpmessage_message_storage_init(
-	    &storage->message,
-	    (uint8_t *)(storage + 1),
-	    max_headerfield_count, max_line_per_headerfield_value);
-	    
-	return storage;
+	return keep_alive;
 }
 
-ssize_t httpmessage_request_consume(
-    httpmessage_request *request,
+ssize_t httpmessage_message_content_consume(
+    httpmessage_message *message,
     const char *text, size_t length,
     int option_flags)
 {
 	ssize_t consumed = 0;
 	ssize_t result = 0;
-	result = httpmessage_request_line_consume(
-	             &request->method, &request->request_uri,
-	             &request->message.major_version,
-	             &request->message.minor_version,
-	             text, length,
-	             (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF)
-	         );
-	         
-	if (result <= 0)
+	size_t body_length;
+	int framing;
+	httpmessage_message_headerfield_list_clear(message, option_flags);
+	httpmessage_stringview_clear(&message->body);
+	
+	/* Headers */
+	if ((option_flags & HTTPMESSAGE_CONSUME_PRESCAN)
+	        && !(option_flags & HTTPMESSAGE_NO_ALLOCATION)
+	        && !message->storage_end)
 	{
-		return HTTPMESSAGE_ERROR_SYNTAX;
+		result = httpmessage_message_headerfield_list_prescan_consume(
+		             message,
+		             text, length,
+		             option_flags);
 	}
-	
-	text += result;
-	length -= (size_t)result;
-	consumed += result;
-	
-	if (length == 0)
+	else
 	{
-		return HTTPMESSAGE_ERROR_INCOMPLETE;
+		result = httpmessage_headerfield_list_consume_with_allocator(
+		             &message->field_list,
+		             text, length,
+		             option_flags,
+		             message->allocator);
 	}
 	
-	result = httpmessage_message_content_consume(
-	             &request->message,
-	             text, length,
-	             option_flags);
-	             
 	if (result < 0)
 	{
 		switch (result)
 		{
 			case HTTPMESSAGE_ERROR_ALLOCATION:
+			case HTTPMESSAGE_ERROR_BUDGET:
+			case HTTPMESSAGE_ERROR_INCOMPLETE:
 				return result;
 				
 			default:
@@ -815,34 +1472,69 @@ ssize_t httpmessage_request_consume(
 		return HTTPMESSAGE_ERROR_SYNTAX;
 	}
 	
-	if (result == 0)
+	text += result;
+	length -= (size_t)result;
+	
+	consumed += result;
+	
+	if (length == 0)
 	{
-		return HTTPMESSAGE_ERROR_INCOMPLETE;
+		if ((option_flags & HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF) == 0)
+		{
+			return HTTPMESSAGE_ERROR_INCOMPLETE;
+		}
+		
+		return consumed;
+	}
+	
+	/* CRLF line */
+	
+	if (!httpmessage_text_is_CRLF(text, length))
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	text += 2;
+	length -= 2;
+	consumed += 2;
+	
+	framing = httpmessage_message_get_framing(&body_length, message);
+	
+	if (framing < 0)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (option_flags & HTTPMESSAGE_CONSUME_HEADER_ONLY)
+	{
+		return consumed;
+	}
+	
+	result = httpmessage_message_body_consume(message, framing, body_length,
+	         text, length, option_flags);
+	         
+	if (result < 0)
+	{
+		return result;
 	}
 	
 	return consumed + result;
 }
 
-ssize_t httpmessage_request_write_file(
+ssize_t httpmessage_message_content_write_file(
     FILE *file,
-    const httpmessage_request *request)
+    const httpmessage_message *message)
 {
 	ssize_t written = 0;
 	ssize_t w;
 	
-	if (!(file && request))
+	if (!(file && message))
 	{
 		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
 	}
 	
-	/* Request line */
-	HTTPMESSAGE_STRING_WRITE_FILE(written, file, request->method)
-	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, " ", 1)
-	HTTPMESSAGE_STRING_WRITE_FILE(written, file, request->request_uri)
-	HTTPMESSAGE_PRINTF_FILE(written, file, " HTTP/%d.%d\r\n",
-	                        request->message.major_version, request->message.minor_version)
-	                        
-	w = httpmessage_message_content_write_file(file, &request->message);
+	/* Header */
+	w = httpmessage_headerfield_list_write_file(file, &message->field_list);
 	
 	if (w < 0)
 	{
@@ -850,101 +1542,326 @@ ssize_t httpmessage_request_write_file(
 	}
 	
 	written += w;
+	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, "\r\n", 2)
+	
+	/* Body */
+	HTTPMESSAGE_STRING_WRITE_FILE(written, file, message->body)
 	
 	return written;
 }
 
-ssize_t httpmessage_request_write_buffer(
+ssize_t httpmessage_message_content_write_buffer(
     void *output, size_t output_size,
-    const httpmessage_request *request)
+    const httpmessage_message *message)
 {
-	char *o = (char *)output;
 	ssize_t w;
+	char *o = (char *)output;
 	
-	if (!(output && output_size && request))
+	if (!(output && output_size && message))
 	{
 		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
 	}
 	
-	/* Request line */
-	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, request->method)
-	HTTPMESSAGE_TEXT_WRITE_BUFFER(o, output_size, " ", 1)
-	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, request->request_uri)
-	HTTPMESSAGE_PRINTF_BUFFER(o, output_size, " HTTP/%d.%d\r\n",
-	                          request->message.major_version, request->message.minor_version)
-	                          
-	w = httpmessage_message_content_write_buffer(o, output_size,
-	    &request->message);
-	    
+	w = httpmessage_headerfield_list_write_buffer(o, output_size, &message->field_list);
+	
 	if (w < 0)
 	{
 		return w;
 	}
 	
 	o += w;
-	/* output_size -= (size_t)w; */
+	output_size -= (size_t)w;
+	
+	HTTPMESSAGE_TEXT_WRITE_BUFFER(o, output_size, "\r\n", 2)
+	
+	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, message->body)
+	
 	return (o - (char *)output);
 }
 
-httpmessage_response *httpmessage_response_new()
+httpmessage_request *httpmessage_request_new()
 {
-	httpmessage_response *response = (httpmessage_response *)malloc(sizeof(httpmessage_response));
+	httpmessage_request *request = (httpmessage_request *)httpmessage_allocator_allocate(
+	                                   NULL, sizeof(httpmessage_request));
 	
-	if (!response)
+	if (!request)
 	{
-		return NULL;
+		return request;
 	}
 	
-	httpmessage_response_init(response);
-	return response;
+	httpmessage_request_init(request);
+	return request;
 }
 
-void httpmessage_response_init(httpmessage_response *response)
+void httpmessage_request_init(httpmessage_request *request)
 {
-	response->status_code = 0;
-	httpmessage_stringview_clear(&response->reason_phrase);
-	httpmessage_message_init(&response->message);
+	httpmessage_stringview_clear(&request->method);
+	httpmessage_stringview_clear(&request->request_uri);
+	httpmessage_message_init(&request->message);
+	request->message.type = HTTPMESSAGE_TYPE_REQUEST;
 }
 
-void httpmessage_response_clear(
-    httpmessage_response *response,
+void httpmessage_request_clear(
+    httpmessage_request *request,
     int option_flags)
 {
-	httpmessage_message_clear(&response->message, option_flags);
-	httpmessage_stringview_clear(&response->reason_phrase);
-	response->status_code = 0;
+	httpmessage_message_clear(&request->message, option_flags);
+	httpmessage_stringview_clear(&request->method);
+	httpmessage_stringview_clear(&request->request_uri);
 }
 
-void httpmessage_response_free(httpmessage_response **response)
+int httpmessage_request_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_request *request)
+{
+	int result = httpmessage_message_memory_usage(usage,
+	             request ? &request->message : NULL);
+	             
+	if (result == HTTPMESSAGE_OK)
+	{
+		usage->referenced_size += request->method.length
+		                          + request->request_uri.length;
+	}
+	
+	return result;
+}
+
+void httpmessage_request_free(httpmessage_request **request)
+{
+	if (*request)
+	{
+		httpmessage_request_clear(*request, 0);
+		httpmessage_message_arena_clear(&(*request)->message, (*request) + 1);
+		httpmessage_allocator_release(NULL, *request);
+	}
+	
+	*request = NULL;
+}
+
+void httpmessage_message_storage_init(
+    httpmessage_message *message,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	httpmessage_headerfield *header;
+	httpmessage_headerfield_value *value;
+	size_t a, b;
+	
+	header = &message->field_list;
+	
+	for (a = 0; a < max_headerfield_count; ++a)
+	{
+		if (a)
+		{
+			header->next_field = headerfields++;
+			header = header->next_field;
+			httpmessage_headerfield_init(header);
+		}
+		
+		value = &header->value;
+		
+		for (b = 1; b < max_line_per_headerfield_value; ++b)
+		{
+			value->next_line = lines++;
+			value = value->next_line;
+			httpmessage_headerfield_value_init(value);
+		}
+	}
+	
+	message->storage_end = (((const uint8_t *)lines > (const uint8_t *)headerfields)
+	                        ? (const void *)lines : (const void *)headerfields);
+}
+
+void httpmessage_request_storage_init(
+    httpmessage_request *request,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	httpmessage_request_init(request);
+	httpmessage_message_storage_init(&request->message,
+	                                 headerfields, lines,
+	                                 max_headerfield_count, max_line_per_headerfield_value);
+}
+
+void httpmessage_response_storage_init(
+    httpmessage_response *response,
+    httpmessage_headerfield *headerfields,
+    httpmessage_headerfield_value *lines,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	httpmessage_response_init(response);
+	httpmessage_message_storage_init(&response->message,
+	                                 headerfields, lines,
+	                                 max_headerfield_count, max_line_per_headerfield_value);
+}
+
+size_t httpmessage_request_storage_size(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	return sizeof(httpmessage_request)
+	       + ((max_headerfield_count - 1) * sizeof(httpmessage_headerfield)
+	          + ((max_line_per_headerfield_value - 1) * max_headerfield_count * sizeof(httpmessage_headerfield_value))
+	         );
+}
+
+void httpmessage_request_storage_free(httpmessage_request **request)
+{
+	if (*request)
+	{
+		httpmessage_message_release(&(*request)->message);
+		httpmessage_allocator_release(NULL, *request);
+	}
+	
+	*request = NULL;
+}
+
+httpmessage_request *httpmessage_request_storage_new(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	return httpmessage_request_storage_new_with_allocator(
+	           max_headerfield_count, max_line_per_headerfield_value, NULL);
+}
+
+httpmessage_request *httpmessage_request_storage_new_with_allocator(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    httpmessage_allocator *allocator)
+{
+	httpmessage_headerfield *headerfields;
+	httpmessage_request *storage = (httpmessage_request *)httpmessage_allocator_allocate(
+	                                 allocator,
+	                                 httpmessage_request_storage_size(
+	                                     max_headerfield_count, max_line_per_headerfield_value));
+	                                     
+	if (!storage)
+	{
+		return NULL;
+	}
+	
+	headerfields = (httpmessage_headerfield *)(storage + 1);
+	httpmessage_request_storage_init(storage,
+	                                 headerfields,
+	                                 (httpmessage_headerfield_value *)(headerfields + (max_headerfield_count - 1)),
+	                                 max_headerfield_count, max_line_per_headerfield_value);
+	return storage;
+}
+
+size_t httpmessage_response_storage_size(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	return sizeof(httpmessage_response)
+	       + ((max_headerfield_count - 1) * sizeof(httpmessage_headerfield)
+	          + ((max_line_per_headerfield_value - 1) * max_headerfield_count * sizeof(httpmessage_headerfield_value))
+	         );
+}
+
+void httpmessage_response_storage_free(httpmessage_response **response)
 {
 	if (*response)
 	{
-		httpmessage_response_clear(*response, 0);
-		free(*response);
+		httpmessage_message_release(&(*response)->message);
+		httpmessage_allocator_release(NULL, *response);
 	}
 	
 	*response = NULL;
 }
 
-ssize_t httpmessage_response_consume(
-    httpmessage_response *response,
+httpmessage_response *httpmessage_response_storage_new(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value)
+{
+	return httpmessage_response_storage_new_with_allocator(
+	           max_headerfield_count, max_line_per_headerfield_value, NULL);
+}
+
+httpmessage_response *httpmessage_response_storage_new_with_allocator(
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    httpmessage_allocator *allocator)
+{
+	httpmessage_headerfield *headerfields;
+	httpmessage_response *storage = (httpmessage_response *)httpmessage_allocator_allocate(
+	                                 allocator,
+	                                 httpmessage_response_storage_size(
+	                                     max_headerfield_count, max_line_per_headerfield_value));
+	                                     
+	if (!storage)
+	{
+		return NULL;
+	}
+	
+	headerfields = (httpmessage_headerfield *)(storage + 1);
+	httpmessage_response_storage_init(storage,
+	                                  headerfields,
+	                                  (httpmessage_headerfield_value *)(headerfields + (max_headerfield_count - 1)),
+	                                  max_headerfield_count, max_line_per_headerfield_value);
+	return storage;
+}
+
+httpmessage_request *httpmessage_request_arena_new(size_t chunk_size)
+{
+	httpmessage_arena *arena;
+	httpmessage_request *request = (httpmessage_request *)httpmessage_allocator_allocate(
+	                                   NULL, sizeof(httpmessage_request) + sizeof(httpmessage_arena));
+	                                   
+	if (!request)
+	{
+		return NULL;
+	}
+	
+	arena = (httpmessage_arena *)(request + 1);
+	httpmessage_arena_init(arena, chunk_size);
+	httpmessage_request_init(request);
+	request->message.allocator = &arena->allocator;
+	return request;
+}
+
+httpmessage_response *httpmessage_response_arena_new(size_t chunk_size)
+{
+	httpmessage_arena *arena;
+	httpmessage_response *response = (httpmessage_response *)httpmessage_allocator_allocate(
+	                                     NULL, sizeof(httpmessage_response) + sizeof(httpmessage_arena));
+	                                     
+	if (!response)
+	{
+		return NULL;
+	}
+	
+	arena = (httpmessage_arena *)(response + 1);
+	httpmessage_arena_init(arena, chunk_size);
+	httpmessage_response_init(response);
+	response->message.allocator = &arena->allocator;
+	return response;
+}
+
+ssize_t httpmessage_request_consume(
+    httpmessage_request *request,
     const char *text, size_t length,
     int option_flags)
 {
 	ssize_t consumed = 0;
 	ssize_t result = 0;
-	
-	result = httpmessage_status_line_consume(&response->message.major_version,
-	         &response->message.minor_version,
-	         &response->status_code,
-	         &response->reason_phrase,
-	         text, length,
-	         (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF)
-	                                        );
-	                                        
+	result = httpmessage_request_line_consume(
+	             &request->method, &request->request_uri,
+	             &request->message.major_version,
+	             &request->message.minor_version,
+	             text, length,
+	             (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF)
+	         );
+	         
 	if (result <= 0)
 	{
-		return HTTPMESSAGE_ERROR_SYNTAX;
+		return ((result == HTTPMESSAGE_ERROR_INCOMPLETE)
+		        ? HTTPMESSAGE_ERROR_INCOMPLETE
+		        : HTTPMESSAGE_ERROR_SYNTAX);
 	}
 	
 	text += result;
@@ -957,7 +1874,7 @@ ssize_t httpmessage_response_consume(
 	}
 	
 	result = httpmessage_message_content_consume(
-	             &response->message,
+	             &request->message,
 	             text, length,
 	             option_flags);
 	             
@@ -966,6 +1883,8 @@ ssize_t httpmessage_response_consume(
 		switch (result)
 		{
 			case HTTPMESSAGE_ERROR_ALLOCATION:
+			case HTTPMESSAGE_ERROR_BUDGET:
+			case HTTPMESSAGE_ERROR_INCOMPLETE:
 				return result;
 				
 			default:
@@ -983,6 +1902,920 @@ ssize_t httpmessage_response_consume(
 	return consumed + result;
 }
 
+ssize_t httpmessage_request_write_file(
+    FILE *file,
+    const httpmessage_request *request)
+{
+	ssize_t written = 0;
+	ssize_t w;
+	
+	if (!(file && request))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	/* Request line */
+	HTTPMESSAGE_STRING_WRITE_FILE(written, file, request->method)
+	HTTPMESSAGE_TEXT_WRITE_FILE(written, file, " ", 1)
+	HTTPMESSAGE_STRING_WRITE_FILE(written, file, request->request_uri)
+	HTTPMESSAGE_PRINTF_FILE(written, file, " HTTP/%d.%d\r\n",
+	                        request->message.major_version, request->message.minor_version)
+	                        
+	w = httpmessage_message_content_write_file(file, &request->message);
+	
+	if (w < 0)
+	{
+		return w;
+	}
+	
+	written += w;
+	
+	return written;
+}
+
+ssize_t httpmessage_request_write_buffer(
+    void *output, size_t output_size,
+    const httpmessage_request *request)
+{
+	char *o = (char *)output;
+	ssize_t w;
+	
+	if (!(output && output_size && request))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	/* Request line */
+	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, request->method)
+	HTTPMESSAGE_TEXT_WRITE_BUFFER(o, output_size, " ", 1)
+	HTTPMESSAGE_STRING_WRITE_BUFFER(o, output_size, request->request_uri)
+	HTTPMESSAGE_PRINTF_BUFFER(o, output_size, " HTTP/%d.%d\r\n",
+	                          request->message.major_version, request->message.minor_version)
+	                          
+	w = httpmessage_message_content_write_buffer(o, output_size,
+	    &request->message);
+	    
+	if (w < 0)
+	{
+		return w;
+	}
+	
+	o += w;
+	/* output_size -= (size_t)w; */
+	return (o - (char *)output);
+}
+
+httpmessage_response *httpmessage_response_new()
+{
+	httpmessage_response *response = (httpmessage_response *)httpmessage_allocator_allocate(
+	                                     NULL, sizeof(httpmessage_response));
+	
+	if (!response)
+	{
+		return NULL;
+	}
+	
+	httpmessage_response_init(response);
+	return response;
+}
+
+void httpmessage_response_init(httpmessage_response *response)
+{
+	response->status_code = 0;
+	httpmessage_stringview_clear(&response->reason_phrase);
+	httpmessage_message_init(&response->message);
+	response->message.type = HTTPMESSAGE_TYPE_RESPONSE;
+}
+
+void httpmessage_response_clear(
+    httpmessage_response *response,
+    int option_flags)
+{
+	httpmessage_message_clear(&response->message, option_flags);
+	httpmessage_stringview_clear(&response->reason_phrase);
+	response->status_code = 0;
+}
+
+int httpmessage_response_memory_usage(
+    httpmessage_memory_usage *usage,
+    const httpmessage_response *response)
+{
+	int result = httpmessage_message_memory_usage(usage,
+	             response ? &response->message : NULL);
+	             
+	if (result == HTTPMESSAGE_OK)
+	{
+		usage->referenced_size += response->reason_phrase.length;
+	}
+	
+	return result;
+}
+
+void httpmessage_response_free(httpmessage_response **response)
+{
+	if (*response)
+	{
+		httpmessage_response_clear(*response, 0);
+		httpmessage_message_arena_clear(&(*response)->message, (*response) + 1);
+		httpmessage_allocator_release(NULL, *response);
+	}
+	
+	*response = NULL;
+}
+
+ssize_t httpmessage_response_consume(
+    httpmessage_response *response,
+    const char *text, size_t length,
+    int option_flags)
+{
+	ssize_t consumed = 0;
+	ssize_t result = 0;
+	
+	result = httpmessage_status_line_consume(&response->message.major_version,
+	         &response->message.minor_version,
+	         &response->status_code,
+	         &response->reason_phrase,
+	         text, length,
+	         (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF)
+	                                        );
+	                                        
+	if (result <= 0)
+	{
+		return ((result == HTTPMESSAGE_ERROR_INCOMPLETE)
+		        ? HTTPMESSAGE_ERROR_INCOMPLETE
+		        : HTTPMESSAGE_ERROR_SYNTAX);
+	}
+	
+	text += result;
+	length -= (size_t)result;
+	consumed += result;
+	
+	if (length == 0)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	result = httpmessage_message_content_consume(
+	             &response->message,
+	             text, length,
+	             option_flags);
+	             
+	if (result < 0)
+	{
+		switch (result)
+		{
+			case HTTPMESSAGE_ERROR_ALLOCATION:
+			case HTTPMESSAGE_ERROR_BUDGET:
+			case HTTPMESSAGE_ERROR_INCOMPLETE:
+				return result;
+				
+			default:
+				break;
+		}
+		
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (result == 0)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	return consumed + result;
+}
+
+int httpmessage_response_is_interim(const httpmessage_response *response)
+{
+	return (response->status_code >= 100
+	        && response->status_code < 200
+	        && response->status_code != 101);
+}
+
+int httpmessage_response_get_framing(
+    size_t *body_length,
+    const httpmessage_response *response,
+    const httpmessage_stringview *request_method)
+{
+	int status_code = response->status_code;
+	*body_length = 0;
+	
+	if ((status_code >= 100 && status_code < 200)
+	        || status_code == 204
+	        || status_code == 304)
+	{
+		return HTTPMESSAGE_FRAMING_NONE;
+	}
+	
+	if (request_method)
+	{
+		if (httpmessage_stringview_compare_text(request_method, "HEAD", 4) == 0)
+		{
+			return HTTPMESSAGE_FRAMING_NONE;
+		}
+		
+		/* The connection becomes a tunnel */
+		if (status_code >= 200 && status_code < 300
+		        && httpmessage_stringview_compare_text(request_method, "CONNECT", 7) == 0)
+		{
+			return HTTPMESSAGE_FRAMING_NONE;
+		}
+	}
+	
+	return httpmessage_message_get_framing(body_length, &response->message);
+}
+
+ssize_t httpmessage_response_consume_for_request(
+    httpmessage_response *response,
+    int *framing,
+    const httpmessage_stringview *request_method,
+    const char *text, size_t length,
+    int option_flags)
+{
+	ssize_t consumed = 0;
+	ssize_t result = 0;
+	size_t body_length;
+	*framing = HTTPMESSAGE_FRAMING_NONE;
+	
+	consumed = httpmessage_response_consume(response, text, length,
+	                                        option_flags | HTTPMESSAGE_CONSUME_HEADER_ONLY);
+	                                        
+	if (consumed < 0)
+	{
+		return consumed;
+	}
+	
+	result = httpmessage_response_get_framing(&body_length, response, request_method);
+	
+	if (result < 0)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	*framing = (int)result;
+	
+	if (option_flags & HTTPMESSAGE_CONSUME_HEADER_ONLY)
+	{
+		return consumed;
+	}
+	
+	result = httpmessage_message_body_consume(&response->message,
+	         *framing, body_length,
+	         text + consumed, length - (size_t)consumed,
+	         option_flags);
+	         
+	if (result < 0)
+	{
+		return result;
+	}
+	
+	return consumed + result;
+}
+
+void httpmessage_pipeline_init(
+    httpmessage_pipeline *pipeline,
+    const char *text, size_t length,
+    int option_flags)
+{
+	pipeline->text = text;
+	pipeline->length = length;
+	pipeline->offset = 0;
+	pipeline->message_count = 0;
+	pipeline->option_flags = option_flags & ~HTTPMESSAGE_CONSUME_HEADER_ONLY;
+}
+
+/* Whether the text contains the empty line ending a message header */
+static int httpmessage_pipeline_header_is_complete(
+    const char *text, size_t length)
+{
+	const char *end = text + length;
+	
+	while ((end - text) >= 4)
+	{
+		text = (const char *)memchr(text, '\r', (size_t)(end - text) - 3);
+		
+		if (!text)
+		{
+			return 0;
+		}
+		
+		if (memcmp(text, "\r\n\r\n", 4) == 0)
+		{
+			return 1;
+		}
+		
+		++text;
+	}
+	
+	return 0;
+}
+
+/*
+ * Whether a syntax error may come from a line truncated by the end of the input:
+ * complete lines are valid and the last line does not contain any invalid
+ * character, except a final CR.
+ */
+static int httpmessage_pipeline_is_truncated(
+    const httpmessage_pipeline *pipeline,
+    httpmessage_request *request,
+    httpmessage_response *response)
+{
+	const char *text = pipeline->text + pipeline->offset;
+	size_t length = pipeline->length - pipeline->offset;
+	size_t line_offset = 0;
+	size_t i;
+	
+	if (httpmessage_pipeline_header_is_complete(text, length))
+	{
+		return 0;
+	}
+	
+	for (i = 0; (i + 1) < length; ++i)
+	{
+		if (text[i] == '\r' && text[i + 1] == '\n')
+		{
+			line_offset = i + 2;
+		}
+	}
+	
+	for (i = line_offset; i < length; ++i)
+	{
+		if (text[i] == '\r' && (i + 1) == length)
+		{
+			break;
+		}
+		
+		if (text[i] != '\t' && httpmessage_text_is_CTL((unsigned char)text[i]))
+		{
+			return 0;
+		}
+	}
+	
+	if (line_offset == 0)
+	{
+		return 1;
+	}
+	
+	return ((request
+	         ? httpmessage_request_consume(request, text, line_offset,
+	                                       pipeline->option_flags)
+	         : httpmessage_response_consume(response, text, line_offset,
+	                                        pipeline->option_flags))
+	        == HTTPMESSAGE_ERROR_INCOMPLETE);
+}
+
+static ssize_t httpmessage_pipeline_advance(
+    httpmessage_pipeline *pipeline,
+    httpmessage_request *request,
+    httpmessage_response *response,
+    ssize_t result)
+{
+	if (result > 0)
+	{
+		pipeline->offset += (size_t)result;
+		++pipeline->message_count;
+	}
+	else if (result == HTTPMESSAGE_ERROR_SYNTAX
+	         && httpmessage_pipeline_is_truncated(pipeline, request, response))
+	{
+		/* The grammar cannot tell a truncated line from an invalid one */
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	return result;
+}
+
+ssize_t httpmessage_pipeline_request_consume(
+    httpmessage_pipeline *pipeline,
+    httpmessage_request *request)
+{
+	if (pipeline->offset == pipeline->length)
+	{
+		return 0;
+	}
+	
+	return httpmessage_pipeline_advance(pipeline, request, NULL,
+	                                    httpmessage_request_consume(request,
+	                                            pipeline->text + pipeline->offset,
+	                                            pipeline->length - pipeline->offset,
+	                                            pipeline->option_flags));
+}
+
+ssize_t httpmessage_pipeline_response_consume(
+    httpmessage_pipeline *pipeline,
+    httpmessage_response *response)
+{
+	if (pipeline->offset == pipeline->length)
+	{
+		return 0;
+	}
+	
+	return httpmessage_pipeline_advance(pipeline, NULL, response,
+	                                    httpmessage_response_consume(response,
+	                                            pipeline->text + pipeline->offset,
+	                                            pipeline->length - pipeline->offset,
+	                                            pipeline->option_flags));
+}
+
+/* Input text split in segments */
+typedef struct __httpmessage_segment_reader
+{
+	const httpmessage_stringview *segments;
+	size_t segment_count;
+	/** Current segment */
+	size_t index;
+	/** Offset in the current segment */
+	size_t offset;
+	/** Number of bytes read */
+	size_t consumed;
+} httpmessage_segment_reader;
+
+/* Move to the next segment with remaining bytes */
+static void httpmessage_segment_reader_skip(httpmessage_segment_reader *reader)
+{
+	while (reader->index < reader->segment_count
+	        && reader->offset >= reader->segments[reader->index].length)
+	{
+		++reader->index;
+		reader->offset = 0;
+	}
+}
+
+static size_t httpmessage_segment_reader_available(
+    const httpmessage_segment_reader *reader)
+{
+	size_t available = 0;
+	size_t i;
+	
+	for (i = reader->index; i < reader->segment_count; ++i)
+	{
+		available += reader->segments[i].length;
+	}
+	
+	return available - reader->offset;
+}
+
+/* Length of the line at the reader position, including the LF */
+static int httpmessage_segment_reader_line_length(
+    const httpmessage_segment_reader *reader,
+    size_t *length)
+{
+	size_t offset = reader->offset;
+	size_t i;
+	*length = 0;
+	
+	for (i = reader->index; i < reader->segment_count; ++i, offset = 0)
+	{
+		const httpmessage_stringview *segment = &reader->segments[i];
+		const char *lf;
+		
+		if (offset >= segment->length)
+		{
+			continue;
+		}
+		
+		lf = (const char *)memchr(segment->text + offset, '\n',
+		                          segment->length - offset);
+		                          
+		if (lf)
+		{
+			*length += (size_t)(lf - (segment->text + offset)) + 1;
+			return HTTPMESSAGE_OK;
+		}
+		
+		*length += segment->length - offset;
+	}
+	
+	return HTTPMESSAGE_ERROR_INCOMPLETE;
+}
+
+/* Length of the chunked body at the reader position */
+static int httpmessage_segment_reader_chunked_length(
+    const httpmessage_segment_reader *reader,
+    size_t *length,
+    size_t *trailer_length)
+{
+	httpmessage_chunked_decoder decoder;
+	httpmessage_stringview data;
+	size_t offset = reader->offset;
+	size_t i;
+	*length = 0;
+	httpmessage_chunked_decoder_init(&decoder);
+	
+	for (i = reader->index;
+	        i < reader->segment_count && decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE;
+	        ++i, offset = 0)
+	{
+		const httpmessage_stringview *segment = &reader->segments[i];
+		
+		while (offset < segment->length
+		        && decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+		{
+			ssize_t result = httpmessage_chunked_decoder_consume(&decoder, &data,
+			                 segment->text + offset, segment->length - offset);
+			                 
+			if (result < 0)
+			{
+				return HTTPMESSAGE_ERROR_SYNTAX;
+			}
+			
+			offset += (size_t)result;
+			*length += (size_t)result;
+		}
+	}
+	
+	if (decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	*trailer_length = decoder.trailer_length;
+	return HTTPMESSAGE_OK;
+}
+
+/*
+ * Read the given number of bytes as a single text.
+ * Bytes crossing a segment boundary are copied in the message string blocks.
+ */
+static int httpmessage_segment_reader_read(
+    httpmessage_segment_reader *reader,
+    httpmessage_stringview *view,
+    size_t length,
+    httpmessage_message *message,
+    int option_flags)
+{
+	const httpmessage_stringview *segment;
+	char *text;
+	
+	httpmessage_segment_reader_skip(reader);
+	
+	if (length == 0)
+	{
+		httpmessage_stringview_clear(view);
+		return HTTPMESSAGE_OK;
+	}
+	
+	if (httpmessage_segment_reader_available(reader) < length)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	segment = &reader->segments[reader->index];
+	
+	if ((segment->length - reader->offset) >= length)
+	{
+		view->text = segment->text + reader->offset;
+		view->length = length;
+		reader->offset += length;
+		reader->consumed += length;
+		return HTTPMESSAGE_OK;
+	}
+	
+	text = httpmessage_message_string_block_reserve(message, length, option_flags);
+	
+	if (!text)
+	{
+		return ((option_flags & HTTPMESSAGE_NO_ALLOCATION)
+		        ? HTTPMESSAGE_ERROR_ALLOCATION
+		        : httpmessage_allocator_get_error(message->allocator));
+	}
+	
+	view->text = text;
+	view->length = length;
+	reader->consumed += length;
+	
+	while (length)
+	{
+		size_t size;
+		httpmessage_segment_reader_skip(reader);
+		segment = &reader->segments[reader->index];
+		size = segment->length - reader->offset;
+		
+		if (size > length)
+		{
+			size = length;
+		}
+		
+		memcpy(text, segment->text + reader->offset, size);
+		text += size;
+		length -= size;
+		reader->offset += size;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/* Move the reader position forward. The given number of bytes must be available. */
+static void httpmessage_segment_reader_advance(
+    httpmessage_segment_reader *reader,
+    size_t length)
+{
+	reader->consumed += length;
+	
+	while (length)
+	{
+		size_t size;
+		httpmessage_segment_reader_skip(reader);
+		size = reader->segments[reader->index].length - reader->offset;
+		
+		if (size > length)
+		{
+			size = length;
+		}
+		
+		reader->offset += size;
+		length -= size;
+	}
+}
+
+/* Whether the given number of bytes are in the current segment */
+static int httpmessage_segment_reader_is_contiguous(
+    httpmessage_segment_reader *reader,
+    size_t length)
+{
+	httpmessage_segment_reader_skip(reader);
+	return (length == 0
+	        || (reader->index < reader->segment_count
+	            && (reader->segments[reader->index].length - reader->offset) >= length));
+}
+
+static int httpmessage_segment_reader_line(
+    httpmessage_segment_reader *reader,
+    httpmessage_stringview *line,
+    httpmessage_message *message,
+    int option_flags)
+{
+	size_t length;
+	int result = httpmessage_segment_reader_line_length(reader, &length);
+	
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	return httpmessage_segment_reader_read(reader, line, length,
+	                                       message, option_flags);
+}
+
+static ssize_t httpmessage_message_segments_content_consume(
+    httpmessage_message *message,
+    httpmessage_segment_reader *reader,
+    httpmessage_segment_range *body_range,
+    int option_flags)
+{
+	httpmessage_headerfield *current = &message->field_list;
+	httpmessage_headerfield *field = NULL;
+	httpmessage_segment_reader body_reader;
+	httpmessage_stringview line;
+	size_t body_length = 0;
+	size_t trailer_length = 0;
+	ssize_t result;
+	int framing;
+	
+	/* Header field lines */
+	for (;;)
+	{
+		result = httpmessage_segment_reader_line(reader, &line,
+		         message, option_flags);
+		         
+		if (result != HTTPMESSAGE_OK)
+		{
+			return result;
+		}
+		
+		if (httpmessage_text_is_CRLF(line.text, line.length))
+		{
+			break;
+		}
+		
+		result = httpmessage_headerfield_line_consume_with_allocator(
+		             &field, current,
+		             line.text, line.length,
+		             option_flags,
+		             message->allocator);
+		             
+		if (result != (ssize_t)line.length)
+		{
+			return (result == HTTPMESSAGE_ERROR_ALLOCATION
+			        || result == HTTPMESSAGE_ERROR_BUDGET)
+			       ? result : HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		current = field;
+	}
+	
+	framing = httpmessage_message_get_framing(&body_length, message);
+	
+	if (framing < 0)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (option_flags & HTTPMESSAGE_CONSUME_HEADER_ONLY)
+	{
+		return (ssize_t)reader->consumed;
+	}
+	
+	/* Body */
+	switch (framing)
+	{
+		case HTTPMESSAGE_FRAMING_NONE:
+			body_length = 0;
+			break;
+		
+		case HTTPMESSAGE_FRAMING_CHUNKED:
+			result = httpmessage_segment_reader_chunked_length(reader,
+			         &body_length, &trailer_length);
+			         
+			if (result != HTTPMESSAGE_OK)
+			{
+				return result;
+			}
+			
+			break;
+		
+		case HTTPMESSAGE_FRAMING_UNTIL_CLOSE:
+			body_length = httpmessage_segment_reader_available(reader);
+			break;
+		
+		default:
+			break;
+	}
+	
+	if (httpmessage_segment_reader_available(reader) < body_length)
+	{
+		return HTTPMESSAGE_ERROR_INCOMPLETE;
+	}
+	
+	httpmessage_segment_reader_skip(reader);
+	body_reader = *reader;
+	
+	if (body_range)
+	{
+		body_range->first_segment = body_range->last_segment = reader->index;
+		body_range->offset = reader->offset;
+		body_range->length = body_length;
+	}
+	
+	if (httpmessage_segment_reader_is_contiguous(reader, body_length))
+	{
+		result = httpmessage_segment_reader_read(reader, &message->body, body_length,
+		         message, option_flags);
+	}
+	else if (option_flags & HTTPMESSAGE_CONSUME_COPY_BODY)
+	{
+		/* The body may be large. It is copied only if it can be allocated. */
+		if (option_flags & HTTPMESSAGE_NO_ALLOCATION)
+		{
+			return HTTPMESSAGE_ERROR_ALLOCATION;
+		}
+		
+		result = httpmessage_segment_reader_read(reader, &message->body, body_length,
+		         message, option_flags);
+	}
+	else
+	{
+		/* Left in the input segments */
+		httpmessage_segment_reader_advance(reader, body_length);
+		result = HTTPMESSAGE_OK;
+	}
+	
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	if (body_range && body_length)
+	{
+		body_range->last_segment = reader->index;
+	}
+	
+	/* Trailer section precedes the final CRLF */
+	if (trailer_length)
+	{
+		httpmessage_stringview trailer;
+		
+		if (message->body.length)
+		{
+			trailer.text = message->body.text + body_length - 2 - trailer_length;
+			trailer.length = trailer_length;
+		}
+		else
+		{
+			httpmessage_segment_reader_advance(&body_reader,
+			                                   body_length - 2 - trailer_length);
+			result = httpmessage_segment_reader_read(&body_reader, &trailer,
+			         trailer_length, message, option_flags);
+			         
+			if (result != HTTPMESSAGE_OK)
+			{
+				return result;
+			}
+		}
+		
+		result = httpmessage_message_trailer_consume(message,
+		         trailer.text, trailer.length, option_flags);
+		         
+		if (result < 0)
+		{
+			return (result == HTTPMESSAGE_ERROR_ALLOCATION
+			        || result == HTTPMESSAGE_ERROR_BUDGET)
+			       ? result : HTTPMESSAGE_ERROR_SYNTAX;
+		}
+	}
+	
+	return (ssize_t)reader->consumed;
+}
+
+ssize_t httpmessage_request_segments_consume(
+    httpmessage_request *request,
+    const httpmessage_stringview *segments, size_t segment_count,
+    httpmessage_segment_range *body_range,
+    int option_flags)
+{
+	httpmessage_segment_reader reader;
+	httpmessage_stringview line;
+	ssize_t result;
+	
+	if (!(request && (segments || !segment_count)))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	reader.segments = segments;
+	reader.segment_count = segment_count;
+	reader.index = reader.offset = reader.consumed = 0;
+	httpmessage_message_headerfield_list_clear(&request->message, option_flags);
+	httpmessage_stringview_clear(&request->message.body);
+	
+	result = httpmessage_segment_reader_line(&reader, &line,
+	         &request->message, option_flags);
+	         
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	result = httpmessage_request_line_consume(
+	             &request->method, &request->request_uri,
+	             &request->message.major_version,
+	             &request->message.minor_version,
+	             line.text, line.length,
+	             (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF));
+	             
+	if (result != (ssize_t)line.length)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	return httpmessage_message_segments_content_consume(&request->message,
+	        &reader, body_range, option_flags);
+}
+
+ssize_t httpmessage_response_segments_consume(
+    httpmessage_response *response,
+    const httpmessage_stringview *segments, size_t segment_count,
+    httpmessage_segment_range *body_range,
+    int option_flags)
+{
+	httpmessage_segment_reader reader;
+	httpmessage_stringview line;
+	ssize_t result;
+	
+	if (!(response && (segments || !segment_count)))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	reader.segments = segments;
+	reader.segment_count = segment_count;
+	reader.index = reader.offset = reader.consumed = 0;
+	httpmessage_message_headerfield_list_clear(&response->message, option_flags);
+	httpmessage_stringview_clear(&response->message.body);
+	
+	result = httpmessage_segment_reader_line(&reader, &line,
+	         &response->message, option_flags);
+	         
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	result = httpmessage_status_line_consume(&response->message.major_version,
+	         &response->message.minor_version,
+	         &response->status_code,
+	         &response->reason_phrase,
+	         line.text, line.length,
+	         (option_flags & ~HTTPMESSAGE_CONSUME_IGNORE_MISSING_CRLF));
+	         
+	if (result != (ssize_t)line.length)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	return httpmessage_message_segments_content_consume(&response->message,
+	        &reader, body_range, option_flags);
+}
+
 ssize_t httpmessage_response_write_file(
     FILE *file,
     const httpmessage_response *response)
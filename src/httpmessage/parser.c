@@ -0,0 +1,738 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+
+static void httpmessage_parser_init(
+    httpmessage_parser *parser,
+    httpmessage_message *message,
+    int type,
+    int option_flags)
+{
+	parser->message = message;
+	parser->type = type;
+	parser->callbacks = NULL;
+	parser->user_data = NULL;
+	parser->text = NULL;
+	parser->length = 0;
+	parser->offset = 0;
+	parser->scan_offset = 0;
+	parser->current_field = (message ? &message->field_list : NULL);
+	parser->field_name_offset = 0;
+	parser->field_name_length = 0;
+	parser->field_value_offset = 0;
+	parser->field_value_length = 0;
+	parser->body_length = 0;
+	httpmessage_chunked_decoder_init(&parser->chunked);
+	parser->framing = HTTPMESSAGE_FRAMING_NONE;
+	parser->state = HTTPMESSAGE_PARSER_FIRST_LINE;
+	parser->option_flags = option_flags
+	                       & (HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION
+	                          | HTTPMESSAGE_CONSUME_MERGE_TRAILER);
+	parser->error = HTTPMESSAGE_OK;
+}
+
+void httpmessage_parser_init_request(
+    httpmessage_parser *parser,
+    httpmessage_request *request,
+    int option_flags)
+{
+	httpmessage_request_clear(request, option_flags);
+	httpmessage_parser_init(parser, &request->message,
+	                        HTTPMESSAGE_TYPE_REQUEST, option_flags);
+}
+
+void httpmessage_parser_init_response(
+    httpmessage_parser *parser,
+    httpmessage_response *response,
+    int option_flags)
+{
+	httpmessage_response_clear(response, option_flags);
+	httpmessage_parser_init(parser, &response->message,
+	                        HTTPMESSAGE_TYPE_RESPONSE, option_flags);
+}
+
+void httpmessage_parser_init_callbacks(
+    httpmessage_parser *parser,
+    int type,
+    const httpmessage_parser_callbacks *callbacks,
+    void *user_data)
+{
+	httpmessage_parser_init(parser, NULL, type, HTTPMESSAGE_NO_ALLOCATION);
+	parser->callbacks = callbacks;
+	parser->user_data = user_data;
+}
+
+static ssize_t httpmessage_parser_fail(
+    httpmessage_parser *parser,
+    int error)
+{
+	parser->state = HTTPMESSAGE_PARSER_ERROR;
+	parser->error = error;
+	return error;
+}
+
+/* A callback interrupted the parser after the element ending at the given offset */
+static int httpmessage_parser_interrupt(
+    httpmessage_parser *parser,
+    size_t offset)
+{
+	parser->offset = offset;
+	return HTTPMESSAGE_ERROR_INTERRUPTED;
+}
+
+/*
+ * Search the CRLF ending the current line, from the scan offset.
+ * Return 1 and the line length (including CRLF) if found.
+ * Otherwise, the scan offset is moved to the end of the input.
+ */
+static int httpmessage_parser_line_find(
+    size_t *line_length,
+    httpmessage_parser *parser,
+    const char *text, size_t length)
+{
+	size_t offset = parser->scan_offset;
+	
+	while (offset < length)
+	{
+		const char *cr = (const char *)memchr(text + offset, '\r', length - offset);
+		
+		if (!cr)
+		{
+			offset = length;
+			break;
+		}
+		
+		offset = (size_t)(cr - text);
+		
+		if ((offset + 1) == length)
+		{
+			/* Resume on the CR */
+			break;
+		}
+		
+		if (text[offset + 1] == '\n')
+		{
+			*line_length = offset + 2 - parser->offset;
+			parser->scan_offset = offset + 2;
+			return 1;
+		}
+		
+		++offset;
+	}
+	
+	parser->scan_offset = offset;
+	return 0;
+}
+
+static int httpmessage_parser_first_line_consume(
+    httpmessage_parser *parser,
+    const char *line, size_t line_length)
+{
+	httpmessage_message *message = parser->message;
+	ssize_t result;
+	
+	if (parser->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request *request = (httpmessage_request *)message;
+		result = httpmessage_request_line_consume(
+		             &request->method, &request->request_uri,
+		             &message->major_version, &message->minor_version,
+		             line, line_length, 0);
+	}
+	else
+	{
+		httpmessage_response *response = (httpmessage_response *)message;
+		result = httpmessage_status_line_consume(
+		             &message->major_version, &message->minor_version,
+		             &response->status_code, &response->reason_phrase,
+		             line, line_length, 0);
+	}
+	
+	return ((result == (ssize_t)line_length)
+	        ? HTTPMESSAGE_OK
+	        : HTTPMESSAGE_ERROR_SYNTAX);
+}
+
+static int httpmessage_parser_headerfield_line_consume(
+    httpmessage_parser *parser,
+    const char *line, size_t line_length)
+{
+	httpmessage_headerfield *field = NULL;
+	ssize_t result = httpmessage_headerfield_line_consume_with_allocator(
+	                     &field, parser->current_field,
+	                     line, line_length,
+	                     parser->option_flags & HTTPMESSAGE_NO_ALLOCATION,
+	                     parser->message->allocator);
+	                     
+	if (result < 0)
+	{
+		switch (result)
+		{
+			case HTTPMESSAGE_ERROR_ALLOCATION:
+			case HTTPMESSAGE_ERROR_BUDGET:
+				return (int)result;
+			
+			default:
+				break;
+		}
+		
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (result != (ssize_t)line_length)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	parser->current_field = field;
+	return HTTPMESSAGE_OK;
+}
+
+static int httpmessage_parser_first_line_notify(
+    httpmessage_parser *parser,
+    const char *line, size_t line_length)
+{
+	const httpmessage_parser_callbacks *callbacks = parser->callbacks;
+	size_t end = parser->offset + line_length;
+	httpmessage_stringview a;
+	httpmessage_stringview b;
+	int major_version;
+	int minor_version;
+	int status_code;
+	
+	if (parser->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		if (httpmessage_request_line_consume(
+		            &a, &b, &major_version, &minor_version,
+		            line, line_length, 0) != (ssize_t)line_length)
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		if (callbacks->on_method
+		        && callbacks->on_method(parser, &a) != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_interrupt(parser, end);
+		}
+		
+		if (callbacks->on_request_uri
+		        && callbacks->on_request_uri(parser, &b) != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_interrupt(parser, end);
+		}
+		
+		if (callbacks->on_version
+		        && callbacks->on_version(parser, major_version,
+		                                 minor_version) != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_interrupt(parser, end);
+		}
+		
+		return HTTPMESSAGE_OK;
+	}
+	
+	if (httpmessage_status_line_consume(
+	            &major_version, &minor_version, &status_code, &b,
+	            line, line_length, 0) != (ssize_t)line_length)
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	if (callbacks->on_version
+	        && callbacks->on_version(parser, major_version,
+	                                 minor_version) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_interrupt(parser, end);
+	}
+	
+	if (callbacks->on_status
+	        && callbacks->on_status(parser, status_code, &b) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_interrupt(parser, end);
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/* Report the pending header field, which ends at the current offset */
+static int httpmessage_parser_headerfield_notify(httpmessage_parser *parser)
+{
+	const httpmessage_parser_callbacks *callbacks = parser->callbacks;
+	httpmessage_stringview name;
+	httpmessage_stringview value;
+	
+	if (!parser->field_name_length)
+	{
+		return HTTPMESSAGE_OK;
+	}
+	
+	name.text = parser->text + parser->field_name_offset;
+	name.length = parser->field_name_length;
+	value.text = parser->text + parser->field_value_offset;
+	value.length = parser->field_value_length;
+	parser->field_name_length = 0;
+	
+	/* Same rules as httpmessage_message_get_framing() */
+	if (httpmessage_stringview_caseless_compare_text(&name, "Transfer-Encoding", 17) == 0)
+	{
+		if (parser->type == HTTPMESSAGE_TYPE_REQUEST
+		        && (parser->framing == HTTPMESSAGE_FRAMING_LENGTH
+		            || !httpmessage_transfer_coding_is_chunked(value.text, value.length)))
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		parser->body_length = 0;
+		parser->framing = (httpmessage_transfer_coding_is_chunked(value.text, value.length)
+		                   ? HTTPMESSAGE_FRAMING_CHUNKED
+		                   : HTTPMESSAGE_FRAMING_UNTIL_CLOSE);
+	}
+	else if (httpmessage_stringview_caseless_compare_text(&name, "Content-Length", 14) == 0)
+	{
+		size_t length;
+		
+		if (httpmessage_size_consume(&length, value.text, value.length)
+		        != (ssize_t)value.length
+		        || (parser->framing == HTTPMESSAGE_FRAMING_LENGTH
+		            && length != parser->body_length)
+		        || (parser->type == HTTPMESSAGE_TYPE_REQUEST
+		            && parser->framing == HTTPMESSAGE_FRAMING_CHUNKED))
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		if (parser->framing == HTTPMESSAGE_FRAMING_NONE
+		        || parser->framing == HTTPMESSAGE_FRAMING_LENGTH)
+		{
+			parser->body_length = length;
+			parser->framing = HTTPMESSAGE_FRAMING_LENGTH;
+		}
+	}
+	
+	if (callbacks->on_header
+	        && callbacks->on_header(parser, &name, &value) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_interrupt(parser, parser->offset);
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/*
+ * Header field line without descriptor.
+ * The field is reported once the following line shows it is not continued.
+ */
+static int httpmessage_parser_headerfield_line_notify(
+    httpmessage_parser *parser,
+    const char *line, size_t line_length)
+{
+	const char *name;
+	size_t name_length;
+	const char *value;
+	size_t value_length;
+	ssize_t consumed;
+	int result;
+	
+	if (httpmessage_text_is_LWS(*line))
+	{
+		/* Continuation of the pending field value */
+		if (!parser->field_name_length
+		        || httpmessage_headerfield_value_line_consume(
+		            &value, &value_length, line + 1, line_length - 1, 0)
+		        != (ssize_t)(line_length - 1))
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		if (!value_length)
+		{
+			return HTTPMESSAGE_OK;
+		}
+		
+		if (!parser->field_value_length)
+		{
+			parser->field_value_offset = (size_t)(value - parser->text);
+		}
+		
+		parser->field_value_length = (size_t)(value + value_length - parser->text)
+		                             - parser->field_value_offset;
+		return HTTPMESSAGE_OK;
+	}
+	
+	result = httpmessage_parser_headerfield_notify(parser);
+	
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	consumed = httpmessage_headerfield_name_consume(&name, &name_length,
+	           line, line_length);
+	           
+	if (consumed <= 0 || line[consumed] != ':')
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	++consumed;
+	
+	if (httpmessage_headerfield_value_line_consume(
+	            &value, &value_length,
+	            line + consumed, line_length - (size_t)consumed, 0)
+	        != (ssize_t)(line_length - (size_t)consumed))
+	{
+		return HTTPMESSAGE_ERROR_SYNTAX;
+	}
+	
+	parser->field_name_offset = (size_t)(name - parser->text);
+	parser->field_name_length = name_length;
+	parser->field_value_offset = (size_t)(value - parser->text);
+	parser->field_value_length = value_length;
+	return HTTPMESSAGE_OK;
+}
+
+/* Body framing of a message whose header is complete */
+static int httpmessage_parser_framing_init(httpmessage_parser *parser)
+{
+	if (parser->message)
+	{
+		int framing = httpmessage_message_get_framing(&parser->body_length,
+		              parser->message);
+		              
+		if (framing < 0)
+		{
+			return HTTPMESSAGE_ERROR_SYNTAX;
+		}
+		
+		parser->framing = framing;
+		return HTTPMESSAGE_OK;
+	}
+	
+	/* Header fields reported to the callbacks */
+	if (parser->framing == HTTPMESSAGE_FRAMING_NONE
+	        && parser->type != HTTPMESSAGE_TYPE_REQUEST)
+	{
+		parser->framing = HTTPMESSAGE_FRAMING_UNTIL_CLOSE;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/* Empty line ending the header */
+static int httpmessage_parser_headers_complete(httpmessage_parser *parser)
+{
+	int result = HTTPMESSAGE_OK;
+	
+	if (!parser->message)
+	{
+		result = httpmessage_parser_headerfield_notify(parser);
+	}
+	
+	if (result == HTTPMESSAGE_OK)
+	{
+		result = httpmessage_parser_framing_init(parser);
+	}
+	
+	if (result != HTTPMESSAGE_OK)
+	{
+		return result;
+	}
+	
+	parser->state = HTTPMESSAGE_PARSER_BODY;
+	
+	if (parser->callbacks && parser->callbacks->on_headers_complete
+	        && parser->callbacks->on_headers_complete(parser) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_interrupt(parser, parser->offset + 2);
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/* Body bytes received so far, up to the given offset */
+static int httpmessage_parser_body_update(
+    httpmessage_parser *parser,
+    size_t end)
+{
+	httpmessage_message *message = parser->message;
+	size_t offset = parser->scan_offset;
+	
+	parser->scan_offset = end;
+	
+	if (message)
+	{
+		message->body.text = parser->text + parser->offset;
+		message->body.length = end - parser->offset;
+		
+		if (!message->body.length)
+		{
+			httpmessage_stringview_clear(&message->body);
+		}
+		
+		return HTTPMESSAGE_OK;
+	}
+	
+	if (end > offset && parser->callbacks->on_body_chunk
+	        && parser->callbacks->on_body_chunk(parser, parser->text + offset,
+	                end - offset) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_interrupt(parser, end);
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+/* Decode the chunked body bytes received so far */
+static int httpmessage_parser_chunked_update(httpmessage_parser *parser)
+{
+	httpmessage_chunked_decoder *decoder = &parser->chunked;
+	httpmessage_stringview data;
+	
+	while (parser->scan_offset < parser->length
+	        && decoder->state != HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		ssize_t result = httpmessage_chunked_decoder_consume(decoder, &data,
+		                 parser->text + parser->scan_offset,
+		                 parser->length - parser->scan_offset);
+		                 
+		if (result < 0)
+		{
+			return (int)result;
+		}
+		
+		parser->scan_offset += (size_t)result;
+		
+		if (data.length && !parser->message
+		        && parser->callbacks->on_body_chunk
+		        && parser->callbacks->on_body_chunk(parser, data.text,
+		                data.length) != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_interrupt(parser, parser->scan_offset);
+		}
+	}
+	
+	if (parser->message)
+	{
+		httpmessage_message *message = parser->message;
+		message->body.text = parser->text + parser->offset;
+		message->body.length = parser->scan_offset - parser->offset;
+		
+		if (!message->body.length)
+		{
+			httpmessage_stringview_clear(&message->body);
+		}
+	}
+	
+	if (decoder->state == HTTPMESSAGE_CHUNKED_COMPLETE)
+	{
+		parser->body_length = parser->scan_offset - parser->offset;
+		
+		/* Trailer section precedes the final CRLF */
+		if (parser->message && decoder->trailer_length)
+		{
+			ssize_t result = httpmessage_message_trailer_consume(parser->message,
+			                 parser->text + parser->scan_offset - 2 - decoder->trailer_length,
+			                 decoder->trailer_length, parser->option_flags);
+			                 
+			if (result < 0)
+			{
+				return (result == HTTPMESSAGE_ERROR_ALLOCATION
+				        || result == HTTPMESSAGE_ERROR_BUDGET)
+				       ? (int)result : HTTPMESSAGE_ERROR_SYNTAX;
+			}
+		}
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+static ssize_t httpmessage_parser_complete(httpmessage_parser *parser)
+{
+	parser->offset += parser->body_length;
+	parser->scan_offset = parser->offset;
+	parser->state = HTTPMESSAGE_PARSER_COMPLETE;
+	
+	if (parser->callbacks && parser->callbacks->on_message_complete
+	        && parser->callbacks->on_message_complete(parser) != HTTPMESSAGE_OK)
+	{
+		return httpmessage_parser_fail(parser, HTTPMESSAGE_ERROR_INTERRUPTED);
+	}
+	
+	return (ssize_t)parser->offset;
+}
+
+static void httpmessage_parser_rebase(
+    httpmessage_parser *parser,
+    const char *text)
+{
+	httpmessage_message *message = parser->message;
+	
+	if (!message)
+	{
+		return;
+	}
+	
+	if (parser->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request_rebase((httpmessage_request *)message,
+		                           parser->text, parser->length, text);
+	}
+	else
+	{
+		httpmessage_response_rebase((httpmessage_response *)message,
+		                            parser->text, parser->length, text);
+	}
+}
+
+ssize_t httpmessage_parser_consume(
+    httpmessage_parser *parser,
+    const char *text, size_t length)
+{
+	size_t line_length;
+	int result;
+	
+	if (parser->state == HTTPMESSAGE_PARSER_ERROR)
+	{
+		return parser->error;
+	}
+	
+	if (!text || length < parser->length)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	if (parser->text && parser->text != text)
+	{
+		httpmessage_parser_rebase(parser, text);
+	}
+	
+	parser->text = text;
+	parser->length = length;
+	
+	while (parser->state == HTTPMESSAGE_PARSER_FIRST_LINE
+	        || parser->state == HTTPMESSAGE_PARSER_HEADERS)
+	{
+		const char *line = text + parser->offset;
+		
+		if (!httpmessage_parser_line_find(&line_length, parser, text, length))
+		{
+			return HTTPMESSAGE_ERROR_INCOMPLETE;
+		}
+		
+		if (parser->state == HTTPMESSAGE_PARSER_FIRST_LINE)
+		{
+			result = (parser->message
+			          ? httpmessage_parser_first_line_consume(parser, line, line_length)
+			          : httpmessage_parser_first_line_notify(parser, line, line_length));
+			parser->state = HTTPMESSAGE_PARSER_HEADERS;
+		}
+		else if (line_length == 2)
+		{
+			/* Empty line */
+			result = httpmessage_parser_headers_complete(parser);
+		}
+		else if (parser->message)
+		{
+			result = httpmessage_parser_headerfield_line_consume(parser, line, line_length);
+		}
+		else
+		{
+			result = httpmessage_parser_headerfield_line_notify(parser, line, line_length);
+		}
+		
+		if (result != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_fail(parser, result);
+		}
+		
+		parser->offset += line_length;
+	}
+	
+	if (parser->state == HTTPMESSAGE_PARSER_BODY
+	        && parser->framing == HTTPMESSAGE_FRAMING_CHUNKED)
+	{
+		result = httpmessage_parser_chunked_update(parser);
+		
+		if (result != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_fail(parser, result);
+		}
+		
+		if (parser->chunked.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+		{
+			return HTTPMESSAGE_ERROR_INCOMPLETE;
+		}
+		
+		return httpmessage_parser_complete(parser);
+	}
+	
+	if (parser->state == HTTPMESSAGE_PARSER_BODY)
+	{
+		size_t end = parser->offset;
+		
+		switch (parser->framing)
+		{
+			case HTTPMESSAGE_FRAMING_LENGTH:
+				end = (((length - parser->offset) < parser->body_length)
+				       ? length
+				       : (parser->offset + parser->body_length));
+				break;
+				
+			case HTTPMESSAGE_FRAMING_UNTIL_CLOSE:
+				end = length;
+				break;
+			
+			default:
+				break;
+		}
+		
+		result = httpmessage_parser_body_update(parser, end);
+		
+		if (result != HTTPMESSAGE_OK)
+		{
+			return httpmessage_parser_fail(parser, result);
+		}
+		
+		if (parser->framing == HTTPMESSAGE_FRAMING_UNTIL_CLOSE
+		        || (end - parser->offset) < parser->body_length)
+		{
+			return HTTPMESSAGE_ERROR_INCOMPLETE;
+		}
+		
+		return httpmessage_parser_complete(parser);
+	}
+	
+	return (ssize_t)parser->offset;
+}
+
+ssize_t httpmessage_parser_finish(httpmessage_parser *parser)
+{
+	switch (parser->state)
+	{
+		case HTTPMESSAGE_PARSER_ERROR:
+			return parser->error;
+		
+		case HTTPMESSAGE_PARSER_COMPLETE:
+			return (ssize_t)parser->offset;
+		
+		case HTTPMESSAGE_PARSER_BODY:
+			if (parser->framing == HTTPMESSAGE_FRAMING_UNTIL_CLOSE)
+			{
+				parser->body_length = parser->length - parser->offset;
+				return httpmessage_parser_complete(parser);
+			}
+			break;
+		
+		default:
+			break;
+	}
+	
+	return HTTPMESSAGE_ERROR_INCOMPLETE;
+}
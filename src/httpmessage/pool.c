@@ -0,0 +1,638 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+/* Empty stack marker */
+#define HTTPMESSAGE_POOL_NIL 0xFFFFFFFFU
+
+/* Stack head = modification counter (high 32 bits) | slot index (low 32 bits) */
+#define HTTPMESSAGE_POOL_HEAD_INDEX(_head) ((uint32_t)((_head) & 0xFFFFFFFFU))
+#define HTTPMESSAGE_POOL_HEAD_NEXT(_head, _index) \
+	(((((_head) >> 32) + 1) << 32) | (uint64_t)(_index))
+
+static uint64_t httpmessage_pool_load(const uint64_t *head)
+{
+#if defined(_MSC_VER)
+	return (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)head, 0, 0);
+#else
+	return __atomic_load_n(head, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static int httpmessage_pool_compare_exchange(
+    uint64_t *head,
+    uint64_t *expected,
+    uint64_t desired)
+{
+#if defined(_MSC_VER)
+	uint64_t previous = (uint64_t)_InterlockedCompareExchange64(
+	                        (volatile __int64 *)head,
+	                        (__int64)desired, (__int64) * expected);
+	                        
+	if (previous == *expected)
+	{
+		return 1;
+	}
+	
+	*expected = previous;
+	return 0;
+#else
+	return __atomic_compare_exchange_n(head, expected, desired, 0,
+	                                   __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static uint32_t httpmessage_pool_next_slot(const httpmessage_pool_slot *slot)
+{
+#if defined(_MSC_VER)
+	return *((volatile const uint32_t *)&slot->next_slot);
+#else
+	return __atomic_load_n(&slot->next_slot, __ATOMIC_RELAXED);
+#endif
+}
+
+static void httpmessage_pool_set_next_slot(
+    httpmessage_pool_slot *slot,
+    uint32_t next_slot)
+{
+#if defined(_MSC_VER)
+	*((volatile uint32_t *)&slot->next_slot) = next_slot;
+#else
+	__atomic_store_n(&slot->next_slot, next_slot, __ATOMIC_RELAXED);
+#endif
+}
+
+static void httpmessage_pool_add_count(
+    httpmessage_pool *pool,
+    int value)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchangeAdd((volatile long *)&pool->block_count, (long)value);
+#else
+	__atomic_add_fetch(&pool->block_count, (uint32_t)value, __ATOMIC_RELAXED);
+#endif
+}
+
+static uint32_t httpmessage_pool_pop(
+    httpmessage_pool *pool,
+    uint64_t *stack)
+{
+	uint64_t head = httpmessage_pool_load(stack);
+	
+	for (;;)
+	{
+		uint32_t index = HTTPMESSAGE_POOL_HEAD_INDEX(head);
+		uint64_t next;
+		
+		if (index == HTTPMESSAGE_POOL_NIL)
+		{
+			return HTTPMESSAGE_POOL_NIL;
+		}
+		
+		/*
+		 * The slot may be popped by another thread meanwhile.
+		 * The modification counter makes the exchange fail in this case.
+		 */
+		next = HTTPMESSAGE_POOL_HEAD_NEXT(head,
+		                                  httpmessage_pool_next_slot(&pool->slots[index]));
+		                                  
+		if (httpmessage_pool_compare_exchange(stack, &head, next))
+		{
+			return index;
+		}
+	}
+}
+
+static void httpmessage_pool_push(
+    httpmessage_pool *pool,
+    uint64_t *stack,
+    uint32_t index)
+{
+	uint64_t head = httpmessage_pool_load(stack);
+	
+	for (;;)
+	{
+		httpmessage_pool_set_next_slot(&pool->slots[index],
+		                               HTTPMESSAGE_POOL_HEAD_INDEX(head));
+		                               
+		if (httpmessage_pool_compare_exchange(stack, &head,
+		                                      HTTPMESSAGE_POOL_HEAD_NEXT(head, index)))
+		{
+			return;
+		}
+	}
+}
+
+httpmessage_pool *httpmessage_pool_new(
+    int type,
+    size_t max_headerfield_count,
+    size_t max_line_per_headerfield_value,
+    size_t capacity)
+{
+	httpmessage_pool *pool;
+	size_t a;
+	
+	if (!((type == HTTPMESSAGE_TYPE_REQUEST || type == HTTPMESSAGE_TYPE_RESPONSE)
+	        && max_headerfield_count
+	        && max_line_per_headerfield_value
+	        && capacity < HTTPMESSAGE_POOL_NIL))
+	{
+		return NULL;
+	}
+	
+	pool = (httpmessage_pool *)httpmessage_allocator_allocate(NULL,
+	            sizeof(httpmessage_pool) + (capacity * sizeof(httpmessage_pool_slot)));
+	                                  
+	if (!pool)
+	{
+		return NULL;
+	}
+	
+	memset(pool, 0, sizeof(httpmessage_pool));
+	pool->type = type;
+	pool->max_headerfield_count = max_headerfield_count;
+	pool->max_line_per_headerfield_value = max_line_per_headerfield_value;
+	pool->capacity = capacity;
+	pool->slots = (httpmessage_pool_slot *)(pool + 1);
+	pool->block_stack = HTTPMESSAGE_POOL_NIL;
+	pool->free_stack = (capacity ? 0 : HTTPMESSAGE_POOL_NIL);
+	
+	for (a = 0; a < capacity; ++a)
+	{
+		pool->slots[a].block = NULL;
+		pool->slots[a].next_slot = (((a + 1) < capacity)
+		                            ? (uint32_t)(a + 1)
+		                            : HTTPMESSAGE_POOL_NIL);
+	}
+	
+	return pool;
+}
+
+/*
+ * Clear a block given back to the pool and detach its allocator.
+ * Memory kept for reuse is released if it comes from another allocator
+ * than the default one.
+ */
+static void httpmessage_pool_block_clear(
+    httpmessage_pool *pool,
+    void *block)
+{
+	httpmessage_message *message = (httpmessage_message *)block;
+	int option_flags = (message->allocator ? 0 : HTTPMESSAGE_CLEAR_NO_FREE);
+	
+	if (pool->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request_clear((httpmessage_request *)block, option_flags);
+	}
+	else
+	{
+		httpmessage_response_clear((httpmessage_response *)block, option_flags);
+	}
+	
+	message->allocator = NULL;
+	message->allocator_shared = 0;
+}
+
+/* Release a block and the memory it keeps for reuse */
+static void httpmessage_pool_block_free(void *block)
+{
+	httpmessage_message_release((httpmessage_message *)block);
+	httpmessage_allocator_release(NULL, block);
+}
+
+void httpmessage_pool_free(httpmessage_pool **pool)
+{
+	if (*pool)
+	{
+		httpmessage_pool_trim(*pool, 0);
+		httpmessage_allocator_release(NULL, *pool);
+	}
+	
+	*pool = NULL;
+}
+
+size_t httpmessage_pool_trim(
+    httpmessage_pool *pool,
+    size_t keep_count)
+{
+	size_t released = 0;
+	
+	while (httpmessage_pool_count(pool) > keep_count)
+	{
+		uint32_t index = httpmessage_pool_pop(pool, &pool->block_stack);
+		
+		if (index == HTTPMESSAGE_POOL_NIL)
+		{
+			break;
+		}
+		
+		httpmessage_pool_add_count(pool, -1);
+		httpmessage_pool_block_free(pool->slots[index].block);
+		pool->slots[index].block = NULL;
+		httpmessage_pool_push(pool, &pool->free_stack, index);
+		++released;
+	}
+	
+	return released;
+}
+
+size_t httpmessage_pool_count(const httpmessage_pool *pool)
+{
+	int32_t count;
+#if defined(_MSC_VER)
+	count = (int32_t)(*((volatile const uint32_t *)&pool->block_count));
+#else
+	count = (int32_t)__atomic_load_n(&pool->block_count, __ATOMIC_RELAXED);
+#endif
+	/* Counter may be transiently negative */
+	return (count > 0) ? (size_t)count : 0;
+}
+
+static void *httpmessage_pool_pop_block(httpmessage_pool *pool)
+{
+	void *block;
+	uint32_t index = httpmessage_pool_pop(pool, &pool->block_stack);
+	
+	if (index == HTTPMESSAGE_POOL_NIL)
+	{
+		return NULL;
+	}
+	
+	httpmessage_pool_add_count(pool, -1);
+	block = pool->slots[index].block;
+	pool->slots[index].block = NULL;
+	httpmessage_pool_push(pool, &pool->free_stack, index);
+	return block;
+}
+
+static void *httpmessage_pool_acquire(httpmessage_pool *pool)
+{
+	void *block = httpmessage_pool_pop_block(pool);
+	
+	if (block)
+	{
+		return block;
+	}
+	
+	if (pool->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		return httpmessage_request_storage_new(
+		           pool->max_headerfield_count,
+		           pool->max_line_per_headerfield_value);
+	}
+	
+	return httpmessage_response_storage_new(
+	           pool->max_headerfield_count,
+	           pool->max_line_per_headerfield_value);
+}
+
+static void httpmessage_pool_release(
+    httpmessage_pool *pool,
+    void *block)
+{
+	uint32_t index = httpmessage_pool_pop(pool, &pool->free_stack);
+	
+	if (index == HTTPMESSAGE_POOL_NIL)
+	{
+		/* Pool is full */
+		httpmessage_pool_block_free(block);
+		return;
+	}
+	
+	pool->slots[index].block = block;
+	httpmessage_pool_push(pool, &pool->block_stack, index);
+	httpmessage_pool_add_count(pool, 1);
+}
+
+httpmessage_request *httpmessage_pool_acquire_request(httpmessage_pool *pool)
+{
+	if (pool->type != HTTPMESSAGE_TYPE_REQUEST)
+	{
+		return NULL;
+	}
+	
+	return (httpmessage_request *)httpmessage_pool_acquire(pool);
+}
+
+void httpmessage_pool_release_request(
+    httpmessage_pool *pool,
+    httpmessage_request *request)
+{
+	if (!request)
+	{
+		return;
+	}
+	
+	if (pool->type != HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request_storage_free(&request);
+		return;
+	}
+	
+	httpmessage_pool_block_clear(pool, request);
+	httpmessage_pool_release(pool, request);
+}
+
+httpmessage_response *httpmessage_pool_acquire_response(httpmessage_pool *pool)
+{
+	if (pool->type != HTTPMESSAGE_TYPE_RESPONSE)
+	{
+		return NULL;
+	}
+	
+	return (httpmessage_response *)httpmessage_pool_acquire(pool);
+}
+
+void httpmessage_pool_release_response(
+    httpmessage_pool *pool,
+    httpmessage_response *response)
+{
+	if (!response)
+	{
+		return;
+	}
+	
+	if (pool->type != HTTPMESSAGE_TYPE_RESPONSE)
+	{
+		httpmessage_response_storage_free(&response);
+		return;
+	}
+	
+	httpmessage_pool_block_clear(pool, response);
+	httpmessage_pool_release(pool, response);
+}
+
+/*
+ * Blocks waiting in the remote free list are linked through
+ * their first bytes. The overwritten message members are restored
+ * when the block is collected by the cache owner.
+ */
+static void *httpmessage_pool_block_get_link(const void *block)
+{
+	void *next;
+	memcpy(&next, block, sizeof(void *));
+	return next;
+}
+
+static void httpmessage_pool_block_set_link(
+    void *block,
+    void *next)
+{
+	memcpy(block, &next, sizeof(void *));
+}
+
+static void *httpmessage_pool_cache_remote_take(httpmessage_pool_cache *cache)
+{
+#if defined(_MSC_VER)
+	return _InterlockedExchangePointer((void *volatile *)&cache->remote_free_list, NULL);
+#else
+	return __atomic_exchange_n(&cache->remote_free_list, NULL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static int httpmessage_pool_cache_remote_is_empty(const httpmessage_pool_cache *cache)
+{
+#if defined(_MSC_VER)
+	return (*((void *volatile const *)&cache->remote_free_list) == NULL);
+#else
+	return (__atomic_load_n(&cache->remote_free_list, __ATOMIC_RELAXED) == NULL);
+#endif
+}
+
+static void httpmessage_pool_cache_remote_push(
+    httpmessage_pool_cache *cache,
+    void *block)
+{
+#if defined(_MSC_VER)
+	void *head = cache->remote_free_list;
+	
+	for (;;)
+	{
+		void *previous;
+		httpmessage_pool_block_set_link(block, head);
+		previous = _InterlockedCompareExchangePointer(
+		               (void *volatile *)&cache->remote_free_list, block, head);
+		               
+		if (previous == head)
+		{
+			return;
+		}
+		
+		head = previous;
+	}
+#else
+	void *head = __atomic_load_n(&cache->remote_free_list, __ATOMIC_RELAXED);
+	
+	do
+	{
+		httpmessage_pool_block_set_link(block, head);
+	}
+	while (!__atomic_compare_exchange_n(&cache->remote_free_list, &head, block, 0,
+	                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+#endif
+}
+
+/* Move blocks released by other threads to the local cache (or to the depot) */
+static void httpmessage_pool_cache_collect(httpmessage_pool_cache *cache)
+{
+	void *block = httpmessage_pool_cache_remote_take(cache);
+	
+	while (block)
+	{
+		void *next = httpmessage_pool_block_get_link(block);
+		httpmessage_message *message = (httpmessage_message *)block;
+		message->type = cache->pool->type;
+		message->major_version = message->minor_version = 1;
+		
+		if (cache->count < HTTPMESSAGE_POOL_CACHE_SIZE)
+		{
+			cache->blocks[cache->count++] = block;
+		}
+		else
+		{
+			httpmessage_pool_release(cache->pool, block);
+		}
+		
+		block = next;
+	}
+}
+
+/* Give the least recently used blocks back to the depot */
+static void httpmessage_pool_cache_drain(
+    httpmessage_pool_cache *cache,
+    size_t count)
+{
+	size_t a;
+	
+	if (count > cache->count)
+	{
+		count = cache->count;
+	}
+	
+	for (a = 0; a < count; ++a)
+	{
+		httpmessage_pool_release(cache->pool, cache->blocks[a]);
+	}
+	
+	memmove(cache->blocks, cache->blocks + count,
+	        (cache->count - count) * sizeof(void *));
+	cache->count -= count;
+}
+
+static void *httpmessage_pool_cache_acquire(httpmessage_pool_cache *cache)
+{
+	/* The remote free list does not grow while other threads keep releasing */
+	if (!httpmessage_pool_cache_remote_is_empty(cache))
+	{
+		httpmessage_pool_cache_collect(cache);
+	}
+	
+	if (cache->count == 0)
+	{
+		/* Refill a batch from the depot */
+		while (cache->count < HTTPMESSAGE_POOL_CACHE_BATCH_SIZE)
+		{
+			void *block = httpmessage_pool_pop_block(cache->pool);
+			
+			if (!block)
+			{
+				break;
+			}
+			
+			cache->blocks[cache->count++] = block;
+		}
+	}
+	
+	if (cache->count == 0)
+	{
+		return httpmessage_pool_acquire(cache->pool);
+	}
+	
+	return cache->blocks[--cache->count];
+}
+
+static void httpmessage_pool_cache_release(
+    httpmessage_pool_cache *cache,
+    int type,
+    void *block)
+{
+	if (cache->pool->type != type)
+	{
+		httpmessage_pool_block_free(block);
+		return;
+	}
+	
+	httpmessage_pool_block_clear(cache->pool, block);
+	
+	if (cache->count == HTTPMESSAGE_POOL_CACHE_SIZE)
+	{
+		httpmessage_pool_cache_drain(cache, HTTPMESSAGE_POOL_CACHE_BATCH_SIZE);
+	}
+	
+	cache->blocks[cache->count++] = block;
+}
+
+void httpmessage_pool_cache_init(
+    httpmessage_pool_cache *cache,
+    httpmessage_pool *pool)
+{
+	cache->pool = pool;
+	cache->remote_free_list = NULL;
+	cache->count = 0;
+}
+
+void httpmessage_pool_cache_flush(httpmessage_pool_cache *cache)
+{
+	httpmessage_pool_cache_collect(cache);
+	httpmessage_pool_cache_drain(cache, cache->count);
+}
+
+httpmessage_request *httpmessage_pool_cache_acquire_request(httpmessage_pool_cache *cache)
+{
+	if (cache->pool->type != HTTPMESSAGE_TYPE_REQUEST)
+	{
+		return NULL;
+	}
+	
+	return (httpmessage_request *)httpmessage_pool_cache_acquire(cache);
+}
+
+void httpmessage_pool_cache_release_request(
+    httpmessage_pool_cache *cache,
+    httpmessage_request *request)
+{
+	if (request)
+	{
+		httpmessage_pool_cache_release(cache, HTTPMESSAGE_TYPE_REQUEST, request);
+	}
+}
+
+void httpmessage_pool_cache_remote_release_request(
+    httpmessage_pool_cache *owner,
+    httpmessage_request *request)
+{
+	if (!request)
+	{
+		return;
+	}
+	
+	if (owner->pool->type != HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request_storage_free(&request);
+		return;
+	}
+	
+	httpmessage_pool_block_clear(owner->pool, request);
+	httpmessage_pool_cache_remote_push(owner, request);
+}
+
+httpmessage_response *httpmessage_pool_cache_acquire_response(httpmessage_pool_cache *cache)
+{
+	if (cache->pool->type != HTTPMESSAGE_TYPE_RESPONSE)
+	{
+		return NULL;
+	}
+	
+	return (httpmessage_response *)httpmessage_pool_cache_acquire(cache);
+}
+
+void httpmessage_pool_cache_release_response(
+    httpmessage_pool_cache *cache,
+    httpmessage_response *response)
+{
+	if (response)
+	{
+		httpmessage_pool_cache_release(cache, HTTPMESSAGE_TYPE_RESPONSE, response);
+	}
+}
+
+void httpmessage_pool_cache_remote_release_response(
+    httpmessage_pool_cache *owner,
+    httpmessage_response *response)
+{
+	if (!response)
+	{
+		return;
+	}
+	
+	if (owner->pool->type != HTTPMESSAGE_TYPE_RESPONSE)
+	{
+		httpmessage_response_storage_free(&response);
+		return;
+	}
+	
+	httpmessage_pool_block_clear(owner->pool, response);
+	httpmessage_pool_cache_remote_push(owner, response);
+}
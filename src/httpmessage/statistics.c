@@ -0,0 +1,213 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include <string.h>
+#include <stdlib.h>
+
+void httpmessage_histogram_init(
+    httpmessage_histogram *histogram,
+    size_t bucket_width)
+{
+	memset(histogram, 0, sizeof(httpmessage_histogram));
+	histogram->bucket_width = (bucket_width ? bucket_width : 1);
+}
+
+void httpmessage_histogram_add(
+    httpmessage_histogram *histogram,
+    size_t value)
+{
+	size_t b = value / histogram->bucket_width;
+	
+	if (b >= HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT)
+	{
+		b = HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT - 1;
+	}
+	
+	++histogram->buckets[b];
+	++histogram->sample_count;
+	
+	if (value > histogram->maximum)
+	{
+		histogram->maximum = value;
+	}
+}
+
+int httpmessage_histogram_merge(
+    httpmessage_histogram *histogram,
+    const httpmessage_histogram *other)
+{
+	size_t b;
+	
+	if (histogram->bucket_width != other->bucket_width)
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	for (b = 0; b < HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT; ++b)
+	{
+		histogram->buckets[b] += other->buckets[b];
+	}
+	
+	histogram->sample_count += other->sample_count;
+	
+	if (other->maximum > histogram->maximum)
+	{
+		histogram->maximum = other->maximum;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
+
+size_t httpmessage_histogram_percentile(
+    const httpmessage_histogram *histogram,
+    double percentile)
+{
+	size_t target;
+	size_t cumulated = 0;
+	size_t b;
+	
+	if (histogram->sample_count == 0)
+	{
+		return 0;
+	}
+	
+	/* Number of samples to cover, rounded up */
+	target = (size_t)(((double)histogram->sample_count * percentile) / 100.0);
+	
+	if ((double)target * 100.0 < (double)histogram->sample_count * percentile)
+	{
+		++target;
+	}
+	
+	if (target == 0)
+	{
+		target = 1;
+	}
+	
+	for (b = 0; b < (HTTPMESSAGE_HISTOGRAM_BUCKET_COUNT - 1); ++b)
+	{
+		cumulated += histogram->buckets[b];
+		
+		if (cumulated >= target)
+		{
+			size_t value = ((b + 1) * histogram->bucket_width) - 1;
+			return (value < histogram->maximum) ? value : histogram->maximum;
+		}
+	}
+	
+	return histogram->maximum;
+}
+
+void httpmessage_statistics_init(httpmessage_statistics *statistics)
+{
+	httpmessage_histogram_init(&statistics->headerfield_count, 1);
+	httpmessage_histogram_init(&statistics->line_per_value, 1);
+	httpmessage_histogram_init(&statistics->header_size, 128);
+	httpmessage_histogram_init(&statistics->first_line_length, 32);
+}
+
+int httpmessage_statistics_add_message(
+    httpmessage_statistics *statistics,
+    const httpmessage_message *message,
+    const char *text, size_t consumed)
+{
+	const httpmessage_headerfield *field;
+	const char *end_of_line;
+	size_t headerfield_count = 0;
+	size_t max_line_per_value = 1;
+	size_t header_size = consumed;
+	
+	if (!(statistics && message && text && consumed))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	for (field = &message->field_list;
+	        field && field->name.length;
+	        field = field->next_field)
+	{
+		const httpmessage_headerfield_value *value = field->value.next_line;
+		size_t line_count = 1;
+		
+		while (value && value->line.text)
+		{
+			++line_count;
+			value = value->next_line;
+		}
+		
+		if (line_count > max_line_per_value)
+		{
+			max_line_per_value = line_count;
+		}
+		
+		++headerfield_count;
+	}
+	
+	if (message->body.text
+	        && message->body.text >= text
+	        && message->body.text <= (text + consumed))
+	{
+		header_size = (size_t)(message->body.text - text);
+	}
+	
+	end_of_line = (const char *)memchr(text, '\n', header_size);
+	
+	httpmessage_histogram_add(&statistics->headerfield_count, headerfield_count);
+	httpmessage_histogram_add(&statistics->line_per_value, max_line_per_value);
+	httpmessage_histogram_add(&statistics->header_size, header_size);
+	httpmessage_histogram_add(&statistics->first_line_length,
+	                          (end_of_line
+	                           ? (size_t)(end_of_line - text) + 1
+	                           : header_size));
+	                           
+	return HTTPMESSAGE_OK;
+}
+
+void httpmessage_statistics_merge(
+    httpmessage_statistics *statistics,
+    const httpmessage_statistics *other)
+{
+	httpmessage_histogram_merge(&statistics->headerfield_count, &other->headerfield_count);
+	httpmessage_histogram_merge(&statistics->line_per_value, &other->line_per_value);
+	httpmessage_histogram_merge(&statistics->header_size, &other->header_size);
+	httpmessage_histogram_merge(&statistics->first_line_length, &other->first_line_length);
+}
+
+int httpmessage_statistics_get_storage_parameters(
+    size_t *max_headerfield_count,
+    size_t *max_line_per_headerfield_value,
+    const httpmessage_statistics *statistics,
+    double percentile)
+{
+	if (!(statistics
+	        && statistics->headerfield_count.sample_count
+	        && percentile > 0.0
+	        && percentile <= 100.0))
+	{
+		return HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+	}
+	
+	*max_headerfield_count = httpmessage_histogram_percentile(
+	                             &statistics->headerfield_count, percentile);
+	*max_line_per_headerfield_value = httpmessage_histogram_percentile(
+	                                      &statistics->line_per_value, percentile);
+	                                      
+	/* Storage always contains at least one header field and one value line */
+	if (*max_headerfield_count == 0)
+	{
+		*max_headerfield_count = 1;
+	}
+	
+	if (*max_line_per_headerfield_value == 0)
+	{
+		*max_line_per_headerfield_value = 1;
+	}
+	
+	return HTTPMESSAGE_OK;
+}
@@ -12,7 +12,8 @@
 
 httpmessage_stringview *httpmessage_stringview_new(void)
 {
-	httpmessage_stringview *o = (httpmessage_stringview *)malloc(sizeof(httpmessage_stringview));
+	httpmessage_stringview *o = (httpmessage_stringview *)httpmessage_allocator_allocate(
+	                                NULL, sizeof(httpmessage_stringview));
 	
 	if (!o)
 	{
@@ -42,7 +43,7 @@ void httpmessage_stringview_clear(
 void httpmessage_stringview_free(
     httpmessage_stringview **string)
 {
-	free(*string);
+	httpmessage_allocator_release(NULL, *string);
 	*string = NULL;
 }
 
@@ -129,8 +130,12 @@ const char *httpmessage_result_get_text(int code)
 			DFLT(ERROR_OVERFLOW)
 			DFLT(ERROR_WRITE)
 			DFLT(ERROR_ALLOCATION)
+			DFLT(ERROR_BUDGET)
+			DFLT(ERROR_READ)
 			DFLT(ERROR_SYNTAX)
 			DFLT(ERROR_INCOMPLETE)
+			DFLT(ERROR_TRUNCATED)
+			DFLT(ERROR_INTERRUPTED)
 			
 	}
 	
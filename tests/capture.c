@@ -0,0 +1,424 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <pthread.h>
+#	define HTTPMESSAGE_TEST_THREADS 1
+#endif
+
+int test_capture_synchronize(int argc, const char **argv);
+int test_capture_ranges(int argc, const char **argv);
+int test_capture_threads(int argc, const char **argv);
+
+#define CAPTURE_TEST_MAX_LENGTH 32768
+#define CAPTURE_TEST_MAX_FRAMES 512
+#define CAPTURE_TEST_MAX_RANGES 32
+
+/* Message bodies looking like messages */
+static const char *capture_test_messages[] =
+{
+	"GET /a HTTP/1.1\r\n"
+	"Host: example.org\r\n"
+	"\r\n",
+	"HTTP/1.1 200 OK\r\n"
+	"Content-Length: 33\r\n"
+	"\r\n"
+	"\r\nGET /fake HTTP/1.1\r\nHost: x\r\n\r\n",
+	"POST /c HTTP/1.1\r\n"
+	"Transfer-Encoding: chunked\r\n"
+	"\r\n"
+	"1a\r\n\r\nHTTP/1.1 404 Not Found\r\n\r\n"
+	"0\r\n"
+	"\r\n",
+	"POST /d HTTP/1.1\r\n"
+	"Content-Length: 19\r\n"
+	"\r\n"
+	"HTTP/1.1 200 OK\r\n\r\n",
+	"HTTP/1.1 304 Not Modified\r\n"
+	"Content-Length: 0\r\n"
+	"\r\n"
+};
+
+typedef struct __capture_test_reference
+{
+	httpmessage_capture_frame frames[CAPTURE_TEST_MAX_FRAMES];
+	size_t frame_count;
+	ssize_t result;
+} capture_test_reference;
+
+/* Build a capture of repeated messages, with an optional garbage and tail */
+static size_t capture_test_build(char *text, size_t repeat,
+                                 const char *garbage, const char *tail)
+{
+	size_t length = 0;
+	size_t r, m;
+	
+	for (r = 0; r < repeat; ++r)
+	{
+		if (garbage && r == repeat / 2)
+		{
+			strcpy(text + length, garbage);
+			length += strlen(garbage);
+		}
+		
+		for (m = 0; m < sizeof(capture_test_messages) / sizeof(const char *); ++m)
+		{
+			strcpy(text + length, capture_test_messages[m]);
+			length += strlen(capture_test_messages[m]);
+		}
+	}
+	
+	strcpy(text + length, tail);
+	return length + strlen(tail);
+}
+
+/* Sequential parse of the whole capture */
+static void capture_test_sequential(capture_test_reference *reference,
+                                    const char *text, size_t length)
+{
+	httpmessage_request *request = httpmessage_request_new();
+	httpmessage_response *response = httpmessage_response_new();
+	httpmessage_pipeline pipeline;
+	
+	httpmessage_pipeline_init(&pipeline, text, length, 0);
+	reference->frame_count = 0;
+	reference->result = HTTPMESSAGE_OK;
+	
+	while (pipeline.offset < length)
+	{
+		size_t offset = pipeline.offset;
+		int type = httpmessage_message_get_type(text + offset, length - offset, 0);
+		ssize_t result = ((type == HTTPMESSAGE_TYPE_RESPONSE)
+		                  ? httpmessage_pipeline_response_consume(&pipeline, response)
+		                  : httpmessage_pipeline_request_consume(&pipeline, request));
+		                  
+		if (result <= 0)
+		{
+			reference->result = result;
+			break;
+		}
+		
+		reference->frames[reference->frame_count].offset = offset;
+		reference->frames[reference->frame_count].length = (size_t)result;
+		reference->frames[reference->frame_count].type =
+		    ((type == HTTPMESSAGE_TYPE_RESPONSE)
+		     ? HTTPMESSAGE_TYPE_RESPONSE
+		     : HTTPMESSAGE_TYPE_REQUEST);
+		++reference->frame_count;
+	}
+	
+	httpmessage_request_free(&request);
+	httpmessage_response_free(&response);
+}
+
+/* Compare stitched ranges to the sequential parse */
+static int capture_test_compare(const capture_test_reference *reference,
+                                const httpmessage_capture_range *ranges,
+                                size_t range_count,
+                                ssize_t frame_count)
+{
+	ssize_t result = HTTPMESSAGE_OK;
+	size_t index = 0;
+	size_t r, f;
+	
+	if (frame_count != (ssize_t)reference->frame_count)
+	{
+		return 0;
+	}
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		for (f = 0; f < ranges[r].frame_count; ++f, ++index)
+		{
+			const httpmessage_capture_frame *a = &ranges[r].frames[f];
+			const httpmessage_capture_frame *b = &reference->frames[index];
+			
+			if (a->offset != b->offset || a->length != b->length || a->type != b->type)
+			{
+				return 0;
+			}
+		}
+		
+		if (ranges[r].result != HTTPMESSAGE_OK)
+		{
+			result = ranges[r].result;
+		}
+	}
+	
+	return (result == reference->result);
+}
+
+/* Frame and stitch a capture split at the given offsets */
+static ssize_t capture_test_ranges(httpmessage_capture_range *ranges,
+                                   const char *text, size_t length,
+                                   const size_t *offsets, size_t range_count)
+{
+	ssize_t result = HTTPMESSAGE_OK;
+	size_t r;
+	
+	for (r = 0; r < range_count; ++r)
+	{
+		httpmessage_capture_range_init(&ranges[r], text, length,
+		                               offsets[r], offsets[r + 1], 4, 0);
+		result = httpmessage_capture_range_frame(&ranges[r]);
+		
+		if (result < 0)
+		{
+			return result;
+		}
+	}
+	
+	return httpmessage_capture_stitch(ranges, range_count);
+}
+
+int test_capture_synchronize(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		size_t offset;
+		size_t expected;
+	} capture_synchronize_test;
+	
+	static const capture_synchronize_test tests[] =
+	{
+		{ "garbage", 0, 0 },
+		{ "GET / HTTP/1.1\r\n\r\n", 1, 18 },
+		{ "x\r\nGET / HTTP/1.1\r\n\r\n", 3, 3 },
+		{ "x\r\nGET / HTTP/1.1\r\n\r\n", 2, 3 },
+		{ "x\nGET / HTTP/1.1\r\n\r\n", 1, 20 },
+		{ "x\r\nHost: GET / HTTP/1.1\r\n\r\n", 1, 27 },
+		{ "x\r\nHost: x\r\nHTTP/1.1 200 OK\r\n\r\n", 1, 12 },
+		{ "x\r\nHTTP/1.1 200 OK", 1, 18 },
+		{ "x\r\nGET / HTTP/1.1", 1, 17 }
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(capture_synchronize_test); ++t)
+	{
+		size_t length = strlen(tests[t].text);
+		size_t result = httpmessage_capture_synchronize(tests[t].text, length,
+		                tests[t].offset);
+		                
+		if (result != tests[t].expected)
+		{
+			fprintf(stderr, "%15.15s: %d: %d, expect %d\n", "SYNCHRONIZE", (int)t,
+			        (int)result, (int)tests[t].expected);
+			print_line(stderr, tests[t].text, length);
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_capture_ranges(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	char *text = (char *)malloc(CAPTURE_TEST_MAX_LENGTH);
+	capture_test_reference *reference =
+	    (capture_test_reference *)malloc(sizeof(capture_test_reference));
+	httpmessage_capture_range ranges[CAPTURE_TEST_MAX_RANGES];
+	size_t offsets[CAPTURE_TEST_MAX_RANGES + 1];
+	size_t t;
+	
+	typedef struct
+	{
+		size_t repeat;
+		const char *garbage;
+		const char *tail;
+		ssize_t result;
+	} capture_ranges_test;
+	
+	static const capture_ranges_test tests[] =
+	{
+		{ 2, NULL, "", HTTPMESSAGE_OK },
+		{ 2, NULL, "GET /truncated HTTP/1.1\r\nHost", HTTPMESSAGE_ERROR_INCOMPLETE },
+		{ 4, "garbage\r\n\r\n", "", HTTPMESSAGE_ERROR_SYNTAX },
+		{ 40, NULL, "", HTTPMESSAGE_OK }
+	};
+	
+	if (!(text && reference))
+	{
+		free(text);
+		free(reference);
+		return ++exit_code;
+	}
+	
+	for (t = 0; t < sizeof(tests) / sizeof(capture_ranges_test); ++t)
+	{
+		size_t length = capture_test_build(text, tests[t].repeat,
+		                                   tests[t].garbage, tests[t].tail);
+		size_t split, count, r;
+		
+		capture_test_sequential(reference, text, length);
+		
+		if (reference->result != tests[t].result)
+		{
+			fprintf(stderr, "%15.15s: %d: %d, expect %d\n", "SEQUENTIAL", (int)t,
+			        (int)reference->result, (int)tests[t].result);
+			++exit_code;
+			continue;
+		}
+		
+		/* Two ranges split at each offset */
+		for (split = 0; split <= length && tests[t].repeat < 10; ++split)
+		{
+			ssize_t result;
+			offsets[0] = 0;
+			offsets[1] = split;
+			offsets[2] = length;
+			result = capture_test_ranges(ranges, text, length, offsets, 2);
+			
+			if (!capture_test_compare(reference, ranges, 2, result))
+			{
+				fprintf(stderr, "%15.15s: %d: split %d, %d frames, expect %d\n",
+				        "SPLIT", (int)t, (int)split, (int)result,
+				        (int)reference->frame_count);
+				++exit_code;
+			}
+			
+			for (r = 0; r < 2; ++r)
+			{
+				httpmessage_capture_range_clear(&ranges[r]);
+			}
+		}
+		
+		/* Ranges of equal size */
+		for (count = 1; count <= CAPTURE_TEST_MAX_RANGES; ++count)
+		{
+			ssize_t result;
+			
+			for (r = 0; r <= count; ++r)
+			{
+				offsets[r] = (length * r) / count;
+			}
+			
+			result = capture_test_ranges(ranges, text, length, offsets, count);
+			
+			if (!capture_test_compare(reference, ranges, count, result))
+			{
+				fprintf(stderr, "%15.15s: %d: %d ranges, %d frames, expect %d\n",
+				        "RANGES", (int)t, (int)count, (int)result,
+				        (int)reference->frame_count);
+				++exit_code;
+			}
+			
+			for (r = 0; r < count; ++r)
+			{
+				httpmessage_capture_range_clear(&ranges[r]);
+			}
+		}
+	}
+	
+	free(text);
+	free(reference);
+	return exit_code;
+}
+
+#if defined(HTTPMESSAGE_TEST_THREADS)
+
+#define CAPTURE_TEST_THREAD_COUNT 8
+
+static void *capture_test_thread_run(void *argument)
+{
+	httpmessage_capture_range_frame((httpmessage_capture_range *)argument);
+	return NULL;
+}
+
+#endif
+
+int test_capture_threads(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+#if defined(HTTPMESSAGE_TEST_THREADS)
+	pthread_t threads[CAPTURE_TEST_THREAD_COUNT];
+	httpmessage_capture_range ranges[CAPTURE_TEST_THREAD_COUNT];
+	char *text = (char *)malloc(CAPTURE_TEST_MAX_LENGTH);
+	capture_test_reference *reference =
+	    (capture_test_reference *)malloc(sizeof(capture_test_reference));
+	size_t length;
+	ssize_t result;
+	int t;
+	
+	if (!(text && reference))
+	{
+		free(text);
+		free(reference);
+		return ++exit_code;
+	}
+	
+	length = capture_test_build(text, 60, NULL, "");
+	capture_test_sequential(reference, text, length);
+	
+	for (t = 0; t < CAPTURE_TEST_THREAD_COUNT; ++t)
+	{
+		httpmessage_capture_range_init(&ranges[t], text, length,
+		                               (length * (size_t)t) / CAPTURE_TEST_THREAD_COUNT,
+		                               (length * (size_t)(t + 1)) / CAPTURE_TEST_THREAD_COUNT,
+		                               4, 0);
+		                               
+		if (pthread_create(&threads[t], NULL, capture_test_thread_run, &ranges[t]) != 0)
+		{
+			fprintf(stderr, "%15.15s: %s\n", "THREAD", strerror(errno));
+			return ++exit_code;
+		}
+	}
+	
+	for (t = 0; t < CAPTURE_TEST_THREAD_COUNT; ++t)
+	{
+		pthread_join(threads[t], NULL);
+	}
+	
+	result = httpmessage_capture_stitch(ranges, CAPTURE_TEST_THREAD_COUNT);
+	
+	if (!capture_test_compare(reference, ranges, CAPTURE_TEST_THREAD_COUNT, result))
+	{
+		fprintf(stderr, "%15.15s: %d frames, expect %d\n", "THREADS",
+		        (int)result, (int)reference->frame_count);
+		++exit_code;
+	}
+	
+	for (t = 0; t < CAPTURE_TEST_THREAD_COUNT; ++t)
+	{
+		httpmessage_capture_range_clear(&ranges[t]);
+	}
+	
+	free(text);
+	free(reference);
+#endif
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "synchronize", test_capture_synchronize },
+		{ "ranges", test_capture_ranges },
+		{ "threads", test_capture_threads }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
@@ -0,0 +1,637 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int test_chunk_size(int argc, const char **argv);
+int test_chunked_consume(int argc, const char **argv);
+int test_chunked_decode(int argc, const char **argv);
+int test_chunked_errors(int argc, const char **argv);
+int test_chunked_message(int argc, const char **argv);
+int test_chunked_encoder(int argc, const char **argv);
+int test_chunked_encoder_file(int argc, const char **argv);
+int test_chunked_trailer(int argc, const char **argv);
+
+static const char *chunked_body =
+    "5\r\n"
+    "Hello\r\n"
+    "7;name=value;quoted=\"a;b\"\r\n"
+    ", world\r\n"
+    "1A ; ext\r\n"
+    "abcdefghijklmnopqrstuvwxyz\r\n"
+    "0\r\n"
+    "Server-Timing: total;dur=12\r\n"
+    "Digest: sha-256=abc\r\n"
+    "\r\n";
+static const char *decoded_body = "Hello, worldabcdefghijklmnopqrstuvwxyz";
+static const char *trailer =
+    "Server-Timing: total;dur=12\r\n"
+    "Digest: sha-256=abc\r\n";
+
+int test_chunk_size(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		ssize_t result;
+		size_t value;
+	} chunk_size_test;
+	
+	static const chunk_size_test tests[] =
+	{
+		{ "0", 1, 0 },
+		{ "a", 1, 10 },
+		{ "Ff\r\n", 2, 255 },
+		{ "7fffFFFF;ext", 8, 0x7fffffffUL },
+		{ "00000000000000000000010", 23, 16 },
+		{ "g", HTTPMESSAGE_ERROR_SYNTAX, 0 },
+		{ "10000000000000000000000000000000000", HTTPMESSAGE_ERROR_OVERFLOW, 0 }
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(chunk_size_test); ++t)
+	{
+		size_t value = 0;
+		ssize_t result = httpmessage_chunk_size_consume(&value, tests[t].text,
+		                 strlen(tests[t].text));
+		                 
+		if (result != tests[t].result
+		        || (result > 0 && value != tests[t].value))
+		{
+			fprintf(stderr, "%15.15s: %s: %d %lu\n", "SIZE", tests[t].text,
+			        (int)result, (unsigned long)value);
+			++exit_code;
+		}
+	}
+	
+	if (!httpmessage_transfer_coding_is_chunked("gzip, Chunked ", 14)
+	        || httpmessage_transfer_coding_is_chunked("chunked, gzip", 13)
+	        || httpmessage_transfer_coding_is_chunked("xchunked", 8))
+	{
+		fprintf(stderr, "%15.15s: unexpected result\n", "TRANSFER CODING");
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_consume(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t length = strlen(chunked_body);
+	size_t step;
+	
+	/* Input split in pieces of any size */
+	for (step = 1; step <= length; ++step)
+	{
+		httpmessage_chunked_decoder decoder;
+		char output[128];
+		size_t output_length = 0;
+		size_t offset = 0;
+		ssize_t result = 0;
+		
+		httpmessage_chunked_decoder_init(&decoder);
+		
+		while (offset < length && decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+		{
+			size_t end = ((offset + step) < length) ? (offset + step) : length;
+			size_t position = offset;
+			
+			while (position < end && decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE)
+			{
+				httpmessage_stringview data;
+				result = httpmessage_chunked_decoder_consume(&decoder, &data,
+				         chunked_body + position, end - position);
+				         
+				if (result < 0)
+				{
+					break;
+				}
+				
+				if (data.length > 0 && (output_length + data.length) <= sizeof(output))
+				{
+					memcpy(output + output_length, data.text, data.length);
+				}
+				
+				output_length += data.length;
+				position += (size_t)result;
+			}
+			
+			if (result < 0)
+			{
+				break;
+			}
+			
+			offset = position;
+		}
+		
+		if (result < 0
+		        || offset != length
+		        || decoder.state != HTTPMESSAGE_CHUNKED_COMPLETE
+		        || decoder.body_length != strlen(decoded_body)
+		        || output_length != strlen(decoded_body)
+		        || memcmp(output, decoded_body, output_length) != 0
+		        || decoder.trailer_length != strlen(trailer))
+		{
+			fprintf(stderr, "%15.15s: step %d: %d %s, %d bytes\n", "CONSUME",
+			        (int)step, (int)result, httpmessage_result_get_text((int)result),
+			        (int)output_length);
+			++exit_code;
+		}
+		
+		if (step == length
+		        && httpmessage_stringview_compare_text(&decoder.trailer, trailer,
+		                strlen(trailer)) != 0)
+		{
+			fprintf(stderr, "%15.15s: %.*s\n", "TRAILER",
+			        (int)decoder.trailer.length, decoder.trailer.text);
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_decode(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_chunked_decoder decoder;
+	size_t length = strlen(chunked_body);
+	char text[256];
+	size_t decoded = 0;
+	size_t offset = 0;
+	ssize_t result = HTTPMESSAGE_ERROR_INCOMPLETE;
+	
+	static const char *next = "GET / HTTP/1.1\r\n";
+	
+	memcpy(text, chunked_body, length);
+	memcpy(text + length, next, strlen(next));
+	length += strlen(next);
+	httpmessage_chunked_decoder_init(&decoder);
+	
+	/* Pieces of 7 bytes are received after the decoded bytes */
+	while (offset < length && result == HTTPMESSAGE_ERROR_INCOMPLETE)
+	{
+		size_t received = ((length - offset) < 7) ? (length - offset) : 7;
+		size_t size = received;
+		memmove(text + decoded, text + offset, received);
+		result = httpmessage_chunked_decode(&decoder, text + decoded, &size);
+		decoded += size;
+		offset += received;
+	}
+	
+	if (result != (ssize_t)(strlen(next) - (length - offset))
+	        || decoded != strlen(decoded_body)
+	        || memcmp(text, decoded_body, decoded) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s, %d bytes\n", "DECODE",
+		        (int)result, httpmessage_result_get_text((int)result), (int)decoded);
+		++exit_code;
+	}
+	
+	/* Whole input */
+	length = strlen(chunked_body);
+	memcpy(text, chunked_body, length);
+	memcpy(text + length, next, strlen(next));
+	decoded = length + strlen(next);
+	httpmessage_chunked_decoder_init(&decoder);
+	result = httpmessage_chunked_decode(&decoder, text, &decoded);
+	
+	if (result != (ssize_t)strlen(next)
+	        || decoded != strlen(decoded_body)
+	        || memcmp(text, decoded_body, decoded) != 0
+	        || memcmp(text + length, next, strlen(next)) != 0
+	        || httpmessage_stringview_compare_text(&decoder.trailer, trailer,
+	                strlen(trailer)) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s, %d bytes\n", "WHOLE",
+		        (int)result, httpmessage_result_get_text((int)result), (int)decoded);
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_errors(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		ssize_t result;
+	} chunked_error_test;
+	
+	static const chunked_error_test tests[] =
+	{
+		{ "\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "x\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5x\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5 garbage\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5 \r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext=a\nb\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext=\"a\nb\"\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;=a\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext=\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext=\"a\"b\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "5;ext=a\rb", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "3\r\nabcd\r\n", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "0\r\nTrailer: 1\rx", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "0\r\n\rx", HTTPMESSAGE_ERROR_SYNTAX },
+		{ "fffffffffffffffffffffffffffffffff\r\n", HTTPMESSAGE_ERROR_OVERFLOW },
+		{ "3\r\nabc\r\n", HTTPMESSAGE_ERROR_INCOMPLETE },
+		{ "3 ;a ; b=\"\\\"q\\\"\";c=d\r\nabc\r\n", HTTPMESSAGE_ERROR_INCOMPLETE },
+		{ "0\r\n\r\n", 0 }
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(chunked_error_test); ++t)
+	{
+		httpmessage_chunked_decoder decoder;
+		char text[64];
+		size_t length = strlen(tests[t].text);
+		ssize_t result;
+		
+		memcpy(text, tests[t].text, length);
+		httpmessage_chunked_decoder_init(&decoder);
+		result = httpmessage_chunked_decode(&decoder, text, &length);
+		
+		if (result != tests[t].result)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "ERROR", (int)t,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		
+		/* Errors are persistent */
+		if (result < 0 && result != HTTPMESSAGE_ERROR_INCOMPLETE)
+		{
+			length = 5;
+			
+			if (httpmessage_chunked_decode(&decoder, text, &length) != result)
+			{
+				++exit_code;
+			}
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_message(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_response response;
+	httpmessage_pipeline pipeline;
+	char text[512];
+	size_t header_length;
+	size_t length;
+	ssize_t result;
+	
+	static const char *header =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n";
+	    
+	header_length = strlen(header);
+	memcpy(text, header, header_length);
+	memcpy(text + header_length, chunked_body, strlen(chunked_body));
+	length = header_length + strlen(chunked_body);
+	memcpy(text + length, text, length);
+	
+	/* The chunked body ends the first message */
+	httpmessage_response_init(&response);
+	httpmessage_pipeline_init(&pipeline, text, 2 * length, 0);
+	result = httpmessage_pipeline_response_consume(&pipeline, &response);
+	
+	if (result != (ssize_t)length
+	        || httpmessage_stringview_compare_text(&response.message.body,
+	                chunked_body, strlen(chunked_body)) != 0
+	        || httpmessage_pipeline_response_consume(&pipeline, &response) != (ssize_t)length)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "PIPELINE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	result = httpmessage_response_consume(&response, text, length - 1, 0);
+	
+	if (result != HTTPMESSAGE_ERROR_INCOMPLETE)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "INCOMPLETE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	httpmessage_response_clear(&response, 0);
+	return exit_code;
+}
+
+static size_t vectors_append(char *output, size_t output_length,
+                             const httpmessage_stringview *vectors, ssize_t count)
+{
+	ssize_t v;
+	
+	for (v = 0; v < count; ++v)
+	{
+		memcpy(output + output_length, vectors[v].text, vectors[v].length);
+		output_length += vectors[v].length;
+	}
+	
+	return output_length;
+}
+
+int test_chunked_encoder(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		size_t buffer_size;
+		const char *expected;
+	} chunked_encoder_test;
+	
+	static const char *fragments[] =
+	{
+		"Hello", ", ", "world", "abcdefghijklmnopqrstuvwxyz", "!"
+	};
+	static const char *trailer_text = "Digest: sha-256=abc\r\n";
+	static const chunked_encoder_test tests[] =
+	{
+		{
+			0,
+			"5\r\nHello\r\n2\r\n, \r\n5\r\nworld\r\n"
+			"1a\r\nabcdefghijklmnopqrstuvwxyz\r\n1\r\n!\r\n"
+			"0\r\nDigest: sha-256=abc\r\n\r\n"
+		},
+		{
+			8,
+			"c\r\nHello, world\r\n"
+			"1a\r\nabcdefghijklmnopqrstuvwxyz\r\n1\r\n!\r\n"
+			"0\r\nDigest: sha-256=abc\r\n\r\n"
+		},
+		{
+			64,
+			"27\r\nHello, worldabcdefghijklmnopqrstuvwxyz!\r\n"
+			"0\r\nDigest: sha-256=abc\r\n\r\n"
+		}
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(chunked_encoder_test); ++t)
+	{
+		httpmessage_chunked_encoder encoder;
+		httpmessage_stringview vectors[HTTPMESSAGE_CHUNKED_ENCODER_VECTOR_COUNT];
+		char buffer[64];
+		char output[256];
+		size_t output_length = 0;
+		size_t f;
+		ssize_t count = 0;
+		
+		httpmessage_chunked_encoder_init(&encoder, buffer, tests[t].buffer_size);
+		
+		for (f = 0; f < sizeof(fragments) / sizeof(const char *) && count >= 0; ++f)
+		{
+			count = httpmessage_chunked_encoder_write(&encoder, vectors,
+			        fragments[f], strlen(fragments[f]));
+			        
+			if (count > 0 && vectors[count - 2].text != fragments[f])
+			{
+				fprintf(stderr, "%15.15s: %d: fragment %d was copied\n", "ENCODER",
+				        (int)t, (int)f);
+				++exit_code;
+			}
+			
+			output_length = vectors_append(output, output_length, vectors, count);
+		}
+		
+		if (count >= 0)
+		{
+			count = httpmessage_chunked_encoder_finish(&encoder, vectors,
+			        trailer_text, strlen(trailer_text));
+			output_length = vectors_append(output, output_length, vectors, count);
+		}
+		
+		if (count < 0
+		        || output_length != strlen(tests[t].expected)
+		        || memcmp(output, tests[t].expected, output_length) != 0
+		        || encoder.body_length != strlen(decoded_body) + 1)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %.*s\n", "ENCODER", (int)t,
+			        (int)count, (int)output_length, output);
+			++exit_code;
+		}
+		
+		if (httpmessage_chunked_encoder_write(&encoder, vectors, "x", 1)
+		        != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+		{
+			fprintf(stderr, "%15.15s: %d: write after finish\n", "ENCODER", (int)t);
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_encoder_file(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_chunked_encoder encoder;
+	httpmessage_chunked_decoder decoder;
+	httpmessage_headerfield trailer;
+	char buffer[16];
+	char text[256];
+	size_t length;
+	ssize_t written = 0;
+	ssize_t w;
+	ssize_t result;
+	FILE *file = tmpfile();
+	
+	static const char *expected_trailer = "Digest: sha-256=abc\r\n";
+	
+	if (!file)
+	{
+		return exit_code;
+	}
+	
+	httpmessage_headerfield_init(&trailer);
+	httpmessage_stringview_assign(&trailer.name, "Digest");
+	httpmessage_stringview_assign(&trailer.value.line, "sha-256=abc");
+	
+	httpmessage_chunked_encoder_init(&encoder, buffer, sizeof(buffer));
+	written += httpmessage_chunked_encoder_write_file(&encoder, file, "Hello", 5);
+	written += httpmessage_chunked_encoder_write_file(&encoder, file, ", world", 7);
+	written += httpmessage_chunked_encoder_write_file(&encoder, file,
+	           "abcdefghijklmnopqrstuvwxyz", 26);
+	w = httpmessage_chunked_encoder_finish_file(&encoder, file, &trailer);
+	written = (w < 0) ? w : written + w;
+	
+	rewind(file);
+	length = fread(text, 1, sizeof(text), file);
+	fclose(file);
+	
+	/* The decoder gives back the original body */
+	httpmessage_chunked_decoder_init(&decoder);
+	result = httpmessage_chunked_decode(&decoder, text, &length);
+	
+	if (written <= 0
+	        || result != 0
+	        || length != strlen(decoded_body)
+	        || memcmp(text, decoded_body, length) != 0
+	        || httpmessage_stringview_compare_text(&decoder.trailer, expected_trailer,
+	                strlen(expected_trailer)) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %d %.*s\n", "ENCODER FILE", (int)written,
+		        (int)result, (int)length, text);
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_chunked_trailer(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_response *response;
+	httpmessage_parser parser;
+	char text[512];
+	size_t length;
+	size_t i;
+	int merge;
+	ssize_t result;
+	
+	static const int option_flags = (HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION);
+	static const char *header =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Content-Type: text/plain\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n";
+	    
+	length = strlen(header);
+	memcpy(text, header, length);
+	memcpy(text + length, chunked_body, strlen(chunked_body));
+	length += strlen(chunked_body);
+	
+	/* Trailer fields use the pre-allocated storage */
+	response = httpmessage_response_storage_new(4, 1);
+	
+	for (merge = 0; merge < 2; ++merge)
+	{
+		int flags = option_flags | (merge ? HTTPMESSAGE_CONSUME_MERGE_TRAILER : 0);
+		const httpmessage_headerfield *trailer_list;
+		
+		result = httpmessage_response_consume(response, text, length, flags);
+		trailer_list = response->message.trailer_list;
+		
+		if (result != (ssize_t)length
+		        || httpmessage_headerfield_count(&response->message.field_list)
+		        != (size_t)(merge ? 4 : 2)
+		        || httpmessage_headerfield_count(trailer_list) != 2
+		        || !httpmessage_headerfield_is(trailer_list, "Server-Timing")
+		        || httpmessage_stringview_compare_text(&trailer_list->value.line,
+		                "total;dur=12", 12) != 0
+		        || !httpmessage_headerfield_is(trailer_list->next_field, "Digest")
+		        || (httpmessage_headerfield_find(&response->message.field_list,
+		                "Digest", 6) != NULL) != merge)
+		{
+			fprintf(stderr, "%15.15s: merge %d: %d %s\n", "TRAILER", merge,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		
+		/* Without trailer */
+		result = httpmessage_response_consume(response, text, length,
+		                                      flags | HTTPMESSAGE_CONSUME_HEADER_ONLY);
+		
+		if (result != (ssize_t)strlen(header)
+		        || response->message.trailer_list
+		        || httpmessage_headerfield_count(&response->message.field_list) != 2)
+		{
+			fprintf(stderr, "%15.15s: merge %d: %d %s\n", "NO TRAILER", merge,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	/* Not enough storage */
+	memcpy(text + length - 2, "X-Extra: 1\r\n\r\n", 14);
+	result = httpmessage_response_consume(response, text, length + 12, option_flags);
+	
+	if (result != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "STORAGE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Incremental parser */
+	length += 12;
+	httpmessage_parser_init_response(&parser, response,
+	                                 HTTPMESSAGE_CLEAR_NO_FREE);
+	result = HTTPMESSAGE_ERROR_INCOMPLETE;
+	
+	for (i = 1; i <= length && result == HTTPMESSAGE_ERROR_INCOMPLETE; ++i)
+	{
+		result = httpmessage_parser_consume(&parser, text, i);
+	}
+	
+	if (result != (ssize_t)length
+	        || httpmessage_headerfield_count(response->message.trailer_list) != 3
+	        || httpmessage_headerfield_count(&response->message.field_list) != 2)
+	{
+		fprintf(stderr, "%15.15s: %d %d %d\n", "PARSER", (int)result,
+		        (int)httpmessage_headerfield_count(response->message.trailer_list),
+		        (int)httpmessage_headerfield_count(&response->message.field_list));
+		++exit_code;
+	}
+	
+	httpmessage_response_storage_free(&response);
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "size", test_chunk_size },
+		{ "consume", test_chunked_consume },
+		{ "decode", test_chunked_decode },
+		{ "errors", test_chunked_errors },
+		{ "message", test_chunked_message },
+		{ "encoder", test_chunked_encoder },
+		{ "encoder_file", test_chunked_encoder_file },
+		{ "trailer", test_chunked_trailer }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
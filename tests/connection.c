@@ -0,0 +1,374 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <unistd.h>
+#	include <sys/socket.h>
+#	define HTTPMESSAGE_TEST_SOCKETPAIR 1
+#endif
+
+int test_connection_pipeline(int argc, const char **argv);
+int test_connection_keep_alive(int argc, const char **argv);
+int test_connection_errors(int argc, const char **argv);
+
+/* Input text sent in pieces of a given size */
+typedef struct
+{
+	const char *text;
+	size_t length;
+	size_t offset;
+	size_t step;
+#if defined(HTTPMESSAGE_TEST_SOCKETPAIR)
+	/* Connection end and peer end of a socket pair */
+	int fds[2];
+#endif
+} connection_source;
+
+#if defined(HTTPMESSAGE_TEST_SOCKETPAIR)
+
+/*
+ * The peer writes the next piece of text before each read()
+ * and closes its end once the whole text is sent.
+ */
+static ssize_t connection_source_input(void *user_data, char *buffer, size_t size)
+{
+	connection_source *source = (connection_source *)user_data;
+	size_t piece = source->length - source->offset;
+	
+	if (piece > source->step)
+	{
+		piece = source->step;
+	}
+	
+	if (piece)
+	{
+		if (write(source->fds[1], source->text + source->offset, piece)
+		        != (ssize_t)piece)
+		{
+			return -1;
+		}
+		
+		source->offset += piece;
+	}
+	
+	if (source->offset == source->length && source->fds[1] >= 0)
+	{
+		close(source->fds[1]);
+		source->fds[1] = -1;
+	}
+	
+	return read(source->fds[0], buffer, size);
+}
+
+#else
+
+static ssize_t connection_source_input(void *user_data, char *buffer, size_t size)
+{
+	connection_source *source = (connection_source *)user_data;
+	
+	if (size > source->step)
+	{
+		size = source->step;
+	}
+	
+	if (size > (source->length - source->offset))
+	{
+		size = source->length - source->offset;
+	}
+	
+	memcpy(buffer, source->text + source->offset, size);
+	source->offset += size;
+	return (ssize_t)size;
+}
+
+#endif
+
+/*
+ * Send the text in pieces of the given size
+ * and log the requests received on the connection.
+ */
+static ssize_t connection_run(httpmessage_connection *connection,
+                              const char *text, size_t step,
+                              char *log, size_t log_size)
+{
+	connection_source source;
+	ssize_t result;
+	
+	source.text = text;
+	source.length = strlen(text);
+	source.offset = 0;
+	source.step = step;
+	log[0] = '\0';
+
+#if defined(HTTPMESSAGE_TEST_SOCKETPAIR)
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, source.fds) != 0)
+	{
+		return HTTPMESSAGE_ERROR_READ;
+	}
+#endif
+	
+	for (;;)
+	{
+		httpmessage_request *request;
+		result = httpmessage_connection_next_request(connection, &request);
+		
+		if (result > 0)
+		{
+			size_t used = strlen(log);
+			const char *begin = connection->buffer;
+			const char *end = connection->buffer + connection->length;
+			
+			/* Views on the connection input buffer */
+			if (request->method.text < begin || request->method.text >= end)
+			{
+				result = HTTPMESSAGE_ERROR_INVALID_ARGUMENT;
+				break;
+			}
+			
+			sprintf(log + used, "%.*s %.*s %d|",
+			        (int)request->method.length, request->method.text,
+			        (int)request->request_uri.length, request->request_uri.text,
+			        (int)request->message.body.length);
+			httpmessage_connection_release(connection);
+			
+			if (strlen(log) + 64 > log_size)
+			{
+				break;
+			}
+			
+			continue;
+		}
+		
+		if (result != HTTPMESSAGE_ERROR_INCOMPLETE)
+		{
+			break;
+		}
+		
+		result = httpmessage_connection_read(connection,
+		                                     connection_source_input, &source);
+		                                     
+		if (result < 0)
+		{
+			break;
+		}
+	}
+
+#if defined(HTTPMESSAGE_TEST_SOCKETPAIR)
+	close(source.fds[0]);
+	
+	if (source.fds[1] >= 0)
+	{
+		close(source.fds[1]);
+	}
+#endif
+	
+	return result;
+}
+
+int test_connection_pipeline(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		size_t buffer_size;
+		size_t step;
+	} connection_pipeline_test;
+	
+	static const connection_pipeline_test tests[] =
+	{
+		{ 1024, 4096 },
+		{ 1024, 1 },
+		{ 16, 1 },
+		{ 16, 7 },
+		{ 64, 4096 }
+	};
+	static const char *text =
+	    "GET /a HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "\r\n"
+	    "POST /b HTTP/1.1\r\n"
+	    "Content-Length: 5\r\n"
+	    "\r\n"
+	    "hello"
+	    "POST /c HTTP/1.1\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "5\r\nhello\r\n0\r\n\r\n";
+	static const char *expected = "GET /a 0|POST /b 5|POST /c 15|";
+	
+	for (t = 0; t < sizeof(tests) / sizeof(connection_pipeline_test); ++t)
+	{
+		httpmessage_connection connection;
+		httpmessage_request *storage;
+		char log[256];
+		ssize_t result;
+		
+		if (httpmessage_connection_init(&connection, tests[t].buffer_size, 256, 4, 0)
+		        != HTTPMESSAGE_OK)
+		{
+			++exit_code;
+			continue;
+		}
+		
+		storage = connection.request;
+		result = connection_run(&connection, text, tests[t].step, log, sizeof(log));
+		
+		if (result != 0
+		        || strcmp(log, expected) != 0
+		        || connection.request_count != 3
+		        || connection.request != storage)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s, %s\n", "PIPELINE", (int)t,
+			        (int)result, httpmessage_result_get_text((int)result), log);
+			++exit_code;
+		}
+		
+		httpmessage_connection_clear(&connection);
+	}
+	
+	return exit_code;
+}
+
+int test_connection_keep_alive(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		const char *expected;
+	} connection_keep_alive_test;
+	
+	static const connection_keep_alive_test tests[] =
+	{
+		{
+			"GET /a HTTP/1.0\r\n\r\n"
+			"GET /b HTTP/1.0\r\n\r\n",
+			"GET /a 0|"
+		},
+		{
+			"GET /a HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n"
+			"GET /b HTTP/1.1\r\nConnection: upgrade, close\r\n\r\n"
+			"GET /c HTTP/1.1\r\n\r\n",
+			"GET /a 0|GET /b 0|"
+		},
+		{
+			"GET /a HTTP/1.1\r\nConnection: keep-alive\r\n\r\n"
+			"GET /b HTTP/1.1\r\n\r\n",
+			"GET /a 0|GET /b 0|"
+		}
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(connection_keep_alive_test); ++t)
+	{
+		httpmessage_connection connection;
+		char log[256];
+		ssize_t result;
+		
+		httpmessage_connection_init(&connection, 1024, 1024, 4,
+		                            HTTPMESSAGE_NO_ALLOCATION);
+		result = connection_run(&connection, tests[t].text, 4096, log, sizeof(log));
+		
+		if (result != 0 || strcmp(log, tests[t].expected) != 0)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s, %s\n", "KEEP-ALIVE", (int)t,
+			        (int)result, httpmessage_result_get_text((int)result), log);
+			++exit_code;
+		}
+		
+		httpmessage_connection_clear(&connection);
+	}
+	
+	return exit_code;
+}
+
+int test_connection_errors(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		size_t max_buffer_size;
+		ssize_t result;
+		const char *expected;
+	} connection_error_test;
+	
+	static const connection_error_test tests[] =
+	{
+		{
+			"GET /a HTTP/1.1\r\n\r\n"
+			"GET /b HTTP/1.1\r\nX-Long: 0123456789012345678901234567890123456789\r\n\r\n",
+			32, HTTPMESSAGE_ERROR_OVERFLOW, "GET /a 0|"
+		},
+		{
+			"GET /a HTTP/1.1\r\n\r\n"
+			"GET /b HTTP/1.1\r\nHost",
+			256, HTTPMESSAGE_ERROR_TRUNCATED, "GET /a 0|"
+		},
+		{
+			"POST /a HTTP/1.1\r\nContent-Length: 10\r\n\r\nhello",
+			256, HTTPMESSAGE_ERROR_TRUNCATED, ""
+		},
+		{
+			"GET /a HTTP/1.1\r\n\r\n"
+			"GET /b HTTP/1.1\r\nHost example.org\r\n\r\n",
+			256, HTTPMESSAGE_ERROR_SYNTAX, "GET /a 0|"
+		}
+	};
+	
+	for (t = 0; t < sizeof(tests) / sizeof(connection_error_test); ++t)
+	{
+		httpmessage_connection connection;
+		char log[256];
+		ssize_t result;
+		
+		httpmessage_connection_init(&connection, 16, tests[t].max_buffer_size, 4, 0);
+		result = connection_run(&connection, tests[t].text, 4096, log, sizeof(log));
+		
+		if (result != tests[t].result || strcmp(log, tests[t].expected) != 0)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s, %s\n", "ERROR", (int)t,
+			        (int)result, httpmessage_result_get_text((int)result), log);
+			++exit_code;
+		}
+		
+		httpmessage_connection_clear(&connection);
+	}
+	
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "pipeline", test_connection_pipeline },
+		{ "keep_alive", test_connection_keep_alive },
+		{ "errors", test_connection_errors }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
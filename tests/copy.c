@@ -0,0 +1,635 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+int test_clone_compact(int argc, const char **argv);
+int test_clone_trailer(int argc, const char **argv);
+int test_rebase(int argc, const char **argv);
+int test_serialize(int argc, const char **argv);
+
+static int message_references(const httpmessage_message *message,
+                              const char *begin, const char *end)
+{
+	const httpmessage_headerfield *field = &message->field_list;
+	
+	while (field && field->name.length)
+	{
+		const httpmessage_headerfield_value *value = &field->value;
+		
+		if (field->name.text >= begin && field->name.text < end)
+		{
+			return 1;
+		}
+		
+		while (value && value->line.length)
+		{
+			if (value->line.text >= begin && value->line.text < end)
+			{
+				return 1;
+			}
+			
+			value = value->next_line;
+		}
+		
+		field = field->next_field;
+	}
+	
+	return (message->body.length
+	        && message->body.text >= begin && message->body.text < end);
+}
+
+static void clone_free(void *clone)
+{
+	if (clone && ((httpmessage_message *)clone)->type == HTTPMESSAGE_TYPE_REQUEST)
+	{
+		httpmessage_request *request = (httpmessage_request *)clone;
+		httpmessage_request_storage_free(&request);
+	}
+	else
+	{
+		httpmessage_response *response = (httpmessage_response *)clone;
+		httpmessage_response_storage_free(&response);
+	}
+}
+
+static int compare_messages(const httpmessage_message *a,
+                            const httpmessage_message *b,
+                            int option_flags)
+{
+	const httpmessage_headerfield *fa = &a->field_list;
+	const httpmessage_headerfield *fb = &b->field_list;
+	
+	if (a->major_version != b->major_version
+	        || a->minor_version != b->minor_version
+	        || httpmessage_headerfield_count(fa) != httpmessage_headerfield_count(fb))
+	{
+		return 1;
+	}
+	
+	while (fa && fa->name.length)
+	{
+		char va[256];
+		char vb[256];
+		
+		if (httpmessage_stringview_compare(&fa->name, &fb->name) != 0
+		        || httpmessage_headerfield_value_merge_lines(va, sizeof(va), &fa->value) < 0
+		        || httpmessage_headerfield_value_merge_lines(vb, sizeof(vb), &fb->value) < 0
+		        || strcmp(va, vb) != 0)
+		{
+			return 1;
+		}
+		
+		fa = fa->next_field;
+		fb = fb->next_field;
+	}
+	
+	if (option_flags & HTTPMESSAGE_CLONE_NO_BODY)
+	{
+		return (b->body.length != 0);
+	}
+	
+	if (a->body.length != b->body.length)
+	{
+		return 1;
+	}
+	
+	return (a->body.length
+	        && memcmp(a->body.text, b->body.text, a->body.length) != 0);
+}
+
+int test_clone_compact(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t a;
+	int option_flags;
+	
+	static const char *files[] =
+	{
+		"tests/data/get-hello.request",
+		"tests/data/get-lucky.request",
+		"tests/data/get-slash.response",
+		"tests/data/head-slash.response"
+	};
+	
+	for (a = 0; a < (sizeof(files) / sizeof(const char *)); ++a)
+	{
+		for (option_flags = 0; option_flags <= HTTPMESSAGE_CLONE_NO_BODY;
+		        option_flags += HTTPMESSAGE_CLONE_NO_BODY)
+		{
+			char text[4096];
+			size_t text_length;
+			ssize_t result;
+			httpmessage_request request;
+			httpmessage_response response;
+			const httpmessage_message *message;
+			const httpmessage_message *clone_message;
+			void *clone;
+			size_t clone_size;
+			int errors = 0;
+			FILE *file = fopen(files[a], "rb");
+			
+			fprintf(stdout, "-- %s %s ----------------------------------------\n",
+			        files[a], (option_flags ? "no body" : "body"));
+			        
+			if (!file)
+			{
+				fprintf(stderr, "warning: %s not found.\n", files[a]);
+				break;
+			}
+			
+			text_length = fread(text, 1, sizeof(text), file);
+			fclose(file);
+			
+			httpmessage_request_init(&request);
+			httpmessage_response_init(&response);
+			
+			if (httpmessage_message_get_type(text, text_length, 0) == HTTPMESSAGE_TYPE_REQUEST)
+			{
+				httpmessage_request *r;
+				result = httpmessage_request_consume(&request, text, text_length, 0);
+				message = &request.message;
+				r = httpmessage_request_clone_compact(&request, option_flags);
+				clone_size = httpmessage_request_clone_compact_size(&request, option_flags);
+				clone = r;
+				
+				if (r && (httpmessage_stringview_compare(&r->method, &request.method) != 0
+				          || httpmessage_stringview_compare(&r->request_uri, &request.request_uri) != 0))
+				{
+					fprintf(stderr, "%15.15s: request line differs\n", "CLONE");
+					++errors;
+				}
+			}
+			else
+			{
+				httpmessage_response *r;
+				result = httpmessage_response_consume(&response, text, text_length, 0);
+				message = &response.message;
+				r = httpmessage_response_clone_compact(&response, option_flags);
+				clone_size = httpmessage_response_clone_compact_size(&response, option_flags);
+				clone = r;
+				
+				if (r && (r->status_code != response.status_code
+				          || httpmessage_stringview_compare(&r->reason_phrase, &response.reason_phrase) != 0))
+				{
+					fprintf(stderr, "%15.15s: status line differs\n", "CLONE");
+					++errors;
+				}
+			}
+			
+			if (result <= 0 || !clone)
+			{
+				fprintf(stderr, "%15.15s: %d %s\n", "RESULT",
+				        (int)result, httpmessage_result_get_text((int)result));
+				++exit_code;
+				httpmessage_request_clear(&request, 0);
+				httpmessage_response_clear(&response, 0);
+				clone_free(clone);
+				continue;
+			}
+			
+			clone_message = (const httpmessage_message *)clone;
+			
+			fprintf(stdout, "%15.15s: %d bytes for %d bytes of input\n", "SIZE",
+			        (int)clone_size, (int)result);
+			        
+			if (compare_messages(message, clone_message, option_flags) != 0)
+			{
+				fprintf(stderr, "%15.15s: copy differs\n", "CLONE");
+				++errors;
+			}
+			
+			/* The copy must not reference the input text */
+			memset(text, 'x', sizeof(text));
+			
+			if (message_references(clone_message, text, text + sizeof(text))
+			        || !message_references(clone_message, (const char *)clone,
+			                               (const char *)clone + clone_size))
+			{
+				fprintf(stderr, "%15.15s: copy references input text\n", "CLONE");
+				++errors;
+			}
+			
+			/* Clearing the copy keeps its nodes */
+			httpmessage_message_clear((httpmessage_message *)clone, 0);
+			
+			exit_code += errors;
+			httpmessage_request_clear(&request, 0);
+			httpmessage_response_clear(&response, 0);
+			clone_free(clone);
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_clone_trailer(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	int merge;
+	
+	static const char *text =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "5\r\nhello\r\n"
+	    "0\r\n"
+	    "X-Checksum: 1234\r\n"
+	    "X-Folded: first\r\n"
+	    " second\r\n"
+	    "\r\n";
+	    
+	for (merge = 0; merge <= 1; ++merge)
+	{
+		httpmessage_response response;
+		httpmessage_response *clone;
+		httpmessage_headerfield *field;
+		httpmessage_headerfield *trailer = NULL;
+		size_t length = strlen(text);
+		size_t clone_size;
+		ssize_t result;
+		
+		httpmessage_response_init(&response);
+		result = httpmessage_response_consume(&response, text, length,
+		                                      merge ? HTTPMESSAGE_CONSUME_MERGE_TRAILER : 0);
+		clone = httpmessage_response_clone_compact(&response, 0);
+		clone_size = httpmessage_response_clone_compact_size(&response, 0);
+		
+		if (!clone)
+		{
+			fprintf(stderr, "%15.15s: merge %d: %d %s\n", "RESULT", merge,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+			httpmessage_response_clear(&response, 0);
+			continue;
+		}
+		
+		field = httpmessage_headerfield_find(&clone->message.field_list, "X-Checksum", 10);
+		
+		if (clone->message.trailer_list)
+		{
+			trailer = httpmessage_headerfield_find(clone->message.trailer_list,
+			                                       "X-Folded", 8);
+		}
+		
+		if (result != (ssize_t)length
+		        || clone->message.trailer_merged != merge
+		        || !trailer
+		        || (merge ? (field != clone->message.trailer_list) : (field != NULL))
+		        || httpmessage_headerfield_count(clone->message.trailer_list) != 2
+		        || !trailer->value.next_line
+		        || httpmessage_stringview_compare_text(&trailer->value.next_line->line,
+		                "second", 6) != 0
+		        || compare_messages(&response.message, &clone->message, 0) != 0
+		        || (const char *)trailer->name.text < (const char *)clone
+		        || (const char *)trailer->name.text >= ((const char *)clone + clone_size))
+		{
+			fprintf(stderr, "%15.15s: merge %d: trailer differs\n", "CLONE", merge);
+			++exit_code;
+		}
+		
+		httpmessage_response_clear(&response, 0);
+		httpmessage_response_storage_free(&clone);
+	}
+	
+	return exit_code;
+}
+
+int test_rebase(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	char buffer[512];
+	httpmessage_request request;
+	httpmessage_request expected;
+	httpmessage_response response;
+	httpmessage_response expected_response;
+	size_t length;
+	size_t count;
+	ssize_t result;
+	
+	static const char *prefix = "previous message";
+	static const char *text =
+	    "GET /lucky HTTP/1.1\r\n"
+	    "Content-Type: text/plain\r\n"
+	    "X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+	    " I'm a long long way from home.\r\n"
+	    "Content-Length: 11\r\n"
+	    "\r\n"
+	    "Hello world";
+	static const char *response_text =
+	    "HTTP/1.1 404 Not Found\r\n"
+	    "Server: rebase\r\n"
+	    "\r\n";
+	static const char *trailer_text =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "5\r\nhello\r\n"
+	    "0\r\n"
+	    "X-Checksum: 1234\r\n"
+	    "X-Signature: abcd\r\n"
+	    "\r\n";
+	    
+	httpmessage_request_init(&request);
+	httpmessage_request_init(&expected);
+	httpmessage_response_init(&response);
+	httpmessage_response_init(&expected_response);
+	
+	/* Parse after a processed message, then compact the buffer */
+	length = strlen(text);
+	memcpy(buffer, prefix, strlen(prefix));
+	memcpy(buffer + strlen(prefix), text, length);
+	result = httpmessage_request_consume(&request, buffer + strlen(prefix), length, 0);
+	
+	if (result != (ssize_t)length
+	        || httpmessage_message_append_header(&request.message, "X-Static", "value", 0)
+	        != HTTPMESSAGE_OK)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "RESULT",
+		        (int)result, httpmessage_result_get_text((int)result));
+		return ++exit_code;
+	}
+	
+	memmove(buffer, buffer + strlen(prefix), length);
+	memset(buffer + length, 'x', strlen(prefix));
+	count = httpmessage_request_rebase(&request, buffer + strlen(prefix), length, buffer);
+	
+	httpmessage_request_consume(&expected, buffer, length, 0);
+	httpmessage_message_append_header(&expected.message, "X-Static", "value", 0);
+	
+	/* method, URI, 3 names, 4 value lines, body */
+	if (count != 10
+	        || httpmessage_stringview_compare(&request.method, &expected.method) != 0
+	        || httpmessage_stringview_compare(&request.request_uri, &expected.request_uri) != 0
+	        || compare_messages(&request.message, &expected.message, 0) != 0
+	        || message_references(&request.message, buffer + length, buffer + sizeof(buffer)))
+	{
+		fprintf(stderr, "%15.15s: %d views moved\n", "REQUEST", (int)count);
+		++exit_code;
+	}
+	
+	/* Shift by an offset */
+	length = strlen(response_text);
+	memcpy(buffer, response_text, length);
+	httpmessage_response_consume(&response, buffer, length, 0);
+	memmove(buffer + 100, buffer, length);
+	count = httpmessage_response_rebase(&response, buffer, sizeof(buffer), buffer + 100);
+	httpmessage_response_consume(&expected_response, buffer + 100, length, 0);
+	
+	if (count != 3
+	        || httpmessage_stringview_compare(&response.reason_phrase,
+	                &expected_response.reason_phrase) != 0
+	        || response.reason_phrase.text != expected_response.reason_phrase.text
+	        || compare_messages(&response.message, &expected_response.message, 0) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d views moved\n", "RESPONSE", (int)count);
+		++exit_code;
+	}
+	
+	/* Trailer fields that are not merged */
+	length = strlen(trailer_text);
+	memcpy(buffer, trailer_text, length);
+	httpmessage_response_consume(&response, buffer, length, 0);
+	memmove(buffer + 100, buffer, length);
+	count = httpmessage_response_rebase(&response, buffer, sizeof(buffer), buffer + 100);
+	
+	/* reason phrase, 1 name, 1 value line, 2 trailer names, 2 trailer value lines, body */
+	if (count != 8
+	        || !response.message.trailer_list
+	        || response.message.trailer_list->name.text != (buffer + 100 + 60)
+	        || httpmessage_stringview_compare_text(&response.message.trailer_list->value.line,
+	                "1234", 4) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d views moved\n", "TRAILER", (int)count);
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	httpmessage_request_clear(&expected, 0);
+	httpmessage_response_clear(&response, 0);
+	httpmessage_response_clear(&expected_response, 0);
+	return exit_code;
+}
+
+int test_serialize(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	uint32_t descriptor[128];
+	uint32_t slot[128];
+	char slot_text[512];
+	httpmessage_request request;
+	httpmessage_request copy;
+	httpmessage_response response;
+	httpmessage_response response_copy;
+	httpmessage_serialized_view view;
+	const httpmessage_serialized_headerfield *field;
+	httpmessage_stringview line;
+	size_t length;
+	ssize_t size;
+	
+	static const char *text =
+	    "GET /lucky HTTP/1.1\r\n"
+	    "Content-Type: text/plain\r\n"
+	    "X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+	    " I'm a long long way from home.\r\n"
+	    "Content-Length: 11\r\n"
+	    "\r\n"
+	    "Hello world";
+	static const char *response_text =
+	    "HTTP/1.1 404 Not Found\r\n"
+	    "Server: serialize\r\n"
+	    "\r\n";
+	static const char *trailer_text =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "5\r\nhello\r\n"
+	    "0\r\n"
+	    "X-Checksum: 1234\r\n"
+	    "X-Folded: first\r\n"
+	    " second\r\n"
+	    "\r\n";
+	int merge;
+	    
+	httpmessage_request_init(&request);
+	httpmessage_request_init(&copy);
+	httpmessage_response_init(&response);
+	httpmessage_response_init(&response_copy);
+	
+	length = strlen(text);
+	httpmessage_request_consume(&request, text, length, 0);
+	size = httpmessage_request_serialize(descriptor, sizeof(descriptor), &request, text, length);
+	
+	if (size <= 0 || (size_t)size != httpmessage_request_serialized_size(&request))
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "SERIALIZE",
+		        (int)size, httpmessage_result_get_text((int)size));
+		return ++exit_code;
+	}
+	
+	if (httpmessage_request_serialize(descriptor, (size_t)size - 1, &request, text, length)
+	        != HTTPMESSAGE_ERROR_OVERFLOW
+	        || httpmessage_request_serialize(descriptor, sizeof(descriptor), &request, text, 10)
+	        != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		fprintf(stderr, "%15.15s: invalid input accepted\n", "SERIALIZE");
+		++exit_code;
+	}
+	
+	/* Move descriptor and text to another location, as another process would see them */
+	memcpy(slot, descriptor, (size_t)size);
+	memcpy(slot_text, text, length);
+	memset(descriptor, 0, sizeof(descriptor));
+	
+	if (httpmessage_serialized_view_init(&view, slot, (size_t)size, slot_text, length)
+	        != HTTPMESSAGE_OK)
+	{
+		fprintf(stderr, "%15.15s: invalid descriptor\n", "VIEW");
+		return ++exit_code;
+	}
+	
+	field = httpmessage_serialized_view_find_headerfield(&view, "x-lyrics", 8);
+	
+	if (!field || field->line_count != 2
+	        || httpmessage_serialized_view_get_value_line(&line, &view, field, 1) != HTTPMESSAGE_OK
+	        || httpmessage_stringview_compare_text(&line, "I'm a long long way from home.", 30) != 0
+	        || httpmessage_serialized_view_get_value_line(&line, &view, field, 2) == HTTPMESSAGE_OK
+	        || httpmessage_serialized_view_find_headerfield(&view, "Server", 6))
+	{
+		fprintf(stderr, "%15.15s: unexpected header field\n", "VIEW");
+		++exit_code;
+	}
+	
+	if (httpmessage_response_deserialize(&response_copy, &view, 0) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+	        || httpmessage_request_deserialize(&copy, &view, 0) != HTTPMESSAGE_OK
+	        || httpmessage_stringview_compare(&copy.method, &request.method) != 0
+	        || httpmessage_stringview_compare(&copy.request_uri, &request.request_uri) != 0
+	        || compare_messages(&request.message, &copy.message, 0) != 0
+	        || message_references(&copy.message, text, text + length)
+	        || !message_references(&copy.message, slot_text, slot_text + length))
+	{
+		fprintf(stderr, "%15.15s: request differs\n", "DESERIALIZE");
+		++exit_code;
+	}
+	
+	/* Corrupted descriptors */
+	slot[0] = 0;
+	
+	if (httpmessage_serialized_view_init(&view, slot, (size_t)size, slot_text, length)
+	        != HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+	        || httpmessage_serialized_view_init(&view, descriptor, (size_t)size, slot_text, length)
+	        != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		fprintf(stderr, "%15.15s: invalid descriptor accepted\n", "VIEW");
+		++exit_code;
+	}
+	
+	/* Response */
+	length = strlen(response_text);
+	httpmessage_response_consume(&response, response_text, length, 0);
+	size = httpmessage_response_serialize(descriptor, sizeof(descriptor),
+	                                      &response, response_text, length);
+	                                      
+	if (size <= 0
+	        || httpmessage_serialized_view_init(&view, descriptor, (size_t)size,
+	                response_text, length) != HTTPMESSAGE_OK
+	        || httpmessage_serialized_view_init(&view, descriptor, (size_t)size,
+	                response_text, length - 3) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT
+	        || httpmessage_serialized_view_init(&view, descriptor, (size_t)size,
+	                response_text, length) != HTTPMESSAGE_OK
+	        || httpmessage_response_deserialize(&response_copy, &view, 0) != HTTPMESSAGE_OK
+	        || response_copy.status_code != 404
+	        || httpmessage_stringview_compare(&response_copy.reason_phrase,
+	                &response.reason_phrase) != 0
+	        || compare_messages(&response.message, &response_copy.message, 0) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "RESPONSE",
+		        (int)size, httpmessage_result_get_text((int)size));
+		++exit_code;
+	}
+	
+	/* Trailer fields */
+	length = strlen(trailer_text);
+	
+	for (merge = 0; merge <= 1; ++merge)
+	{
+		httpmessage_headerfield *trailer = NULL;
+		
+		httpmessage_response_consume(&response, trailer_text, length,
+		                             merge ? HTTPMESSAGE_CONSUME_MERGE_TRAILER : 0);
+		size = httpmessage_response_serialize(descriptor, sizeof(descriptor),
+		                                      &response, trailer_text, length);
+		                                      
+		if (size <= 0
+		        || (size_t)size != httpmessage_response_serialized_size(&response)
+		        || httpmessage_serialized_view_init(&view, descriptor, (size_t)size,
+		                trailer_text, length) != HTTPMESSAGE_OK
+		        || view.message->headerfield_count != 3
+		        || view.message->trailer_count != 2
+		        || (httpmessage_serialized_view_find_headerfield(&view, "X-Checksum", 10)
+		            != NULL) != merge
+		        || httpmessage_response_deserialize(&response_copy, &view, 0) != HTTPMESSAGE_OK)
+		{
+			fprintf(stderr, "%15.15s: merge %d: %d %s\n", "TRAILER", merge,
+			        (int)size, httpmessage_result_get_text((int)size));
+			++exit_code;
+			continue;
+		}
+		
+		if (response_copy.message.trailer_list)
+		{
+			trailer = httpmessage_headerfield_find(response_copy.message.trailer_list,
+			                                       "X-Folded", 8);
+		}
+		
+		if (response_copy.message.trailer_merged != merge
+		        || !trailer
+		        || !trailer->value.next_line
+		        || httpmessage_stringview_compare_text(&trailer->value.next_line->line,
+		                "second", 6) != 0
+		        || httpmessage_headerfield_count(response_copy.message.trailer_list) != 2
+		        || compare_messages(&response.message, &response_copy.message, 0) != 0)
+		{
+			fprintf(stderr, "%15.15s: merge %d: trailer differs\n", "TRAILER", merge);
+			++exit_code;
+		}
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	httpmessage_request_clear(&copy, 0);
+	httpmessage_response_clear(&response, 0);
+	httpmessage_response_clear(&response_copy, 0);
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "clone_compact", test_clone_compact },
+		{ "clone_trailer", test_clone_trailer },
+		{ "rebase", test_rebase },
+		{ "serialize", test_serialize }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
@@ -0,0 +1,629 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+int test_arena(int argc, const char **argv);
+int test_arena_message(int argc, const char **argv);
+int test_arena_shared(int argc, const char **argv);
+int test_hugepage(int argc, const char **argv);
+int test_budget(int argc, const char **argv);
+int test_heap_counters(int argc, const char **argv);
+
+int test_arena(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_arena arena;
+	httpmessage_arena_chunk *first_chunk;
+	size_t a;
+	char *p;
+	char *q;
+	
+	httpmessage_arena_init(&arena, 64);
+	
+	if (httpmessage_arena_chunk_count(&arena) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d, expect 0\n", "CHUNKS",
+		        (int)httpmessage_arena_chunk_count(&arena));
+		++exit_code;
+	}
+	
+	p = (char *)httpmessage_arena_allocate(&arena, 3);
+	q = (char *)httpmessage_arena_allocate(&arena, 5);
+	
+	if (!(p && q))
+	{
+		fprintf(stderr, "%15.15s: failed\n", "ALLOCATE");
+		return ++exit_code;
+	}
+	
+	if (((size_t)p % HTTPMESSAGE_MEMORY_ALIGNMENT)
+	        || ((size_t)q % HTTPMESSAGE_MEMORY_ALIGNMENT))
+	{
+		fprintf(stderr, "%15.15s: %p %p\n", "ALIGNMENT", (void *)p, (void *)q);
+		++exit_code;
+	}
+	
+	if ((size_t)(q - p) != HTTPMESSAGE_MEMORY_ALIGN(3))
+	{
+		fprintf(stderr, "%15.15s: %d, expect %d\n", "OFFSET",
+		        (int)(q - p), (int)HTTPMESSAGE_MEMORY_ALIGN(3));
+		++exit_code;
+	}
+	
+	/* Overflow first chunk, then oversized block */
+	for (a = 0; a < 8; ++a)
+	{
+		memset(httpmessage_arena_allocate(&arena, 16), 0, 16);
+	}
+	
+	memset(httpmessage_arena_allocate(&arena, 1000), 0, 1000);
+	
+	if (httpmessage_arena_chunk_count(&arena) != 4)
+	{
+		fprintf(stderr, "%15.15s: %d, expect 4\n", "CHUNKS",
+		        (int)httpmessage_arena_chunk_count(&arena));
+		++exit_code;
+	}
+	
+	first_chunk = arena.first_chunk;
+	httpmessage_arena_reset(&arena);
+	
+	/* Same allocation sequence reuse existing chunks */
+	if (httpmessage_arena_allocate(&arena, 3) != p)
+	{
+		fprintf(stderr, "%15.15s: first chunk not reused\n", "RESET");
+		++exit_code;
+	}
+	
+	httpmessage_arena_allocate(&arena, 5);
+	
+	for (a = 0; a < 8; ++a)
+	{
+		httpmessage_arena_allocate(&arena, 16);
+	}
+	
+	httpmessage_arena_allocate(&arena, 1000);
+	
+	if (httpmessage_arena_chunk_count(&arena) != 4
+	        || arena.first_chunk != first_chunk)
+	{
+		fprintf(stderr, "%15.15s: %d, expect 4\n", "REUSED CHUNKS",
+		        (int)httpmessage_arena_chunk_count(&arena));
+		++exit_code;
+	}
+	
+	httpmessage_arena_clear(&arena);
+	
+	if (arena.first_chunk || httpmessage_arena_chunk_count(&arena))
+	{
+		fprintf(stderr, "%15.15s: chunks not released\n", "CLEAR");
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_arena_message(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request *request = httpmessage_request_arena_new(256);
+	httpmessage_arena *arena = (httpmessage_arena *)request->message.allocator;
+	httpmessage_arena_chunk *first_chunk = NULL;
+	size_t chunk_count = 0;
+	int pass;
+	
+	static const char *text =
+	    "GET /keep-alive HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Connection: keep-alive\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "Accept-Language: fr\r\n"
+	    "Cache-Control: no-cache\r\n"
+	    "\r\n";
+	    
+	for (pass = 0; pass < 4; ++pass)
+	{
+		ssize_t result;
+		char value[128];
+		httpmessage_headerfield *field;
+		
+		fprintf(stdout, "-- pass %d ----------------------------------------\n", pass);
+		
+		result = httpmessage_request_consume(request,
+		                                     text, strlen(text), 0);
+		                                     
+		if (result != (ssize_t)strlen(text))
+		{
+			fprintf(stderr, "%15.15s: %d %s, expect %d\n", "RESULT",
+			        (int)result, httpmessage_result_get_text((int)result),
+			        (int)strlen(text));
+			++exit_code;
+			break;
+		}
+		
+		if (httpmessage_headerfield_count(&request->message.field_list) != 5)
+		{
+			fprintf(stderr, "%15.15s: %d, expect 5\n", "HEADERS",
+			        (int)httpmessage_headerfield_count(&request->message.field_list));
+			++exit_code;
+		}
+		
+		field = httpmessage_headerfield_find(&request->message.field_list,
+		                                     "Accept", 6);
+		                                     
+		if (!field
+		        || httpmessage_headerfield_value_merge_lines(value, sizeof(value),
+		                &field->value) < 0
+		        || strcmp(value, "text/html, application/xhtml+xml") != 0)
+		{
+			fprintf(stderr, "%15.15s: unexpected multiline value\n", "ACCEPT");
+			++exit_code;
+		}
+		
+		if (pass == 0)
+		{
+			first_chunk = arena->first_chunk;
+			chunk_count = httpmessage_arena_chunk_count(arena);
+		}
+		else if (arena->first_chunk != first_chunk
+		         || httpmessage_arena_chunk_count(arena) != chunk_count)
+		{
+			fprintf(stderr, "%15.15s: arena grew on pass %d\n", "CHUNKS", pass);
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(request, 0);
+		
+		if (request->message.field_list.next_field
+		        || arena->current_chunk)
+		{
+			fprintf(stderr, "%15.15s: arena not rewound\n", "CLEAR");
+			++exit_code;
+		}
+	}
+	
+	httpmessage_request_free(&request);
+	return exit_code;
+}
+
+int test_arena_shared(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_arena arena;
+	httpmessage_request requests[2];
+	size_t r;
+	
+	static const char *text =
+	    "GET /shared HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "Accept-Language: fr\r\n"
+	    "\r\n";
+	    
+	httpmessage_arena_init(&arena, 0);
+	
+	for (r = 0; r < 2; ++r)
+	{
+		httpmessage_request_init(&requests[r]);
+		requests[r].message.allocator = &arena.allocator;
+		requests[r].message.allocator_shared = 1;
+		
+		if (httpmessage_request_consume(&requests[r], text, strlen(text), 0)
+		        != (ssize_t)strlen(text))
+		{
+			fprintf(stderr, "%15.15s: request %d\n", "RESULT", (int)r);
+			++exit_code;
+		}
+	}
+	
+	/* Clearing a message keeps the nodes of the other one */
+	httpmessage_request_clear(&requests[0], 0);
+	
+	if (requests[0].message.field_list.next_field
+	        || !arena.current_chunk
+	        || httpmessage_headerfield_count(&requests[1].message.field_list) != 3
+	        || !httpmessage_headerfield_find(&requests[1].message.field_list,
+	                                         "Accept-Language", 15))
+	{
+		fprintf(stderr, "%15.15s: arena reset by a message\n", "SHARED");
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&requests[1], HTTPMESSAGE_CLEAR_NO_FREE);
+	
+	if (requests[1].message.field_list.next_field || !arena.current_chunk)
+	{
+		fprintf(stderr, "%15.15s: nodes kept after clear\n", "SHARED");
+		++exit_code;
+	}
+	
+	httpmessage_arena_clear(&arena);
+	return exit_code;
+}
+
+int test_hugepage(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_hugepage_allocator allocator;
+	httpmessage_request *requests[1024];
+	size_t block_size = httpmessage_request_storage_size(32, 2);
+	size_t block_per_region;
+	size_t region_count;
+	size_t a;
+	int s;
+	
+	static const int strategies[] =
+	{
+		HTTPMESSAGE_HUGEPAGE_ANY,
+		HTTPMESSAGE_HUGEPAGE_FALLBACK
+	};
+	
+	static const char *text =
+	    "GET /hugepage HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "\r\n";
+	    
+	for (s = 0; s < (int)(sizeof(strategies) / sizeof(int)); ++s)
+	{
+		fprintf(stdout, "-- strategies 0x%x ----------------------------------\n",
+		        strategies[s]);
+		        
+		httpmessage_hugepage_allocator_init(&allocator, block_size, strategies[s]);
+		block_per_region = (HTTPMESSAGE_HUGEPAGE_SIZE - HTTPMESSAGE_MEMORY_ALIGN(
+		                        sizeof(httpmessage_hugepage_region))) / allocator.block_size;
+		                        
+		if (httpmessage_hugepage_allocator_allocate(&allocator, allocator.block_size + 1))
+		{
+			fprintf(stderr, "%15.15s: oversized block allocated\n", "ALLOCATE");
+			++exit_code;
+		}
+		
+		for (a = 0; a < (sizeof(requests) / sizeof(httpmessage_request *)); ++a)
+		{
+			requests[a] = httpmessage_request_storage_new_with_allocator(32, 2,
+			              &allocator.allocator);
+			              
+			if (!requests[a])
+			{
+				fprintf(stderr, "%15.15s: request %d\n", "ALLOCATE", (int)a);
+				++exit_code;
+				break;
+			}
+		}
+		
+		if (a < (sizeof(requests) / sizeof(httpmessage_request *)))
+		{
+			httpmessage_hugepage_allocator_clear(&allocator);
+			continue;
+		}
+		
+		region_count = httpmessage_hugepage_allocator_region_count(&allocator,
+		               HTTPMESSAGE_HUGEPAGE_ANY);
+		fprintf(stdout, "%15.15s: %d hugetlb, %d transparent, %d fallback\n", "REGIONS",
+		        (int)httpmessage_hugepage_allocator_region_count(&allocator, HTTPMESSAGE_HUGEPAGE_HUGETLB),
+		        (int)httpmessage_hugepage_allocator_region_count(&allocator, HTTPMESSAGE_HUGEPAGE_TRANSPARENT),
+		        (int)httpmessage_hugepage_allocator_region_count(&allocator, HTTPMESSAGE_HUGEPAGE_FALLBACK));
+		        
+		if (region_count != (a + block_per_region - 1) / block_per_region
+		        || ((strategies[s] == HTTPMESSAGE_HUGEPAGE_FALLBACK)
+		            && httpmessage_hugepage_allocator_region_count(&allocator,
+		                    HTTPMESSAGE_HUGEPAGE_FALLBACK) != region_count))
+		{
+			fprintf(stderr, "%15.15s: unexpected region count %d\n", "REGIONS",
+			        (int)region_count);
+			++exit_code;
+		}
+		
+		if (((uint8_t *)requests[1] - (uint8_t *)requests[0]) != (ptrdiff_t)allocator.block_size)
+		{
+			fprintf(stderr, "%15.15s: blocks are not contiguous\n", "ALLOCATE");
+			++exit_code;
+		}
+		
+		for (a = 0; a < (sizeof(requests) / sizeof(httpmessage_request *)); a += 100)
+		{
+			ssize_t result = httpmessage_request_consume(requests[a], text, strlen(text),
+			                 HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION);
+			                 
+			if (result != (ssize_t)strlen(text)
+			        || httpmessage_headerfield_count(&requests[a]->message.field_list) != 2)
+			{
+				fprintf(stderr, "%15.15s: request %d: %d %s\n", "RESULT", (int)a,
+				        (int)result, httpmessage_result_get_text((int)result));
+				++exit_code;
+			}
+		}
+		
+		/* Released blocks are reused first */
+		httpmessage_allocator_release(&allocator.allocator, requests[10]);
+		httpmessage_allocator_release(&allocator.allocator, requests[20]);
+		
+		if (httpmessage_hugepage_allocator_allocate(&allocator, block_size) != (void *)requests[20]
+		        || httpmessage_hugepage_allocator_allocate(&allocator, block_size) != (void *)requests[10]
+		        || httpmessage_hugepage_allocator_region_count(&allocator,
+		                HTTPMESSAGE_HUGEPAGE_ANY) != region_count)
+		{
+			fprintf(stderr, "%15.15s: released blocks not reused\n", "RELEASE");
+			++exit_code;
+		}
+		
+		httpmessage_hugepage_allocator_clear(&allocator);
+		
+		if (httpmessage_hugepage_allocator_region_count(&allocator,
+		        HTTPMESSAGE_HUGEPAGE_ANY) != 0)
+		{
+			fprintf(stderr, "%15.15s: regions not released\n", "CLEAR");
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
+int test_budget(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_budget budget;
+	httpmessage_arena arena;
+	httpmessage_request request;
+	size_t node_size = HTTPMESSAGE_BUDGET_BLOCK_HEADER_SIZE + sizeof(httpmessage_headerfield);
+	size_t length;
+	ssize_t result;
+	int pass;
+	
+	static const char *text =
+	    "GET /budget HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Connection: keep-alive\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "Accept-Language: fr\r\n"
+	    "Cache-Control: no-cache\r\n"
+	    "\r\n";
+	    
+	length = strlen(text);
+	
+	/* Not enough for the 4 additional header fields and the continuation line */
+	httpmessage_budget_init(&budget, 3 * node_size, NULL);
+	httpmessage_request_init(&request);
+	request.message.allocator = &budget.allocator;
+	result = httpmessage_request_consume(&request, text, length, 0);
+	
+	if (result != HTTPMESSAGE_ERROR_BUDGET
+	        || budget.refusal_count != 1
+	        || budget.used > budget.limit)
+	{
+		fprintf(stderr, "%15.15s: %d %s, expect %s\n", "RESULT",
+		        (int)result, httpmessage_result_get_text((int)result),
+		        httpmessage_result_get_text(HTTPMESSAGE_ERROR_BUDGET));
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	
+	if (budget.used != 0)
+	{
+		fprintf(stderr, "%15.15s: %d bytes still charged\n", "CLEAR", (int)budget.used);
+		++exit_code;
+	}
+	
+	/* Enough budget */
+	budget.limit = 8 * node_size;
+	result = httpmessage_request_consume(&request, text, length, 0);
+	
+	if (result != (ssize_t)length
+	        || budget.exceeded
+	        || budget.used != budget.peak
+	        || httpmessage_allocator_get_error(&budget.allocator) != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: %d %s, %d bytes used\n", "RESULT",
+		        (int)result, httpmessage_result_get_text((int)result), (int)budget.used);
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	
+	/* Budget over an arena, with the prescan mode */
+	httpmessage_arena_init(&arena, 0);
+	httpmessage_budget_init(&budget, 2 * HTTPMESSAGE_ARENA_CHUNK_SIZE, &arena.allocator);
+	request.message.allocator = &budget.allocator;
+	
+	if (budget.allocator.release || !budget.allocator.reset)
+	{
+		fprintf(stderr, "%15.15s: does not match the arena interface\n", "BUDGET");
+		++exit_code;
+	}
+	
+	for (pass = 0; pass < 4; ++pass)
+	{
+		result = httpmessage_request_consume(&request, text, length,
+		                                     HTTPMESSAGE_CONSUME_PRESCAN);
+		                                     
+		if (result != (ssize_t)length || budget.used == 0)
+		{
+			fprintf(stderr, "%15.15s: pass %d: %d %s\n", "ARENA", pass,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(&request, 0);
+		
+		if (budget.used != 0)
+		{
+			fprintf(stderr, "%15.15s: pass %d: budget not credited\n", "ARENA", pass);
+			++exit_code;
+		}
+	}
+	
+	/* Oversized request */
+	if (httpmessage_budget_allocate(&budget, 2 * HTTPMESSAGE_ARENA_CHUNK_SIZE)
+	        || httpmessage_allocator_get_error(&budget.allocator) != HTTPMESSAGE_ERROR_BUDGET)
+	{
+		fprintf(stderr, "%15.15s: oversized block accepted\n", "BUDGET");
+		++exit_code;
+	}
+	
+	httpmessage_arena_clear(&arena);
+	return exit_code;
+}
+
+/* Input function giving the whole text once */
+static ssize_t heap_counters_input(void *user_data, char *buffer, size_t size)
+{
+	const char **text = (const char **)user_data;
+	size_t length = strlen(*text);
+	
+	if (length > size)
+	{
+		length = size;
+	}
+	
+	memcpy(buffer, *text, length);
+	*text += length;
+	return (ssize_t)length;
+}
+
+int test_heap_counters(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_allocation_counters before;
+	httpmessage_allocation_counters after;
+	httpmessage_request *request;
+	httpmessage_request *clone;
+	httpmessage_response *response;
+	httpmessage_pool *pool;
+	httpmessage_connection connection;
+	httpmessage_capture_range range;
+	httpmessage_stringview *string;
+	httpmessage_headerfield_value *value;
+	const char *input;
+	size_t length;
+	
+	static const char *text =
+	    "POST /counters HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "Accept-Language: fr\r\n"
+	    "Content-Length: 5\r\n"
+	    "\r\n"
+	    "hello";
+	    
+	length = strlen(text);
+	httpmessage_allocation_counters_get(&before);
+	
+	request = httpmessage_request_new();
+	httpmessage_request_consume(request, text, length, 0);
+	httpmessage_message_append_header_copy(&request->message, "X-Copy", "value", 0);
+	httpmessage_request_free(&request);
+	
+	response = httpmessage_response_new();
+	httpmessage_response_free(&response);
+	
+	request = httpmessage_request_arena_new(0);
+	httpmessage_request_consume(request, text, length, 0);
+	httpmessage_request_free(&request);
+	
+	/* Overflow nodes and string block of the storage */
+	request = httpmessage_request_storage_new(2, 1);
+	httpmessage_request_consume(request, text, length, HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_message_append_header_copy(&request->message, "X-Copy", "value",
+	                                       HTTPMESSAGE_CLEAR_NO_FREE);
+	clone = httpmessage_request_clone_compact(request, 0);
+	httpmessage_request_storage_free(&request);
+	httpmessage_request_storage_free(&clone);
+	
+	pool = httpmessage_pool_new(HTTPMESSAGE_TYPE_REQUEST, 4, 1, 1);
+	request = httpmessage_pool_acquire_request(pool);
+	clone = httpmessage_pool_acquire_request(pool);
+	httpmessage_pool_release_request(pool, request);
+	httpmessage_pool_release_request(pool, clone);
+	httpmessage_pool_free(&pool);
+	
+	/* Input buffer growth */
+	httpmessage_connection_init(&connection, 16, 1024, 4, 0);
+	input = text;
+	
+	while (httpmessage_connection_next_request(&connection, &request)
+	        == HTTPMESSAGE_ERROR_INCOMPLETE
+	        && httpmessage_connection_read(&connection, heap_counters_input, &input) > 0)
+	{
+	}
+	
+	/* String block kept by the connection request */
+	httpmessage_message_append_header_copy(&connection.request->message,
+	                                       "X-Copy", "value", HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_connection_release(&connection);
+	httpmessage_connection_clear(&connection);
+	
+	httpmessage_capture_range_init(&range, text, length, 0, length, 4, 0);
+	httpmessage_capture_range_frame(&range);
+	httpmessage_message_append_header_copy(&range.request->message,
+	                                       "X-Copy", "value", HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_message_append_header_copy(&range.response->message,
+	                                       "X-Copy", "value", HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_capture_range_clear(&range);
+	
+	string = httpmessage_stringview_new();
+	httpmessage_stringview_free(&string);
+	value = httpmessage_headerfield_value_new();
+	httpmessage_headerfield_value_append_line(value, "line", 4);
+	httpmessage_headerfield_value_free(&value);
+	
+	httpmessage_allocation_counters_get(&after);
+	
+	if ((after.allocation_count - before.allocation_count) < 10
+	        || (after.allocation_count - before.allocation_count)
+	        != (after.release_count - before.release_count))
+	{
+		fprintf(stderr, "%15.15s: %d allocations, %d releases\n", "BALANCE",
+		        (int)(after.allocation_count - before.allocation_count),
+		        (int)(after.release_count - before.release_count));
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "arena", test_arena },
+		{ "arena_message", test_arena_message },
+		{ "arena_shared", test_arena_shared },
+		{ "hugepage", test_hugepage },
+		{ "budget", test_budget },
+		{ "heap_counters", test_heap_counters }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
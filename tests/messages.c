@@ -29,7 +29,16 @@ int test_status_line(int argc, const char **argv);
 int test_line_type(int argc, const char **argv);
 int test_first_line(int argc, const char **argv);
 int test_storage(int argc, const char **argv);
+int test_storage_overflow(int argc, const char **argv);
+int test_prescan(int argc, const char **argv);
+int test_storage_declare(int argc, const char **argv);
+int test_memory_usage(int argc, const char **argv);
+int test_append_header_copy(int argc, const char **argv);
 int test_request_uri_consume(int argc, const char **argv);
+int test_header_only(int argc, const char **argv);
+int test_pipeline(int argc, const char **argv);
+int test_response_framing(int argc, const char **argv);
+int test_segments(int argc, const char **argv);
 
 int test_http_version(int argc, const char **argv)
 {
@@ -460,11 +469,12 @@ int test_storage(int argc, const char **argv)
 	
 	static const storage_test tests[] =
 	{
+		/* No Content-Length: the request does not have a body */
 		{
 			"tests/data/get-lucky.request", HTTPMESSAGE_TYPE_REQUEST,
-			8, 2, 158, 3,
+			8, 2, 136, 3,
 			"X-Lyrics", "I'm a poor lonesome cowboy. I'm a long long way from home.",
-			"This is not Daft Punk!"
+			NULL
 		},
 		/** Failed because X-Lyrics header value is multipline */
 		{
@@ -762,10 +772,8 @@ int test_storage(int argc, const char **argv)
 		}
 		
 test_storage_test_loop_end:
-		free(request);
-		request = NULL;
-		free(response);
-		response = NULL;
+		httpmessage_request_storage_free(&request);
+		httpmessage_response_storage_free(&response);
 		
 		if (file)
 		{
@@ -777,8 +785,389 @@ test_storage_test_loop_end:
 	return exit_code;
 }
 
+int test_storage_overflow(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	int pass;
+	httpmessage_arena arena;
+	
+	static const char *text =
+	    "GET /lucky HTTP/1.1\r\n"
+	    "Content-Type: text/plain\r\n"
+	    "X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+	    " I'm a long long way from home.\r\n"
+	    "Host: west.us\r\n"
+	    "Connection: keep-alive\r\n"
+	    "\r\n";
+	    
+	httpmessage_arena_init(&arena, 256);
+	
+	/* Overflow nodes from the standard C library, then from an arena */
+	for (pass = 0; pass < 4; ++pass)
+	{
+		httpmessage_request *request = httpmessage_request_storage_new(2, 1);
+		ssize_t result;
+		size_t max_headerfield_count;
+		size_t max_line_per_value;
+		char value[128];
+		httpmessage_headerfield *field;
+		
+		fprintf(stdout, "-- pass %d ----------------------------------------\n", pass);
+		
+		if (!request)
+		{
+			fprintf(stderr, "Failed to allocate storage\n");
+			return ++exit_code;
+		}
+		
+		if (pass >= 2)
+		{
+			request->message.allocator = &arena.allocator;
+		}
+		
+		result = httpmessage_request_consume(request, text, strlen(text),
+		                                     HTTPMESSAGE_CLEAR_NO_FREE);
+		                                     
+		if (result != (ssize_t)strlen(text))
+		{
+			fprintf(stderr, "%15.15s: %d %s, expect %d\n", "RESULT",
+			        (int)result, httpmessage_result_get_text((int)result),
+			        (int)strlen(text));
+			++exit_code;
+		}
+		
+		if (httpmessage_headerfield_count(&request->message.field_list) != 4)
+		{
+			fprintf(stderr, "%15.15s: %d, expect 4\n", "HEADERS",
+			        (int)httpmessage_headerfield_count(&request->message.field_list));
+			++exit_code;
+		}
+		
+		field = httpmessage_headerfield_find(&request->message.field_list,
+		                                     "X-Lyrics", 8);
+		                                     
+		if (!field
+		        || httpmessage_headerfield_value_merge_lines(value, sizeof(value),
+		                &field->value) < 0
+		        || strcmp(value, "I'm a poor lonesome cowboy. I'm a long long way from home.") != 0)
+		{
+			fprintf(stderr, "%15.15s: unexpected multiline value\n", "X-LYRICS");
+			++exit_code;
+		}
+		
+		/* Overflow nodes are detached, pre-allocated storage is kept */
+		httpmessage_request_clear(request, HTTPMESSAGE_CLEAR_NO_FREE);
+		httpmessage_message_get_storage_infos(&max_headerfield_count,
+		                                      &max_line_per_value, &request->message);
+		                                      
+		if (max_headerfield_count != 2 || max_line_per_value != 1)
+		{
+			fprintf(stderr, "%15.15s: %d/%d, expect 2/1\n", "STORAGE",
+			        (int)max_headerfield_count, (int)max_line_per_value);
+			++exit_code;
+		}
+		
+		if (pass >= 2 && arena.current_chunk)
+		{
+			fprintf(stderr, "%15.15s: arena not rewound\n", "CLEAR");
+			++exit_code;
+		}
+		
+		httpmessage_request_storage_free(&request);
+	}
+	
+	httpmessage_arena_clear(&arena);
+	return exit_code;
+}
+
 /***************************************************/
 
+typedef struct __counting_allocator
+{
+	httpmessage_allocator allocator;
+	size_t allocation_count;
+	size_t release_count;
+	size_t last_size;
+} counting_allocator;
+
+static void *counting_allocator_allocate(httpmessage_allocator *allocator,
+        size_t size)
+{
+	counting_allocator *counter = (counting_allocator *)allocator;
+	++counter->allocation_count;
+	counter->last_size = size;
+	return malloc(size);
+}
+
+static void counting_allocator_release(httpmessage_allocator *allocator,
+                                       void *memory)
+{
+	++((counting_allocator *)allocator)->release_count;
+	free(memory);
+}
+
+typedef struct __prescan_test
+{
+	const char *text;
+	size_t headerfield_count;
+	size_t allocation_count;
+	size_t allocation_size;
+} prescan_test;
+
+int test_prescan(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	counting_allocator counter;
+	httpmessage_request request;
+	size_t a;
+	
+	static const prescan_test tests[] =
+	{
+		{
+			"GET / HTTP/1.1\r\n"
+			"\r\n", 0, 0, 0
+		},
+		{
+			"GET / HTTP/1.1\r\n"
+			"Host: example.org\r\n"
+			"\r\n", 1, 0, 0
+		},
+		{
+			"GET /lucky HTTP/1.1\r\n"
+			"Content-Type: text/plain\r\n"
+			"X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+			" I'm a long long way from home.\r\n"
+			"\tAnd this long long way is my home.\r\n"
+			"Host: west.us\r\n"
+			"X-Newline: bare\nline feed\r\n"
+			"Connection: keep-alive\r\n"
+			"\r\n", 5, 1, 4 * sizeof(httpmessage_headerfield)
+			+ 2 * sizeof(httpmessage_headerfield_value)
+		}
+	};
+	
+	counter.allocator.allocate = counting_allocator_allocate;
+	counter.allocator.release = counting_allocator_release;
+	counter.allocator.reset = NULL;
+	counter.allocation_count = 0;
+	counter.release_count = 0;
+	counter.last_size = 0;
+	
+	httpmessage_request_init(&request);
+	request.message.allocator = &counter.allocator;
+	
+	for (a = 0; a < (sizeof(tests) / sizeof(prescan_test)); ++a)
+	{
+		const prescan_test *T = &tests[a];
+		size_t allocation_count = counter.allocation_count;
+		ssize_t result = httpmessage_request_consume(&request,
+		                 T->text, strlen(T->text),
+		                 HTTPMESSAGE_CONSUME_PRESCAN);
+		                 
+		fprintf(stdout, "%15.15s: %d headers, %d allocations\n", "PRESCAN",
+		        (int)httpmessage_headerfield_count(&request.message.field_list),
+		        (int)(counter.allocation_count - allocation_count));
+		        
+		if (result != (ssize_t)strlen(T->text))
+		{
+			fprintf(stderr, "%15.15s: %d %s, expect %d\n", "RESULT",
+			        (int)result, httpmessage_result_get_text((int)result),
+			        (int)strlen(T->text));
+			++exit_code;
+			continue;
+		}
+		
+		if (httpmessage_headerfield_count(&request.message.field_list) != T->headerfield_count
+		        || (counter.allocation_count - allocation_count) != T->allocation_count
+		        || (T->allocation_count && counter.last_size < T->allocation_size))
+		{
+			fprintf(stderr, "%15.15s: %d headers, %d allocations of %d bytes, expect %d, %d, %d\n",
+			        "PRESCAN",
+			        (int)httpmessage_headerfield_count(&request.message.field_list),
+			        (int)(counter.allocation_count - allocation_count),
+			        (int)counter.last_size,
+			        (int)T->headerfield_count, (int)T->allocation_count,
+			        (int)T->allocation_size);
+			++exit_code;
+		}
+	}
+	
+	{
+		char value[128];
+		httpmessage_headerfield *field = httpmessage_headerfield_find(
+		                                     &request.message.field_list, "X-Lyrics", 8);
+		                                     
+		if (!field
+		        || httpmessage_headerfield_value_merge_lines(value, sizeof(value),
+		                &field->value) < 0
+		        || strcmp(value, "I'm a poor lonesome cowboy."
+		                  " I'm a long long way from home."
+		                  " And this long long way is my home.") != 0)
+		{
+			fprintf(stderr, "%15.15s: unexpected multiline value\n", "X-LYRICS");
+			++exit_code;
+		}
+	}
+	
+	/* Header fields appended after the block are released with it */
+	if (httpmessage_message_append_header(&request.message, "X-Appended", "yes", 0)
+	        != HTTPMESSAGE_OK
+	        || httpmessage_headerfield_count(&request.message.field_list) != 6)
+	{
+		fprintf(stderr, "%15.15s: failed to append header\n", "APPEND");
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, HTTPMESSAGE_CLEAR_NO_FREE);
+	
+	if (request.message.header_block
+	        || request.message.field_list.next_field
+	        || counter.allocation_count != counter.release_count)
+	{
+		fprintf(stderr, "%15.15s: %d allocations, %d releases\n", "CLEAR",
+		        (int)counter.allocation_count, (int)counter.release_count);
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+HTTPMESSAGE_DECLARE_REQUEST_STORAGE(test_request_storage, 4, 2);
+HTTPMESSAGE_DECLARE_RESPONSE_STORAGE(test_response_storage, 1, 1);
+
+typedef struct __test_connection
+{
+	int socket;
+	test_request_storage request_storage;
+} test_connection;
+
+static test_response_storage test_responses[2];
+
+typedef struct __storage_declare_test
+{
+	const char *text;
+	int result;
+	size_t header_count;
+} storage_declare_test;
+
+int test_storage_declare(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	int option_flags = (HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION);
+	test_connection connection;
+	httpmessage_request *request;
+	httpmessage_response *response;
+	size_t max_headerfield_count;
+	size_t max_line_per_value;
+	size_t a;
+	
+	static const storage_declare_test tests[] =
+	{
+		{
+			"GET /lucky HTTP/1.1\r\n"
+			"Content-Type: text/plain\r\n"
+			"X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+			" I'm a long long way from home.\r\n"
+			"Host: west.us\r\n"
+			"Connection: keep-alive\r\n"
+			"\r\n", 0, 4
+		},
+		/* Too many header fields */
+		{
+			"GET /lucky HTTP/1.1\r\n"
+			"Content-Type: text/plain\r\n"
+			"Host: west.us\r\n"
+			"Connection: keep-alive\r\n"
+			"Accept: */*\r\n"
+			"Cache-Control: no-cache\r\n"
+			"\r\n", HTTPMESSAGE_ERROR_ALLOCATION, 4
+		},
+		/* Too many value lines */
+		{
+			"GET /lucky HTTP/1.1\r\n"
+			"X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+			" I'm a long long way from home.\r\n"
+			" And this long long way is my home.\r\n"
+			"\r\n", HTTPMESSAGE_ERROR_ALLOCATION, 1
+		}
+	};
+	
+	request = HTTPMESSAGE_REQUEST_STORAGE_INIT(test_request_storage,
+	          &connection.request_storage);
+	          
+	if (request != &connection.request_storage.request
+	        || httpmessage_message_get_storage_infos(&max_headerfield_count,
+	                &max_line_per_value, &request->message) != HTTPMESSAGE_OK
+	        || max_headerfield_count != 4 || max_line_per_value != 2)
+	{
+		fprintf(stderr, "%15.15s: %d/%d, expect 4/2\n", "STORAGE",
+		        (int)max_headerfield_count, (int)max_line_per_value);
+		++exit_code;
+	}
+	
+	for (a = 0; a < (sizeof(tests) / sizeof(storage_declare_test)); ++a)
+	{
+		const storage_declare_test *T = &tests[a];
+		ssize_t expected = (T->result ? T->result : (ssize_t)strlen(T->text));
+		ssize_t result = httpmessage_request_consume(request,
+		                 T->text, strlen(T->text), option_flags);
+		                 
+		if (result != expected
+		        || httpmessage_headerfield_count(&request->message.field_list) != T->header_count)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s (%d headers), expect %d (%d headers)\n",
+			        "RESULT", (int)a,
+			        (int)result, httpmessage_result_get_text((int)result),
+			        (int)httpmessage_headerfield_count(&request->message.field_list),
+			        (int)expected, (int)T->header_count);
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(request, option_flags);
+	}
+	
+	/* Storage is kept */
+	if (httpmessage_message_get_storage_infos(&max_headerfield_count,
+	        &max_line_per_value, &request->message) != HTTPMESSAGE_OK
+	        || max_headerfield_count != 4 || max_line_per_value != 2)
+	{
+		fprintf(stderr, "%15.15s: %d/%d after clear, expect 4/2\n", "STORAGE",
+		        (int)max_headerfield_count, (int)max_line_per_value);
+		++exit_code;
+	}
+	
+	for (a = 0; a < (sizeof(test_responses) / sizeof(test_response_storage)); ++a)
+	{
+		static const char *text =
+		    "HTTP/1.1 204 No Content\r\n"
+		    "Server: static\r\n"
+		    "\r\n";
+		ssize_t result;
+		
+		response = HTTPMESSAGE_RESPONSE_STORAGE_INIT(test_response_storage,
+		           &test_responses[a]);
+		result = httpmessage_response_consume(response, text, strlen(text),
+		                                      option_flags);
+		                                      
+		if (result != (ssize_t)strlen(text)
+		        || response->status_code != 204
+		        || httpmessage_headerfield_count(&response->message.field_list) != 1)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "RESPONSE", (int)a,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
 typedef struct __request_uri_test
 {
 	const char *text;
@@ -788,6 +1177,242 @@ typedef struct __request_uri_test
 	size_t uri_length;
 } request_uri_test;
 
+int test_memory_usage(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_request *storage;
+	httpmessage_memory_usage usage;
+	httpmessage_allocation_counters before;
+	httpmessage_allocation_counters after;
+	size_t length;
+	size_t referenced;
+	ssize_t result;
+	
+	static const char *text =
+	    "GET /usage HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Accept: text/html,\r\n"
+	    " application/xhtml+xml\r\n"
+	    "Connection: close\r\n"
+	    "\r\n";
+	    
+	length = strlen(text);
+	referenced = strlen("GET") + strlen("/usage")
+	             + strlen("Host") + strlen("example.org")
+	             + strlen("Accept") + strlen("text/html,") + strlen("application/xhtml+xml")
+	             + strlen("Connection") + strlen("close");
+	             
+	/* Default allocator */
+	httpmessage_request_init(&request);
+	httpmessage_allocation_counters_get(&before);
+	result = httpmessage_request_consume(&request, text, length, 0);
+	httpmessage_allocation_counters_get(&after);
+	httpmessage_request_memory_usage(&usage, &request);
+	
+	if (result != (ssize_t)length
+	        || usage.headerfield_size != 2 * sizeof(httpmessage_headerfield)
+	        || usage.line_size != sizeof(httpmessage_headerfield_value)
+	        || usage.unused_size != 0
+	        || usage.internal_size != 0
+	        || usage.total_size != usage.headerfield_size + usage.line_size
+	        || usage.referenced_size != referenced
+	        || (after.allocation_count - before.allocation_count) != 3
+	        || (after.allocation_size - before.allocation_size) != usage.total_size)
+	{
+		fprintf(stderr, "%15.15s: %d bytes, %d referenced, %d allocations\n", "DEFAULT",
+		        (int)usage.total_size, (int)usage.referenced_size,
+		        (int)(after.allocation_count - before.allocation_count));
+		++exit_code;
+	}
+	
+	/* Nodes kept for reuse */
+	httpmessage_request_clear(&request, HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_request_memory_usage(&usage, &request);
+	
+	if (usage.unused_size != (2 * sizeof(httpmessage_headerfield)
+	                          + sizeof(httpmessage_headerfield_value))
+	        || usage.headerfield_size || usage.line_size || usage.referenced_size)
+	{
+		fprintf(stderr, "%15.15s: %d unused bytes\n", "NO_FREE", (int)usage.unused_size);
+		++exit_code;
+	}
+	
+	httpmessage_allocation_counters_get(&before);
+	httpmessage_request_clear(&request, 0);
+	httpmessage_allocation_counters_get(&after);
+	
+	if ((after.release_count - before.release_count) != 3)
+	{
+		fprintf(stderr, "%15.15s: %d releases\n", "CLEAR",
+		        (int)(after.release_count - before.release_count));
+		++exit_code;
+	}
+	
+	/* Header block */
+	result = httpmessage_request_consume(&request, text, length, HTTPMESSAGE_CONSUME_PRESCAN);
+	httpmessage_request_memory_usage(&usage, &request);
+	
+	if (result != (ssize_t)length
+	        || usage.headerfield_size != 2 * sizeof(httpmessage_headerfield)
+	        || usage.internal_size == 0
+	        || usage.referenced_size != referenced)
+	{
+		fprintf(stderr, "%15.15s: %d internal bytes\n", "PRESCAN", (int)usage.internal_size);
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	
+	/* Pre-allocated storage */
+	storage = httpmessage_request_storage_new(4, 2);
+	result = httpmessage_request_consume(storage, text, length, 0);
+	httpmessage_request_memory_usage(&usage, storage);
+	
+	if (result != (ssize_t)length
+	        || usage.headerfield_size != 2 * sizeof(httpmessage_headerfield)
+	        || usage.line_size != sizeof(httpmessage_headerfield_value)
+	        || usage.unused_size != (sizeof(httpmessage_headerfield)
+	                                 + 3 * sizeof(httpmessage_headerfield_value))
+	        || usage.referenced_size != referenced)
+	{
+		fprintf(stderr, "%15.15s: %d unused bytes\n", "STORAGE", (int)usage.unused_size);
+		++exit_code;
+	}
+	
+	httpmessage_request_storage_free(&storage);
+	
+	if (httpmessage_message_memory_usage(&usage, NULL) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_append_header_copy(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_response response;
+	httpmessage_response *arena_response;
+	httpmessage_memory_usage usage;
+	httpmessage_allocation_counters before;
+	httpmessage_allocation_counters after;
+	char value[HTTPMESSAGE_STRING_BLOCK_SIZE + 32];
+	char output[2048];
+	ssize_t result;
+	int a;
+	
+	static const char *expected =
+	    "HTTP/1.1 200 OK\r\n"
+	    "X-Request-Id: 0\r\n"
+	    "X-Request-Id: 1\r\n"
+	    "X-Request-Id: 2\r\n"
+	    "X-Request-Id: 3\r\n"
+	    "\r\n";
+	    
+	httpmessage_response_init(&response);
+	response.status_code = 200;
+	response.reason_phrase.text = "OK";
+	response.reason_phrase.length = 2;
+	
+	/* Generated values, overwritten after each call */
+	httpmessage_allocation_counters_get(&before);
+	
+	for (a = 0; a < 4; ++a)
+	{
+		sprintf(value, "%d", a);
+		
+		if (httpmessage_message_append_header_copy(&response.message,
+		        "X-Request-Id", value, 0) != HTTPMESSAGE_OK)
+		{
+			++exit_code;
+		}
+	}
+	
+	memset(value, 'x', sizeof(value));
+	httpmessage_allocation_counters_get(&after);
+	result = httpmessage_response_write_buffer(output, sizeof(output), &response);
+	
+	/* 3 header field nodes and a single string block */
+	if (result != (ssize_t)strlen(expected)
+	        || strncmp(output, expected, (size_t)result) != 0
+	        || (after.allocation_count - before.allocation_count) != 4)
+	{
+		fprintf(stderr, "%15.15s: %d allocations\n%.*s\n", "APPEND",
+		        (int)(after.allocation_count - before.allocation_count),
+		        (int)((result > 0) ? result : 0), output);
+		++exit_code;
+	}
+	
+	/* Larger than the remaining block space */
+	if (httpmessage_message_append_header_copy_with_lengths(&response.message,
+	        "X-Large", 7, value, sizeof(value), 0) != HTTPMESSAGE_OK
+	        || httpmessage_message_append_header_copy_with_lengths(&response.message,
+	                "X-Large", 7, value, sizeof(value),
+	                HTTPMESSAGE_NO_ALLOCATION) != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: unexpected result\n", "LARGE");
+		++exit_code;
+	}
+	
+	/* The largest block is kept */
+	httpmessage_response_clear(&response, HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_response_memory_usage(&usage, &response);
+	
+	if (!response.message.string_block
+	        || usage.internal_size < (2 * HTTPMESSAGE_STRING_BLOCK_SIZE)
+	        || usage.internal_size >= (3 * HTTPMESSAGE_STRING_BLOCK_SIZE)
+	        || httpmessage_message_append_header_copy_with_lengths(&response.message,
+	                "X-Large", 7, value, sizeof(value),
+	                HTTPMESSAGE_NO_ALLOCATION) != HTTPMESSAGE_OK
+	        || httpmessage_stringview_compare_text(&response.message.field_list.name,
+	                "X-Large", 7) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d internal bytes\n", "NO_FREE", (int)usage.internal_size);
+		++exit_code;
+	}
+	
+	httpmessage_allocation_counters_get(&before);
+	httpmessage_response_clear(&response, 0);
+	httpmessage_allocation_counters_get(&after);
+	
+	/* The string block and the 4 header field nodes kept by HTTPMESSAGE_CLEAR_NO_FREE */
+	if (response.message.string_block
+	        || (after.release_count - before.release_count) != 5)
+	{
+		fprintf(stderr, "%15.15s: string block not released\n", "CLEAR");
+		++exit_code;
+	}
+	
+	/* Blocks are released by the arena reset */
+	arena_response = httpmessage_response_arena_new(0);
+	
+	for (a = 0; a < 64; ++a)
+	{
+		if (httpmessage_message_append_header_copy(&arena_response->message,
+		        "Date", "Sun, 06 Nov 1994 08:49:37 GMT", 0) != HTTPMESSAGE_OK)
+		{
+			++exit_code;
+		}
+	}
+	
+	httpmessage_response_clear(arena_response, 0);
+	
+	if (arena_response->message.string_block)
+	{
+		fprintf(stderr, "%15.15s: string block not released\n", "ARENA");
+		++exit_code;
+	}
+	
+	httpmessage_response_free(&arena_response);
+	return exit_code;
+}
+
 int test_request_uri_consume(int argc, const char **argv)
 {
 	(void) argc;
@@ -860,6 +1485,566 @@ int test_request_uri_consume(int argc, const char **argv)
 	return exit_code;
 }
 
+int test_header_only(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_response response;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *text;
+		/* Expected error, or 0 if the whole input is the header */
+		int error;
+		int framing;
+		size_t body_length;
+	} header_only_test;
+	
+	/* Bodies are not part of the input */
+	static const header_only_test tests[] =
+	{
+		{ "PUT /upload HTTP/1.1\r\nContent-Length: 4000000000\r\n\r\n", 0, HTTPMESSAGE_FRAMING_LENGTH, 4000000000UL },
+		{ "PUT /upload HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "PUT /upload HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "PUT /upload HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "PUT /upload HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\n", 0, HTTPMESSAGE_FRAMING_LENGTH, 5 },
+		{ "POST /chunks HTTP/1.1\r\nTransfer-Encoding: gzip, Chunked\r\n\r\n", 0, HTTPMESSAGE_FRAMING_CHUNKED, 0 },
+		{ "POST /chunks HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 12\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "POST /chunks HTTP/1.1\r\nContent-Length: 12\r\nTransfer-Encoding: chunked\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "HTTP/1.1 200 OK\r\nContent-Length: 12\r\nTransfer-Encoding: chunked\r\n\r\n", 0, HTTPMESSAGE_FRAMING_CHUNKED, 0 },
+		{ "POST /gzip HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "POST /te HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: identity\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "POST /te HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "POST /te HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip, chunked\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "POST /te HTTP/1.1\r\nTransfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n\r\n", 0, HTTPMESSAGE_FRAMING_CHUNKED, 0 },
+		{ "POST /te HTTP/1.1\r\nTransfer-Encoding: gzip,\r\n chunked\r\n\r\n", 0, HTTPMESSAGE_FRAMING_CHUNKED, 0 },
+		{ "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n\r\n", HTTPMESSAGE_ERROR_SYNTAX, 0, 0 },
+		{ "GET / HTTP/1.1\r\nHost: example.org\r\n\r\n", 0, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n", 0, HTTPMESSAGE_FRAMING_CHUNKED, 0 },
+		{ "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip\r\n\r\n", 0, HTTPMESSAGE_FRAMING_UNTIL_CLOSE, 0 },
+		{ "HTTP/1.0 200 OK\r\nServer: test\r\n\r\n", 0, HTTPMESSAGE_FRAMING_UNTIL_CLOSE, 0 }
+	};
+	
+	httpmessage_request_init(&request);
+	httpmessage_response_init(&response);
+	
+	for (t = 0; t < sizeof(tests) / sizeof(header_only_test); ++t)
+	{
+		const header_only_test *test = &tests[t];
+		httpmessage_message *message;
+		size_t body_length = 0;
+		ssize_t result;
+		int framing;
+		
+		if (test->text[0] == 'H')
+		{
+			message = &response.message;
+			result = httpmessage_response_consume(&response, test->text, strlen(test->text),
+			                                      HTTPMESSAGE_CONSUME_HEADER_ONLY);
+		}
+		else
+		{
+			message = &request.message;
+			result = httpmessage_request_consume(&request, test->text, strlen(test->text),
+			                                     HTTPMESSAGE_CONSUME_HEADER_ONLY);
+		}
+		
+		framing = httpmessage_message_get_framing(&body_length, message);
+		
+		if (result != (test->error ? test->error : (ssize_t)strlen(test->text))
+		        || (result > 0 && (framing != test->framing
+		                           || body_length != test->body_length
+		                           || message->body.length != 0)))
+		{
+			fprintf(stderr, "%15.15s: %d %s framing %d length %lu\n", "HEADER_ONLY",
+			        (int)result, httpmessage_result_get_text((int)result),
+			        framing, (unsigned long)body_length);
+			++exit_code;
+		}
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	httpmessage_response_clear(&response, 0);
+	return exit_code;
+}
+
+int test_pipeline(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_pipeline pipeline;
+	size_t length;
+	size_t m;
+	ssize_t result;
+	
+	static const char *messages[] =
+	{
+		"GET /1 HTTP/1.1\r\nHost: example.org\r\n\r\n",
+		"GET /2 HTTP/1.1\r\nHost: example.org\r\n\r\n",
+		"POST /3 HTTP/1.1\r\nHost: example.org\r\nContent-Length: 9\r\n\r\nGET /4 HT",
+		"GET /5 HTTP/1.1\r\nHost: example.org\r\n\r\n"
+	};
+	static const char *invalid[] =
+	{
+		"GARBAGE\r\nmore",
+		"GET /a HTTP/1.1\r\nHost example.org\r\n",
+		"GET /a HTTP/1.1\r\nHost: example.org\r\nX\001",
+		"GET /a\001 HT"
+	};
+	char text[512];
+	
+	length = 0;
+	
+	for (m = 0; m < sizeof(messages) / sizeof(const char *); ++m)
+	{
+		memcpy(text + length, messages[m], strlen(messages[m]));
+		length += strlen(messages[m]);
+	}
+	
+	httpmessage_request_init(&request);
+	
+	/* The last message is truncated */
+	httpmessage_pipeline_init(&pipeline, text, length - 2, HTTPMESSAGE_CLEAR_NO_FREE);
+	
+	for (m = 0; m < sizeof(messages) / sizeof(const char *); ++m)
+	{
+		result = httpmessage_pipeline_request_consume(&pipeline, &request);
+		
+		if (result < 0)
+		{
+			break;
+		}
+		
+		if (result != (ssize_t)strlen(messages[m])
+		        || request.request_uri.length != 2
+		        || request.request_uri.text[1] != (char)('1' + m))
+		{
+			fprintf(stderr, "%15.15s: message %d: %d %.*s\n", "PIPELINE",
+			        (int)m, (int)result,
+			        (int)request.request_uri.length, request.request_uri.text);
+			++exit_code;
+		}
+	}
+	
+	if (m != 3 || result != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || pipeline.message_count != 3
+	        || pipeline.offset != (length - strlen(messages[3])))
+	{
+		fprintf(stderr, "%15.15s: %d messages, %d %s\n", "TRUNCATED",
+		        (int)pipeline.message_count,
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* The remaining input is received */
+	pipeline.length = length;
+	result = httpmessage_pipeline_request_consume(&pipeline, &request);
+	
+	if (result != (ssize_t)strlen(messages[3])
+	        || httpmessage_pipeline_request_consume(&pipeline, &request) != 0
+	        || pipeline.message_count != 4)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "COMPLETE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Any partial request is incomplete */
+	length = strlen(messages[2]);
+	
+	for (m = 1; m < length; ++m)
+	{
+		httpmessage_pipeline_init(&pipeline, messages[2], m, 0);
+		result = httpmessage_pipeline_request_consume(&pipeline, &request);
+		
+		if (result != HTTPMESSAGE_ERROR_INCOMPLETE)
+		{
+			fprintf(stderr, "%15.15s: %d bytes: %d %s\n", "PARTIAL",
+			        (int)m, (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	/* Invalid input is reported before the end of the header */
+	for (m = 0; m < sizeof(invalid) / sizeof(const char *); ++m)
+	{
+		httpmessage_pipeline_init(&pipeline, invalid[m], strlen(invalid[m]), 0);
+		result = httpmessage_pipeline_request_consume(&pipeline, &request);
+		
+		if (result != HTTPMESSAGE_ERROR_SYNTAX)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "INVALID",
+			        (int)m, (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	return exit_code;
+}
+
+int test_response_framing(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_response response;
+	size_t t;
+	
+	typedef struct
+	{
+		const char *method;
+		const char *text;
+		ssize_t result;
+		int framing;
+		int interim;
+	} response_framing_test;
+	
+	static const response_framing_test tests[] =
+	{
+		{ "HEAD", "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n", 39, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "GET", "HTTP/1.1 204 No Content\r\n\r\n", 27, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "GET", "HTTP/1.1 304 Not Modified\r\nContent-Length: 10\r\n\r\n", 49, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "GET", "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\n\r\n", 25, HTTPMESSAGE_FRAMING_NONE, 1 },
+		{ "GET", "HTTP/1.1 101 Switching Protocols\r\n\r\nframe", 36, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "CONNECT", "HTTP/1.1 200 OK\r\n\r\ntunnel", 19, HTTPMESSAGE_FRAMING_NONE, 0 },
+		{ "GET", "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nokHTTP", 40, HTTPMESSAGE_FRAMING_LENGTH, 0 },
+		{ NULL, "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", 40, HTTPMESSAGE_FRAMING_LENGTH, 0 },
+		{ "GET", "HTTP/1.0 200 OK\r\n\r\nuntil close", 30, HTTPMESSAGE_FRAMING_UNTIL_CLOSE, 0 },
+		{ "GET", "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort", HTTPMESSAGE_ERROR_INCOMPLETE, HTTPMESSAGE_FRAMING_LENGTH, 0 },
+		{ "GET", "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n", HTTPMESSAGE_ERROR_INCOMPLETE, HTTPMESSAGE_FRAMING_NONE, 0 }
+	};
+	
+	httpmessage_response_init(&response);
+	
+	for (t = 0; t < sizeof(tests) / sizeof(response_framing_test); ++t)
+	{
+		const response_framing_test *test = &tests[t];
+		httpmessage_stringview method;
+		int framing;
+		ssize_t result;
+		
+		if (test->method)
+		{
+			httpmessage_stringview_assign(&method, test->method);
+		}
+		
+		result = httpmessage_response_consume_for_request(&response, &framing,
+		         (test->method ? &method : NULL),
+		         test->text, strlen(test->text), 0);
+		         
+		if (result != test->result
+		        || framing != test->framing
+		        || (result > 0 && httpmessage_response_is_interim(&response) != test->interim))
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s, framing %d\n", "FRAMING",
+			        (int)t, (int)result, httpmessage_result_get_text((int)result), framing);
+			++exit_code;
+		}
+	}
+	
+	httpmessage_response_clear(&response, 0);
+	return exit_code;
+}
+
+static int headerfield_list_compare(const httpmessage_headerfield *a,
+                                    const httpmessage_headerfield *b)
+{
+	while (a && b && a->name.length && b->name.length)
+	{
+		const httpmessage_headerfield_value *va = &a->value;
+		const httpmessage_headerfield_value *vb = &b->value;
+		
+		if (httpmessage_stringview_compare_text(&a->name, b->name.text, b->name.length) != 0)
+		{
+			return 1;
+		}
+		
+		while (va && vb && (va->line.length || vb->line.length))
+		{
+			if (httpmessage_stringview_compare_text(&va->line, vb->line.text,
+			                                        vb->line.length) != 0)
+			{
+				return 1;
+			}
+			
+			va = va->next_line;
+			vb = vb->next_line;
+		}
+		
+		a = a->next_field;
+		b = b->next_field;
+	}
+	
+	return (httpmessage_headerfield_count(a) != httpmessage_headerfield_count(b));
+}
+
+/* Compare the bytes of a segment range with a text */
+static int segment_range_compare(const httpmessage_stringview *segments,
+                                 const httpmessage_segment_range *range,
+                                 const char *text, size_t length)
+{
+	size_t offset = range->offset;
+	size_t compared = 0;
+	size_t i;
+	
+	if (range->length != length)
+	{
+		return 1;
+	}
+	
+	for (i = range->first_segment; compared < length && i <= range->last_segment;
+	        ++i, offset = 0)
+	{
+		size_t size = segments[i].length - offset;
+		
+		if (size > (length - compared))
+		{
+			size = length - compared;
+		}
+		
+		if (memcmp(segments[i].text + offset, text + compared, size) != 0)
+		{
+			return 1;
+		}
+		
+		compared += size;
+	}
+	
+	return (compared != length);
+}
+
+int test_segments(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request expected_request;
+	httpmessage_request request;
+	httpmessage_response expected_response;
+	httpmessage_response response;
+	httpmessage_stringview segments[3];
+	httpmessage_segment_range range;
+	httpmessage_request *storage;
+	size_t length;
+	size_t a, b;
+	ssize_t expected;
+	ssize_t result;
+	
+	static const char *request_text =
+	    "POST /upload?id=1 HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "X-Folded: first\r\n"
+	    " second\r\n"
+	    "Content-Length: 11\r\n"
+	    "\r\n"
+	    "hello world"
+	    "GET / HTTP/1.1\r\n";
+	static const char *response_text =
+	    "HTTP/1.1 200 OK\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "5\r\nhello\r\n"
+	    "0\r\n"
+	    "Digest: sha-256=abc\r\n"
+	    "\r\n";
+	    
+	httpmessage_request_init(&expected_request);
+	httpmessage_request_init(&request);
+	httpmessage_response_init(&expected_response);
+	httpmessage_response_init(&response);
+	
+	/* Single segment: no copy */
+	length = strlen(request_text);
+	expected = httpmessage_request_consume(&expected_request, request_text, length, 0);
+	segments[0].text = request_text;
+	segments[0].length = length;
+	result = httpmessage_request_segments_consume(&request, segments, 1, NULL, 0);
+	         
+	if (result != expected
+	        || request.method.text != request_text
+	        || request.message.body.text != expected_request.message.body.text
+	        || request.message.string_block)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "SINGLE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Any split in three segments */
+	for (a = 0; a <= length; ++a)
+	{
+		for (b = a; b <= length; ++b)
+		{
+			segments[0].text = request_text;
+			segments[0].length = a;
+			segments[1].text = request_text + a;
+			segments[1].length = b - a;
+			segments[2].text = request_text + b;
+			segments[2].length = length - b;
+			result = httpmessage_request_segments_consume(&request, segments, 3, NULL,
+			         HTTPMESSAGE_CONSUME_COPY_BODY);
+			
+			if (result != expected
+			        || httpmessage_stringview_compare_text(&request.method,
+			                "POST", 4) != 0
+			        || httpmessage_stringview_compare_text(&request.request_uri,
+			                "/upload?id=1", 12) != 0
+			        || headerfield_list_compare(&request.message.field_list,
+			                                    &expected_request.message.field_list)
+			        || httpmessage_stringview_compare_text(&request.message.body,
+			                "hello world", 11) != 0)
+			{
+				fprintf(stderr, "%15.15s: %d %d: %d %s\n", "REQUEST", (int)a, (int)b,
+				        (int)result, httpmessage_result_get_text((int)result));
+				++exit_code;
+			}
+		}
+	}
+	
+	length = strlen(response_text);
+	expected = httpmessage_response_consume(&expected_response, response_text, length, 0);
+	
+	for (a = 0; a <= length; ++a)
+	{
+		segments[0].text = response_text;
+		segments[0].length = a;
+		segments[1].text = response_text + a;
+		segments[1].length = length - a;
+		result = httpmessage_response_segments_consume(&response, segments, 2, NULL,
+		         HTTPMESSAGE_CONSUME_COPY_BODY);
+		
+		if (result != expected
+		        || response.status_code != 200
+		        || headerfield_list_compare(response.message.trailer_list,
+		                                    expected_response.message.trailer_list)
+		        || httpmessage_stringview_compare_text(&response.message.body,
+		                expected_response.message.body.text,
+		                expected_response.message.body.length) != 0)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "RESPONSE", (int)a,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		
+		/* Body left in the input segments */
+		result = httpmessage_response_segments_consume(&response, segments, 2,
+		         &range, 0);
+		         
+		if (result != expected
+		        || headerfield_list_compare(response.message.trailer_list,
+		                                    expected_response.message.trailer_list)
+		        || segment_range_compare(segments, &range,
+		                                 expected_response.message.body.text,
+		                                 expected_response.message.body.length) != 0
+		        || (response.message.body.length
+		            && range.first_segment != range.last_segment))
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "BODY RANGE", (int)a,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		
+		/* Truncated */
+		segments[1].length = length - a - 1;
+		result = httpmessage_response_segments_consume(&response, segments, 2, NULL,
+		         HTTPMESSAGE_CONSUME_COPY_BODY);
+		
+		if (a < length && result != HTTPMESSAGE_ERROR_INCOMPLETE)
+		{
+			fprintf(stderr, "%15.15s: %d: %d %s\n", "INCOMPLETE", (int)a,
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	/* Copies require memory */
+	httpmessage_response_clear(&response, 0);
+	segments[0].length = 10;
+	segments[1].text = response_text + 10;
+	segments[1].length = length - 10;
+	result = httpmessage_response_segments_consume(&response, segments, 2, NULL,
+	         HTTPMESSAGE_NO_ALLOCATION);
+	         
+	if (result != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "NO ALLOCATION",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* A body crossing a segment boundary is never copied without allocation */
+	length = strlen(request_text);
+	expected = (ssize_t)(length - strlen("GET / HTTP/1.1\r\n"));
+	a = length - strlen("lo worldGET / HTTP/1.1\r\n");
+	segments[0].text = request_text;
+	segments[0].length = a;
+	segments[1].text = request_text + a;
+	segments[1].length = length - a;
+	result = httpmessage_request_segments_consume(&request, segments, 2, NULL,
+	         HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_CONSUME_COPY_BODY);
+	         
+	if (result != expected || !request.message.string_block
+	        || httpmessage_request_segments_consume(&request, segments, 2, NULL,
+	                HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION
+	                | HTTPMESSAGE_CONSUME_COPY_BODY)
+	        != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "BODY COPY",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Other elements may use the memory kept by the message */
+	segments[0].length = 20;
+	segments[1].text = request_text + 20;
+	segments[1].length = length - 20;
+	result = httpmessage_request_segments_consume(&request, segments, 2, NULL,
+	         HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION);
+	         
+	if (result != expected
+	        || request.message.body.text != expected_request.message.body.text)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "KEPT MEMORY",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Zero copy body. Only the header field crossing a segment boundary is copied. */
+	storage = httpmessage_request_storage_new(4, 2);
+	segments[0].length = 40;
+	segments[1].text = request_text + 40;
+	segments[1].length = (size_t)expected - 40 - 4;
+	segments[2].text = request_text + expected - 4;
+	segments[2].length = length - (size_t)expected + 4;
+	result = httpmessage_request_segments_consume(storage, segments, 3, &range,
+	         HTTPMESSAGE_CLEAR_NO_FREE);
+	         
+	if (result != expected
+	        || storage->message.body.length
+	        || !storage->message.string_block
+	        || range.first_segment != 1 || range.last_segment != 2
+	        || segment_range_compare(segments, &range, "hello world", 11) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "ZERO COPY",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	httpmessage_request_storage_free(&storage);
+	
+	httpmessage_request_clear(&expected_request, 0);
+	httpmessage_request_clear(&request, 0);
+	httpmessage_response_clear(&expected_response, 0);
+	httpmessage_response_clear(&response, 0);
+	return exit_code;
+}
+
 int main(int argc, const char **argv)
 {
 	static const httpmessage_test tests[] =
@@ -870,6 +2055,15 @@ int main(int argc, const char **argv)
 		{ "first_line", test_first_line },
 		{ "line_type", test_line_type },
 		{ "storage", test_storage },
+		{ "storage_overflow", test_storage_overflow },
+		{ "prescan", test_prescan },
+		{ "storage_declare", test_storage_declare },
+		{ "memory_usage", test_memory_usage },
+		{ "append_header_copy", test_append_header_copy },
+		{ "header_only", test_header_only },
+		{ "pipeline", test_pipeline },
+		{ "response_framing", test_response_framing },
+		{ "segments", test_segments },
 		/* Written by Claude Code */
 		{ "request_uri_consume", test_request_uri_consume }
 	};
@@ -0,0 +1,817 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+int test_incremental(int argc, const char **argv);
+int test_relocation(int argc, const char **argv);
+int test_until_close(int argc, const char **argv);
+int test_parser_errors(int argc, const char **argv);
+int test_callbacks(int argc, const char **argv);
+int test_parser_chunked(int argc, const char **argv);
+int test_parser_trailer(int argc, const char **argv);
+
+static int compare_headers(const httpmessage_message *a,
+                           const httpmessage_message *b)
+{
+	const httpmessage_headerfield *fa = &a->field_list;
+	const httpmessage_headerfield *fb = &b->field_list;
+	
+	if (a->major_version != b->major_version
+	        || a->minor_version != b->minor_version
+	        || httpmessage_headerfield_count(fa) != httpmessage_headerfield_count(fb))
+	{
+		return 1;
+	}
+	
+	while (fa && fa->name.length)
+	{
+		char va[256];
+		char vb[256];
+		
+		if (httpmessage_stringview_compare(&fa->name, &fb->name) != 0
+		        || httpmessage_headerfield_value_merge_lines(va, sizeof(va), &fa->value) < 0
+		        || httpmessage_headerfield_value_merge_lines(vb, sizeof(vb), &fb->value) < 0
+		        || strcmp(va, vb) != 0)
+		{
+			return 1;
+		}
+		
+		fa = fa->next_field;
+		fb = fb->next_field;
+	}
+	
+	return 0;
+}
+
+int test_incremental(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	size_t a;
+	
+	/* Files with a framed body */
+	static const char *files[] =
+	{
+		"tests/data/get-hello.request",
+		"tests/data/get-lucky.request",
+		"tests/data/get-slash.response"
+	};
+	
+	for (a = 0; a < (sizeof(files) / sizeof(const char *)); ++a)
+	{
+		char text[4096];
+		size_t text_length;
+		size_t length;
+		httpmessage_request request;
+		httpmessage_request expected_request;
+		httpmessage_response response;
+		httpmessage_response expected_response;
+		httpmessage_parser parser;
+		const httpmessage_message *message;
+		const httpmessage_message *expected;
+		ssize_t result = HTTPMESSAGE_ERROR_INCOMPLETE;
+		FILE *file = fopen(files[a], "rb");
+		
+		fprintf(stdout, "-- %s ----------------------------------------\n", files[a]);
+		
+		if (!file)
+		{
+			fprintf(stderr, "warning: %s not found.\n", files[a]);
+			continue;
+		}
+		
+		text_length = fread(text, 1, sizeof(text), file);
+		fclose(file);
+		
+		httpmessage_request_init(&request);
+		httpmessage_request_init(&expected_request);
+		httpmessage_response_init(&response);
+		httpmessage_response_init(&expected_response);
+		
+		if (httpmessage_message_get_type(text, text_length, 0) == HTTPMESSAGE_TYPE_REQUEST)
+		{
+			httpmessage_request_consume(&expected_request, text, text_length, 0);
+			httpmessage_parser_init_request(&parser, &request, 0);
+			message = &request.message;
+			expected = &expected_request.message;
+		}
+		else
+		{
+			httpmessage_response_consume(&expected_response, text, text_length, 0);
+			httpmessage_parser_init_response(&parser, &response, 0);
+			message = &response.message;
+			expected = &expected_response.message;
+		}
+		
+		/* One byte at a time */
+		for (length = 1; length <= text_length; ++length)
+		{
+			result = httpmessage_parser_consume(&parser, text, length);
+			
+			if (result != HTTPMESSAGE_ERROR_INCOMPLETE)
+			{
+				break;
+			}
+			
+			/* Header bytes are scanned once. Only a trailing CR is scanned again. */
+			if (parser.state != HTTPMESSAGE_PARSER_BODY
+			        && parser.scan_offset != length
+			        && !(parser.scan_offset == (length - 1) && text[length - 1] == '\r'))
+			{
+				fprintf(stderr, "%15.15s: scan offset %d for %d bytes\n", "SCAN",
+				        (int)parser.scan_offset, (int)length);
+				++exit_code;
+				break;
+			}
+		}
+		
+		fprintf(stdout, "%15.15s: %d of %d bytes\n", "RESULT", (int)result, (int)text_length);
+		
+		if (result <= 0 || parser.state != HTTPMESSAGE_PARSER_COMPLETE)
+		{
+			fprintf(stderr, "%15.15s: %d %s\n", "RESULT",
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+		else if (compare_headers(message, expected) != 0)
+		{
+			fprintf(stderr, "%15.15s: header differs\n", "HEADERS");
+			++exit_code;
+		}
+		else if (message->type == HTTPMESSAGE_TYPE_REQUEST
+		         && (httpmessage_stringview_compare(&request.method, &expected_request.method) != 0
+		             || httpmessage_stringview_compare(&request.request_uri,
+		                     &expected_request.request_uri) != 0))
+		{
+			fprintf(stderr, "%15.15s: request line differs\n", "REQUEST");
+			++exit_code;
+		}
+		else if (message->type == HTTPMESSAGE_TYPE_RESPONSE
+		         && (response.status_code != expected_response.status_code
+		             || httpmessage_stringview_compare(&response.reason_phrase,
+		                     &expected_response.reason_phrase) != 0))
+		{
+			fprintf(stderr, "%15.15s: status line differs\n", "RESPONSE");
+			++exit_code;
+		}
+		else if (parser.framing == HTTPMESSAGE_FRAMING_LENGTH
+		         && (message->body.length != expected->body.length
+		             || memcmp(message->body.text, expected->body.text, message->body.length) != 0
+		             || (size_t)result != (size_t)(message->body.text - text) + message->body.length))
+		{
+			fprintf(stderr, "%15.15s: body differs\n", "BODY");
+			++exit_code;
+		}
+		else if (parser.framing == HTTPMESSAGE_FRAMING_NONE
+		         && (message->body.length
+		             || (size_t)result != parser.offset
+		             || memcmp(text + result - 4, "\r\n\r\n", 4) != 0))
+		{
+			fprintf(stderr, "%15.15s: request without Content-Length has a body\n", "BODY");
+			++exit_code;
+		}
+		
+		/* Further calls do not change the result */
+		if (httpmessage_parser_consume(&parser, text, text_length) != result)
+		{
+			fprintf(stderr, "%15.15s: result changed\n", "COMPLETE");
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(&request, 0);
+		httpmessage_request_clear(&expected_request, 0);
+		httpmessage_response_clear(&response, 0);
+		httpmessage_response_clear(&expected_response, 0);
+	}
+	
+	return exit_code;
+}
+
+int test_relocation(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_parser parser;
+	httpmessage_headerfield *field;
+	char value[128];
+	char *buffer;
+	char *moved;
+	size_t length;
+	size_t split;
+	ssize_t result;
+	
+	static const char *text =
+	    "POST /relocation HTTP/1.1\r\n"
+	    "Content-Type: text/plain\r\n"
+	    "X-Lyrics: I'm a poor lonesome cowboy.\r\n"
+	    " I'm a long long way from home.\r\n"
+	    "Content-Length: 11\r\n"
+	    "\r\n"
+	    "Hello world";
+	    
+	length = strlen(text);
+	/* In the middle of the continuation line */
+	split = (size_t)(strstr(text, "long long") - text);
+	
+	buffer = (char *)malloc(split);
+	memcpy(buffer, text, split);
+	httpmessage_request_init(&request);
+	httpmessage_parser_init_request(&parser, &request, 0);
+	result = httpmessage_parser_consume(&parser, buffer, split);
+	
+	if (result != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || parser.state != HTTPMESSAGE_PARSER_HEADERS)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "FIRST",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Grow the input buffer, which moves it */
+	moved = (char *)malloc(length);
+	memcpy(moved, buffer, split);
+	memset(buffer, 'x', split);
+	memcpy(moved + split, text + split, length - split);
+	result = httpmessage_parser_consume(&parser, moved, length);
+	field = httpmessage_headerfield_find(&request.message.field_list, "X-Lyrics", 8);
+	
+	if (result != (ssize_t)length
+	        || httpmessage_stringview_compare_text(&request.method, "POST", 4) != 0
+	        || request.method.text != moved
+	        || !field
+	        || httpmessage_headerfield_value_merge_lines(value, sizeof(value), &field->value) < 0
+	        || strcmp(value, "I'm a poor lonesome cowboy. I'm a long long way from home.") != 0
+	        || httpmessage_stringview_compare_text(&request.message.body, "Hello world", 11) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "MOVED",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	free(buffer);
+	free(moved);
+	return exit_code;
+}
+
+int test_until_close(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_response response;
+	httpmessage_parser parser;
+	size_t header_length;
+	size_t length;
+	ssize_t result;
+	
+	static const char *text =
+	    "HTTP/1.0 200 OK\r\n"
+	    "Server: until-close\r\n"
+	    "\r\n"
+	    "The body ends with the connection";
+	    
+	length = strlen(text);
+	header_length = (size_t)(strstr(text, "The body") - text);
+	httpmessage_response_init(&response);
+	httpmessage_parser_init_response(&parser, &response, 0);
+	
+	if (httpmessage_parser_finish(&parser) != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || httpmessage_parser_consume(&parser, text, header_length) != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || parser.framing != HTTPMESSAGE_FRAMING_UNTIL_CLOSE
+	        || httpmessage_parser_consume(&parser, text, length) != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || response.message.body.length != (length - header_length))
+	{
+		fprintf(stderr, "%15.15s: unexpected state %d\n", "PARTIAL", parser.state);
+		++exit_code;
+	}
+	
+	result = httpmessage_parser_finish(&parser);
+	
+	if (result != (ssize_t)length
+	        || response.status_code != 200
+	        || httpmessage_stringview_compare_text(&response.message.body,
+	                text + header_length, length - header_length) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "FINISH",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	httpmessage_response_clear(&response, 0);
+	return exit_code;
+}
+
+int test_parser_errors(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request *storage = httpmessage_request_storage_new(2, 1);
+	httpmessage_request request;
+	httpmessage_parser parser;
+	size_t length;
+	ssize_t result;
+	
+	static const char *invalid =
+	    "GET /invalid HTTP/1.1\r\n"
+	    "Host example.org\r\n"
+	    "\r\n";
+	static const char *too_many =
+	    "GET /storage HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "Accept: */*\r\n"
+	    "Connection: close\r\n"
+	    "\r\n";
+	static const char *smuggling[] =
+	{
+		"POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n0123456789ab",
+		"POST / HTTP/1.1\r\nContent-Length: 2\r\nContent-Length: 12\r\n\r\n0123456789ab",
+		"POST / HTTP/1.1\r\nContent-Length: 2\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+		"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 2\r\n\r\n0\r\n\r\n"
+	};
+	static const httpmessage_parser_callbacks no_callbacks =
+	{
+		NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+	};
+	    
+	/* Errors are persistent */
+	length = strlen(invalid);
+	httpmessage_request_init(&request);
+	httpmessage_parser_init_request(&parser, &request, 0);
+	result = httpmessage_parser_consume(&parser, invalid, length - 2);
+	
+	if (result != HTTPMESSAGE_ERROR_SYNTAX
+	        || httpmessage_parser_consume(&parser, invalid, length) != HTTPMESSAGE_ERROR_SYNTAX
+	        || httpmessage_parser_finish(&parser) != HTTPMESSAGE_ERROR_SYNTAX
+	        || parser.state != HTTPMESSAGE_PARSER_ERROR)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "SYNTAX",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	if (httpmessage_parser_consume(&parser, NULL, 0) != HTTPMESSAGE_ERROR_SYNTAX)
+	{
+		++exit_code;
+	}
+	
+	/* Input shrinks */
+	httpmessage_parser_init_request(&parser, &request, 0);
+	httpmessage_parser_consume(&parser, too_many, 10);
+	
+	if (httpmessage_parser_consume(&parser, too_many, 5) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		fprintf(stderr, "%15.15s: shorter input accepted\n", "LENGTH");
+		++exit_code;
+	}
+	
+	/* Pre-allocated storage without allocation */
+	length = strlen(too_many);
+	httpmessage_parser_init_request(&parser, storage, HTTPMESSAGE_NO_ALLOCATION);
+	result = httpmessage_parser_consume(&parser, too_many, length);
+	
+	if (result != HTTPMESSAGE_ERROR_ALLOCATION)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "STORAGE",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Ambiguous body framing, with and without descriptor */
+	for (length = 0; length < sizeof(smuggling) / sizeof(const char *); ++length)
+	{
+		int callbacks;
+		
+		for (callbacks = 0; callbacks <= 1; ++callbacks)
+		{
+			if (callbacks)
+			{
+				httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+				                                  &no_callbacks, NULL);
+			}
+			else
+			{
+				httpmessage_parser_init_request(&parser, &request, 0);
+			}
+			
+			result = httpmessage_parser_consume(&parser, smuggling[length],
+			                                    strlen(smuggling[length]));
+			                                    
+			if (result != HTTPMESSAGE_ERROR_SYNTAX)
+			{
+				fprintf(stderr, "%15.15s: %d %d: %d %s\n", "FRAMING",
+				        (int)length, callbacks,
+				        (int)result, httpmessage_result_get_text((int)result));
+				++exit_code;
+			}
+		}
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	httpmessage_request_storage_free(&storage);
+	return exit_code;
+}
+
+typedef struct __callback_log
+{
+	char text[512];
+	size_t length;
+	/* Name of the callback interrupting the parser */
+	const char *stop;
+} callback_log;
+
+static int callback_log_append(
+    httpmessage_parser *parser,
+    const char *name,
+    const char *text, size_t length)
+{
+	callback_log *log = (callback_log *)parser->user_data;
+	size_t name_length = strlen(name);
+	
+	if ((log->length + name_length + length + 3) < sizeof(log->text))
+	{
+		memcpy(log->text + log->length, name, name_length);
+		log->length += name_length;
+		log->text[log->length++] = '[';
+		
+		if (length)
+		{
+			memcpy(log->text + log->length, text, length);
+			log->length += length;
+		}
+		
+		log->text[log->length++] = ']';
+		log->text[log->length] = '\0';
+	}
+	
+	return ((log->stop && strcmp(log->stop, name) == 0)
+	        ? HTTPMESSAGE_ERROR_INTERRUPTED
+	        : HTTPMESSAGE_OK);
+}
+
+static int on_method(httpmessage_parser *parser,
+                     const httpmessage_stringview *method)
+{
+	return callback_log_append(parser, "method", method->text, method->length);
+}
+
+static int on_request_uri(httpmessage_parser *parser,
+                          const httpmessage_stringview *request_uri)
+{
+	return callback_log_append(parser, "uri", request_uri->text, request_uri->length);
+}
+
+static int on_status(httpmessage_parser *parser, int status_code,
+                     const httpmessage_stringview *reason_phrase)
+{
+	char code[4];
+	code[0] = (char)('0' + (status_code / 100) % 10);
+	code[1] = (char)('0' + (status_code / 10) % 10);
+	code[2] = (char)('0' + status_code % 10);
+	code[3] = '\0';
+	callback_log_append(parser, "status", code, 3);
+	return callback_log_append(parser, "reason",
+	                           reason_phrase->text, reason_phrase->length);
+}
+
+static int on_version(httpmessage_parser *parser,
+                      int major_version, int minor_version)
+{
+	char version[3];
+	version[0] = (char)('0' + major_version);
+	version[1] = '.';
+	version[2] = (char)('0' + minor_version);
+	return callback_log_append(parser, "version", version, 3);
+}
+
+static int on_header(httpmessage_parser *parser,
+                     const httpmessage_stringview *name,
+                     const httpmessage_stringview *value)
+{
+	callback_log_append(parser, "name", name->text, name->length);
+	return callback_log_append(parser, "value", value->text, value->length);
+}
+
+static int on_headers_complete(httpmessage_parser *parser)
+{
+	return callback_log_append(parser, "headers", NULL, 0);
+}
+
+static int on_body_chunk(httpmessage_parser *parser,
+                         const char *text, size_t length)
+{
+	return callback_log_append(parser, "body", text, length);
+}
+
+static int on_message_complete(httpmessage_parser *parser)
+{
+	return callback_log_append(parser, "complete", NULL, 0);
+}
+
+int test_callbacks(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_allocation_counters before;
+	httpmessage_allocation_counters after;
+	httpmessage_parser parser;
+	callback_log log;
+	size_t length;
+	size_t i;
+	ssize_t result;
+	
+	static const httpmessage_parser_callbacks callbacks =
+	{
+		on_method,
+		on_request_uri,
+		on_status,
+		on_version,
+		on_header,
+		on_headers_complete,
+		on_body_chunk,
+		on_message_complete
+	};
+	static const char *request =
+	    "POST /submit HTTP/1.1\r\n"
+	    "Host: example.org\r\n"
+	    "X-Folded: first\r\n"
+	    "  second \r\n"
+	    "content-length: 4\r\n"
+	    "\r\n"
+	    "bodyGET";
+	static const char *request_log =
+	    "method[POST]uri[/submit]version[1.1]"
+	    "name[Host]value[example.org]"
+	    "name[X-Folded]value[first\r\n  second]"
+	    "name[content-length]value[4]"
+	    "headers[]body[body]complete[]";
+	static const char *response =
+	    "HTTP/1.0 404 Not Found\r\n"
+	    "\r\n"
+	    "gone";
+	static const char *response_log =
+	    "version[1.0]status[404]reason[Not Found]headers[]"
+	    "body[gone]complete[]";
+	    
+	/* Whole message, without allocation */
+	length = strlen(request);
+	log.length = 0;
+	log.stop = NULL;
+	httpmessage_allocation_counters_get(&before);
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+	                                  &callbacks, &log);
+	result = httpmessage_parser_consume(&parser, request, length);
+	httpmessage_allocation_counters_get(&after);
+	
+	if (result != (ssize_t)(length - 3)
+	        || strcmp(log.text, request_log) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "WHOLE", (int)result, log.text);
+		++exit_code;
+	}
+	
+	if (after.allocation_count != before.allocation_count)
+	{
+		fprintf(stderr, "%15.15s: %lu allocations\n", "ALLOCATION",
+		        (unsigned long)(after.allocation_count - before.allocation_count));
+		++exit_code;
+	}
+	
+	/* One byte at a time. The body is reported byte per byte */
+	log.length = 0;
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+	                                  &callbacks, &log);
+	                                  
+	for (i = 1; i <= length; ++i)
+	{
+		result = httpmessage_parser_consume(&parser, request, i);
+		
+		if (result != HTTPMESSAGE_ERROR_INCOMPLETE)
+		{
+			break;
+		}
+	}
+	
+	if (result != (ssize_t)(length - 3)
+	        || strstr(log.text, "headers[]body[b]body[o]body[d]body[y]complete[]") == NULL
+	        || strncmp(log.text, request_log, strstr(request_log, "body") - request_log) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "BYTES", (int)result, log.text);
+		++exit_code;
+	}
+	
+	/* Stop once the request target is known */
+	log.length = 0;
+	log.stop = "uri";
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+	                                  &callbacks, &log);
+	result = httpmessage_parser_consume(&parser, request, length);
+	
+	if (result != HTTPMESSAGE_ERROR_INTERRUPTED
+	        || parser.state != HTTPMESSAGE_PARSER_ERROR
+	        || parser.offset != 23
+	        || strcmp(log.text, "method[POST]uri[/submit]") != 0
+	        || httpmessage_parser_consume(&parser, request, length) != HTTPMESSAGE_ERROR_INTERRUPTED)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "STOP", (int)result, log.text);
+		++exit_code;
+	}
+	
+	/* A header field is reported when the next line is received */
+	log.length = 0;
+	log.stop = "value";
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+	                                  &callbacks, &log);
+	result = httpmessage_parser_consume(&parser, request, length);
+	
+	if (result != HTTPMESSAGE_ERROR_INTERRUPTED
+	        || parser.offset != (size_t)(strstr(request, "X-Folded") - request))
+	{
+		fprintf(stderr, "%15.15s: %d offset %lu\n", "STOP HEADER",
+		        (int)result, (unsigned long)parser.offset);
+		++exit_code;
+	}
+	
+	/* Response body until the end of the input */
+	length = strlen(response);
+	log.length = 0;
+	log.stop = NULL;
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_RESPONSE,
+	                                  &callbacks, &log);
+	                                  
+	if (httpmessage_parser_consume(&parser, response, length) != HTTPMESSAGE_ERROR_INCOMPLETE
+	        || httpmessage_parser_finish(&parser) != (ssize_t)length
+	        || strcmp(log.text, response_log) != 0)
+	{
+		fprintf(stderr, "%15.15s: %s\n", "RESPONSE", log.text);
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+int test_parser_chunked(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_parser parser;
+	callback_log log;
+	size_t body_offset;
+	size_t length;
+	size_t i;
+	ssize_t result = HTTPMESSAGE_ERROR_INCOMPLETE;
+	
+	static const httpmessage_parser_callbacks callbacks =
+	{
+		NULL, NULL, NULL, NULL, NULL,
+		on_headers_complete,
+		on_body_chunk,
+		on_message_complete
+	};
+	static const char *text =
+	    "POST /stream HTTP/1.1\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "4\r\n"
+	    "abcd\r\n"
+	    "2;ext\r\n"
+	    "ef\r\n"
+	    "0\r\n"
+	    "\r\n"
+	    "GET / HTTP/1.1\r\n";
+	    
+	length = (size_t)(strstr(text, "GET") - text);
+	body_offset = (size_t)(strstr(text, "4\r\n") - text);
+	
+	/* Descriptor: the body is the chunked text */
+	httpmessage_request_init(&request);
+	httpmessage_parser_init_request(&parser, &request, 0);
+	
+	for (i = 1; i <= strlen(text) && result == HTTPMESSAGE_ERROR_INCOMPLETE; ++i)
+	{
+		result = httpmessage_parser_consume(&parser, text, i);
+	}
+	
+	if (result != (ssize_t)length
+	        || parser.framing != HTTPMESSAGE_FRAMING_CHUNKED
+	        || httpmessage_stringview_compare_text(&request.message.body,
+	                text + body_offset, length - body_offset) != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "DESCRIPTOR",
+		        (int)result, httpmessage_result_get_text((int)result));
+		++exit_code;
+	}
+	
+	/* Callbacks receive decoded data */
+	log.length = 0;
+	log.stop = NULL;
+	httpmessage_parser_init_callbacks(&parser, HTTPMESSAGE_TYPE_REQUEST,
+	                                  &callbacks, &log);
+	result = httpmessage_parser_consume(&parser, text, strlen(text));
+	
+	if (result != (ssize_t)length
+	        || strcmp(log.text, "headers[]body[abcd]body[ef]complete[]") != 0)
+	{
+		fprintf(stderr, "%15.15s: %d %s\n", "CALLBACKS", (int)result, log.text);
+		++exit_code;
+	}
+	
+	httpmessage_request_clear(&request, 0);
+	return exit_code;
+}
+
+int test_parser_trailer(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_request request;
+	httpmessage_parser parser;
+	int merge;
+	
+	static const char *text =
+	    "POST /stream HTTP/1.1\r\n"
+	    "Transfer-Encoding: chunked\r\n"
+	    "\r\n"
+	    "4\r\n"
+	    "abcd\r\n"
+	    "0\r\n"
+	    "X-Checksum: 1234\r\n"
+	    "\r\n";
+	    
+	for (merge = 0; merge <= 1; ++merge)
+	{
+		ssize_t result = HTTPMESSAGE_ERROR_INCOMPLETE;
+		httpmessage_headerfield *field;
+		httpmessage_headerfield *trailer;
+		size_t i;
+		
+		httpmessage_request_init(&request);
+		httpmessage_parser_init_request(&parser, &request,
+		                                merge ? HTTPMESSAGE_CONSUME_MERGE_TRAILER : 0);
+		                                
+		for (i = 1; i <= strlen(text) && result == HTTPMESSAGE_ERROR_INCOMPLETE; ++i)
+		{
+			result = httpmessage_parser_consume(&parser, text, i);
+		}
+		
+		field = httpmessage_headerfield_find(&request.message.field_list,
+		                                     "X-Checksum", 10);
+		trailer = (request.message.trailer_list
+		           ? httpmessage_headerfield_find(request.message.trailer_list,
+		                                          "X-Checksum", 10)
+		           : NULL);
+		           
+		if (result != (ssize_t)strlen(text)
+		        || request.message.trailer_merged != merge
+		        || !trailer
+		        || (merge ? (field != trailer) : (field != NULL))
+		        || (merge && httpmessage_stringview_compare_text(
+		                &field->value.line, "1234", 4) != 0))
+		{
+			fprintf(stderr, "%15.15s: merge %d: %d %s, merged %d\n", "TRAILER", merge,
+			        (int)result, httpmessage_result_get_text((int)result),
+			        request.message.trailer_merged);
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(&request, 0);
+	}
+	
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "incremental", test_incremental },
+		{ "relocation", test_relocation },
+		{ "until_close", test_until_close },
+		{ "errors", test_parser_errors },
+		{ "callbacks", test_callbacks },
+		{ "chunked", test_parser_chunked },
+		{ "trailer", test_parser_trailer }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
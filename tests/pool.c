@@ -0,0 +1,493 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	include <pthread.h>
+#	include <sched.h>
+#	define HTTPMESSAGE_TEST_THREADS 1
+#endif
+
+int test_pool(int argc, const char **argv);
+int test_pool_threads(int argc, const char **argv);
+int test_pool_cache(int argc, const char **argv);
+int test_pool_cache_threads(int argc, const char **argv);
+
+static const char *pool_test_text =
+    "GET /pool HTTP/1.1\r\n"
+    "Host: example.org\r\n"
+    "Accept: text/html,\r\n"
+    " application/xhtml+xml\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+int test_pool(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_pool *pool = httpmessage_pool_new(HTTPMESSAGE_TYPE_REQUEST, 4, 2, 2);
+	httpmessage_request *requests[3];
+	httpmessage_request *request;
+	httpmessage_budget budget;
+	size_t max_headerfield_count;
+	size_t max_line_per_value;
+	size_t a;
+	
+	httpmessage_budget_init(&budget, 4096, NULL);
+	
+	if (!pool)
+	{
+		fprintf(stderr, "%15.15s: failed\n", "NEW");
+		return ++exit_code;
+	}
+	
+	if (httpmessage_pool_acquire_response(pool))
+	{
+		fprintf(stderr, "%15.15s: response from a request pool\n", "TYPE");
+		++exit_code;
+	}
+	
+	for (a = 0; a < 3; ++a)
+	{
+		ssize_t result;
+		requests[a] = httpmessage_pool_acquire_request(pool);
+		
+		if (!requests[a])
+		{
+			fprintf(stderr, "%15.15s: failed\n", "ACQUIRE");
+			return ++exit_code;
+		}
+		
+		result = httpmessage_request_consume(requests[a],
+		                                     pool_test_text, strlen(pool_test_text),
+		                                     (HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION));
+		                                     
+		if (result != (ssize_t)strlen(pool_test_text))
+		{
+			fprintf(stderr, "%15.15s: %d %s\n", "RESULT",
+			        (int)result, httpmessage_result_get_text((int)result));
+			++exit_code;
+		}
+	}
+	
+	/* Third request does not fit in the pool and is freed */
+	for (a = 0; a < 3; ++a)
+	{
+		httpmessage_pool_release_request(pool, requests[a]);
+	}
+	
+	if (httpmessage_pool_count(pool) != 2)
+	{
+		fprintf(stderr, "%15.15s: %d, expect 2\n", "COUNT",
+		        (int)httpmessage_pool_count(pool));
+		++exit_code;
+	}
+	
+	/* Most recently released block first */
+	request = httpmessage_pool_acquire_request(pool);
+	
+	if (request != requests[1])
+	{
+		fprintf(stderr, "%15.15s: unexpected block\n", "LIFO");
+		++exit_code;
+	}
+	
+	if (request->method.text
+	        || httpmessage_headerfield_count(&request->message.field_list))
+	{
+		fprintf(stderr, "%15.15s: request not cleared\n", "CLEAR");
+		++exit_code;
+	}
+	
+	httpmessage_message_get_storage_infos(&max_headerfield_count,
+	                                      &max_line_per_value, &request->message);
+	                                      
+	if (max_headerfield_count != 4 || max_line_per_value != 2)
+	{
+		fprintf(stderr, "%15.15s: %d/%d, expect 4/2\n", "STORAGE",
+		        (int)max_headerfield_count, (int)max_line_per_value);
+		++exit_code;
+	}
+	
+	/* Memory kept for reuse goes back to the allocator it comes from */
+	request->message.allocator = &budget.allocator;
+	httpmessage_message_append_header_copy(&request->message, "X-Copy", "value",
+	                                       HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_pool_release_request(pool, request);
+	
+	if (budget.used != 0)
+	{
+		fprintf(stderr, "%15.15s: %d bytes still charged\n", "BUDGET",
+		        (int)budget.used);
+		++exit_code;
+	}
+	
+	request = httpmessage_pool_acquire_request(pool);
+	httpmessage_request_clear(request, 0);
+	httpmessage_pool_release_request(pool, request);
+	
+	if (httpmessage_pool_trim(pool, 1) != 1
+	        || httpmessage_pool_count(pool) != 1)
+	{
+		fprintf(stderr, "%15.15s: %d, expect 1\n", "TRIM",
+		        (int)httpmessage_pool_count(pool));
+		++exit_code;
+	}
+	
+	httpmessage_pool_free(&pool);
+	return exit_code;
+}
+
+#if defined(HTTPMESSAGE_TEST_THREADS)
+
+#define POOL_TEST_THREAD_COUNT 8
+#define POOL_TEST_ITERATIONS 20000
+
+typedef struct __pool_test_thread
+{
+	pthread_t thread;
+	httpmessage_pool *pool;
+	int error_count;
+	char marker;
+} pool_test_thread;
+
+static void *pool_test_thread_run(void *argument)
+{
+	pool_test_thread *context = (pool_test_thread *)argument;
+	int i;
+	
+	for (i = 0; i < POOL_TEST_ITERATIONS; ++i)
+	{
+		httpmessage_request *request = httpmessage_pool_acquire_request(context->pool);
+		
+		if (!request)
+		{
+			++context->error_count;
+			continue;
+		}
+		
+		/* A block handed out twice would be cleared or tagged by another thread */
+		if (request->method.text)
+		{
+			++context->error_count;
+		}
+		
+		request->method.text = &context->marker;
+		sched_yield();
+		
+		if (request->method.text != &context->marker)
+		{
+			++context->error_count;
+		}
+		
+		request->method.text = NULL;
+		httpmessage_pool_release_request(context->pool, request);
+	}
+	
+	return NULL;
+}
+
+#endif
+
+int test_pool_threads(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+#if defined(HTTPMESSAGE_TEST_THREADS)
+	pool_test_thread threads[POOL_TEST_THREAD_COUNT];
+	httpmessage_pool *pool = httpmessage_pool_new(HTTPMESSAGE_TYPE_REQUEST, 8, 2, 4);
+	int t;
+	
+	if (!pool)
+	{
+		return ++exit_code;
+	}
+	
+	for (t = 0; t < POOL_TEST_THREAD_COUNT; ++t)
+	{
+		threads[t].pool = pool;
+		threads[t].error_count = 0;
+		
+		if (pthread_create(&threads[t].thread, NULL, pool_test_thread_run, &threads[t]) != 0)
+		{
+			fprintf(stderr, "%15.15s: %s\n", "THREAD", strerror(errno));
+			return ++exit_code;
+		}
+	}
+	
+	for (t = 0; t < POOL_TEST_THREAD_COUNT; ++t)
+	{
+		pthread_join(threads[t].thread, NULL);
+		
+		if (threads[t].error_count)
+		{
+			fprintf(stderr, "%15.15s: thread %d, %d errors\n", "SHARED",
+			        t, threads[t].error_count);
+			++exit_code;
+		}
+	}
+	
+	if (httpmessage_pool_count(pool) > pool->capacity)
+	{
+		fprintf(stderr, "%15.15s: %d, expect at most %d\n", "COUNT",
+		        (int)httpmessage_pool_count(pool), (int)pool->capacity);
+		++exit_code;
+	}
+	
+	fprintf(stdout, "%15.15s: %d\n", "COUNT", (int)httpmessage_pool_count(pool));
+	httpmessage_pool_free(&pool);
+#else
+	fprintf(stdout, "Thread support not available\n");
+#endif
+	return exit_code;
+}
+
+int test_pool_cache(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_pool *pool = httpmessage_pool_new(HTTPMESSAGE_TYPE_RESPONSE, 4, 1, 64);
+	httpmessage_pool_cache cache;
+	httpmessage_response *responses[HTTPMESSAGE_POOL_CACHE_SIZE + 4];
+	httpmessage_response *response;
+	httpmessage_request *request;
+	size_t a;
+	
+	if (!pool)
+	{
+		return ++exit_code;
+	}
+	
+	httpmessage_pool_cache_init(&cache, pool);
+	
+	if (httpmessage_pool_cache_acquire_request(&cache))
+	{
+		fprintf(stderr, "%15.15s: request from a response cache\n", "TYPE");
+		++exit_code;
+	}
+	
+	for (a = 0; a < (HTTPMESSAGE_POOL_CACHE_SIZE + 4); ++a)
+	{
+		responses[a] = httpmessage_pool_cache_acquire_response(&cache);
+		
+		if (!responses[a])
+		{
+			fprintf(stderr, "%15.15s: failed\n", "ACQUIRE");
+			return ++exit_code;
+		}
+	}
+	
+	/* Overflowing the cache moves the oldest batch to the pool */
+	for (a = 0; a < (HTTPMESSAGE_POOL_CACHE_SIZE + 4); ++a)
+	{
+		httpmessage_pool_cache_release_response(&cache, responses[a]);
+	}
+	
+	if (cache.count != (4 + HTTPMESSAGE_POOL_CACHE_BATCH_SIZE)
+	        || httpmessage_pool_count(pool) != HTTPMESSAGE_POOL_CACHE_BATCH_SIZE)
+	{
+		fprintf(stderr, "%15.15s: cache %d, pool %d\n", "RELEASE",
+		        (int)cache.count, (int)httpmessage_pool_count(pool));
+		++exit_code;
+	}
+	
+	response = httpmessage_pool_cache_acquire_response(&cache);
+	
+	if (response != responses[HTTPMESSAGE_POOL_CACHE_SIZE + 3])
+	{
+		fprintf(stderr, "%15.15s: unexpected block\n", "LIFO");
+		++exit_code;
+	}
+	
+	/* Blocks released by other threads are collected on the next acquisition */
+	httpmessage_pool_cache_remote_release_response(&cache, response);
+	response = httpmessage_pool_cache_acquire_response(&cache);
+	
+	if (cache.remote_free_list
+	        || response != responses[HTTPMESSAGE_POOL_CACHE_SIZE + 3])
+	{
+		fprintf(stderr, "%15.15s: remote free list not collected\n", "REMOTE");
+		++exit_code;
+	}
+	
+	httpmessage_pool_cache_release_response(&cache, response);
+	
+	/* A request given to a response cache is freed with its overflow nodes */
+	request = httpmessage_request_storage_new(1, 1);
+	httpmessage_request_consume(request, pool_test_text, strlen(pool_test_text),
+	                            HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_pool_cache_release_request(&cache, request);
+	request = httpmessage_request_storage_new(1, 1);
+	httpmessage_request_consume(request, pool_test_text, strlen(pool_test_text),
+	                            HTTPMESSAGE_CLEAR_NO_FREE);
+	httpmessage_pool_cache_remote_release_request(&cache, request);
+	
+	httpmessage_pool_cache_flush(&cache);
+	
+	if (cache.count != 0
+	        || httpmessage_pool_count(pool) != (HTTPMESSAGE_POOL_CACHE_SIZE + 4))
+	{
+		fprintf(stderr, "%15.15s: cache %d, pool %d\n", "FLUSH",
+		        (int)cache.count, (int)httpmessage_pool_count(pool));
+		++exit_code;
+	}
+	
+	httpmessage_pool_free(&pool);
+	return exit_code;
+}
+
+#if defined(HTTPMESSAGE_TEST_THREADS)
+
+#define POOL_CACHE_TEST_BLOCKS 64
+
+typedef struct __pool_cache_test_thread
+{
+	pthread_t thread;
+	httpmessage_pool_cache *owner;
+	httpmessage_request **requests;
+	size_t count;
+} pool_cache_test_thread;
+
+static void *pool_cache_test_thread_run(void *argument)
+{
+	pool_cache_test_thread *context = (pool_cache_test_thread *)argument;
+	size_t a;
+	
+	for (a = 0; a < context->count; ++a)
+	{
+		httpmessage_pool_cache_remote_release_request(context->owner,
+		        context->requests[a]);
+	}
+	
+	return NULL;
+}
+
+#endif
+
+int test_pool_cache_threads(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+#if defined(HTTPMESSAGE_TEST_THREADS)
+	pool_cache_test_thread threads[POOL_TEST_THREAD_COUNT];
+	httpmessage_request *requests[POOL_CACHE_TEST_BLOCKS];
+	httpmessage_pool *pool = httpmessage_pool_new(HTTPMESSAGE_TYPE_REQUEST, 8, 2,
+	                         POOL_CACHE_TEST_BLOCKS);
+	httpmessage_pool_cache cache;
+	size_t per_thread = POOL_CACHE_TEST_BLOCKS / POOL_TEST_THREAD_COUNT;
+	int pass;
+	
+	if (!pool)
+	{
+		return ++exit_code;
+	}
+	
+	httpmessage_pool_cache_init(&cache, pool);
+	
+	for (pass = 0; pass < 100; ++pass)
+	{
+		size_t a;
+		int t;
+		
+		/* Parsed here, released by workers */
+		for (a = 0; a < POOL_CACHE_TEST_BLOCKS; ++a)
+		{
+			httpmessage_request *request = httpmessage_pool_cache_acquire_request(&cache);
+			
+			if (pass && request)
+			{
+				size_t b;
+				
+				for (b = 0; b < POOL_CACHE_TEST_BLOCKS; ++b)
+				{
+					if (requests[b] == request)
+					{
+						break;
+					}
+				}
+				
+				/* Blocks of the previous pass not acquired again yet are kept from index a */
+				if (b == POOL_CACHE_TEST_BLOCKS || b < a)
+				{
+					fprintf(stderr, "%15.15s: pass %d, unknown block\n", "REUSE", pass);
+					++exit_code;
+				}
+				
+				requests[b] = requests[a];
+			}
+			
+			requests[a] = request;
+			
+			if (!request
+			        || httpmessage_request_consume(request,
+			                                       pool_test_text, strlen(pool_test_text),
+			                                       (HTTPMESSAGE_CLEAR_NO_FREE | HTTPMESSAGE_NO_ALLOCATION)) <= 0)
+			{
+				fprintf(stderr, "%15.15s: pass %d\n", "ACQUIRE", pass);
+				return ++exit_code;
+			}
+		}
+		
+		for (t = 0; t < POOL_TEST_THREAD_COUNT; ++t)
+		{
+			threads[t].owner = &cache;
+			threads[t].requests = requests + (per_thread * (size_t)t);
+			threads[t].count = per_thread;
+			
+			if (pthread_create(&threads[t].thread, NULL, pool_cache_test_thread_run, &threads[t]) != 0)
+			{
+				fprintf(stderr, "%15.15s: %s\n", "THREAD", strerror(errno));
+				return ++exit_code;
+			}
+		}
+		
+		for (t = 0; t < POOL_TEST_THREAD_COUNT; ++t)
+		{
+			pthread_join(threads[t].thread, NULL);
+		}
+	}
+	
+	httpmessage_pool_cache_flush(&cache);
+	
+	if (httpmessage_pool_count(pool) != POOL_CACHE_TEST_BLOCKS)
+	{
+		fprintf(stderr, "%15.15s: %d, expect %d\n", "COUNT",
+		        (int)httpmessage_pool_count(pool), POOL_CACHE_TEST_BLOCKS);
+		++exit_code;
+	}
+	
+	httpmessage_pool_free(&pool);
+#else
+	fprintf(stdout, "Thread support not available\n");
+#endif
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "pool", test_pool },
+		{ "pool_threads", test_pool_threads },
+		{ "pool_cache", test_pool_cache },
+		{ "pool_cache_threads", test_pool_cache_threads }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}
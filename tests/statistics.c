@@ -0,0 +1,236 @@
+/**************************************************************************************$
+ * httpmessage
+ ***************************************************************************************
+ * Copyright © 2022 by Renaud Guillard (dev@nore.fr)
+ * Distributed under the terms of the MIT License, see LICENSE
+ ***************************************************************************************
+ */
+
+#include "httpmessage/httpmessage.h"
+#include "shared.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+int test_histogram(int argc, const char **argv);
+int test_statistics(int argc, const char **argv);
+
+typedef struct __percentile_test
+{
+	double percentile;
+	size_t value;
+} percentile_test;
+
+int test_histogram(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_histogram histogram;
+	httpmessage_histogram other;
+	size_t a;
+	
+	static const percentile_test tests[] =
+	{
+		{ 1.0, 9 },
+		{ 50.0, 49 },
+		{ 90.0, 89 },
+		{ 99.0, 99 },
+		{ 100.0, 1000 }
+	};
+	
+	httpmessage_histogram_init(&histogram, 10);
+	httpmessage_histogram_init(&other, 10);
+	
+	if (httpmessage_histogram_percentile(&histogram, 50.0) != 0)
+	{
+		fprintf(stderr, "%15.15s: empty histogram\n", "PERCENTILE");
+		++exit_code;
+	}
+	
+	/* 0..98 then one large value in the overflow bucket */
+	for (a = 0; a < 99; ++a)
+	{
+		httpmessage_histogram_add(((a % 2) ? &histogram : &other), a);
+	}
+	
+	httpmessage_histogram_add(&histogram, 1000);
+	
+	if (httpmessage_histogram_merge(&histogram, &other) != HTTPMESSAGE_OK
+	        || histogram.sample_count != 100
+	        || histogram.maximum != 1000)
+	{
+		fprintf(stderr, "%15.15s: %d samples, max %d\n", "MERGE",
+		        (int)histogram.sample_count, (int)histogram.maximum);
+		++exit_code;
+	}
+	
+	for (a = 0; a < (sizeof(tests) / sizeof(percentile_test)); ++a)
+	{
+		const percentile_test *T = &tests[a];
+		size_t value = httpmessage_histogram_percentile(&histogram, T->percentile);
+		
+		fprintf(stdout, "%15.15s: p%g = %d\n", "PERCENTILE",
+		        T->percentile, (int)value);
+		        
+		if (value != T->value)
+		{
+			fprintf(stderr, "%15.15s: p%g = %d, expect %d\n", "PERCENTILE",
+			        T->percentile, (int)value, (int)T->value);
+			++exit_code;
+		}
+	}
+	
+	httpmessage_histogram_init(&other, 1);
+	
+	if (httpmessage_histogram_merge(&histogram, &other) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		fprintf(stderr, "%15.15s: bucket width mismatch accepted\n", "MERGE");
+		++exit_code;
+	}
+	
+	return exit_code;
+}
+
+typedef struct __storage_parameters_test
+{
+	double percentile;
+	size_t max_headerfield_count;
+	size_t max_line_per_value;
+} storage_parameters_test;
+
+int test_statistics(int argc, const char **argv)
+{
+	(void) argc;
+	(void) argv;
+	int exit_code = EXIT_SUCCESS;
+	httpmessage_statistics statistics;
+	size_t max_headerfield_count = 0;
+	size_t max_line_per_value = 0;
+	size_t a;
+	
+	static const char *files[] =
+	{
+		"tests/data/get-hello.request",
+		"tests/data/get-lucky.request",
+		"tests/data/get-slash.response",
+		"tests/data/head-slash.response"
+	};
+	
+	static const storage_parameters_test tests[] =
+	{
+		{ 50.0, 3, 1 },
+		{ 75.0, 4, 1 },
+		{ 100.0, 5, 2 }
+	};
+	
+	httpmessage_statistics_init(&statistics);
+	
+	if (httpmessage_statistics_get_storage_parameters(&max_headerfield_count,
+	        &max_line_per_value, &statistics, 100.0) != HTTPMESSAGE_ERROR_INVALID_ARGUMENT)
+	{
+		fprintf(stderr, "%15.15s: no message recorded\n", "PARAMETERS");
+		++exit_code;
+	}
+	
+	for (a = 0; a < (sizeof(files) / sizeof(const char *)); ++a)
+	{
+		char text[4096];
+		size_t text_length;
+		ssize_t result;
+		httpmessage_request request;
+		httpmessage_response response;
+		const httpmessage_message *message;
+		FILE *file = fopen(files[a], "rb");
+		
+		/* Expected values are computed from all files */
+		if (!file)
+		{
+			fprintf(stderr, "%15.15s: %s not found\n", "DATA", files[a]);
+			return ++exit_code;
+		}
+		
+		text_length = fread(text, 1, sizeof(text), file);
+		fclose(file);
+		
+		httpmessage_request_init(&request);
+		httpmessage_response_init(&response);
+		
+		if (httpmessage_message_get_type(text, text_length, 0) == HTTPMESSAGE_TYPE_REQUEST)
+		{
+			result = httpmessage_request_consume(&request, text, text_length, 0);
+			message = &request.message;
+		}
+		else
+		{
+			result = httpmessage_response_consume(&response, text, text_length, 0);
+			message = &response.message;
+		}
+		
+		if (result <= 0
+		        || httpmessage_statistics_add_message(&statistics, message,
+		                text, (size_t)result) != HTTPMESSAGE_OK)
+		{
+			fprintf(stderr, "%15.15s: %s %d\n", "RESULT", files[a], (int)result);
+			++exit_code;
+		}
+		
+		httpmessage_request_clear(&request, 0);
+		httpmessage_response_clear(&response, 0);
+	}
+	
+	if (statistics.first_line_length.maximum != 26
+	        || statistics.header_size.maximum != 182)
+	{
+		fprintf(stderr, "%15.15s: first line %d, header %d, expect 26, 182\n", "SIZES",
+		        (int)statistics.first_line_length.maximum,
+		        (int)statistics.header_size.maximum);
+		++exit_code;
+	}
+	
+	for (a = 0; a < (sizeof(tests) / sizeof(storage_parameters_test)); ++a)
+	{
+		const storage_parameters_test *T = &tests[a];
+		int result;
+		max_headerfield_count = max_line_per_value = 0;
+		result = httpmessage_statistics_get_storage_parameters(
+		             &max_headerfield_count, &max_line_per_value,
+		             &statistics, T->percentile);
+		             
+		if (result != HTTPMESSAGE_OK)
+		{
+			fprintf(stderr, "%15.15s: p%g: %d %s\n", "PARAMETERS",
+			        T->percentile, result, httpmessage_result_get_text(result));
+			++exit_code;
+			continue;
+		}
+		
+		fprintf(stdout, "%15.15s: p%g = %d/%d\n", "PARAMETERS",
+		        T->percentile, (int)max_headerfield_count, (int)max_line_per_value);
+		        
+		if (max_headerfield_count != T->max_headerfield_count
+		        || max_line_per_value != T->max_line_per_value)
+		{
+			fprintf(stderr, "%15.15s: p%g = %d/%d, expect %d/%d\n", "PARAMETERS",
+			        T->percentile,
+			        (int)max_headerfield_count, (int)max_line_per_value,
+			        (int)T->max_headerfield_count, (int)T->max_line_per_value);
+			++exit_code;
+		}
+	}
+	
+	return exit_code;
+}
+
+int main(int argc, const char **argv)
+{
+	static const httpmessage_test tests[] =
+	{
+		{ "histogram", test_histogram },
+		{ "statistics", test_statistics }
+	};
+	
+	return run_tests(tests, sizeof(tests) / sizeof(httpmessage_test),
+	                 argc, argv);
+}